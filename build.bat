@@ -13,6 +13,10 @@ where /q cl || (
 :: --- Prepare arguments ----------------------------------------------------
 set "release=0"
 set "asan=0"
+set "render_cli=0"
+set "avx2=0"
+set "morton=0"
+set "bricks=0"
 for %%a in (%*) do set "%%a=1"
 
 :: --- Prepare build directory ---------------------------------------------
@@ -37,6 +41,13 @@ if "%release%"=="1" (
 set exe_name=editor.exe
 
 set cl_build_flags=/DR_BACKEND_GL=1 /DBUILD_CLI=0 /DBUILD_DEBUG=%debug%
+
+if "%render_cli%"=="1" (
+  set exe_name=vox_render.exe
+  set cl_build_flags=/DBUILD_CLI=1 /DBUILD_HEADLESS=1 /DBUILD_DEBUG=%debug%
+  echo [render cli]
+)
+
 set cl_warning_flags=/D_CRT_SECURE_NO_WARNINGS /wd4201 /wd4456 /wd4505 /W4
 set cl_common=/Fe:%exe_name% /nologo /FC /Zi /diagnostics:caret /std:c++17 
 
@@ -45,6 +56,21 @@ if "%asan%"=="1" (
   echo [asan enabled]
 )
 
+:: AVX2 ray packets and BMI2 Morton codes
+if "%avx2%"=="1" (
+  set cl_optimize_flags=%cl_optimize_flags% /arch:AVX2
+  echo [avx2]
+)
+
+:: Chunk voxel layout (see VOX_CHUNK_LAYOUT in src\voxel\voxel_core.h)
+if "%morton%"=="1" (
+  set cl_build_flags=%cl_build_flags% /DVOX_CHUNK_LAYOUT=1
+  echo [morton layout]
+) else if "%bricks%"=="1" (
+  set cl_build_flags=%cl_build_flags% /DVOX_CHUNK_LAYOUT=2
+  echo [bricks layout]
+)
+
 set compiler_flags=%cl_common% %cl_optimize_flags% %cl_build_flags% %cl_warning_flags%
 
 :: --- Includes -----------------------------------------------------------
@@ -61,7 +87,11 @@ set linker_flags=/link %freetype%\build\freetype.lib /ignore:4099 /INCREMENTAL:n
 
 :: --- Build targets ------------------------------------------------------
 set targets=
-set targets=%targets% %root%\src\main.cpp
+if "%render_cli%"=="1" (
+  set targets=%targets% %root%\src\vox_render_cli.cpp
+) else (
+  set targets=%targets% %root%\src\main.cpp
+)
 
 :: --- Compile and link the program  --------------------------------------
 pushd %root%\build
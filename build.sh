@@ -0,0 +1,75 @@
+#!/bin/sh
+set -e
+
+# --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- #
+# Note: This script assumes that it will be called from project's root directory. #
+# Only the headless render CLI and the editor undo test build on Linux.           #
+# --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- #
+
+# --- Prepare arguments ----------------------------------------------------
+release=0
+asan=0
+avx2=0
+morton=0
+bricks=0
+editor_test=0
+for arg in "$@"; do eval "$arg=1"; done
+
+# --- Prepare build directory ---------------------------------------------
+root=$(pwd)
+mkdir -p "$root/build"
+
+# --- Determine build configuration ---------------------------------------
+if [ "$release" = "1" ]; then
+  debug=0
+  optimize_flags="-O2"
+  echo "[release]"
+else
+  debug=1
+  optimize_flags="-O0"
+  echo "[debug]"
+fi
+
+# --- Compiler flags -----------------------------------------------------
+exe_name=vox_render
+main_file=vox_render_cli.cpp
+build_flags="-DBUILD_CLI=1 -DBUILD_HEADLESS=1 -DBUILD_DEBUG=$debug"
+warning_flags="-Wall -Wno-unused-function -Wno-unused-variable -Wno-missing-braces"
+common="-g -std=c++17"
+
+if [ "$asan" = "1" ]; then
+  common="$common -fsanitize=address"
+  echo "[asan enabled]"
+fi
+
+# SSE4.1 ray packets by default, as MSVC builds get them; AVX2 ray packets and
+# BMI2 Morton codes on request
+optimize_flags="$optimize_flags -msse4.1"
+if [ "$avx2" = "1" ]; then
+  optimize_flags="$optimize_flags -mavx2 -mbmi2"
+  echo "[avx2]"
+fi
+
+# Chunk voxel layout (see VOX_CHUNK_LAYOUT in src/voxel/voxel_core.h)
+if [ "$morton" = "1" ]; then
+  build_flags="$build_flags -DVOX_CHUNK_LAYOUT=1"
+  echo "[morton layout]"
+elif [ "$bricks" = "1" ]; then
+  build_flags="$build_flags -DVOX_CHUNK_LAYOUT=2"
+  echo "[bricks layout]"
+fi
+
+# Standalone test of the editor's undo ring (see src/editor_undo_test.cpp)
+if [ "$editor_test" = "1" ]; then
+  exe_name=editor_undo_test
+  main_file=editor_undo_test.cpp
+  warning_flags="$warning_flags -Wno-switch -Wno-write-strings -Wno-sign-compare"
+  echo "[editor undo test]"
+fi
+
+# --- Includes -----------------------------------------------------------
+includes="-I$root/src -I$root/src/third_party/stb"
+
+# --- Compile and link the program  --------------------------------------
+cd "$root/build"
+c++ -o $exe_name $common $optimize_flags $build_flags $warning_flags $includes "$root/src/$main_file" -lpthread -lm
@@ -1,50 +1,236 @@
-function void
-async_thread_proc(void *param)
+//
+// Chase-Lev deque
+//
+
+// NOTE: Indices are free-running U32s; differences are taken as S32 so that
+// wrap-around is harmless.
+
+function B32
+async_deque_push(ASYNC_Deque *deque, ASYNC_Job *job)
 {
-  (void *)param;
+  B32 result = 0;
   
-  ASYNC_Context *ctx = async_ctx;
+  U32 b = deque->bottom;
+  U32 t = deque->top;
+  if ((S32)(b - t) < ASYNC_DEQUE_CAP) {
+    deque->jobs[b & (ASYNC_DEQUE_CAP - 1)] = *job;
+    os_memory_barrier();
+    deque->bottom = b + 1;
+    result = 1;
+  }
   
-  for (;;) {
-    U32 queue_max = ctx->queue_max;
-    U32 write = ctx->next_write;
-    U32 read = ctx->next_read;
+  return result;
+}
+
+function B32
+async_deque_pop(ASYNC_Deque *deque, ASYNC_Job *job)
+{
+  B32 result = 0;
+  
+  U32 b = deque->bottom - 1;
+  deque->bottom = b;
+  os_memory_barrier();
+  U32 t = deque->top;
+  
+  if ((S32)(b - t) >= 0) {
+    *job = deque->jobs[b & (ASYNC_DEQUE_CAP - 1)];
+    result = 1;
     
-    if (read != write) {
-      U32 next_read = read + 1;
-      U32 latest_read = os_interlocked_compare_exchange_32(&ctx->next_read, next_read, read);
-      
-      if (latest_read == read) {
-        ASYNC_Job *job = &ctx->queue[latest_read % queue_max];
-        job->proc(job->data);
-        
-        os_interlocked_increment_32(&ctx->queue_count);
+    // Last job: race thieves for it
+    if (b == t) {
+      if (os_interlocked_compare_exchange_32(&deque->top, t + 1, t) != t) {
+        result = 0;
       }
+      deque->bottom = b + 1;
     }
-    else {
-      B32 signaled = os_semaphore_wait(ctx->semaphore, OS_WAIT_INFINITE); 
-      if (!signaled) {
+  }
+  else {
+    deque->bottom = b + 1;
+  }
+  
+  return result;
+}
+
+function B32
+async_deque_steal(ASYNC_Deque *deque, ASYNC_Job *job)
+{
+  B32 result = 0;
+  
+  U32 t = deque->top;
+  os_memory_barrier();
+  U32 b = deque->bottom;
+  
+  if ((S32)(b - t) > 0) {
+    *job = deque->jobs[t & (ASYNC_DEQUE_CAP - 1)];
+    if (os_interlocked_compare_exchange_32(&deque->top, t + 1, t) == t) {
+      result = 1;
+    }
+  }
+  
+  return result;
+}
+
+//
+// Injection queue
+//
+
+function B32
+async_inject_push(ASYNC_Context *ctx, ASYNC_Job *job)
+{
+  B32 result = 0;
+  
+  U32 pos = ctx->inject_write;
+  for (;;) {
+    ASYNC_InjectCell *cell = &ctx->inject[pos & (ASYNC_INJECT_CAP - 1)];
+    S32 diff = (S32)(cell->sequence - pos);
+    if (diff == 0) {
+      if (os_interlocked_compare_exchange_32(&ctx->inject_write, pos + 1, pos) == pos) {
+        cell->job = *job;
+        os_memory_barrier();
+        cell->sequence = pos + 1;
+        result = 1;
+        break;
+      }
+    }
+    else if (diff < 0) {
+      break; // Full
+    }
+    pos = ctx->inject_write;
+  }
+  
+  return result;
+}
+
+function B32
+async_inject_pop(ASYNC_Context *ctx, ASYNC_Job *job)
+{
+  B32 result = 0;
+  
+  U32 pos = ctx->inject_read;
+  for (;;) {
+    ASYNC_InjectCell *cell = &ctx->inject[pos & (ASYNC_INJECT_CAP - 1)];
+    S32 diff = (S32)(cell->sequence - (pos + 1));
+    if (diff == 0) {
+      if (os_interlocked_compare_exchange_32(&ctx->inject_read, pos + 1, pos) == pos) {
+        *job = cell->job;
+        os_memory_barrier();
+        cell->sequence = pos + ASYNC_INJECT_CAP;
+        result = 1;
         break;
       }
     }
+    else if (diff < 0) {
+      break; // Empty
+    }
+    pos = ctx->inject_read;
   }
+  
+  return result;
 }
 
+//
+// Scheduler
+//
+
 function void
-async_init(U32 threads_count, U32 queue_max) 
+async_job_run(ASYNC_Job *job)
+{
+  job->proc(job->data);
+  if (job->counter) {
+    os_interlocked_decrement_32(&job->counter->count);
+  }
+}
+
+// Finds a job for the calling thread: its own deque first, then the shared
+// queue, then the other workers' deques.
+function B32
+async_job_find(ASYNC_Context *ctx, ASYNC_Worker *self, ASYNC_Job *job)
+{
+  B32 result = 0;
+  
+  if (self) {
+    result = async_deque_pop(&self->deque, job);
+  }
+  
+  if (!result) {
+    result = async_inject_pop(ctx, job);
+  }
+  
+  if (!result) {
+    U32 start = 0;
+    if (self) {
+      self->rng ^= self->rng << 13;
+      self->rng ^= self->rng >> 17;
+      self->rng ^= self->rng << 5;
+      start = self->rng;
+    }
+    for (U32 idx = 0; idx < ctx->workers_count && !result; idx += 1) {
+      ASYNC_Worker *victim = &ctx->workers[(start + idx) % ctx->workers_count];
+      if (victim != self) {
+        result = async_deque_steal(&victim->deque, job);
+      }
+    }
+  }
+  
+  return result;
+}
+
+function B32
+async_run_one(void)
+{
+  B32 result = 0;
+  if (async_ctx) {
+    ASYNC_Job job = {0};
+    result = async_job_find(async_ctx, async_worker, &job);
+    if (result) {
+      async_job_run(&job);
+    }
+  }
+  return result;
+}
+
+function void
+async_thread_proc(void *param)
+{
+  ASYNC_Context *ctx = async_ctx;
+  async_worker = (ASYNC_Worker *)param;
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  prof_thread_set_name(str8_pushf(scratch.arena, (char *)"worker %u", async_worker->idx));
+  arena_scratch_end(scratch);
+  
+  while (!ctx->stop) {
+    if (!async_run_one()) {
+      os_semaphore_wait(ctx->semaphore, OS_WAIT_INFINITE);
+    }
+  }
+}
+
+function void
+async_init(U32 threads_count)
 {
   Arena *arena = arena_alloc_default();
   async_ctx = ArenaPushStruct(arena, ASYNC_Context);
   async_ctx->arena = arena;
   
-  async_ctx->queue = ArenaPushArray(arena, ASYNC_Job, queue_max);
-  async_ctx->queue_max = queue_max;
+  async_ctx->workers_count = threads_count + 1;
+  async_ctx->workers = ArenaPushArray(arena, ASYNC_Worker, async_ctx->workers_count);
+  for (U32 idx = 0; idx < async_ctx->workers_count; idx += 1) {
+    async_ctx->workers[idx].idx = idx;
+    async_ctx->workers[idx].rng = 0x9E3779B9u*(idx + 1);
+  }
+  async_worker = &async_ctx->workers[0];
   
-  async_ctx->semaphore = os_semaphore_create(0, threads_count);
+  async_ctx->inject = ArenaPushArray(arena, ASYNC_InjectCell, ASYNC_INJECT_CAP);
+  for (U32 idx = 0; idx < ASYNC_INJECT_CAP; idx += 1) {
+    async_ctx->inject[idx].sequence = idx;
+  }
+  
+  async_ctx->semaphore = os_semaphore_create(0, Max(threads_count, 1));
   
   OS_Handle *threads = ArenaPushArray(arena, OS_Handle, threads_count);
   for (U32 idx = 0; idx < threads_count; idx += 1) {
-    threads[idx] = os_thread_launch(async_thread_proc, 0, 0);
+    threads[idx] = os_thread_launch(async_thread_proc, &async_ctx->workers[idx + 1], 0);
   }
   async_ctx->threads = threads;
   async_ctx->threads_count = threads_count;
@@ -53,34 +239,81 @@ async_init(U32 threads_count, U32 queue_max)
 function void
 async_release(void)
 {
-  U32 threads_count = async_ctx->threads_count;
-  OS_Handle *threads = async_ctx->threads;
-  for (U32 idx = 0; idx < threads_count; idx += 1) {
-    os_thread_delete(threads[idx]);
+  ASYNC_Context *ctx = async_ctx;
+  
+  // Finish whatever was submitted before stopping the workers
+  while (async_run_one()) {}
+  
+  ctx->stop = 1;
+  for (U32 idx = 0; idx < ctx->threads_count; idx += 1) {
+    os_semaphore_post(ctx->semaphore);
+  }
+  for (U32 idx = 0; idx < ctx->threads_count; idx += 1) {
+    os_thread_join(ctx->threads[idx], OS_WAIT_INFINITE);
+    os_thread_delete(ctx->threads[idx]);
   }
-  os_semaphore_delete(async_ctx->semaphore);
   
-  arena_release(async_ctx->arena);
+  // Jobs that workers pushed to their own deques while running one, after the
+  // loop above came up empty, are still queued. With the workers gone, stealing
+  // them can't fail, so this runs every job left.
+  while (async_run_one()) {}
+  os_semaphore_delete(ctx->semaphore);
+  
+  async_worker = 0;
+  async_ctx = 0;
+  arena_release(ctx->arena);
 }
 
-// TODO: Should copy data to job's data (which should be a static array with a good size limit in that case); this is 
-// where size parameter would come in handy.
-function void 
-async_job_push(ASYNC_JobProc *proc, void *data, U64 size)
+function void
+async_job_push(ASYNC_JobProc *proc, void *data, ASYNC_Counter *counter)
 {
   ASYNC_Context *ctx = async_ctx;
   
-  U32 queue_max = ctx->queue_max;
-  U32 write = ctx->next_write;
-  U32 next_write = write + 1;
+  ASYNC_Job job = {0};
+  job.proc = proc;
+  job.data = data;
+  job.counter = counter;
   
-  ASYNC_Job *job = &ctx->queue[write % queue_max];
-  job->proc = proc;
-  job->data = data; 
-  job->size = size;
+  if (counter) {
+    os_interlocked_increment_32(&counter->count);
+  }
   
-  ctx->next_write = next_write;
-  os_interlocked_increment_32(&ctx->queue_count);
+  // Without an initialized async layer, jobs run on the calling thread
+  B32 queued = 0;
+  if (ctx && async_worker) {
+    queued = async_deque_push(&async_worker->deque, &job);
+  }
+  else if (ctx) {
+    queued = async_inject_push(ctx, &job);
+  }
   
-  os_semaphore_post(ctx->semaphore);
-}
\ No newline at end of file
+  if (queued) {
+    os_semaphore_post(ctx->semaphore);
+  }
+  else {
+    async_job_run(&job);
+  }
+}
+
+// With nothing left to run, the jobs still counted are running on other threads.
+// Where workers would sleep on the semaphore, a waiter backs off instead: pauses,
+// twice as many each round, then yields its time slice to them.
+function void
+async_wait(ASYNC_Counter *counter)
+{
+  U32 spins = 1;
+  while (counter->count != 0) {
+    if (async_run_one()) {
+      spins = 1;
+    }
+    else if (spins <= ASYNC_WAIT_SPINS) {
+      for (U32 idx = 0; idx < spins; idx += 1) {
+        os_cpu_pause();
+      }
+      spins *= 2;
+    }
+    else {
+      os_thread_yield();
+    }
+  }
+}
@@ -1,18 +1,48 @@
 #pragma once
 
-// TODO: It might be a good idea to give each job an input and output buffer 
-// rather than a single input buffer (`data`); right now you have to save the
-// output to some global data structure that is accessible by both the job and
-// the main thread.
+// NOTE: Work-stealing job system. Every worker thread, and the thread that calls
+// async_init (worker 0), owns a Chase-Lev deque: the owner pushes and pops at the
+// bottom, other workers steal from the top. Threads that aren't workers submit
+// through a shared bounded multi-producer queue instead. Idle workers sleep on a
+// semaphore that is posted on every push.
+//
+// Jobs can't return values directly; a job writes its results through `data` and
+// the submitter reads them after waiting on the job's counter. Waiting threads
+// run pending jobs instead of blocking.
 
-// TODO: Make sure threads are stopped gracefully when releasing the async layer.
+#define ASYNC_DEQUE_CAP  4096 // Per worker, power of two
+#define ASYNC_INJECT_CAP 4096 // Shared queue for non-worker threads, power of two
+#define ASYNC_WAIT_SPINS 64   // Most pauses in a row before a waiter yields its time slice
 
 typedef void ASYNC_JobProc(void *);
 
+// Number of submitted jobs that haven't finished yet. Zero-initialize, pass to
+// async_job_push, then async_wait on it.
+struct ASYNC_Counter {
+  volatile U32 count;
+};
+
 struct ASYNC_Job {
   ASYNC_JobProc *proc;
   void *data;
-  U64 size;
+  ASYNC_Counter *counter;
+};
+
+struct ASYNC_Deque {
+  volatile U32 top;    // Next job to steal
+  volatile U32 bottom; // Next free slot for the owner
+  ASYNC_Job jobs[ASYNC_DEQUE_CAP];
+};
+
+struct ASYNC_InjectCell {
+  volatile U32 sequence;
+  ASYNC_Job job;
+};
+
+struct ASYNC_Worker {
+  U32 idx;
+  U32 rng; // Victim selection when stealing
+  ASYNC_Deque deque;
 };
 
 struct ASYNC_Context {
@@ -22,17 +52,37 @@ struct ASYNC_Context {
   OS_Handle *threads;
   U32 threads_count;
   
-  ASYNC_Job *queue;
-  U32 queue_max;
-  volatile U32 queue_count;
-  volatile U32 next_read;
-  volatile U32 next_write;
+  // workers[0] belongs to the thread that called async_init; workers[1..] to
+  // the launched threads.
+  ASYNC_Worker *workers;
+  U32 workers_count;
+  
+  ASYNC_InjectCell *inject;
+  volatile U32 inject_write;
+  volatile U32 inject_read;
+  
+  volatile U32 stop;
 };
 
 global ASYNC_Context *async_ctx;
+threadlocal ASYNC_Worker *async_worker;
 
 function void async_thread_proc(void *param);
 
-function void async_init(U32 thread_count, U32 queue_max);
+function void async_init(U32 threads_count);
 function void async_release(void);
-function void async_job_push(ASYNC_JobProc *proc, void *data, U64 size); 
\ No newline at end of file
+
+// Safe to call from any thread. Runs the job immediately when the queues are full
+// or the async layer isn't initialized.
+function void async_job_push(ASYNC_JobProc *proc, void *data, ASYNC_Counter *counter);
+function B32 async_run_one(void);
+function void async_wait(ASYNC_Counter *counter);
+
+// Chase-Lev deque
+function B32 async_deque_push(ASYNC_Deque *deque, ASYNC_Job *job);
+function B32 async_deque_pop(ASYNC_Deque *deque, ASYNC_Job *job);
+function B32 async_deque_steal(ASYNC_Deque *deque, ASYNC_Job *job);
+
+// Bounded multi-producer, multi-consumer queue (Vyukov)
+function B32 async_inject_push(ASYNC_Context *ctx, ASYNC_Job *job);
+function B32 async_inject_pop(ASYNC_Context *ctx, ASYNC_Job *job);
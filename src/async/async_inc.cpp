@@ -1 +1,2 @@
-#include "async.cpp"
\ No newline at end of file
+#include "async.cpp"
+#include "async_parallel.cpp"
\ No newline at end of file
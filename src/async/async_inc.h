@@ -1,3 +1,4 @@
 #pragma once
 
-#include "async.h"
\ No newline at end of file
+#include "async.h"
+#include "async_parallel.h"
\ No newline at end of file
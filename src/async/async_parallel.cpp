@@ -0,0 +1,129 @@
+//
+// Parallel for
+//
+
+function void
+async_parallel_for_work(void *data)
+{
+  ASYNC_ParallelFor *pf = (ASYNC_ParallelFor *)data;
+  
+  for (;;) {
+    // NOTE: os_interlocked_increment_32 returns the incremented value.
+    U32 batch_idx = os_interlocked_increment_32(&pf->next_batch) - 1;
+    if (batch_idx >= pf->batches_count) {
+      break;
+    }
+    
+    U64 first = (U64)batch_idx*pf->grain;
+    U64 opl = Min(first + pf->grain, pf->count);
+    
+    ProfBegin("parallel_for batch");
+    TempArena scratch = arena_scratch_begin(0, 0);
+    pf->proc(scratch.arena, pf->user, first, opl);
+    arena_scratch_end(scratch);
+    ProfEnd();
+  }
+}
+
+function void
+async_parallel_for(U64 count, U64 grain, ASYNC_ParallelForProc *proc, void *user)
+{
+  if (count > 0) {
+    ASYNC_ParallelFor pf = {0};
+    pf.proc = proc;
+    pf.user = user;
+    pf.count = count;
+    pf.grain = Max(grain, 1);
+    pf.batches_count = (U32)((count + pf.grain - 1) / pf.grain);
+    
+    // Batches are handed out through a shared cursor, so one job per worker is
+    // enough; the calling thread takes batches too.
+    ASYNC_Counter counter = {0};
+    if (async_ctx) {
+      U32 jobs_count = Min(async_ctx->threads_count, pf.batches_count - 1);
+      for (U32 idx = 0; idx < jobs_count; idx += 1) {
+        async_job_push(async_parallel_for_work, &pf, &counter);
+      }
+    }
+    
+    async_parallel_for_work(&pf);
+    async_wait(&counter);
+  }
+}
+
+//
+// Task graph
+//
+
+function ASYNC_TaskGraph *
+async_task_graph_alloc(Arena *arena)
+{
+  ASYNC_TaskGraph *graph = ArenaPushStruct(arena, ASYNC_TaskGraph);
+  graph->arena = arena;
+  return graph;
+}
+
+function ASYNC_Task *
+async_task_push(ASYNC_TaskGraph *graph, ASYNC_JobProc *proc, void *data)
+{
+  ASYNC_Task *task = ArenaPushStruct(graph->arena, ASYNC_Task);
+  task->graph = graph;
+  task->proc = proc;
+  task->data = data;
+  
+  SLLQueuePush(graph->first, graph->last, task);
+  graph->tasks_count += 1;
+  
+  return task;
+}
+
+function void
+async_task_depend(ASYNC_Task *task, ASYNC_Task *dependency)
+{
+  ASYNC_TaskLink *link = ArenaPushStruct(task->graph->arena, ASYNC_TaskLink);
+  link->task = task;
+  SLLStackPush(dependency->successors, link);
+  task->dependencies_count += 1;
+}
+
+function void
+async_task_run(void *data)
+{
+  ASYNC_Task *task = (ASYNC_Task *)data;
+  ASYNC_TaskGraph *graph = task->graph;
+  
+  task->proc(task->data);
+  
+  for (ASYNC_TaskLink *link = task->successors; link != 0; link = link->next) {
+    ASYNC_Task *successor = link->task;
+    if (os_interlocked_decrement_32(&successor->pending) == 0) {
+      async_job_push(async_task_run, successor, 0);
+    }
+  }
+  
+  os_interlocked_decrement_32(&graph->counter.count);
+}
+
+function void
+async_task_graph_run(ASYNC_TaskGraph *graph)
+{
+  // Reset for this run. The counter tracks tasks rather than submitted jobs,
+  // since successors are submitted from inside their last dependency.
+  U32 roots_count = 0;
+  for (ASYNC_Task *task = graph->first; task != 0; task = task->next) {
+    task->pending = task->dependencies_count;
+    roots_count += (task->dependencies_count == 0);
+  }
+  graph->counter.count = graph->tasks_count;
+  
+  // A graph with tasks but no roots has a cycle and would never finish.
+  Assert(graph->tasks_count == 0 || roots_count > 0);
+  
+  for (ASYNC_Task *task = graph->first; task != 0; task = task->next) {
+    if (task->dependencies_count == 0) {
+      async_job_push(async_task_run, task, 0);
+    }
+  }
+  
+  async_wait(&graph->counter);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// NOTE: Higher-level helpers built on the job system: splitting an index range
+// across workers, and running a static graph of tasks with dependencies. Both
+// run serially on the calling thread when the async layer isn't initialized.
+
+//
+// Parallel for
+//
+
+// Called with [first, opl) sub-ranges of at most `grain` indices. `scratch` is
+// the executing thread's scratch arena; it is reset after every call.
+typedef void ASYNC_ParallelForProc(Arena *scratch, void *user, U64 first, U64 opl);
+
+struct ASYNC_ParallelFor {
+  ASYNC_ParallelForProc *proc;
+  void *user;
+  U64 count;
+  U64 grain;
+  U32 batches_count;
+  volatile U32 next_batch;
+};
+
+function void async_parallel_for(U64 count, U64 grain, ASYNC_ParallelForProc *proc, void *user);
+
+//
+// Task graph
+//
+
+struct ASYNC_TaskLink {
+  ASYNC_TaskLink *next;
+  struct ASYNC_Task *task;
+};
+
+struct ASYNC_Task {
+  ASYNC_Task *next;
+  struct ASYNC_TaskGraph *graph;
+  
+  ASYNC_JobProc *proc;
+  void *data;
+  
+  ASYNC_TaskLink *successors; // Tasks that depend on this one
+  U32 dependencies_count;
+  volatile U32 pending;       // Dependencies that haven't finished during a run
+};
+
+struct ASYNC_TaskGraph {
+  Arena *arena;
+  ASYNC_Task *first;
+  ASYNC_Task *last;
+  U32 tasks_count;
+  ASYNC_Counter counter;
+};
+
+function ASYNC_TaskGraph *async_task_graph_alloc(Arena *arena);
+function ASYNC_Task *async_task_push(ASYNC_TaskGraph *graph, ASYNC_JobProc *proc, void *data);
+
+// `task` won't start before `dependency` has finished.
+function void async_task_depend(ASYNC_Task *task, ASYNC_Task *dependency);
+
+// Runs every task once, respecting dependencies, and returns when all are done.
+// The graph can be run again afterwards.
+function void async_task_graph_run(ASYNC_TaskGraph *graph);
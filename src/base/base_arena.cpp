@@ -18,7 +18,7 @@ arena_alloc(U64 size)
     arena->commit_pos = upfront_commit_size;
     arena->align = ARENA_DEFAULT_ALIGNMENT;
     arena->reserve_size = size;
-    AsanPoisonMemoryRegion((void*)arena->pos, arena->reserve_size);
+    AsanPoisonMemoryRegion((U8 *)arena + arena->pos, arena->commit_pos - arena->pos);
   }
   
   return arena;
@@ -33,7 +33,7 @@ arena_alloc_default(void)
 function void 
 arena_release(Arena *arena) 
 {
-  os_release(arena);
+  os_release(arena, arena->reserve_size);
 }
 
 function void *
@@ -53,10 +53,14 @@ arena_push_nozero(Arena *arena, U64 size)
       U64 commit_size = arena->pos - arena->commit_pos;
       commit_size = AlignPow2(commit_size, ARENA_COMMIT_GRANULARITY);
       os_commit(base + arena->commit_pos, commit_size);
-      arena->commit_pos += commit_size;
       
-      AsanUnpoisonMemoryRegion((void*)pos_aligned, size + align_offset);
+      // Only committed memory is poisoned; the reserve can be far larger than
+      // what the shadow memory should cover.
+      AsanPoisonMemoryRegion(base + arena->commit_pos, commit_size);
+      arena->commit_pos += commit_size;
     }
+    
+    AsanUnpoisonMemoryRegion(memory, size);
   } 
   else {
     os_exit_process(1);
@@ -85,7 +89,9 @@ arena_pop_to(Arena *arena, U64 target)
   if (target > pos_min) target_new = target; 
   arena->pos = target_new;
   
-  AsanPoisonMemoryRegion((void*)target_new, pos_init - target_new);
+  if (pos_init > target_new) {
+    AsanPoisonMemoryRegion((U8 *)arena + target_new, pos_init - target_new);
+  }
   
   // The new current position aligned to the size of a commit block.
   U64 pos_commit_block_aligned = AlignPow2(arena->pos, ARENA_COMMIT_GRANULARITY);
@@ -169,6 +169,18 @@
 # define BUILD_CLI 0
 #endif
 
+// Headless builds leave out the windowing/graphics layers so that they can run
+// on machines without a display or GPU.
+#if !defined(BUILD_HEADLESS)
+# define BUILD_HEADLESS 0
+#endif
+
+// Profiling zones (prof/prof_core.h). Cheap enough to leave on in release builds;
+// 0 compiles them out.
+#if !defined(BUILD_PROFILE)
+# define BUILD_PROFILE 1
+#endif
+
 // -- Address sanitizer 
 
 #if defined(__SANITIZE_ADDRESS__)
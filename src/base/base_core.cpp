@@ -0,0 +1,31 @@
+#if COMPILER_MSVC
+# include <intrin.h>
+#endif
+
+//
+// Bit operations
+//
+
+function U32
+count_bits_set_u64(U64 v)
+{
+#if COMPILER_MSVC
+  U32 result = (U32)__popcnt64(v);
+#else
+  U32 result = (U32)__builtin_popcountll(v);
+#endif
+  return result;
+}
+
+function U32
+count_trailing_zeros_u32(U32 v)
+{
+#if COMPILER_MSVC
+  unsigned long idx = 0;
+  _BitScanForward(&idx, v);
+  U32 result = (U32)idx;
+#else
+  U32 result = (U32)__builtin_ctz(v);
+#endif
+  return result;
+}
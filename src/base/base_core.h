@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
 
 // 
 // Custom types and storage class aliases
@@ -54,6 +56,9 @@ typedef double   F64;
 
 #define MemoryMove(dst, src, size) memmove((dst),(src),(size))
 
+#define MemoryMatch(a, b, size)  (memcmp((a),(b),(size)) == 0)
+#define MemoryMatchStruct(a, b)  MemoryMatch((a),(b),sizeof(*(a)))
+
 #define IntFromPtr(p) (unsigned long long)((char*)p - (char*)0)
 #define PtrFromInt(p) (void*)((char*)0 + (p))
 
@@ -143,8 +148,8 @@ typedef double   F64;
 // Address sanitizer 
 //
 
-void __asan_poison_memory_region(void const volatile *addr, size_t size);
-void __asan_unpoison_memory_region(void const volatile *addr, size_t size);
+extern "C" void __asan_poison_memory_region(void const volatile *addr, size_t size);
+extern "C" void __asan_unpoison_memory_region(void const volatile *addr, size_t size);
 
 #if ASAN_ENABLED
 # define AsanPoisonMemoryRegion(base, size)   (__asan_poison_memory_region(base, size))
@@ -153,3 +158,10 @@ void __asan_unpoison_memory_region(void const volatile *addr, size_t size);
 # define AsanPoisonMemoryRegion(base, size)   
 # define AsanUnpoisonMemoryRegion(base, size) 
 #endif
+
+//
+// Bit operations
+//
+
+function U32 count_bits_set_u64(U64 v);
+function U32 count_trailing_zeros_u32(U32 v); // `v` must not be 0
@@ -42,7 +42,7 @@ function void
 json_make_token_number(JSON_Context *ctx, JSON_Token *t)
 {
   // TODO: Negative numbers
-  JSON_Token token = {0}; 
+  JSON_Token token = {}; 
   (void)token; 
   
   t->kind = JSON_Token_Number; 
@@ -112,7 +112,7 @@ json_get_token(JSON_Context *ctx)
 {
   json_eat_whitespace(ctx);
   
-  JSON_Token token = {0};
+  JSON_Token token = {};
   token.text = str8(ctx->at, 1);
   token.line = ctx->line;
   
@@ -189,7 +189,7 @@ json_parse_array(JSON_Context *ctx)
 function JSON_Value 
 json_parse_value(JSON_Context *ctx)
 {
-  JSON_Value value = {0}; 
+  JSON_Value value = {}; 
   
   JSON_Token next = json_get_token(ctx); 
   switch (next.kind) {
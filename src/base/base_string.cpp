@@ -14,9 +14,9 @@ str8(U8 *data, U64 count)
 function B32 
 str8_equal(String8 a, String8 b)
 {
-  B32 equal = 1; 
+  B32 equal = (a.count == b.count); 
   
-  for (U64 idx = 0; idx < a.count; idx += 1) {
+  for (U64 idx = 0; equal && idx < a.count; idx += 1) {
     if (a.data[idx] != b.data[idx]) { 
       equal = 0;
       break;
@@ -100,9 +100,9 @@ str16(U16 *data, U64 count)
 function B32
 str16_equal(String16 a, String16 b)
 {
-  B32 equal = 1; 
+  B32 equal = (a.count == b.count); 
   
-  for (U64 idx = 0; idx < a.count; idx += 1) {
+  for (U64 idx = 0; equal && idx < a.count; idx += 1) {
     if (a.data[idx] != b.data[idx]) { 
       equal = 0;
       break;
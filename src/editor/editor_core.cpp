@@ -9,6 +9,8 @@ ed_undo_make(void)
   
   Arena *arena = arena_alloc_default();
   undo.arena = arena;
+  undo.ring = ArenaPushArrayNoZero(arena, U8, ED_UNDO_BUDGET);
+  undo.entries = ArenaPushArray(arena, ED_UndoEntry, ED_UNDO_ENTRIES_MAX);
   
   return undo;
 }
@@ -22,44 +24,240 @@ ed_undo_release(ED_UndoContext *undo)
 function void 
 ed_undo_clear(ED_UndoContext *undo)
 {
-  arena_clear(undo->arena);
-  undo->count = 0;
+  undo->entries_first = 0;
+  undo->entries_count = 0;
+  undo->applied_count = 0;
 }
 
-function void 
-ed_undo_push(ED_UndoContext *undo, G_TileMap *map)
+function ED_UndoEntry *
+ed_undo_entry_from_idx(ED_UndoContext *undo, U32 idx)
+{
+  ED_UndoEntry *result = &undo->entries[(undo->entries_first + idx) % ED_UNDO_ENTRIES_MAX];
+  return result;
+}
+
+function U64
+ed_undo_bytes_used(ED_UndoContext *undo)
+{
+  U64 result = 0;
+  for (U32 idx = 0; idx < undo->entries_count; idx += 1) {
+    result += ed_undo_entry_from_idx(undo, idx)->size;
+  }
+  return result;
+}
+
+function void
+ed_undo_evict_oldest(ED_UndoContext *undo)
 {
-  ED_UndoNode *n = undo->free;
-  SLLStackPopN(undo->free, free_next);
-  if (!n) {
-    n = ArenaPushStruct(undo->arena, ED_UndoNode);
+  undo->entries_first = (undo->entries_first + 1) % ED_UNDO_ENTRIES_MAX;
+  undo->entries_count -= 1;
+  if (undo->applied_count > 0) {
+    undo->applied_count -= 1;
   }
+}
+
+// Starts a new step of `size` bytes after the newest one, discarding redo steps
+// and evicting the oldest steps until it fits.
+function ED_UndoRecord *
+ed_undo_record_push(ED_UndoContext *undo, U32 size)
+{
+  undo->entries_count = undo->applied_count;
+  size = AlignPow2(size, 8); // Keeps every record aligned
   
-  U32 tiles_size = map->width * map->height * sizeof(G_TileToken);
-  MemoryCopy(n->tokens, map->tokens, tiles_size);
-  n->width = map->width;
-  n->height = map->height;
+  U32 offset = 0;
+  for (;;) {
+    if (undo->entries_count == ED_UNDO_ENTRIES_MAX) {
+      ed_undo_evict_oldest(undo);
+    }
+    if (undo->entries_count == 0) {
+      offset = 0;
+      break;
+    }
+    
+    ED_UndoEntry *oldest = ed_undo_entry_from_idx(undo, 0);
+    ED_UndoEntry *newest = ed_undo_entry_from_idx(undo, undo->entries_count - 1);
+    U32 head = oldest->offset;
+    U32 tail = newest->offset + newest->size;
+    
+    if (newest->offset >= head) {
+      // Free space is after the newest step and before the oldest one
+      if (size <= ED_UNDO_BUDGET - tail) {
+        offset = tail;
+        break;
+      }
+      if (size <= head) {
+        offset = 0;
+        break;
+      }
+    }
+    else if (size <= head - tail) {
+      offset = tail;
+      break;
+    }
+    
+    ed_undo_evict_oldest(undo);
+  }
   
-  SLLQueuePushFrontN(undo->first, undo->last, n, stack_next);
-  undo->count += 1;
+  ED_UndoEntry *entry = ed_undo_entry_from_idx(undo, undo->entries_count);
+  entry->offset = offset;
+  entry->size = size;
+  undo->entries_count += 1;
+  undo->applied_count += 1;
+  
+  ED_UndoRecord *record = (ED_UndoRecord *)(undo->ring + offset);
+  MemoryZeroStruct(record);
+  return record;
+}
+
+function void
+ed_undo_push_tile(ED_UndoContext *undo, S32 tile_idx, G_TileToken old_token, G_TileToken new_token)
+{
+  if (old_token != new_token) {
+    ED_UndoRecord *record = ed_undo_record_push(undo, sizeof(ED_UndoRecord));
+    record->kind = ED_UndoRecordKind_Tile;
+    record->tile_idx = tile_idx;
+    record->old_token = old_token;
+    record->new_token = new_token;
+  }
 }
 
 function void
+ed_undo_push_resize(ED_UndoContext *undo, G_TileMap *map, ED_TilemapOp op)
+{
+  S32 width = map->width;
+  S32 height = map->height;
+  
+  // Removing a row or column loses its tokens, so they are kept for undo
+  B32 removes = 0;
+  S32 removed_count = 0;
+  S32 removed_first = 0;
+  S32 removed_stride = 1;
+  switch (op) {
+    case ED_TilemapOp_ColumnRemoveLeft: {
+      removes = 1;
+      removed_count = height;
+      removed_stride = width;
+    }break;
+    case ED_TilemapOp_ColumnRemoveRight: {
+      removes = 1;
+      removed_count = height;
+      removed_first = width - 1;
+      removed_stride = width;
+    }break;
+    case ED_TilemapOp_RowRemoveTop: {
+      removes = 1;
+      removed_count = width;
+    }break;
+    case ED_TilemapOp_RowRemoveBottom: {
+      removes = 1;
+      removed_count = width;
+      removed_first = (height - 1)*width;
+    }break;
+  }
+  
+  // Removing from an empty map does nothing, so there is nothing to undo
+  if (removes && width*height == 0) {
+    return;
+  }
+  
+  U32 size = sizeof(ED_UndoRecord) + removed_count*sizeof(G_TileToken);
+  if (size <= ED_UNDO_BUDGET) {
+    ED_UndoRecord *record = ed_undo_record_push(undo, size);
+    record->kind = ED_UndoRecordKind_Resize;
+    record->op = op;
+    record->removed_count = removed_count;
+    
+    G_TileToken *removed = (G_TileToken *)(record + 1);
+    for (S32 idx = 0; idx < removed_count; idx += 1) {
+      removed[idx] = map->tokens[removed_first + idx*removed_stride];
+    }
+  }
+  else {
+    // Older steps can't be replayed without this one
+    ed_undo_clear(undo);
+  }
+}
+
+function B32
 ed_undo_pop(ED_UndoContext *undo, G_TileMap *map)
 {
-  ED_UndoNode *n = undo->first;
-  if (n) {
-    if (map) {
-      U32 tiles_size = map->width * map->height * sizeof(G_TileToken);
-      MemoryCopy(map->tokens, n->tokens, tiles_size);
-      map->width = n->width;
-      map->height = n->height;
+  B32 result = 0;
+  
+  if (undo->applied_count > 0 && map) {
+    ED_UndoEntry *entry = ed_undo_entry_from_idx(undo, undo->applied_count - 1);
+    ED_UndoRecord *record = (ED_UndoRecord *)(undo->ring + entry->offset);
+    
+    switch (record->kind) {
+      case ED_UndoRecordKind_Tile: {
+        map->tokens[record->tile_idx] = record->old_token;
+      }break;
       
-      SLLQueuePopN(undo->first, undo->last, stack_next);
-      SLLStackPushN(undo->free, n, free_next);
-      undo->count -= 1;
+      case ED_UndoRecordKind_Resize: {
+        local ED_TilemapOp inverse_ops[ED_TilemapOp_COUNT] = {
+          ED_TilemapOp_ColumnRemoveLeft,
+          ED_TilemapOp_ColumnRemoveRight,
+          ED_TilemapOp_ColumnAppendLeft,
+          ED_TilemapOp_ColumnAppendRight,
+          ED_TilemapOp_RowRemoveTop,
+          ED_TilemapOp_RowRemoveBottom,
+          ED_TilemapOp_RowAppendTop,
+          ED_TilemapOp_RowAppendBottom,
+        };
+        
+        TempArena scratch = arena_scratch_begin(0, 0);
+        ed_tilemap_apply_op(scratch.arena, map, inverse_ops[record->op]);
+        arena_scratch_end(scratch);
+        
+        // The row or column is back but empty; refill it
+        S32 width = map->width;
+        S32 height = map->height;
+        G_TileToken *removed = (G_TileToken *)(record + 1);
+        for (S32 idx = 0; idx < record->removed_count; idx += 1) {
+          S32 tile_idx = 0;
+          switch (record->op) {
+            case ED_TilemapOp_ColumnRemoveLeft:  { tile_idx = idx*width;                }break;
+            case ED_TilemapOp_ColumnRemoveRight: { tile_idx = idx*width + width - 1;    }break;
+            case ED_TilemapOp_RowRemoveTop:      { tile_idx = idx;                      }break;
+            case ED_TilemapOp_RowRemoveBottom:   { tile_idx = (height - 1)*width + idx; }break;
+          }
+          map->tokens[tile_idx] = removed[idx];
+        }
+      }break;
+    }
+    
+    undo->applied_count -= 1;
+    result = 1;
+  }
+  
+  return result;
+}
+
+function B32
+ed_undo_redo(ED_UndoContext *undo, G_TileMap *map)
+{
+  B32 result = 0;
+  
+  if (undo->applied_count < undo->entries_count && map) {
+    ED_UndoEntry *entry = ed_undo_entry_from_idx(undo, undo->applied_count);
+    ED_UndoRecord *record = (ED_UndoRecord *)(undo->ring + entry->offset);
+    
+    switch (record->kind) {
+      case ED_UndoRecordKind_Tile: {
+        map->tokens[record->tile_idx] = record->new_token;
+      }break;
+      
+      case ED_UndoRecordKind_Resize: {
+        TempArena scratch = arena_scratch_begin(0, 0);
+        ed_tilemap_apply_op(scratch.arena, map, record->op);
+        arena_scratch_end(scratch);
+      }break;
     }
+    
+    undo->applied_count += 1;
+    result = 1;
   }
+  
+  return result;
 }
 
 //
@@ -71,14 +269,13 @@ ed_tilemap_column_append_left(Arena *arena, G_TileMap *map)
 {
   S32 width = map->width;
   S32 height = map->height;
-  S32 tiles_count = width*height;
   S32 src_row_size = sizeof(G_TileToken)*width;
   
   G_TileMap *tmp = ArenaPushStruct(arena, G_TileMap);
   MemoryCopyStruct(tmp, map);
   
-  S32 tiles_size = sizeof(G_TileToken)*tiles_count;
-  for (S32 idx = 0; idx < tiles_size; idx += 1) {
+  S32 new_tiles_count = (width + 1)*height; // Tokens, not bytes
+  for (S32 idx = 0; idx < new_tiles_count; idx += 1) {
     map->tokens[idx] = G_TileToken_Empty;
   }
   
@@ -97,15 +294,14 @@ ed_tilemap_column_append_right(Arena *arena, G_TileMap *map)
 {
   S32 width = map->width;
   S32 height = map->height;
-  S32 tiles_count = width*height;
   
   S32 src_row_size = sizeof(G_TileToken)*width;
   
   G_TileMap *tmp = ArenaPushStruct(arena, G_TileMap);
   MemoryCopyStruct(tmp, map);
   
-  S32 tiles_size = sizeof(G_TileToken)*tiles_count;
-  for (S32 idx = 0; idx < tiles_size; idx += 1) {
+  S32 new_tiles_count = (width + 1)*height; // Tokens, not bytes
+  for (S32 idx = 0; idx < new_tiles_count; idx += 1) {
     map->tokens[idx] = G_TileToken_Empty;
   }
   
@@ -176,15 +372,14 @@ ed_tilemap_row_append_top(Arena *arena, G_TileMap *map)
 {
   S32 width = map->width;
   S32 height = map->height;
-  S32 tiles_count = width*height;
   S32 src_row_size = sizeof(G_TileToken)*width;
   
   G_TileMap *tmp = ArenaPushStruct(arena, G_TileMap);
   
   MemoryCopyStruct(tmp, map);
   
-  S32 tiles_size = sizeof(G_TileToken)*tiles_count;
-  for (S32 idx = 0; idx < tiles_size; idx += 1) {
+  S32 new_tiles_count = width*(height + 1); // Tokens, not bytes
+  for (S32 idx = 0; idx < new_tiles_count; idx += 1) {
     map->tokens[idx] = G_TileToken_Empty;
   }
   
@@ -203,15 +398,14 @@ ed_tilemap_row_append_bottom(Arena *arena, G_TileMap *map)
 {
   S32 width = map->width;
   S32 height = map->height;
-  S32 tiles_count = width*height;
   S32 src_row_size = sizeof(G_TileToken)*width;
   
   G_TileMap *tmp = ArenaPushStruct(arena, G_TileMap);
   MemoryCopyStruct(tmp, map);
   
   
-  S32 tiles_size = sizeof(G_TileToken)*tiles_count;
-  for (S32 idx = 0; idx < tiles_size; idx += 1) {
+  S32 new_tiles_count = width*(height + 1); // Tokens, not bytes
+  for (S32 idx = 0; idx < new_tiles_count; idx += 1) {
     map->tokens[idx] = G_TileToken_Empty;
   }
   
@@ -273,6 +467,21 @@ ed_tilemap_row_remove_bottom(Arena *arena, G_TileMap *map)
   }
 }
 
+function void
+ed_tilemap_apply_op(Arena *arena, G_TileMap *map, ED_TilemapOp op)
+{
+  switch (op) {
+    case ED_TilemapOp_ColumnAppendLeft:  { ed_tilemap_column_append_left(arena, map);  }break;
+    case ED_TilemapOp_ColumnAppendRight: { ed_tilemap_column_append_right(arena, map); }break;
+    case ED_TilemapOp_ColumnRemoveLeft:  { ed_tilemap_column_remove_left(arena, map);  }break;
+    case ED_TilemapOp_ColumnRemoveRight: { ed_tilemap_column_remove_right(arena, map); }break;
+    case ED_TilemapOp_RowAppendTop:      { ed_tilemap_row_append_top(arena, map);      }break;
+    case ED_TilemapOp_RowAppendBottom:   { ed_tilemap_row_append_bottom(arena, map);   }break;
+    case ED_TilemapOp_RowRemoveTop:      { ed_tilemap_row_remove_top(arena, map);      }break;
+    case ED_TilemapOp_RowRemoveBottom:   { ed_tilemap_row_remove_bottom(arena, map);   }break;
+  }
+}
+
 //
 // Tile choice controls
 //
@@ -484,44 +693,25 @@ ed_resize_ctrl_update(ED_ResizeControl *ctrl, ED_MapControl *map_ctrl, G_MapStor
   Arena *scratch = arena_get_scratch(0,0);
   
   ctrl->hovered_direction = hovered_direction;
-  if (g_mouse_pressed(input, G_MouseButton_Left)) {
+  if (g_mouse_pressed(input, G_MouseButton_Left) && hovered_direction != ED_ResizeDirection_None) {
     G_TileMap *map = ed_map_get(maps, map_ctrl->current_map_idx);
-    ed_undo_push(undo, map);
-    
-    switch (ctrl->mode) {
-      case ED_ResizeMode_Append: {
-        switch (hovered_direction) {
-          case ED_ResizeDirection_Left: {
-            ed_tilemap_column_append_left(scratch, map);
-          }break;
-          case ED_ResizeDirection_Right: {
-            ed_tilemap_column_append_right(scratch, map);
-          }break;
-          case ED_ResizeDirection_Top: {
-            ed_tilemap_row_append_top(scratch, map);
-          }break;
-          case ED_ResizeDirection_Bottom: {
-            ed_tilemap_row_append_bottom(scratch, map);
-          }break;
-        }
-      }break;
-      case ED_ResizeMode_Remove: {
-        switch (hovered_direction) {
-          case ED_ResizeDirection_Left: {
-            ed_tilemap_column_remove_left(scratch, map);
-          }break;
-          case ED_ResizeDirection_Right: {
-            ed_tilemap_column_remove_right(scratch, map);
-          }break;
-          case ED_ResizeDirection_Top: {
-            ed_tilemap_row_remove_top(scratch, map);
-          }break;
-          case ED_ResizeDirection_Bottom: {
-            ed_tilemap_row_remove_bottom(scratch, map);
-          }break;
-        }
-      }break;
-    }
+    
+    local ED_TilemapOp append_ops[ED_ResizeDirection_COUNT] = {
+      ED_TilemapOp_ColumnAppendLeft,
+      ED_TilemapOp_ColumnAppendRight,
+      ED_TilemapOp_RowAppendTop,
+      ED_TilemapOp_RowAppendBottom,
+    };
+    local ED_TilemapOp remove_ops[ED_ResizeDirection_COUNT] = {
+      ED_TilemapOp_ColumnRemoveLeft,
+      ED_TilemapOp_ColumnRemoveRight,
+      ED_TilemapOp_RowRemoveTop,
+      ED_TilemapOp_RowRemoveBottom,
+    };
+    ED_TilemapOp op = (ctrl->mode == ED_ResizeMode_Append) ? append_ops[hovered_direction] : remove_ops[hovered_direction];
+    
+    ed_undo_push_resize(undo, map, op);
+    ed_tilemap_apply_op(scratch, map, op);
   }
   
   //
@@ -672,9 +862,8 @@ ed_map_ctrl_update(ED_MapControl *ctrl, ED_ChoiceControl *choice_ctrl, G_MapStor
   
   B32 indices_valid = (ctrl->selected_tile_idx >= 0 && choice_ctrl->selected_choice_idx >= 0);
   if (indices_valid) {
-    ed_undo_push(undo, map);
-    
     ED_ChoiceEntry *choice = &ed_choice_table[choice_ctrl->selected_choice_idx];
+    ed_undo_push_tile(undo, ctrl->selected_tile_idx, map->tokens[ctrl->selected_tile_idx], choice->token);
     map->tokens[ctrl->selected_tile_idx] = choice->token;
     
     ctrl->selected_tile_idx = -1;
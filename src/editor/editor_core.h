@@ -7,30 +7,73 @@
 // Undo system
 //
 
-struct ED_UndoNode {
-  ED_UndoNode *stack_next;
-  ED_UndoNode *free_next;
-  
-  G_TileToken tokens[G_TILEMAP_TOKENS_MAX];
-  S32 width;
-  S32 height;
+// NOTE: Undo steps are diff records in a fixed-size byte ring instead of map
+// snapshots. A tile edit stores the tile index with its old and new token; a
+// resize stores the operation, plus the tokens of the row or column it removed.
+// When the ring is full the oldest steps are dropped, so memory stays at
+// ED_UNDO_BUDGET however long the session is.
+
+#define ED_UNDO_BUDGET      KiB(256)
+#define ED_UNDO_ENTRIES_MAX 4096
+
+enum ED_TilemapOp {
+  ED_TilemapOp_ColumnAppendLeft,
+  ED_TilemapOp_ColumnAppendRight,
+  ED_TilemapOp_ColumnRemoveLeft,
+  ED_TilemapOp_ColumnRemoveRight,
+  ED_TilemapOp_RowAppendTop,
+  ED_TilemapOp_RowAppendBottom,
+  ED_TilemapOp_RowRemoveTop,
+  ED_TilemapOp_RowRemoveBottom,
+  ED_TilemapOp_COUNT,
+};
+
+enum ED_UndoRecordKind {
+  ED_UndoRecordKind_Tile,
+  ED_UndoRecordKind_Resize,
+};
+
+// Followed by `removed_count` tokens for resizes that remove a row or column.
+struct ED_UndoRecord {
+  ED_UndoRecordKind kind;
+  ED_TilemapOp op;
+  S32 tile_idx;
+  G_TileToken old_token;
+  G_TileToken new_token;
+  S32 removed_count;
+};
+
+struct ED_UndoEntry {
+  U32 offset; // Into the ring
+  U32 size;
 };
 
 struct ED_UndoContext {
   Arena *arena;
   
-  ED_UndoNode *first; // Most recent undo state
-  ED_UndoNode *last;  // Least recent undo state
-  S32 count;
+  U8 *ring;
   
-  ED_UndoNode *free;
+  // Ring of entries, oldest first. Entries [0, applied_count) can be undone,
+  // the rest redone.
+  ED_UndoEntry *entries;
+  U32 entries_first;
+  U32 entries_count;
+  U32 applied_count;
 };
 
 function ED_UndoContext ed_undo_make(void);
 function void ed_undo_release(ED_UndoContext *undo);
 function void ed_undo_clear(ED_UndoContext *undo);
-function void ed_undo_push(ED_UndoContext *undo, G_TileMap *map);
-function void ed_undo_pop(ED_UndoContext *undo, G_TileMap *map);
+function U64 ed_undo_bytes_used(ED_UndoContext *undo);
+
+// Record a step before (resize) or after (tile) applying it to the map.
+function void ed_undo_push_tile(ED_UndoContext *undo, S32 tile_idx, G_TileToken old_token, G_TileToken new_token);
+function void ed_undo_push_resize(ED_UndoContext *undo, G_TileMap *map, ED_TilemapOp op);
+
+// Undo/redo the most recent step on `map`; return 0 when there is none.
+function B32 ed_undo_pop(ED_UndoContext *undo, G_TileMap *map);
+function B32 ed_undo_redo(ED_UndoContext *undo, G_TileMap *map);
+
 //
 // Tile choice controls
 //
@@ -141,6 +184,7 @@ function void ed_tilemap_row_append_top(Arena *arena, G_TileMap *map);
 function void ed_tilemap_row_append_bottom(Arena *arena, G_TileMap *map);
 function void ed_tilemap_row_remove_top(Arena *arena, G_TileMap *map);
 function void ed_tilemap_row_remove_bottom(Arena *arena, G_TileMap *map);
+function void ed_tilemap_apply_op(Arena *arena, G_TileMap *map, ED_TilemapOp op);
 function G_TileMap *ed_map_get(G_MapStorage *maps, S32 map_idx);
 function U32 ed_codepoint_from_key(G_Key key);
 
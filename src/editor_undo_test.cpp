@@ -0,0 +1,323 @@
+// NOTE: Standalone test of the editor's undo ring (see editor/editor_core.h). The
+// game layer the editor builds against (G_*) is not in this tree, so the few
+// types and calls editor_core.cpp uses are stubbed below. The controls compile
+// against the stubs but never run; only the undo ring and the resize helpers do.
+//
+// Usage: editor_undo_test
+//
+// Each history edits a tilemap at random with tile edits and resizes, and keeps
+// a copy of the map after every step. It then undoes every step the ring kept,
+// past the last one, and redoes them all, checking the map against the copies
+// after each step. Histories:
+//   resizes  half of the steps are resizes, so the byte ring wraps and
+//            evicts the oldest steps long before the entry count runs out
+//   tiles    tile edits only, so the entry ring wraps at ED_UNDO_ENTRIES_MAX
+//   branch   a step pushed after undoing half the history drops the redo steps
+// Exits with 1 when any map differs or the ring holds more than its budget.
+//
+// Build: sh build.sh editor_test [release] [asan]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base/base_inc.h"
+#include "os/os_inc.h"
+
+#include "base/base_inc.cpp"
+#include "os/os_inc.cpp"
+
+//
+// Game layer stubs
+//
+
+#define G_TILEMAP_TOKENS_MAX (128*128)
+#define G_MAPS_MAX 4
+
+enum G_TileToken {
+  G_TileToken_Empty,
+  G_TileToken_Dirt,
+  G_TileToken_StoneT0,
+  G_TileToken_StoneT1,
+  G_TileToken_OreT0,
+  G_TileToken_OreT1,
+  G_TileToken_OreT2,
+  G_TileToken_Bedrock,
+  G_TileToken_Player,
+  G_TileToken_EnemyGround,
+  G_TileToken_EnemyAir,
+  G_TileToken_BoulderSmall,
+  G_TileToken_BoulderLarge,
+  G_TileToken_Lava,
+  G_TileToken_COUNT,
+};
+
+struct G_TileMap {
+  G_TileToken tokens[G_TILEMAP_TOKENS_MAX];
+  S32 width;
+  S32 height;
+};
+
+struct G_MapStorage {
+  G_TileMap maps[G_MAPS_MAX];
+};
+
+enum G_Key {
+  G_Key_0, G_Key_1, G_Key_2, G_Key_3, G_Key_4, G_Key_5, G_Key_6, G_Key_7, G_Key_8, G_Key_9,
+  G_Key_E, G_Key_R, G_Key_Left, G_Key_Right, G_Key_Up, G_Key_Down, G_Key_Space,
+};
+
+enum G_MouseButton {
+  G_MouseButton_Left,
+  G_MouseButton_Right,
+};
+
+struct G_Input {
+  struct { F32 x, y; } mouse;
+};
+
+struct G_TransitionF32 {
+  F32 value;
+};
+
+struct G_Sprite {
+  RectF32 uv_rect;
+  void *texture;
+};
+
+struct G_AssetContext;
+struct R_Context;
+struct R_Font;
+
+struct R_Quad {
+  RectF32 rect;
+  RectF32 uv_rect;
+  V4F32 colors[4];
+  F32 corner_softness;
+  F32 radius;
+  F32 border_thickness;
+};
+
+function B32 g_mouse_pressed(G_Input *input, G_MouseButton button) { return 0; }
+function B32 g_mouse_down(G_Input *input, G_MouseButton button) { return 0; }
+function B32 g_key_pressed(G_Input *input, G_Key key) { return 0; }
+function G_Sprite *g_assets_get_sprite(G_AssetContext *assets, String8 path) { return 0; }
+function void g_render_sprite(R_Context *renderer, G_Sprite *sprite, F32 x, F32 y, F32 scale) {}
+function void r_quad(R_Context *renderer, R_Quad *quad, void *texture) {}
+function void r_text(R_Context *renderer, String8 text, R_Font *font, F32 size, V2F32 pos, V4F32 color, void *texture) {}
+
+#include "editor/editor_inc.h"
+#include "editor/editor_inc.cpp"
+
+//
+// Test
+//
+
+// Maps stay within these sides, so a copy of one fits a fixed slot
+#define ED_TEST_SIDE_MIN 48
+#define ED_TEST_SIDE_MAX 80
+
+// Copy of the map after a step. Tokens fit a byte.
+struct ED_TestMapCopy {
+  S32 width;
+  S32 height;
+  U8 tokens[ED_TEST_SIDE_MAX*ED_TEST_SIDE_MAX];
+};
+
+// Copies of the last ED_UNDO_ENTRIES_MAX steps and the map before them, which is
+// as far back as the ring can undo
+#define ED_TEST_COPIES_COUNT (ED_UNDO_ENTRIES_MAX + 1)
+
+struct ED_TestHistory {
+  ED_TestMapCopy *copies;
+  U32 steps_count;
+};
+
+// Hashed LCG, as in the CLI
+function U32
+ed_test_random(U32 *state)
+{
+  *state = *state*1664525u + 1013904223u;
+  U32 result = *state;
+  result ^= result >> 16;
+  result *= 0x7FEB352Du;
+  result ^= result >> 15;
+  result *= 0x846CA68Bu;
+  result ^= result >> 16;
+  return result;
+}
+
+function ED_TestMapCopy *
+ed_test_copy_from_step(ED_TestHistory *history, U32 step)
+{
+  ED_TestMapCopy *result = &history->copies[step % ED_TEST_COPIES_COUNT];
+  return result;
+}
+
+function void
+ed_test_copy_map(ED_TestMapCopy *copy, G_TileMap *map)
+{
+  copy->width = map->width;
+  copy->height = map->height;
+  for (S32 idx = 0; idx < map->width*map->height; idx += 1) {
+    copy->tokens[idx] = (U8)map->tokens[idx];
+  }
+}
+
+function B32
+ed_test_map_matches(G_TileMap *map, ED_TestMapCopy *copy)
+{
+  B32 result = (map->width == copy->width && map->height == copy->height);
+  for (S32 idx = 0; result && idx < map->width*map->height; idx += 1) {
+    result = (map->tokens[idx] == copy->tokens[idx]);
+  }
+  return result;
+}
+
+// Pushes and applies one random step, a resize with probability `resize_chance`
+// in 256, and copies the map after it. Keeps the map's sides within
+// ED_TEST_SIDE_MIN and ED_TEST_SIDE_MAX.
+function void
+ed_test_history_push(ED_TestHistory *history, ED_UndoContext *undo, G_TileMap *map, U32 *random, U32 resize_chance)
+{
+  if ((ed_test_random(random) & 255) < resize_chance) {
+    ED_TilemapOp op = (ED_TilemapOp)(ed_test_random(random) % ED_TilemapOp_COUNT);
+    
+    // Two appends then two removes per axis; switch to the other two at a bound
+    B32 columns = (op <= ED_TilemapOp_ColumnRemoveRight);
+    B32 appends = (columns ? op < ED_TilemapOp_ColumnRemoveLeft : op < ED_TilemapOp_RowRemoveTop);
+    S32 side = columns ? map->width : map->height;
+    if ((appends && side == ED_TEST_SIDE_MAX) || (!appends && side == ED_TEST_SIDE_MIN)) {
+      op = (ED_TilemapOp)(appends ? op + 2 : op - 2);
+    }
+    
+    ed_undo_push_resize(undo, map, op);
+    TempArena scratch = arena_scratch_begin(0, 0);
+    ed_tilemap_apply_op(scratch.arena, map, op);
+    arena_scratch_end(scratch);
+  }
+  else {
+    // Always a different token, so the edit is a step
+    S32 tile_idx = ed_test_random(random) % (map->width*map->height);
+    G_TileToken old_token = map->tokens[tile_idx];
+    G_TileToken token = (G_TileToken)((old_token + 1 + ed_test_random(random) % (G_TileToken_COUNT - 1)) % G_TileToken_COUNT);
+    ed_undo_push_tile(undo, tile_idx, old_token, token);
+    map->tokens[tile_idx] = token;
+  }
+  
+  history->steps_count += 1;
+  ed_test_copy_map(ed_test_copy_from_step(history, history->steps_count), map);
+}
+
+// Undoes every step the ring kept and one more, then redoes them all and one
+// more, checking the map after each. Leaves the map as it was. Returns the
+// number of errors.
+function U32
+ed_test_history_check(ED_TestHistory *history, ED_UndoContext *undo, G_TileMap *map, char *name)
+{
+  U32 errors = 0;
+  U32 kept = undo->applied_count;
+  U64 bytes_used = ed_undo_bytes_used(undo);
+  
+  if (bytes_used > ED_UNDO_BUDGET) {
+    errors += 1;
+  }
+  
+  for (U32 idx = 0; idx < kept; idx += 1) {
+    B32 popped = ed_undo_pop(undo, map);
+    if (!popped || !ed_test_map_matches(map, ed_test_copy_from_step(history, history->steps_count - idx - 1))) {
+      errors += 1;
+    }
+  }
+  if (ed_undo_pop(undo, map)) {
+    errors += 1;
+  }
+  
+  U32 first_step = history->steps_count - kept;
+  for (U32 idx = 0; idx < kept; idx += 1) {
+    B32 redone = ed_undo_redo(undo, map);
+    if (!redone || !ed_test_map_matches(map, ed_test_copy_from_step(history, first_step + idx + 1))) {
+      errors += 1;
+    }
+  }
+  if (ed_undo_redo(undo, map)) {
+    errors += 1;
+  }
+  
+  printf("%-8s %5u step(s), %4u kept in %6llu byte(s), %u error(s)\n",
+         name, history->steps_count, kept, (unsigned long long)bytes_used, errors);
+  return errors;
+}
+
+void
+entry_point(void)
+{
+  os_init();
+  
+  Arena *arena = arena_alloc_default();
+  ED_TestHistory history = {0};
+  history.copies = ArenaPushArrayNoZero(arena, ED_TestMapCopy, ED_TEST_COPIES_COUNT);
+  G_TileMap *map = ArenaPushStruct(arena, G_TileMap);
+  ED_UndoContext undo = ed_undo_make();
+  U32 random = 12345;
+  U32 errors = 0;
+  
+  // Resizes: removals keep a whole row or column, so the bytes run out first
+  {
+    map->width = 64;
+    map->height = 64;
+    for (S32 idx = 0; idx < map->width*map->height; idx += 1) {
+      map->tokens[idx] = (G_TileToken)(ed_test_random(&random) % G_TileToken_COUNT);
+    }
+    history.steps_count = 0;
+    ed_test_copy_map(ed_test_copy_from_step(&history, 0), map);
+    
+    for (U32 idx = 0; idx < 8000; idx += 1) {
+      ed_test_history_push(&history, &undo, map, &random, 128);
+    }
+    if (undo.entries_count == history.steps_count || undo.entries_count == ED_UNDO_ENTRIES_MAX) {
+      printf("resizes: the byte ring did not evict steps\n");
+      errors += 1;
+    }
+    errors += ed_test_history_check(&history, &undo, map, (char *)"resizes");
+  }
+  
+  // Tiles: small steps, so the entries run out first
+  {
+    ed_undo_clear(&undo);
+    history.steps_count = 0;
+    ed_test_copy_map(ed_test_copy_from_step(&history, 0), map);
+    
+    for (U32 idx = 0; idx < 3*ED_UNDO_ENTRIES_MAX; idx += 1) {
+      ed_test_history_push(&history, &undo, map, &random, 0);
+    }
+    if (undo.entries_count != ED_UNDO_ENTRIES_MAX) {
+      printf("tiles: the entry ring did not fill up\n");
+      errors += 1;
+    }
+    errors += ed_test_history_check(&history, &undo, map, (char *)"tiles");
+  }
+  
+  // Branch: undo half the history, then push a step, which drops the redo steps
+  {
+    ed_undo_clear(&undo);
+    history.steps_count = 0;
+    ed_test_copy_map(ed_test_copy_from_step(&history, 0), map);
+    
+    for (U32 idx = 0; idx < 1000; idx += 1) {
+      ed_test_history_push(&history, &undo, map, &random, 64);
+    }
+    for (U32 idx = 0; idx < 500; idx += 1) {
+      ed_undo_pop(&undo, map);
+    }
+    history.steps_count -= 500;
+    ed_test_history_push(&history, &undo, map, &random, 64);
+    if (undo.entries_count != history.steps_count) {
+      printf("branch: the redo steps were kept\n");
+      errors += 1;
+    }
+    errors += ed_test_history_check(&history, &undo, map, (char *)"branch");
+  }
+  
+  ed_undo_release(&undo);
+  os_exit_process(errors != 0);
+}
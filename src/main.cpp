@@ -1,10 +1,16 @@
 #include "base/base_inc.h"
 #include "os/os_inc.h"
+#include "prof/prof_inc.h"
+#include "shader_cache/shader_cache_inc.h"
+#include "async/async_inc.h"
 #include "font/font_inc.h"
 #include "voxel/voxel_inc.h"
 
 #include "base/base_inc.cpp"
 #include "os/os_inc.cpp"
+#include "prof/prof_inc.cpp"
+#include "shader_cache/shader_cache_inc.cpp"
+#include "async/async_inc.cpp"
 #include "font/font_inc.cpp"
 #include "voxel/voxel_inc.cpp"
 
@@ -20,35 +26,19 @@ entry_point(void)
 {
   os_init();
   os_gfx_init();
+  prof_init();
+  prof_thread_set_name(S8("main"));
+  
+  // At least one worker, so that background jobs such as shader compiles never
+  // wait for the main thread
+  async_init((U32)Max(os_logical_processor_count(), 2) - 1);
   
   AppState app = {0};
   app.window = os_window_open(S8("VoxelEdit"), 1280, 720);
   app.arena = arena_alloc_default();
   app.vox_ctx = vox_ctx_make(app.window);
   
-  {
-    VOX_Context *ctx = &app.vox_ctx;
-    VOX_Chunk *chunk = &ctx->chunk;
-    for (S32 voxel_idx = 0; voxel_idx < VOX_CHUNK_SIZE; voxel_idx += 1) {
-      VOX_Voxel *v = &chunk->voxels[voxel_idx];
-      v->opacity = 155;
-      v->color = 2;
-      
-      v->id0 = (U8)((voxel_idx >> 8) & 255);
-      v->id1 = (U8)(voxel_idx & 255);
-#if 0
-      if (voxel_idx >= VOX_CHUNK_SIZE/8) {
-        v->color = 0;
-      }
-      if (voxel_idx >= VOX_CHUNK_SIZE/4) {
-        v->color = 3;
-      }
-      if (voxel_idx >= VOX_CHUNK_SIZE/2) {
-        v->color = 1;
-      }
-#endif
-    }
-  }
+  vox_world_make_test_scene(app.vox_ctx.world);
   
   while (!app.quit) {
     OS_Handle window = app.window;
@@ -61,15 +51,49 @@ entry_point(void)
       }
     }
     
-    vox_get_input(ctx, events);
-    vox_update_uniforms(ctx);
-    vox_update_edit_state(ctx);
-    vox_update_chunk(ctx);
+    ProfScope("update") {
+      vox_get_input(ctx, events);
+      vox_update_uniforms(ctx);
+      vox_update_edit_state(ctx);
+      ProfScope("vox_update_chunk") {
+        vox_update_chunk(ctx);
+      }
+    }
+    
+    ProfScope("vox_reload_shader") {
+      vox_reload_shader(ctx);
+    }
+    ProfScope("vox_render") {
+      vox_render(ctx);
+    }
+    ProfCounter("chunks", ctx->world->chunks_count);
     
-    vox_reload_shader(ctx);
-    vox_render(ctx);
+    prof_frame_end();
+    
+    // The app has no text rendering of its own, so the frame times go to the
+    // title bar, a few times a second.
+    if (prof_state->frames_count % 30 == 0) {
+      F64 last_ms, avg_ms, max_ms;
+      prof_frame_times(&last_ms, &avg_ms, &max_ms);
+      TempArena scratch = arena_scratch_begin(0, 0);
+      String8 title = str8_pushf(scratch.arena, (char *)"VoxelEdit - %.2f ms (avg %.2f, max %.2f)", last_ms, avg_ms, max_ms);
+      
+      // Compile errors print in full to the debugger's output; the title only
+      // shows the first line
+      String8 shader_error = ctx->renderer->shader_error;
+      if (shader_error.count > 0) {
+        U64 line_count = 0;
+        while (line_count < shader_error.count && !is_end_of_line(shader_error.data[line_count])) {
+          line_count += 1;
+        }
+        title = str8_pushf(scratch.arena, (char *)"%.*s - shader error: %.*s", (int)title.count, title.data, (int)line_count, shader_error.data);
+      }
+      os_window_set_title(window, title);
+      arena_scratch_end(scratch);
+    }
   }
   
+  async_release();
   arena_release(app.arena);
   os_window_close(app.window);
 }
\ No newline at end of file
@@ -1,23 +1,617 @@
-function String 
-OS_ReadFile(Arena *arena, String path)
+//
+// Linux-specific helpers
+//
+
+function OS_Linux_Entity *
+os_linux_entity_alloc(OS_Linux_EntityKind kind)
 {
-  U8 *data     = 0;
-  U32 filesize = 0;
+  pthread_mutex_lock(&os_linux_state.entity_mutex);
+  OS_Linux_Entity *entity = os_linux_state.entity_free;
+  if (entity) {
+    os_linux_state.entity_free = entity->next;
+  }
+  else {
+    entity = ArenaPushStruct(os_linux_state.arena, OS_Linux_Entity);
+  }
+  pthread_mutex_unlock(&os_linux_state.entity_mutex);
+  
+  MemoryZeroStruct(entity);
+  entity->kind = kind;
+  return entity;
+}
+
+function void
+os_linux_entity_release(OS_Linux_Entity *entity)
+{
+  entity->kind = OS_Linux_EntityKind_Null;
+  pthread_mutex_lock(&os_linux_state.entity_mutex);
+  entity->next = os_linux_state.entity_free;
+  os_linux_state.entity_free = entity;
+  pthread_mutex_unlock(&os_linux_state.entity_mutex);
+}
+
+function OS_Linux_Entity *
+os_linux_entity_from_handle(OS_Handle handle)
+{
+  OS_Linux_Entity *result = (OS_Linux_Entity *)handle.h[0];
+  return result;
+}
+
+function OS_Handle
+os_linux_handle_from_entity(OS_Linux_Entity *entity)
+{
+  OS_Handle result = {0};
+  result.h[0] = (U64)entity;
+  return result;
+}
+
+// Absolute CLOCK_REALTIME deadline `duration_ms` from now, for the *timed* calls.
+function struct timespec
+os_linux_deadline_from_duration(U32 duration_ms)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  U64 nsec = (U64)ts.tv_nsec + (U64)(duration_ms % 1000)*1000000;
+  ts.tv_sec += duration_ms/1000 + nsec/1000000000;
+  ts.tv_nsec = nsec % 1000000000;
+  return ts;
+}
+
+// 
+// OS subsystem init
+//
+
+function void 
+os_init(void)
+{
+  pthread_mutex_init(&os_linux_state.entity_mutex, 0);
+  os_linux_state.arena = arena_alloc_default();
+}
+
+//
+// File IO
+//
 
-  FILE *file = fopen((char *)path.data, "rb");
+function String8 
+os_file_read(Arena *arena, String8 path)
+{
+  U8 *data     = 0;
+  U64 filesize = 0;
+  
+  TempArena scratch = arena_scratch_begin(&arena, 1);
+  String8 path_cstr = str8_pushf(scratch.arena, (char *)"%.*s", (int)path.count, path.data);
+  
+  FILE *file = fopen((char *)path_cstr.data, "rb");
   if (file) {
-    fseek(file, 0, SEEK_END);
-    filesize = ftell(file);
-    rewind(file);
+    struct stat st;
+    if (fstat(fileno(file), &st) == 0) {
+      filesize = (U64)st.st_size;
+    }
     data = ArenaPushArray(arena, U8, filesize + 1);
-    fread(data, 1, filesize, file);
+    filesize = fread(data, 1, filesize, file);
     data[filesize] = '\0';
     fclose(file);
   }
-
-  String str = {
-    .data  = data,
-    .count = filesize,
-  };
+  
+  arena_scratch_end(scratch);
+  
+  String8 str = {0};
+  str.data = data;
+  str.count = filesize;
   return str;
 }
+
+function B32
+os_file_write(String8 path, String8 data)
+{
+  B32 result = 0;
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  String8 path_cstr = str8_pushf(scratch.arena, (char *)"%.*s", (int)path.count, path.data);
+  
+  FILE *file = fopen((char *)path_cstr.data, "wb");
+  if (file) {
+    U64 written = fwrite(data.data, 1, data.count, file);
+    result = (written == data.count);
+    fclose(file);
+  }
+  
+  arena_scratch_end(scratch);
+  return result;
+}
+
+function B32
+os_directory_make(String8 path)
+{
+  TempArena scratch = arena_scratch_begin(0, 0);
+  String8 path_cstr = str8_pushf(scratch.arena, (char *)"%.*s", (int)path.count, path.data);
+  B32 result = (mkdir((char *)path_cstr.data, 0755) == 0 || errno == EEXIST);
+  arena_scratch_end(scratch);
+  return result;
+}
+
+// NOTE: The handle stores the descriptor plus one, so that zero stays the null handle.
+function OS_Handle
+os_file_open(String8 path, OS_FileAccessFlags flags)
+{
+  OS_Handle result = {0};
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  String8 path_cstr = str8_pushf(scratch.arena, (char *)"%.*s", (int)path.count, path.data);
+  
+  int oflags = 0;
+  if ((flags & OS_FileAccess_Read) && (flags & OS_FileAccess_Write)) {
+    oflags = O_RDWR | O_CREAT | O_TRUNC;
+  }
+  else if (flags & OS_FileAccess_Write) {
+    oflags = O_WRONLY | O_CREAT | O_TRUNC;
+  }
+  else {
+    oflags = O_RDONLY;
+  }
+  
+  int fd = open((char *)path_cstr.data, oflags, 0644);
+  if (fd >= 0) {
+    result.h[0] = (U64)fd + 1;
+  }
+  
+  arena_scratch_end(scratch);
+  return result;
+}
+
+function void
+os_file_close(OS_Handle file)
+{
+  int fd = (int)(file.h[0] - 1);
+  close(fd);
+}
+
+function U64
+os_file_size(OS_Handle file)
+{
+  int fd = (int)(file.h[0] - 1);
+  struct stat st = {0};
+  U64 result = 0;
+  if (fstat(fd, &st) == 0) {
+    result = (U64)st.st_size;
+  }
+  return result;
+}
+
+function B32
+os_file_write_at(OS_Handle file, U64 offset, String8 data)
+{
+  int fd = (int)(file.h[0] - 1);
+  B32 result = 1;
+  
+  U64 written_total = 0;
+  while (written_total < data.count) {
+    ssize_t written = pwrite(fd, data.data + written_total, data.count - written_total, (off_t)(offset + written_total));
+    if (written <= 0) {
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+      result = 0;
+      break;
+    }
+    written_total += (U64)written;
+  }
+  
+  return result;
+}
+
+function void *
+os_file_map_view(OS_Handle file, U64 size)
+{
+  int fd = (int)(file.h[0] - 1);
+  void *result = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (result == MAP_FAILED) {
+    result = 0;
+  }
+  return result;
+}
+
+function void
+os_file_unmap_view(void *view, U64 size)
+{
+  munmap(view, size);
+}
+
+// File watches
+
+function U64
+os_linux_mtime_from_path(char *path)
+{
+  U64 result = 0;
+  struct stat st = {0};
+  if (stat(path, &st) == 0) {
+    result = (U64)st.st_mtim.tv_sec*1000000000ull + (U64)st.st_mtim.tv_nsec;
+  }
+  return result;
+}
+
+function OS_Handle
+os_file_watch_open(String8 path, OS_FileWatchFlags flags)
+{
+  OS_Handle result = {0};
+  
+  String8 dir = {0};
+  String8 name = {0};
+  os_path_split(path, &dir, &name);
+  
+  OS_Linux_Entity *entity = os_linux_entity_alloc(OS_Linux_EntityKind_FileWatch);
+  
+  // NOTE: The strings stay in the OS arena when the watch is closed; watches are
+  // few and long-lived.
+  pthread_mutex_lock(&os_linux_state.entity_mutex);
+  entity->file_watch.path = str8_pushf(os_linux_state.arena, (char *)"%.*s", (int)path.count, path.data);
+  entity->file_watch.name = str8_pushf(os_linux_state.arena, (char *)"%.*s", (int)name.count, name.data);
+  pthread_mutex_unlock(&os_linux_state.entity_mutex);
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  String8 dir_cstr = str8_pushf(scratch.arena, (char *)"%.*s", (int)dir.count, dir.data);
+  
+  // Closing after a write, and renames into the directory, are when a file's
+  // new contents are complete. A touch only changes attributes, but polling the
+  // modification time sees it, so it counts here too.
+  int fd = (flags & OS_FileWatch_Poll) ? -1 : inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  U32 mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB;
+  if (fd >= 0 && inotify_add_watch(fd, (char *)dir_cstr.data, mask) < 0) {
+    close(fd);
+    fd = -1;
+  }
+  entity->file_watch.inotify_fd = fd;
+  entity->file_watch.mtime = os_linux_mtime_from_path((char *)entity->file_watch.path.data);
+  
+  arena_scratch_end(scratch);
+  
+  if (fd >= 0 || entity->file_watch.mtime != 0) {
+    result = os_linux_handle_from_entity(entity);
+  }
+  else {
+    os_linux_entity_release(entity);
+  }
+  
+  return result;
+}
+
+function void
+os_file_watch_close(OS_Handle watch)
+{
+  OS_Linux_Entity *entity = os_linux_entity_from_handle(watch);
+  if (entity) {
+    if (entity->file_watch.inotify_fd >= 0) {
+      close(entity->file_watch.inotify_fd);
+    }
+    os_linux_entity_release(entity);
+  }
+}
+
+function B32
+os_file_watch_changed(OS_Handle watch)
+{
+  B32 result = 0;
+  
+  OS_Linux_Entity *entity = os_linux_entity_from_handle(watch);
+  if (entity) {
+    if (entity->file_watch.inotify_fd >= 0) {
+      // Drain everything queued; any event naming the file counts
+      alignas(struct inotify_event) char buffer[4096];
+      for (;;) {
+        ssize_t size = read(entity->file_watch.inotify_fd, buffer, sizeof(buffer));
+        if (size <= 0) {
+          break;
+        }
+        for (ssize_t at = 0; at < size;) {
+          struct inotify_event *event = (struct inotify_event *)(buffer + at);
+          if (event->len > 0 && cstr_equal(event->name, (char *)entity->file_watch.name.data)) {
+            result = 1;
+          }
+          if (event->mask & IN_Q_OVERFLOW) {
+            result = 1; // Events were dropped; ours may have been among them
+          }
+          at += sizeof(struct inotify_event) + event->len;
+        }
+      }
+    }
+    else {
+      U64 mtime = os_linux_mtime_from_path((char *)entity->file_watch.path.data);
+      if (mtime != entity->file_watch.mtime) {
+        entity->file_watch.mtime = mtime;
+        result = 1;
+      }
+    }
+  }
+  
+  return result;
+}
+
+//
+// System info
+//
+
+function U64 
+os_page_size(void) 
+{
+  U64 result = (U64)sysconf(_SC_PAGESIZE);
+  return result;
+}
+
+function U64 
+os_logical_processor_count(void)
+{
+  U64 result = (U64)sysconf(_SC_NPROCESSORS_ONLN);
+  return result;
+}
+
+//
+// Memory
+//
+
+// NOTE: Reserved ranges are PROT_NONE and MAP_NORESERVE, so they cost address
+// space only. Committing flips pages to read/write; the kernel backs them on
+// first touch. Decommitting hands the pages back with MADV_DONTNEED (they read
+// as zero if committed again) and makes the range inaccessible again.
+
+function void *
+os_reserve(U64 size)
+{
+  void *memory = mmap(0, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (memory == MAP_FAILED) {
+    memory = 0;
+  }
+  return memory; 
+}
+
+function void 
+os_commit(void *mem, U64 size) 
+{
+  U64 page_size = os_page_size();
+  U64 size_round_next_page_size = AlignPow2(size, page_size); 
+  mprotect(mem, size_round_next_page_size, PROT_READ | PROT_WRITE);
+}
+
+function void 
+os_decommit(void *mem, U64 size)
+{
+  U64 page_size = os_page_size();
+  U64 size_round_next_page_size = AlignPow2(size, page_size); 
+  madvise(mem, size_round_next_page_size, MADV_DONTNEED);
+  mprotect(mem, size_round_next_page_size, PROT_NONE);
+}
+
+function void 
+os_release(void *mem, U64 size)
+{
+  munmap(mem, size);
+}
+
+//
+// Processes
+//
+
+function void 
+os_exit_process(S32 exit_code)
+{
+  exit(exit_code);
+}
+
+// NOTE: The first argument is the program path, as with argv.
+function String8List
+os_get_command_line_args(Arena *arena)
+{
+  String8List result = {0};
+  for (int idx = 0; idx < os_linux_state.argc; idx += 1) {
+    char *arg = os_linux_state.argv[idx];
+    str8_list_push(arena, &result, str8((U8 *)arg, cstr_count(arg)));
+  }
+  return result;
+}
+
+//
+// High-resolution performance counter
+//
+
+// NOTE: Ticks are CLOCK_MONOTONIC nanoseconds.
+function F64
+os_get_ticks(void) 
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  F64 result = (F64)ts.tv_sec*1000000000.0 + (F64)ts.tv_nsec;
+  return result;
+}
+
+function F64
+os_get_ticks_frequency(void)
+{
+  return 1000000000.0;
+}
+
+//
+// Multithreading and synchronization
+//
+
+// Threads
+
+function void *
+os_linux_thread_entry_point(void *param)
+{
+  OS_Linux_Entity *entity = (OS_Linux_Entity *)param;
+  entity->thread.func(entity->thread.param);
+  if (os_interlocked_decrement_32(&entity->thread.refs) == 0) {
+    os_linux_entity_release(entity);
+  }
+  return 0;
+}
+
+function OS_Handle
+os_thread_launch(os_thread_entry_point *entry_point, void *param, U32 *id)
+{
+  OS_Handle result = {0};
+  
+  OS_Linux_Entity *entity = os_linux_entity_alloc(OS_Linux_EntityKind_Thread);
+  entity->thread.func = entry_point;
+  entity->thread.param = param;
+  entity->thread.refs = 2;
+  
+  if (pthread_create(&entity->thread.handle, 0, os_linux_thread_entry_point, entity) == 0) {
+    result = os_linux_handle_from_entity(entity);
+    if (id) {
+      *id = (U32)entity->thread.handle;
+    }
+  }
+  else {
+    os_linux_entity_release(entity);
+  }
+  
+  return result;
+}
+
+function B32
+os_thread_join(OS_Handle handle, U32 duration_ms)
+{
+  OS_Linux_Entity *entity = os_linux_entity_from_handle(handle);
+  int result = 0;
+  if (duration_ms == OS_WAIT_INFINITE) {
+    result = pthread_join(entity->thread.handle, 0);
+  }
+  else {
+    struct timespec deadline = os_linux_deadline_from_duration(duration_ms);
+    result = pthread_timedjoin_np(entity->thread.handle, 0, &deadline);
+  }
+  B32 joined = (result == 0);
+  if (joined) {
+    entity->thread.joined = 1;
+  }
+  return joined;
+}
+
+// NOTE: Detaches a thread that hasn't been joined, like closing the handle on Win32.
+// A detached thread may still be running, or not have started yet, so the entity
+// is only released once both the handle and the thread are done with it.
+function void 
+os_thread_delete(OS_Handle handle)
+{
+  OS_Linux_Entity *entity = os_linux_entity_from_handle(handle);
+  if (entity) {
+    if (!entity->thread.joined) {
+      pthread_detach(entity->thread.handle);
+    }
+    if (os_interlocked_decrement_32(&entity->thread.refs) == 0) {
+      os_linux_entity_release(entity);
+    }
+  }
+}
+
+// Semaphores
+
+// NOTE: POSIX semaphores have no upper bound, so max_count is ignored.
+function OS_Handle
+os_semaphore_create(U32 init_count, U32 max_count)
+{
+  (void)max_count;
+  OS_Linux_Entity *entity = os_linux_entity_alloc(OS_Linux_EntityKind_Semaphore);
+  sem_init(&entity->semaphore, 0, init_count);
+  OS_Handle result = os_linux_handle_from_entity(entity);
+  return result;
+}
+
+function void
+os_semaphore_delete(OS_Handle handle)
+{
+  OS_Linux_Entity *entity = os_linux_entity_from_handle(handle);
+  sem_destroy(&entity->semaphore);
+  os_linux_entity_release(entity);
+}
+
+function B32
+os_semaphore_wait(OS_Handle handle, U32 duration_ms)
+{
+  OS_Linux_Entity *entity = os_linux_entity_from_handle(handle);
+  int result = 0;
+  if (duration_ms == OS_WAIT_INFINITE) {
+    do {
+      result = sem_wait(&entity->semaphore);
+    } while (result != 0 && errno == EINTR);
+  }
+  else {
+    struct timespec deadline = os_linux_deadline_from_duration(duration_ms);
+    do {
+      result = sem_timedwait(&entity->semaphore, &deadline);
+    } while (result != 0 && errno == EINTR);
+  }
+  B32 signaled = (result == 0);
+  return signaled;
+}
+
+function void
+os_semaphore_post(OS_Handle handle)
+{
+  OS_Linux_Entity *entity = os_linux_entity_from_handle(handle);
+  sem_post(&entity->semaphore);
+}
+
+// Atomic operations
+
+// NOTE: Same contract as the Win32 Interlocked* intrinsics: compare-exchange
+// returns the previous value, increment/decrement return the new one.
+
+function U32
+os_interlocked_compare_exchange_32(volatile U32 *dst, U32 exchange, U32 cmp)
+{
+  U32 latest = cmp;
+  __atomic_compare_exchange_n(dst, &latest, exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  return latest;
+}
+
+function U32 
+os_interlocked_increment_32(volatile U32 *v)
+{
+  U32 result = __atomic_add_fetch(v, 1, __ATOMIC_SEQ_CST);
+  return result;
+}
+
+function U32 
+os_interlocked_decrement_32(volatile U32 *v)
+{
+  U32 result = __atomic_sub_fetch(v, 1, __ATOMIC_SEQ_CST);
+  return result;
+}
+
+function void
+os_memory_barrier(void)
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// Spinning
+
+function void
+os_cpu_pause(void)
+{
+#if ARCH_X64 || ARCH_X86
+  __builtin_ia32_pause();
+#elif ARCH_ARM64 || ARCH_ARM32
+  __asm__ __volatile__("yield");
+#endif
+}
+
+function void
+os_thread_yield(void)
+{
+  sched_yield();
+}
+
+//
+// Program entry point
+//
+
+int main(int argcount, char **arguments)
+{
+  os_linux_state.argc = argcount;
+  os_linux_state.argv = arguments;
+  entry_point();
+  
+  return 0;
+}
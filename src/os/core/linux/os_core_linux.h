@@ -0,0 +1,43 @@
+#pragma once
+
+// NOTE: Threads, semaphores and file watches live in entities allocated from the OS arena and
+// recycled through a free list; OS_Handle stores the entity pointer.
+
+enum OS_Linux_EntityKind {
+  OS_Linux_EntityKind_Null,
+  OS_Linux_EntityKind_Thread,
+  OS_Linux_EntityKind_Semaphore,
+  OS_Linux_EntityKind_FileWatch,
+};
+
+struct OS_Linux_Entity {
+  OS_Linux_Entity *next;
+  OS_Linux_EntityKind kind;
+  union {
+    struct {
+      pthread_t handle;
+      os_thread_entry_point *func;
+      void *param;
+      B32 joined; // A joined thread is gone, and must not be detached
+      U32 refs;   // Held by the handle and by the thread; the last one releases
+    } thread;
+    sem_t semaphore;
+    struct {
+      int inotify_fd; // -1 when polling the modification time instead
+      String8 path;   // Nul-terminated, like `name`
+      String8 name;
+      U64 mtime;
+    } file_watch;
+  };
+};
+
+struct OS_Linux_State {
+  Arena *arena;
+  int argc;
+  char **argv;
+  
+  pthread_mutex_t entity_mutex;
+  OS_Linux_Entity *entity_free;
+};
+
+global OS_Linux_State os_linux_state;
@@ -1 +1,29 @@
 // Platform-independent OS code here...
+
+function B32
+os_handle_is_null(OS_Handle handle)
+{
+  B32 result = (handle.h[0] == 0);
+  return result;
+}
+
+function void
+os_path_split(String8 path, String8 *dir, String8 *name)
+{
+  U64 slash = path.count;
+  for (U64 idx = path.count; idx > 0; idx -= 1) {
+    if (path.data[idx - 1] == '/' || path.data[idx - 1] == '\\') {
+      slash = idx - 1;
+      break;
+    }
+  }
+  
+  if (slash == path.count) {
+    *dir = S8(".");
+    *name = path;
+  }
+  else {
+    *dir = str8(path.data, Max(slash, 1)); // Keeps the root of "/file"
+    *name = str8(path.data + slash + 1, path.count - slash - 1);
+  }
+}
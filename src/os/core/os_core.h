@@ -4,6 +4,8 @@ struct OS_Handle {
   U64 h[1]; 
 };
 
+function B32 os_handle_is_null(OS_Handle handle);
+
 // 
 // OS subsystem init
 //
@@ -15,6 +17,41 @@ function void os_init(void);
 //
 
 function String8 os_file_read(Arena *arena, String8 path);
+function B32 os_file_write(String8 path, String8 data);
+function B32 os_directory_make(String8 path); // Succeeds when it already exists
+
+// File handles, for streaming writes and memory-mapped reads. Opening for write
+// creates the file or truncates it. Views are read-only and stay valid after the
+// file is closed, until they are unmapped.
+typedef U32 OS_FileAccessFlags;
+enum {
+  OS_FileAccess_Read  = (1 << 0),
+  OS_FileAccess_Write = (1 << 1),
+};
+
+function OS_Handle os_file_open(String8 path, OS_FileAccessFlags flags);
+function void os_file_close(OS_Handle file);
+function U64 os_file_size(OS_Handle file);
+function B32 os_file_write_at(OS_Handle file, U64 offset, String8 data);
+function void *os_file_map_view(OS_Handle file, U64 size);
+function void os_file_unmap_view(void *view, U64 size);
+
+// File change notifications. A watch reports changes to one file, including the
+// file being replaced through a rename, as many editors save, and being touched.
+// The file's directory is watched (inotify, ReadDirectoryChangesW); where that
+// isn't possible, or with OS_FileWatch_Poll, the modification time is polled
+// instead. Returns a null handle when neither works.
+typedef U32 OS_FileWatchFlags;
+enum {
+  OS_FileWatch_Poll = (1 << 0),
+};
+
+function OS_Handle os_file_watch_open(String8 path, OS_FileWatchFlags flags);
+function void os_file_watch_close(OS_Handle watch);
+function B32 os_file_watch_changed(OS_Handle watch); // Since the last call; never blocks
+
+// Splits at the last slash; `dir` is "." when there is none.
+function void os_path_split(String8 path, String8 *dir, String8 *name);
 
 // 
 // System info
@@ -30,13 +67,14 @@ function U64 os_logical_processor_count(void);
 function void *os_reserve(U64 size);
 function void os_commit(void *mem, U64 size);
 function void os_decommit(void *mem, U64 size);
-function void os_release(void *mem);
+function void os_release(void *mem, U64 size);
 
 //
 // Processes
 //
 
 function void os_exit_process(S32 exit_code);
+function String8List os_get_command_line_args(Arena *arena);
 
 //
 // High-resolution performance counter
@@ -54,6 +92,7 @@ function F64 os_get_ticks_frequency(void);
 typedef void os_thread_entry_point(void *);
 
 function OS_Handle os_thread_launch(os_thread_entry_point *entry_point, void *param, U32 *id);
+function B32 os_thread_join(OS_Handle handle, U32 duration_ms);
 function void os_thread_delete(OS_Handle handle);
 
 // Semaphores
@@ -66,6 +105,12 @@ function void os_semaphore_post(OS_Handle handle);
 function U32 os_interlocked_compare_exchange_32(volatile U32 *dst, U32 exchange, U32 cmp);
 function U32 os_interlocked_increment_32(volatile U32 *v);
 function U32 os_interlocked_decrement_32(volatile U32 *v);
+function void os_memory_barrier(void); // Full fence: no loads or stores move across it
+
+// Spinning: a hint to the CPU inside a spin-wait, and giving up the rest of the
+// thread's time slice
+function void os_cpu_pause(void);
+function void os_thread_yield(void);
 
 //
 // Program entry point
@@ -90,6 +90,242 @@ os_file_read(Arena *arena, String8 path)
   return str;
 }
 
+function B32
+os_file_write(String8 path, String8 data)
+{
+  B32 result = 0;
+  
+  FILE *file = fopen((char *)path.data, "wb");
+  if (file) {
+    U64 written = fwrite(data.data, 1, data.count, file);
+    result = (written == data.count);
+    fclose(file);
+  }
+  
+  return result;
+}
+
+function B32
+os_directory_make(String8 path)
+{
+  TempArena scratch = arena_scratch_begin(0, 0);
+  String8 path_cstr = str8_pushf(scratch.arena, (char *)"%.*s", (int)path.count, path.data);
+  B32 result = (CreateDirectoryA((char *)path_cstr.data, 0) || GetLastError() == ERROR_ALREADY_EXISTS);
+  arena_scratch_end(scratch);
+  return result;
+}
+
+function OS_Handle
+os_file_open(String8 path, OS_FileAccessFlags flags)
+{
+  OS_Handle result = {0};
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  String8 path_cstr = str8_pushf(scratch.arena, (char *)"%.*s", (int)path.count, path.data);
+  
+  DWORD access = 0;
+  DWORD share = 0;
+  DWORD creation = OPEN_EXISTING;
+  if (flags & OS_FileAccess_Read) {
+    access |= GENERIC_READ;
+    share |= FILE_SHARE_READ;
+  }
+  if (flags & OS_FileAccess_Write) {
+    access |= GENERIC_WRITE;
+    creation = CREATE_ALWAYS;
+  }
+  
+  HANDLE file = CreateFileA((char *)path_cstr.data, access, share, 0, creation, FILE_ATTRIBUTE_NORMAL, 0);
+  if (file != INVALID_HANDLE_VALUE) {
+    result.h[0] = (U64)file;
+  }
+  
+  arena_scratch_end(scratch);
+  return result;
+}
+
+function void
+os_file_close(OS_Handle file)
+{
+  HANDLE h = os_win32_handle_from_handle(file);
+  CloseHandle(h);
+}
+
+function U64
+os_file_size(OS_Handle file)
+{
+  HANDLE h = os_win32_handle_from_handle(file);
+  LARGE_INTEGER size = {0};
+  GetFileSizeEx(h, &size);
+  return (U64)size.QuadPart;
+}
+
+function B32
+os_file_write_at(OS_Handle file, U64 offset, String8 data)
+{
+  HANDLE h = os_win32_handle_from_handle(file);
+  B32 result = 1;
+  
+  U64 written_total = 0;
+  while (written_total < data.count) {
+    U64 at = offset + written_total;
+    OVERLAPPED overlapped = {0};
+    overlapped.Offset = (DWORD)(at & 0xFFFFFFFF);
+    overlapped.OffsetHigh = (DWORD)(at >> 32);
+    
+    DWORD to_write = (DWORD)Min(data.count - written_total, MAX_U32);
+    DWORD written = 0;
+    if (!WriteFile(h, data.data + written_total, to_write, &written, &overlapped) || written == 0) {
+      result = 0;
+      break;
+    }
+    written_total += written;
+  }
+  
+  return result;
+}
+
+// NOTE: The view keeps the mapping object alive, so its handle is closed right away.
+function void *
+os_file_map_view(OS_Handle file, U64 size)
+{
+  void *result = 0;
+  
+  HANDLE h = os_win32_handle_from_handle(file);
+  HANDLE mapping = CreateFileMappingA(h, 0, PAGE_READONLY, 0, 0, 0);
+  if (mapping) {
+    result = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+    CloseHandle(mapping);
+  }
+  
+  return result;
+}
+
+function void
+os_file_unmap_view(void *view, U64 size)
+{
+  (void)size;
+  UnmapViewOfFile(view);
+}
+
+// File watches
+
+function U64
+os_win32_mtime_from_path(char *path)
+{
+  U64 result = 0;
+  WIN32_FILE_ATTRIBUTE_DATA attributes = {0};
+  if (GetFileAttributesExA(path, GetFileExInfoStandard, &attributes)) {
+    result = ((U64)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+  }
+  return result;
+}
+
+function B32
+os_win32_file_watch_issue(OS_Win32_FileWatch *watch)
+{
+  MemoryZeroStruct(&watch->overlapped);
+  B32 result = ReadDirectoryChangesW(watch->dir, watch->buffer, sizeof(watch->buffer), FALSE,
+                                     FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+                                     0, &watch->overlapped, 0);
+  return result;
+}
+
+function OS_Handle
+os_file_watch_open(String8 path, OS_FileWatchFlags flags)
+{
+  OS_Handle result = {0};
+  
+  String8 dir = {0};
+  String8 name = {0};
+  os_path_split(path, &dir, &name);
+  
+  Arena *arena = os_win32_state.arena;
+  OS_Win32_FileWatch *watch = ArenaPushStruct(arena, OS_Win32_FileWatch);
+  watch->path = str8_pushf(arena, (char *)"%.*s", (int)path.count, path.data);
+  watch->name = str16_from_str8(arena, name);
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  String8 dir_cstr = str8_pushf(scratch.arena, (char *)"%.*s", (int)dir.count, dir.data);
+  
+  watch->dir = INVALID_HANDLE_VALUE;
+  if (!(flags & OS_FileWatch_Poll)) {
+    watch->dir = CreateFileA((char *)dir_cstr.data, FILE_LIST_DIRECTORY,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING,
+                             FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, 0);
+  }
+  if (watch->dir != INVALID_HANDLE_VALUE && !os_win32_file_watch_issue(watch)) {
+    CloseHandle(watch->dir);
+    watch->dir = INVALID_HANDLE_VALUE;
+  }
+  watch->mtime = os_win32_mtime_from_path((char *)watch->path.data);
+  
+  arena_scratch_end(scratch);
+  
+  if (watch->dir != INVALID_HANDLE_VALUE || watch->mtime != 0) {
+    result.h[0] = (U64)watch;
+  }
+  
+  return result;
+}
+
+function void
+os_file_watch_close(OS_Handle watch_handle)
+{
+  OS_Win32_FileWatch *watch = (OS_Win32_FileWatch *)watch_handle.h[0];
+  if (watch && watch->dir != INVALID_HANDLE_VALUE) {
+    CancelIo(watch->dir);
+    
+    // The pending read writes into the watch until the cancellation completes
+    DWORD bytes = 0;
+    GetOverlappedResult(watch->dir, &watch->overlapped, &bytes, TRUE);
+    CloseHandle(watch->dir);
+    watch->dir = INVALID_HANDLE_VALUE;
+  }
+}
+
+function B32
+os_file_watch_changed(OS_Handle watch_handle)
+{
+  B32 result = 0;
+  
+  OS_Win32_FileWatch *watch = (OS_Win32_FileWatch *)watch_handle.h[0];
+  if (watch && watch->dir != INVALID_HANDLE_VALUE) {
+    DWORD bytes = 0;
+    while (GetOverlappedResult(watch->dir, &watch->overlapped, &bytes, FALSE)) {
+      if (bytes == 0) {
+        result = 1; // The buffer overflowed and changes were dropped; ours may have been among them
+      }
+      else {
+        // File names compare case-insensitively, as the file system does
+        for (U8 *at = (U8 *)watch->buffer; at != 0;) {
+          FILE_NOTIFY_INFORMATION *info = (FILE_NOTIFY_INFORMATION *)at;
+          S32 name_count = (S32)(info->FileNameLength / sizeof(WCHAR));
+          if (CompareStringOrdinal(info->FileName, name_count, (WCHAR *)watch->name.data, (S32)watch->name.count, TRUE) == CSTR_EQUAL) {
+            result = 1;
+          }
+          at = (info->NextEntryOffset != 0) ? at + info->NextEntryOffset : 0;
+        }
+      }
+      
+      if (!os_win32_file_watch_issue(watch)) {
+        CloseHandle(watch->dir);
+        watch->dir = INVALID_HANDLE_VALUE;
+        break;
+      }
+    }
+  }
+  else if (watch) {
+    U64 mtime = os_win32_mtime_from_path((char *)watch->path.data);
+    if (mtime != watch->mtime) {
+      watch->mtime = mtime;
+      result = 1;
+    }
+  }
+  
+  return result;
+}
+
 //
 // System info
 //
@@ -137,8 +373,9 @@ os_decommit(void *mem, U64 size)
 }
 
 function void 
-os_release(void *mem)
+os_release(void *mem, U64 size)
 {
+  (void)size; // NOTE: MEM_RELEASE always frees the whole reservation
   VirtualFree(mem, 0, MEM_RELEASE);
 }
 
@@ -152,6 +389,18 @@ os_exit_process(S32 exit_code)
   ExitProcess(exit_code);
 }
 
+// NOTE: The first argument is the program path, as with argv.
+function String8List
+os_get_command_line_args(Arena *arena)
+{
+  String8List result = {0};
+  for (int idx = 0; idx < os_win32_state.argc; idx += 1) {
+    char *arg = os_win32_state.argv[idx];
+    str8_list_push(arena, &result, str8((U8 *)arg, cstr_count(arg)));
+  }
+  return result;
+}
+
 //
 // High-resolution performance counter
 //
@@ -207,6 +456,15 @@ os_thread_launch(os_thread_entry_point *entry_point, void *param, U32 *id)
   return result;
 }
 
+function B32
+os_thread_join(OS_Handle handle, U32 duration_ms)
+{
+  HANDLE h = os_win32_handle_from_handle(handle);
+  DWORD result = WaitForSingleObject(h, duration_ms);
+  B32 joined = (result == WAIT_OBJECT_0);
+  return joined;
+}
+
 function void 
 os_thread_delete(OS_Handle handle)
 {
@@ -274,6 +532,26 @@ os_interlocked_decrement_32(volatile U32 *v)
   return prev;
 }
 
+function void
+os_memory_barrier(void)
+{
+  MemoryBarrier();
+}
+
+// Spinning
+
+function void
+os_cpu_pause(void)
+{
+  YieldProcessor();
+}
+
+function void
+os_thread_yield(void)
+{
+  SwitchToThread();
+}
+
 //
 // Program entry point
 //
@@ -282,10 +560,9 @@ os_interlocked_decrement_32(volatile U32 *v)
 #if BUILD_CLI
 int main(int argcount, char **arguments)
 {
-  (void)argcount;
-  (void)arguments;
-  
   os_win32_state.hinstance = GetModuleHandle(0);
+  os_win32_state.argc = argcount;
+  os_win32_state.argv = arguments;
   entry_point();
   
   return 0;
@@ -294,11 +571,9 @@ int main(int argcount, char **arguments)
 int WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR lp_cmd_line, int n_show_cmd)
 {
   os_win32_state.hinstance = instance;
-  int argc = __argc;
-  char **argv = __argv;
+  os_win32_state.argc = __argc;
+  os_win32_state.argv = __argv;
   
-  (void)argc;
-  (void)argv;
   (void)prev_instance;
   (void)lp_cmd_line;
   (void)n_show_cmd;
@@ -4,6 +4,19 @@ struct OS_Win32_State {
   Arena *arena;
   HINSTANCE hinstance; // NOTE: Used by os/gfx/win32
   LARGE_INTEGER hrpc;
+  int argc;
+  char **argv;
+};
+
+// NOTE: Allocated from the OS arena and not reused after closing; watches are
+// few and long-lived.
+struct OS_Win32_FileWatch {
+  HANDLE dir; // INVALID_HANDLE_VALUE when polling the modification time instead
+  OVERLAPPED overlapped;
+  DWORD buffer[1024]; // FILE_NOTIFY_INFORMATION records, which must be DWORD-aligned
+  String16 name;
+  String8 path; // Nul-terminated
+  U64 mtime;
 };
 
 global OS_Win32_State os_win32_state;
@@ -160,6 +160,7 @@ function void os_window_maximize(OS_Handle window);
 function void os_window_restore(OS_Handle window);
 function void os_window_fullscreen_enter(OS_Handle window);
 function void os_window_fullscreen_exit(OS_Handle window);
+function void os_window_set_title(OS_Handle window, String8 title);
 
 function RectU32 os_window_rect(OS_Handle window);
 function RectU32 os_window_client_rect(OS_Handle window);
@@ -413,6 +413,17 @@ os_window_fullscreen_exit(OS_Handle window)
   }
 }
 
+function void
+os_window_set_title(OS_Handle window, String8 title)
+{
+  OS_Win32_Window *win32_window = os_win32_window_from_handle(window);
+  
+  // SetWindowText wants a nul-terminated string
+  TempArena scratch = arena_scratch_begin(0, 0);
+  String8 title_cstr = str8_pushf(scratch.arena, (char *)"%.*s", (int)title.count, title.data);
+  SetWindowText(win32_window->hwnd, (LPCSTR)title_cstr.data);
+  arena_scratch_end(scratch);
+}
 
 function RectU32
 os_window_rect(OS_Handle window)
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "os/core/os_core.h"
-#include "os/gfx/os_gfx.h"
+#if !BUILD_HEADLESS
+# include "os/gfx/os_gfx.h"
+#endif
 
 #if OS_WINDOWS
 # define WIN32_LEAN_AND_MEAN
@@ -9,6 +11,26 @@
 # include <windows.h>
 # pragma warning (pop)
 # include "os/core/win32/os_core_win32.h"
-# include "os/gfx/win32/os_gfx_win32.h"
-#else #error OS layer not implemented on this platform.
+# if !BUILD_HEADLESS
+#  include "os/gfx/win32/os_gfx_win32.h"
+# endif
+#elif OS_LINUX
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/inotify.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <pthread.h>
+# include <sched.h>
+# include <semaphore.h>
+# include <errno.h>
+# include <time.h>
+# include <stdio.h>
+# include <stdlib.h>
+# include "os/core/linux/os_core_linux.h"
+# if !BUILD_HEADLESS
+#  error os/gfx has no Linux backend yet; build with BUILD_HEADLESS=1.
+# endif
+#else
+# error OS layer not implemented on this platform.
 #endif
@@ -0,0 +1,411 @@
+//
+// Setup and timing
+//
+
+function void
+prof_init(void)
+{
+  Arena *arena = arena_alloc_default();
+  PROF_State *state = ArenaPushStruct(arena, PROF_State);
+  state->arena = arena;
+  
+  // A first calibration over a few milliseconds; prof_ticks_per_second refines
+  // it as the time since init grows.
+  state->ticks_base = prof_ticks();
+  state->os_ticks_base = os_get_ticks();
+  F64 os_freq = os_get_ticks_frequency();
+  F64 os_elapsed = 0;
+  while (os_elapsed < os_freq*0.005) {
+    os_elapsed = os_get_ticks() - state->os_ticks_base;
+  }
+  state->ticks_per_second = (F64)(prof_ticks() - state->ticks_base)*os_freq / os_elapsed;
+  state->frame_begin_ticks = prof_ticks();
+  state->frame_zone_idx = PROF_ZONES_MAX;
+  
+  os_memory_barrier();
+  prof_state = state;
+}
+
+function U64
+prof_ticks(void)
+{
+#if ARCH_X64
+  U64 result = __rdtsc();
+#else
+  U64 result = (U64)os_get_ticks();
+#endif
+  return result;
+}
+
+function F64
+prof_ticks_per_second(void)
+{
+  F64 result = 0;
+  
+  PROF_State *state = prof_state;
+  if (state) {
+    F64 os_elapsed = os_get_ticks() - state->os_ticks_base;
+    U64 elapsed = prof_ticks() - state->ticks_base;
+    if (os_elapsed > 0 && elapsed > 0) {
+      state->ticks_per_second = (F64)elapsed*os_get_ticks_frequency() / os_elapsed;
+    }
+    result = state->ticks_per_second;
+  }
+  
+  return result;
+}
+
+//
+// Threads and zones
+//
+
+function PROF_Thread *
+prof_thread_get(void)
+{
+  PROF_Thread *thread = prof_thread;
+  
+  PROF_State *state = prof_state;
+  if (!thread && state && state->threads_count < PROF_THREADS_MAX) {
+    U32 idx = os_interlocked_increment_32(&state->threads_count) - 1;
+    if (idx < PROF_THREADS_MAX) {
+      Arena *arena = arena_alloc_default();
+      thread = ArenaPushStruct(arena, PROF_Thread);
+      thread->arena = arena;
+      thread->idx = idx;
+      thread->name = str8_pushf(arena, (char *)"thread %u", idx);
+      thread->events = ArenaPushArrayNoZero(arena, PROF_Event, PROF_EVENTS_PER_THREAD);
+      
+      os_memory_barrier();
+      state->threads[idx] = thread;
+      prof_thread = thread;
+    }
+  }
+  
+  return thread;
+}
+
+function void
+prof_thread_set_name(String8 name)
+{
+  PROF_Thread *thread = prof_thread_get();
+  if (thread) {
+    thread->name = str8_pushf(thread->arena, (char *)"%.*s", (int)name.count, name.data);
+  }
+}
+
+// Returns PROF_ZONES_MAX when the table is full.
+function U32
+prof_zone_idx_from_name(const char *name, PROF_ZoneKind kind, U32 depth)
+{
+  U32 result = PROF_ZONES_MAX;
+  
+  PROF_State *state = prof_state;
+  U64 hash = ((U64)name >> 3)*0x9E3779B97F4A7C15ull;
+  U32 first = (U32)(hash >> 32);
+  
+  for (U32 probe = 0; probe < PROF_ZONES_MAX; probe += 1) {
+    U32 idx = (first + probe) & (PROF_ZONES_MAX - 1);
+    PROF_Zone *zone = &state->zones[idx];
+    
+    U32 zone_state = zone->state;
+    if (zone_state == PROF_ZONE_STATE_FREE) {
+      if (os_interlocked_compare_exchange_32(&zone->state, PROF_ZONE_STATE_CLAIMED, PROF_ZONE_STATE_FREE) == PROF_ZONE_STATE_FREE) {
+        zone->name = name;
+        zone->kind = kind;
+        zone->depth = depth;
+        zone->order = os_interlocked_increment_32(&state->zones_count) - 1;
+        os_memory_barrier();
+        zone->state = PROF_ZONE_STATE_READY;
+        result = idx;
+        break;
+      }
+      zone_state = zone->state;
+    }
+    
+    // Another thread is filling the slot in; it may be this name
+    while (zone_state == PROF_ZONE_STATE_CLAIMED) {
+      zone_state = zone->state;
+    }
+    
+    if (zone->name == name) {
+      result = idx;
+      break;
+    }
+  }
+  
+  return result;
+}
+
+function void
+prof_thread_push_event(PROF_Thread *thread, PROF_Event *event)
+{
+  U64 count = thread->events_count;
+  thread->events[count & (PROF_EVENTS_PER_THREAD - 1)] = *event;
+  thread->events_count = count + 1;
+}
+
+function void
+prof_zone_begin(const char *name)
+{
+  PROF_Thread *thread = prof_thread_get();
+  if (thread) {
+    if (thread->depth < PROF_DEPTH_MAX) {
+      PROF_OpenZone *open = &thread->stack[thread->depth];
+      open->zone_idx = prof_zone_idx_from_name(name, PROF_ZoneKind_Zone, thread->depth);
+      open->begin_ticks = prof_ticks();
+    }
+    thread->depth += 1;
+  }
+}
+
+function void
+prof_zone_end(void)
+{
+  U64 end_ticks = prof_ticks();
+  
+  // Zones opened before the thread was registered have nothing to close
+  PROF_Thread *thread = prof_thread;
+  if (thread && thread->depth > 0) {
+    thread->depth -= 1;
+    if (thread->depth < PROF_DEPTH_MAX) {
+      PROF_OpenZone *open = &thread->stack[thread->depth];
+      if (open->zone_idx < PROF_ZONES_MAX) {
+        thread->zone_ticks[open->zone_idx] += end_ticks - open->begin_ticks;
+        thread->zone_hits[open->zone_idx] += 1;
+        
+        PROF_Event event = {0};
+        event.ticks = open->begin_ticks;
+        event.end_ticks = end_ticks;
+        event.zone_idx = open->zone_idx;
+        event.kind = PROF_ZoneKind_Zone;
+        event.depth = (U16)thread->depth;
+        prof_thread_push_event(thread, &event);
+      }
+    }
+  }
+}
+
+function void
+prof_counter(const char *name, F64 value)
+{
+  PROF_Thread *thread = prof_thread_get();
+  if (thread) {
+    U32 zone_idx = prof_zone_idx_from_name(name, PROF_ZoneKind_Counter, thread->depth);
+    if (zone_idx < PROF_ZONES_MAX) {
+      prof_state->zones[zone_idx].value = value;
+      thread->zone_hits[zone_idx] += 1;
+      
+      PROF_Event event = {0};
+      event.ticks = prof_ticks();
+      event.value = value;
+      event.zone_idx = zone_idx;
+      event.kind = PROF_ZoneKind_Counter;
+      event.depth = (U16)Min(thread->depth, 0xFFFF);
+      prof_thread_push_event(thread, &event);
+    }
+  }
+}
+
+//
+// Frame stats
+//
+
+function void
+prof_frame_end(void)
+{
+  PROF_State *state = prof_state;
+  if (state) {
+    U64 now = prof_ticks();
+    F64 ticks_per_ms = prof_ticks_per_second() / 1000.0;
+
+#if BUILD_PROFILE
+    PROF_Thread *thread = prof_thread_get();
+    if (thread) {
+      U32 zone_idx = prof_zone_idx_from_name("frame", PROF_ZoneKind_Zone, 0);
+      if (zone_idx < PROF_ZONES_MAX) {
+        state->frame_zone_idx = zone_idx;
+        thread->zone_ticks[zone_idx] += now - state->frame_begin_ticks;
+        thread->zone_hits[zone_idx] += 1;
+        
+        PROF_Event event = {0};
+        event.ticks = state->frame_begin_ticks;
+        event.end_ticks = now;
+        event.zone_idx = zone_idx;
+        event.kind = PROF_ZoneKind_Zone;
+        prof_thread_push_event(thread, &event);
+      }
+    }
+#endif
+    
+    state->frame_ms[state->frames_count & (PROF_FRAMES_HISTORY - 1)] = (F64)(now - state->frame_begin_ticks) / ticks_per_ms;
+    state->frames_count += 1;
+    state->frame_begin_ticks = now;
+    
+    U32 threads_count = Min(state->threads_count, PROF_THREADS_MAX);
+    for (U32 zone_idx = 0; zone_idx < PROF_ZONES_MAX; zone_idx += 1) {
+      PROF_Zone *zone = &state->zones[zone_idx];
+      if (zone->state == PROF_ZONE_STATE_READY && zone->kind == PROF_ZoneKind_Zone) {
+        U64 ticks = 0;
+        U64 hits = 0;
+        for (U32 thread_idx = 0; thread_idx < threads_count; thread_idx += 1) {
+          PROF_Thread *thread = state->threads[thread_idx];
+          if (thread) {
+            ticks += thread->zone_ticks[zone_idx];
+            hits += thread->zone_hits[zone_idx];
+          }
+        }
+        
+        PROF_ZoneStats *stats = &state->zone_stats[zone_idx];
+        stats->ms = (F64)(ticks - state->zone_ticks_prev[zone_idx]) / ticks_per_ms;
+        stats->hits = hits - state->zone_hits_prev[zone_idx];
+        stats->ms_avg = (state->frames_count == 1) ? stats->ms : stats->ms_avg + (stats->ms - stats->ms_avg)*PROF_AVG_WEIGHT;
+        
+        state->zone_ticks_prev[zone_idx] = ticks;
+        state->zone_hits_prev[zone_idx] = hits;
+      }
+    }
+  }
+}
+
+function void
+prof_frame_times(F64 *last_ms, F64 *avg_ms, F64 *max_ms)
+{
+  *last_ms = 0;
+  *avg_ms = 0;
+  *max_ms = 0;
+  
+  PROF_State *state = prof_state;
+  if (state && state->frames_count > 0) {
+    U64 count = Min(state->frames_count, PROF_FRAMES_HISTORY);
+    F64 sum = 0;
+    for (U64 idx = 0; idx < count; idx += 1) {
+      F64 ms = state->frame_ms[idx];
+      sum += ms;
+      *max_ms = Max(*max_ms, ms);
+    }
+    *last_ms = state->frame_ms[(state->frames_count - 1) & (PROF_FRAMES_HISTORY - 1)];
+    *avg_ms = sum / (F64)count;
+  }
+}
+
+function String8List
+prof_stats_lines(Arena *arena)
+{
+  String8List result = {0};
+  
+  F64 last_ms, avg_ms, max_ms;
+  prof_frame_times(&last_ms, &avg_ms, &max_ms);
+  str8_list_push(arena, &result, str8_pushf(arena, (char *)"frame %6.2f ms (avg %6.2f, max %6.2f)", last_ms, avg_ms, max_ms));
+  
+  PROF_State *state = prof_state;
+  if (state) {
+    // Zones in the order they were first seen
+    U32 zone_idx_from_order[PROF_ZONES_MAX];
+    for (U32 idx = 0; idx < PROF_ZONES_MAX; idx += 1) {
+      zone_idx_from_order[idx] = PROF_ZONES_MAX;
+    }
+    for (U32 zone_idx = 0; zone_idx < PROF_ZONES_MAX; zone_idx += 1) {
+      PROF_Zone *zone = &state->zones[zone_idx];
+      if (zone->state == PROF_ZONE_STATE_READY && zone->order < PROF_ZONES_MAX) {
+        zone_idx_from_order[zone->order] = zone_idx;
+      }
+    }
+    
+    for (U32 order = 0; order < PROF_ZONES_MAX; order += 1) {
+      U32 zone_idx = zone_idx_from_order[order];
+      if (zone_idx < PROF_ZONES_MAX && zone_idx != state->frame_zone_idx) {
+        PROF_Zone *zone = &state->zones[zone_idx];
+        S32 indent = 2 + 2*(S32)Min(zone->depth, 16);
+        String8 line = {0};
+        if (zone->kind == PROF_ZoneKind_Zone) {
+          PROF_ZoneStats *stats = &state->zone_stats[zone_idx];
+          line = str8_pushf(arena, (char *)"%*s%-24s %6.2f ms (avg %6.2f) x%llu", indent, "", zone->name,
+                            stats->ms, stats->ms_avg, (unsigned long long)stats->hits);
+        }
+        else {
+          line = str8_pushf(arena, (char *)"%*s%-24s %g", indent, "", zone->name, zone->value);
+        }
+        str8_list_push(arena, &result, line);
+      }
+    }
+  }
+  
+  return result;
+}
+
+//
+// Chrome trace export
+//
+
+// Appends the thread's metadata and the events still in its ring.
+function void
+prof_chrome_trace_thread(Arena *arena, String8List *list, PROF_Thread *thread, F64 ticks_per_us)
+{
+  PROF_State *state = prof_state;
+  
+  str8_list_push(arena, list, str8_pushf(arena, (char *)",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%.*s\"}}",
+                                         thread->idx, (int)thread->name.count, thread->name.data));
+  
+  U64 events_opl = thread->events_count;
+  U64 events_first = (events_opl > PROF_EVENTS_PER_THREAD) ? events_opl - PROF_EVENTS_PER_THREAD : 0;
+  for (U64 event_idx = events_first; event_idx < events_opl; event_idx += 1) {
+    PROF_Event *event = &thread->events[event_idx & (PROF_EVENTS_PER_THREAD - 1)];
+    PROF_Zone *zone = &state->zones[event->zone_idx];
+    F64 ts = (F64)(S64)(event->ticks - state->ticks_base) / ticks_per_us;
+    
+    String8 str = {0};
+    if (event->kind == PROF_ZoneKind_Zone) {
+      F64 dur = (F64)(event->end_ticks - event->ticks) / ticks_per_us;
+      str = str8_pushf(arena, (char *)",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                       zone->name, thread->idx, ts, dur);
+    }
+    else {
+      str = str8_pushf(arena, (char *)",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.17g}}",
+                       zone->name, thread->idx, ts, event->value);
+    }
+    str8_list_push(arena, list, str);
+  }
+}
+
+// NOTE: Written one thread at a time, so that a full trace of many threads never
+// has to fit in the scratch arena at once.
+function B32
+prof_write_chrome_trace(String8 path)
+{
+  B32 result = 0;
+  
+  OS_Handle file = os_file_open(path, OS_FileAccess_Write);
+  if (!os_handle_is_null(file)) {
+    result = 1;
+    
+    // The leading event keeps every later one free to start with a comma
+    String8 header = S8("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"prof\"}}");
+    result = result && os_file_write_at(file, 0, header);
+    U64 offset = header.count;
+    
+    PROF_State *state = prof_state;
+    if (state) {
+      F64 ticks_per_us = prof_ticks_per_second() / 1000000.0;
+      U32 threads_count = Min(state->threads_count, PROF_THREADS_MAX);
+      for (U32 thread_idx = 0; thread_idx < threads_count && result; thread_idx += 1) {
+        PROF_Thread *thread = state->threads[thread_idx];
+        if (thread) {
+          TempArena scratch = arena_scratch_begin(0, 0);
+          String8List list = {0};
+          prof_chrome_trace_thread(scratch.arena, &list, thread, ticks_per_us);
+          String8 str = str8_list_join(scratch.arena, &list);
+          result = os_file_write_at(file, offset, str);
+          offset += str.count;
+          arena_scratch_end(scratch);
+        }
+      }
+    }
+    
+    String8 footer = S8("\n]}\n");
+    result = result && os_file_write_at(file, offset, footer);
+    os_file_close(file);
+  }
+  
+  return result;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+// NOTE: Frame profiler. Zones are timed with the CPU's timestamp counter and
+// recorded into a ring owned by the thread that ran them, so recording never
+// takes a lock; the ring keeps the most recent PROF_EVENTS_PER_THREAD events.
+// Each thread also accumulates the time and hits of every zone, which
+// prof_frame_end turns into per-frame stats. Counters record a value over time.
+//
+//   ProfScope("update") { ... }     // Times the block; don't `return` or `break` out of it
+//   ProfBegin("render"); ... ProfEnd();
+//   ProfCounter("chunks", count);
+//
+// Zone and counter names must be string literals: they are told apart by
+// address, and are written to traces as they are, so they must not need JSON
+// escaping. With BUILD_PROFILE 0 the macros compile to nothing; frame times are
+// still measured.
+
+#if ARCH_X64
+# if COMPILER_MSVC
+#  include <intrin.h>
+# else
+#  include <x86intrin.h>
+# endif
+#endif
+
+#define PROF_THREADS_MAX       64
+#define PROF_ZONES_MAX         256   // Distinct zone and counter names, power of two
+#define PROF_EVENTS_PER_THREAD 65536 // Power of two
+#define PROF_DEPTH_MAX         64    // Deeper zones are counted but not recorded
+#define PROF_FRAMES_HISTORY    128   // Power of two
+#define PROF_AVG_WEIGHT        0.05  // Of the latest frame in the running averages
+
+#if BUILD_PROFILE
+# define ProfBegin(name)          prof_zone_begin(name)
+# define ProfEnd()                prof_zone_end()
+# define ProfScope(name)          DeferLoop(prof_zone_begin(name), prof_zone_end())
+# define ProfCounter(name, value) prof_counter(name, (F64)(value))
+#else
+# define ProfBegin(name)          ((void)0)
+# define ProfEnd()                ((void)0)
+# define ProfScope(name)
+# define ProfCounter(name, value) ((void)0)
+#endif
+
+enum PROF_ZoneKind {
+  PROF_ZoneKind_Zone,
+  PROF_ZoneKind_Counter,
+};
+
+// Slots of the zone table are claimed with a compare-exchange on `state`; the
+// other fields are valid once it reads PROF_ZONE_STATE_READY.
+#define PROF_ZONE_STATE_FREE    0
+#define PROF_ZONE_STATE_CLAIMED 1
+#define PROF_ZONE_STATE_READY   2
+
+struct PROF_Zone {
+  volatile U32 state;
+  PROF_ZoneKind kind;
+  const char *name;
+  U32 depth; // Nesting depth where it was first seen, for display
+  U32 order; // Position among zones in the order they were first seen
+  volatile F64 value; // Counters: the latest value
+};
+
+struct PROF_Event {
+  U64 ticks;       // Zone begin, or when the counter was set
+  union {
+    U64 end_ticks; // Zones
+    F64 value;     // Counters
+  };
+  U32 zone_idx;
+  U16 kind;
+  U16 depth;
+};
+
+struct PROF_OpenZone {
+  U32 zone_idx;
+  U64 begin_ticks;
+};
+
+struct PROF_Thread {
+  Arena *arena;
+  U32 idx;
+  String8 name;
+  
+  PROF_Event *events;
+  volatile U64 events_count; // Ever written; the ring holds the last PROF_EVENTS_PER_THREAD
+  
+  PROF_OpenZone stack[PROF_DEPTH_MAX];
+  U32 depth;
+  
+  // Since the thread was registered, per zone, inclusive of nested zones
+  volatile U64 zone_ticks[PROF_ZONES_MAX];
+  volatile U64 zone_hits[PROF_ZONES_MAX];
+};
+
+struct PROF_ZoneStats {
+  F64 ms;     // Last frame, summed over threads
+  F64 ms_avg;
+  U64 hits;   // Last frame
+};
+
+struct PROF_State {
+  Arena *arena;
+  
+  // Timestamp counter calibration against os_get_ticks
+  U64 ticks_base;
+  F64 os_ticks_base;
+  F64 ticks_per_second;
+  
+  PROF_Zone zones[PROF_ZONES_MAX]; // Open addressing, keyed by the name's address
+  volatile U32 zones_count;
+  U32 frame_zone_idx;
+  
+  PROF_Thread *threads[PROF_THREADS_MAX];
+  volatile U32 threads_count;
+  
+  // Frame stats, maintained by prof_frame_end
+  U64 frame_begin_ticks;
+  U64 frames_count;
+  F64 frame_ms[PROF_FRAMES_HISTORY];
+  U64 zone_ticks_prev[PROF_ZONES_MAX];
+  U64 zone_hits_prev[PROF_ZONES_MAX];
+  PROF_ZoneStats zone_stats[PROF_ZONES_MAX];
+};
+
+global PROF_State *prof_state;
+threadlocal PROF_Thread *prof_thread;
+
+function void prof_init(void);
+function U64 prof_ticks(void);
+function F64 prof_ticks_per_second(void);
+
+// Threads register on their first zone, as "thread N" unless they are named first.
+function void prof_thread_set_name(String8 name);
+
+function void prof_zone_begin(const char *name);
+function void prof_zone_end(void);
+function void prof_counter(const char *name, F64 value);
+
+// Call once per frame, on the thread that runs the frame. Also records the frame
+// itself as a zone named "frame".
+function void prof_frame_end(void);
+
+// Last frame's time, and the average and worst over the last PROF_FRAMES_HISTORY frames.
+function void prof_frame_times(F64 *last_ms, F64 *avg_ms, F64 *max_ms);
+
+// One line for the frame times, then one per zone and counter, indented by depth.
+function String8List prof_stats_lines(Arena *arena);
+
+// Chrome's trace event format (chrome://tracing, Perfetto), timestamps in
+// microseconds since prof_init. Reads every thread's ring, so call it while the
+// other threads are idle, e.g. between frames.
+function B32 prof_write_chrome_trace(String8 path);
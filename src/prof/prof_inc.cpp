@@ -0,0 +1 @@
+#include "prof_core.cpp"
\ No newline at end of file
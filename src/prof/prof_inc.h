@@ -0,0 +1,3 @@
+#pragma once
+
+#include "prof_core.h"
\ No newline at end of file
@@ -40,6 +40,134 @@ r_gl_texture_format(R_TextureFormat fmt)
   return result; 
 }
 
+// Program binaries are stored as this header, then the binary
+struct R_GL_ProgramBinaryHeader {
+  U32 format;
+};
+
+// SC_CompileProc for one separable stage; `user` points to its GLenum stage.
+// Links the program and returns its binary, which only the driver that made it
+// can load, so the cache's target names the driver.
+function String8
+r_gl_shader_compile(Arena *arena, void *user, String8 source, String8 entry, String8 target, U32 flags, String8 *error)
+{
+  String8 result = {0};
+  GLenum stage = *(GLenum *)user;
+  
+  GLuint shader = glCreateShader(stage);
+  char *source_cstr = (char *)source.data;
+  GLint source_count = (GLint)source.count;
+  glShaderSource(shader, 1, &source_cstr, &source_count);
+  glCompileShader(shader);
+  
+  GLint compiled = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+  if (compiled) {
+    GLuint program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDetachShader(program, shader);
+    
+    GLint linked = 0;
+    GLint binary_size = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+    if (linked && binary_size > 0) {
+      R_GL_ProgramBinaryHeader header = {0};
+      U64 size = sizeof(header) + (U64)binary_size;
+      U8 *data = ArenaPushArray(arena, U8, size);
+      glGetProgramBinary(program, binary_size, 0, (GLenum *)&header.format, data + sizeof(header));
+      MemoryCopy(data, &header, sizeof(header));
+      result = str8(data, size);
+    }
+    else if (linked) {
+      *error = S8("the driver has no program binary formats");
+    }
+    else {
+      GLint log_size = 0;
+      glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
+      U8 *log = ArenaPushArray(arena, U8, Max(log_size, 1));
+      glGetProgramInfoLog(program, Max(log_size, 1), 0, (char *)log);
+      *error = str8(log, cstr_count((char *)log));
+    }
+    glDeleteProgram(program);
+  }
+  else {
+    GLint log_size = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_size);
+    U8 *log = ArenaPushArray(arena, U8, Max(log_size, 1));
+    glGetShaderInfoLog(shader, Max(log_size, 1), 0, (char *)log);
+    *error = str8(log, cstr_count((char *)log));
+  }
+  glDeleteShader(shader);
+  
+  return result;
+}
+
+// Returns 0 when the driver refuses the binary, e.g. after a driver update that
+// kept its version string.
+function GLuint
+r_gl_program_from_binary(String8 bytecode)
+{
+  GLuint result = 0;
+  
+  R_GL_ProgramBinaryHeader header = {0};
+  if (str8_read(&header, bytecode, 0, sizeof(header))) {
+    GLuint program = glCreateProgram();
+    glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glProgramBinary(program, (GLenum)header.format, bytecode.data + sizeof(header), (GLsizei)(bytecode.count - sizeof(header)));
+    
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked) {
+      result = program;
+    }
+    else {
+      glDeleteProgram(program);
+    }
+  }
+  
+  return result;
+}
+
+// Builds a separable program for one stage from its cached binary, compiling
+// and caching it on a miss. Falls back to glCreateShaderProgramv when there is
+// no usable binary.
+function GLuint
+r_gl_program_from_source(SC_Cache *cache, char *name, char *source, GLenum stage)
+{
+  GLuint result = 0;
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  SC_Shader shader = {0};
+  shader.name = str8((U8 *)name, cstr_count(name));
+  shader.source = str8((U8 *)source, cstr_count(source));
+  shader.entry = S8("main");
+  shader.target = str8_pushf(scratch.arena, (char *)"glsl %u %s %s %s", stage,
+                             (char *)glGetString(GL_VENDOR), (char *)glGetString(GL_RENDERER),
+                             (char *)glGetString(GL_VERSION));
+  
+  String8 error = {0};
+  String8 bytecode = sc_bytecode_from_shader(scratch.arena, cache, &shader, r_gl_shader_compile, &stage, &error);
+  result = r_gl_program_from_binary(bytecode);
+  if (result == 0) {
+    result = glCreateShaderProgramv(stage, 1, &source);
+  }
+  
+  GLint linked = 0;
+  glGetProgramiv(result, GL_LINK_STATUS, &linked);
+  if (!linked) {
+    char message[1024];
+    glGetProgramInfoLog(result, sizeof(message), 0, message);
+  }
+  Assert(linked);
+  
+  arena_scratch_end(scratch);
+  return result;
+}
+
 //
 // OpenGL backend initialization
 //
@@ -75,24 +203,11 @@ r_gl_backend_init(void)
     r_gl_backend->fallback_texture = texture; 
   }
   
-  // Compile shaders used for rendering textured quads
-  GLuint vshader = glCreateShaderProgramv(GL_VERTEX_SHADER, 1, &quad_vs_glsl);
-  GLuint fshader = glCreateShaderProgramv(GL_FRAGMENT_SHADER, 1, &quad_fs_glsl);
-  
-  GLint linked;
-  glGetProgramiv(vshader, GL_LINK_STATUS, &linked);
-  if (!linked) {
-    char message[1024];
-    glGetProgramInfoLog(vshader, sizeof(message), 0, message);
-  }
-  Assert(linked);
-  
-  glGetProgramiv(fshader, GL_LINK_STATUS, &linked);
-  if (!linked) {
-    char message[1024];
-    glGetProgramInfoLog(fshader, sizeof(message), 0, message);
-  }
-  Assert(linked);
+  // Compile shaders used for rendering textured quads, or load their program
+  // binaries from the last run
+  r_gl_backend->shader_cache = sc_cache_alloc(S8("shader_cache"));
+  GLuint vshader = r_gl_program_from_source(r_gl_backend->shader_cache, (char *)"quad_vs_glsl", quad_vs_glsl, GL_VERTEX_SHADER);
+  GLuint fshader = r_gl_program_from_source(r_gl_backend->shader_cache, (char *)"quad_fs_glsl", quad_fs_glsl, GL_FRAGMENT_SHADER);
   
   // Create a shader program pipeline for the OpenGL backend
   GLuint pipeline;
@@ -18,6 +18,9 @@ struct R_GL_Backend {
   GLuint quad_fs; 
   
   GLuint fallback_texture; 
+  
+  // Program binaries of the shaders; needs the shader_cache layer included first
+  SC_Cache *shader_cache;
 };
 
 global R_GL_Backend *r_gl_backend;
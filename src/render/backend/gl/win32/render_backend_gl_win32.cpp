@@ -29,6 +29,20 @@ X(PFNGLVERTEXARRAYATTRIBFORMATPROC,     glVertexArrayAttribFormat     ) \
 X(PFNGLVERTEXARRAYBINDINGDIVISORPROC,   glVertexArrayBindingDivisor   ) \
 X(PFNGLENABLEVERTEXARRAYATTRIBPROC,     glEnableVertexArrayAttrib     ) \
 X(PFNGLCREATESHADERPROGRAMVPROC,        glCreateShaderProgramv        ) \
+X(PFNGLCREATESHADERPROC,                glCreateShader                ) \
+X(PFNGLSHADERSOURCEPROC,                glShaderSource                ) \
+X(PFNGLCOMPILESHADERPROC,               glCompileShader               ) \
+X(PFNGLGETSHADERIVPROC,                 glGetShaderiv                 ) \
+X(PFNGLGETSHADERINFOLOGPROC,            glGetShaderInfoLog            ) \
+X(PFNGLDELETESHADERPROC,                glDeleteShader                ) \
+X(PFNGLCREATEPROGRAMPROC,               glCreateProgram               ) \
+X(PFNGLPROGRAMPARAMETERIPROC,           glProgramParameteri           ) \
+X(PFNGLATTACHSHADERPROC,                glAttachShader                ) \
+X(PFNGLDETACHSHADERPROC,                glDetachShader                ) \
+X(PFNGLLINKPROGRAMPROC,                 glLinkProgram                 ) \
+X(PFNGLDELETEPROGRAMPROC,               glDeleteProgram               ) \
+X(PFNGLGETPROGRAMBINARYPROC,            glGetProgramBinary            ) \
+X(PFNGLPROGRAMBINARYPROC,               glProgramBinary               ) \
 X(PFNGLGETPROGRAMIVPROC,                glGetProgramiv                ) \
 X(PFNGLGETPROGRAMINFOLOGPROC,           glGetProgramInfoLog           ) \
 X(PFNGLGENPROGRAMPIPELINESPROC,         glGenProgramPipelines         ) \
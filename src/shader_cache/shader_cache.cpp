@@ -0,0 +1,127 @@
+function SC_Cache *
+sc_cache_alloc(String8 dir)
+{
+  Arena *arena = arena_alloc_default();
+  SC_Cache *cache = ArenaPushStruct(arena, SC_Cache);
+  cache->arena = arena;
+  cache->dir = str8_pushf(arena, (char *)"%.*s", (int)dir.count, dir.data);
+  os_directory_make(cache->dir);
+  return cache;
+}
+
+function void
+sc_cache_release(SC_Cache *cache)
+{
+  if (cache) {
+    arena_release(cache->arena);
+  }
+}
+
+function SC_Key
+sc_key_from_shader(SC_Shader *shader)
+{
+  SC_Key key = {0};
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  // Fields are separated by a nul, so that text moving from one field to the
+  // next changes the key
+  String8 slot_str = str8_pushf(scratch.arena, (char *)"%.*s%c%.*s%c%.*s",
+                                (int)shader->name.count, shader->name.data, 0,
+                                (int)shader->entry.count, shader->entry.data, 0,
+                                (int)shader->target.count, shader->target.data);
+  key.slot = hash_from_str8(slot_str);
+  
+  String8List parts = {0};
+  str8_list_push(scratch.arena, &parts, shader->source);
+  str8_list_push(scratch.arena, &parts, str8_pushf(scratch.arena, (char *)"%c%.*s%c%.*s%c%08x", 0,
+                                                   (int)shader->entry.count, shader->entry.data, 0,
+                                                   (int)shader->target.count, shader->target.data, 0,
+                                                   shader->flags));
+  key.hash = hash_from_str8(str8_list_join(scratch.arena, &parts));
+  
+  arena_scratch_end(scratch);
+  return key;
+}
+
+function String8
+sc_cache_path_from_key(Arena *arena, SC_Cache *cache, SC_Key key)
+{
+  String8 result = str8_pushf(arena, (char *)"%.*s/%016llx.shc", (int)cache->dir.count, cache->dir.data, (unsigned long long)key.slot);
+  return result;
+}
+
+function String8
+sc_cache_load(Arena *arena, SC_Cache *cache, SC_Key key)
+{
+  String8 result = {0};
+  
+  String8 path = sc_cache_path_from_key(arena, cache, key);
+  String8 file = os_file_read(arena, path);
+  
+  SC_FileHeader header = {0};
+  if (str8_read(&header, file, 0, sizeof(header))) {
+    String8 bytecode = str8(file.data + sizeof(header), file.count - sizeof(header));
+    B32 valid = (header.magic == SC_FILE_MAGIC &&
+                 header.version == SC_FILE_VERSION &&
+                 header.hash == key.hash &&
+                 header.bytecode_size == bytecode.count &&
+                 header.bytecode_hash == hash_from_str8(bytecode));
+    if (valid) {
+      result = bytecode;
+    }
+  }
+  
+  return result;
+}
+
+function B32
+sc_cache_store(SC_Cache *cache, SC_Key key, String8 bytecode)
+{
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  SC_FileHeader header = {0};
+  header.magic = SC_FILE_MAGIC;
+  header.version = SC_FILE_VERSION;
+  header.hash = key.hash;
+  header.bytecode_size = bytecode.count;
+  header.bytecode_hash = hash_from_str8(bytecode);
+  
+  String8List parts = {0};
+  str8_list_push(scratch.arena, &parts, str8((U8 *)&header, sizeof(header)));
+  str8_list_push(scratch.arena, &parts, bytecode);
+  String8 file = str8_list_join(scratch.arena, &parts);
+  
+  String8 path = sc_cache_path_from_key(scratch.arena, cache, key);
+  B32 result = os_file_write(path, file);
+  
+  arena_scratch_end(scratch);
+  return result;
+}
+
+function String8
+sc_bytecode_from_shader(Arena *arena, SC_Cache *cache, SC_Shader *shader, SC_CompileProc *compile, void *user, String8 *error)
+{
+  String8 result = {0};
+  *error = str8(0, 0);
+  
+  SC_Key key = sc_key_from_shader(shader);
+  if (cache) {
+    result = sc_cache_load(arena, cache, key);
+  }
+  
+  if (result.count > 0) {
+    cache->hits += 1;
+  }
+  else {
+    result = compile(arena, user, shader->source, shader->entry, shader->target, shader->flags, error);
+    if (cache) {
+      cache->misses += 1;
+      if (result.count > 0) {
+        sc_cache_store(cache, key, result);
+      }
+    }
+  }
+  
+  return result;
+}
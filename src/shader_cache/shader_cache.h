@@ -0,0 +1,61 @@
+#pragma once
+
+// NOTE: On-disk cache of compiled shaders. Backend-neutral: the bytecode is
+// whatever the backend's compile proc returns (DXBC, a GL program binary with
+// its format, ...), and the compiler is only called on a miss.
+//
+// Entries are keyed by hash_from_str8 of the source, entry point, target and
+// compile flags. Each shader stage owns one file, named after its `name`, entry
+// point and target, so a stale entry is evicted by overwriting it as soon as the
+// source or flags change. Entries are checksummed; a truncated or corrupt file
+// is a miss.
+
+#define SC_FILE_MAGIC   0x31434853 // "SHC1"
+#define SC_FILE_VERSION 1
+
+// Returns the bytecode, allocated on `arena`, or an empty string and the
+// compiler's message in `error`.
+typedef String8 SC_CompileProc(Arena *arena, void *user, String8 source, String8 entry, String8 target, U32 flags, String8 *error);
+
+struct SC_Shader {
+  String8 name;   // Stays the same across edits, e.g. the source file's path
+  String8 source;
+  String8 entry;
+  String8 target; // Compiler profile, plus anything else the bytecode depends on (e.g. the GL driver)
+  U32 flags;
+};
+
+struct SC_Key {
+  U64 slot; // Names the entry's file: name, entry point, target
+  U64 hash; // Source, entry point, target, flags
+};
+
+struct SC_FileHeader {
+  U32 magic;
+  U32 version;
+  U64 hash;
+  U64 bytecode_size;
+  U64 bytecode_hash;
+};
+
+struct SC_Cache {
+  Arena *arena;
+  String8 dir;
+  
+  U64 hits;
+  U64 misses;
+};
+
+// Creates `dir` if it doesn't exist.
+function SC_Cache *sc_cache_alloc(String8 dir);
+function void sc_cache_release(SC_Cache *cache);
+
+function SC_Key sc_key_from_shader(SC_Shader *shader);
+
+// Returns an empty string when there is no up-to-date entry.
+function String8 sc_cache_load(Arena *arena, SC_Cache *cache, SC_Key key);
+function B32 sc_cache_store(SC_Cache *cache, SC_Key key, String8 bytecode);
+
+// Loads the shader's bytecode from the cache, or compiles and stores it. Failed
+// compiles aren't cached. `cache` may be 0 to always compile.
+function String8 sc_bytecode_from_shader(Arena *arena, SC_Cache *cache, SC_Shader *shader, SC_CompileProc *compile, void *user, String8 *error);
@@ -0,0 +1 @@
+#include "shader_cache.cpp"
\ No newline at end of file
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "shader_cache.h"
\ No newline at end of file
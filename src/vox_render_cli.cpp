@@ -0,0 +1,2686 @@
+// NOTE: Headless renderer. Renders the editor's test scene, or a scene file, with
+// the CPU reference renderer and writes the result to a PNG. Optionally compares
+// the result against a golden image and exits with 1 when they differ.
+//
+// Usage: vox_render [-o out.png] [-size w h] [-view x y] [-frames n]
+//                   [-golden ref.png] [-tolerance n] [-threads n] [-scaling]
+//                   [-scene in.vxs] [-save out.vxs] [-brush_bench]
+//                   [-trace out.json] [-mesh_bench] [-light] [-distance_bench]
+//                   [-lod bias] [-tree_bench] [-layout_bench] [-vox in.vox]
+//                   [-save_vox out.vox] [-vox_bench out.vox] [-codec_bench]
+//                   [-frame_test] [-palette_test] [-shader_cache_test dir]
+//                   [-raycast_bench] [-upload_test] [-csg_test]
+//                   [-undo_test] [-file_watch_test dir] [-async_test]
+//
+// -scene renders a scene file (see voxel/voxel_scene.h) instead of the test scene.
+// -save writes the rendered scene to a scene file.
+// -vox renders a MagicaVoxel file (see voxel/voxel_magica.h) instead of the test
+// scene, and -save_vox writes the rendered scene to one.
+// -threads sets the number of threads rendering (including the main thread).
+// -scaling renders with 1 to N threads and reports the throughput of each.
+// -brush_bench measures brush stroke throughput at radius 1 to 64 and exits.
+// -mesh_bench greedy-meshes every chunk of the scene, reports quads per chunk and
+// meshing time on one thread and through the mesh cache on -threads, and exits.
+// -light bakes ambient occlusion and sun shadows (see voxel/voxel_light.h) and
+// renders with them, like the editor does.
+// -distance_bench builds the distance field (see voxel/voxel_distance.h) of every
+// chunk on one thread and through the distance cache on -threads, checks every
+// field against its definition, and exits with 1 when any voxel is wrong.
+// -lod builds the LOD pyramids (see voxel/voxel_lod.h) and renders far voxels
+// through them, with `bias` added to the level each ray's footprint picks.
+// -tree_bench builds the sparse 64-tree (see voxel/voxel_tree64.h) of the scene,
+// compares its size with the chunks', checks it against the world, times camera
+// rays through it and through vox_raycast, and exits with 1 when they disagree.
+// -raycast_bench casts camera rays through the scene, random rays through a dense
+// and a sparse generated scene (and into the dense one from far away), and the
+// light bake's shadow rays through all three, with vox_raycast and
+// vox_raycast_packet. It reports steps and ns per
+// ray, checks every hit against a voxel-by-voxel walk and every packet result
+// against vox_raycast's, and exits with 1 when they disagree.
+// -layout_bench times neighborhood queries over every chunk in the chunk layout
+// the program was built with (see VOX_CHUNK_LAYOUT in voxel/voxel_core.h), plus
+// the light, LOD and mesh builds that make them, and exits.
+// -vox_bench writes 256^3 models and the scene to a MagicaVoxel file, times
+// loading them back on -threads, checks they come back voxel for voxel, and exits
+// with 1 when they don't.
+// -codec_bench encodes synthetic chunks and the scene's with the chunk codec (see
+// voxel/voxel_codec.h), reports the ratio and GB/s of each set, checks every
+// chunk decodes to what was encoded, and exits with 1 when one doesn't.
+// -frame_test runs frames as the editor does, with the CPU renderer in place of
+// the GPU, around edits of a chunk other than the origin's, and exits with 1 when
+// a frame after the one following an edit still rebuilds anything.
+// -palette_test converts synthetic chunks and the scene's to palette chunks (see
+// voxel/voxel_palette.h) and back, reports their size against the dense chunks',
+// edits one up to 16-bit indices and back down to 1 bit and at random, checks it
+// against a dense copy all along, and exits with 1 when they differ.
+// -shader_cache_test runs the shader cache (see shader_cache/shader_cache.h) in
+// `dir` with a stand-in compiler through hits, misses, edits that evict a stale
+// entry, and corrupt and short entry files, and exits with 1 when one loads
+// the wrong bytecode or compiles when it shouldn't.
+// -file_watch_test writes, renames over and touches a file in `dir` under a file
+// watch (see os/core/os_core.h), through inotify and through polling, and exits
+// with 1 when a watch misses a change or reports one that didn't happen. Linux
+// only.
+// -upload_test plans uploads (see voxel/voxel_upload.h) for random dirty brick
+// masks and exits with 1 when a plan misses a dirty brick, uploads a clean one
+// outside of the bounding box it falls back to, or uploads a voxel twice.
+// -csg_test runs random CSG operations (see voxel/voxel_csg.h) with generated
+// worlds and SDF primitives on -threads, and exits with 1 when a voxel differs
+// from one worked out voxel by voxel, or when the bricks marked dirty are not
+// exactly the ones that changed.
+// -undo_test edits a world at random through a small undo history (see
+// voxel/voxel_undo.h), undoing and redoing along the way and the whole history
+// at checkpoints, and exits with 1 when a step doesn't bring back a full copy of
+// the world from that point, including steps recorded after eviction wrapped the
+// ring.
+// -async_test releases the job system (see async/async.h) right after pushing a
+// tree of jobs that push their children from the workers running them, on
+// -threads, and exits with 1 when a job never ran.
+// -trace writes the profiler's zones to a Chrome trace (see prof/prof_core.h) and
+// prints the last frame's zone times.
+//
+// Built by build.bat with the `render_cli` argument (BUILD_CLI, BUILD_HEADLESS).
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base/base_inc.h"
+#include "os/os_inc.h"
+#include "prof/prof_inc.h"
+#include "shader_cache/shader_cache_inc.h"
+#include "async/async_inc.h"
+#include "voxel/voxel_inc.h"
+
+#include "base/base_inc.cpp"
+#include "os/os_inc.cpp"
+#include "prof/prof_inc.cpp"
+#include "shader_cache/shader_cache_inc.cpp"
+#include "async/async_inc.cpp"
+#include "voxel/voxel_inc.cpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+struct CLI_Options {
+  char *out_path;
+  char *golden_path;
+  char *scene_path;
+  char *save_path;
+  char *trace_path;
+  char *vox_path;
+  char *save_vox_path;
+  char *vox_bench_path;
+  char *shader_cache_test_dir;
+  char *file_watch_test_dir;
+  U32 width;
+  U32 height;
+  V2F32 view;
+  U32 frames;
+  U32 tolerance;
+  U32 threads;
+  B32 scaling;
+  B32 brush_bench;
+  B32 mesh_bench;
+  B32 light;
+  B32 distance_bench;
+  B32 lod;
+  F32 lod_bias;
+  B32 tree_bench;
+  B32 raycast_bench;
+  B32 layout_bench;
+  B32 codec_bench;
+  B32 frame_test;
+  B32 palette_test;
+  B32 upload_test;
+  B32 csg_test;
+  B32 undo_test;
+  B32 async_test;
+};
+
+function CLI_Options
+cli_options_from_args(String8List *args)
+{
+  CLI_Options opts = {0};
+  opts.out_path = (char *)"out.png";
+  opts.width = 1280;
+  opts.height = 720;
+  opts.frames = 1;
+  opts.threads = (U32)Max(os_logical_processor_count(), 1);
+  
+  B32 has_view = 0;
+  
+  // NOTE: Arguments come straight from argv, so they are nul-terminated.
+  String8Node *n = args->first ? args->first->next : 0;
+  for (; n != 0; n = n->next) {
+    char *arg = (char *)n->str.data;
+    char *arg1 = n->next ? (char *)n->next->str.data : 0;
+    char *arg2 = (n->next && n->next->next) ? (char *)n->next->next->str.data : 0;
+    
+    if (cstr_equal(arg, "-o") && arg1) {
+      opts.out_path = arg1;
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-size") && arg2) {
+      opts.width = (U32)Max(atoi(arg1), 1);
+      opts.height = (U32)Max(atoi(arg2), 1);
+      n = n->next->next;
+    }
+    else if (cstr_equal(arg, "-view") && arg2) {
+      opts.view = v2f32((F32)atof(arg1), (F32)atof(arg2));
+      has_view = 1;
+      n = n->next->next;
+    }
+    else if (cstr_equal(arg, "-frames") && arg1) {
+      opts.frames = (U32)Max(atoi(arg1), 1);
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-golden") && arg1) {
+      opts.golden_path = arg1;
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-tolerance") && arg1) {
+      opts.tolerance = (U32)Max(atoi(arg1), 0);
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-threads") && arg1) {
+      opts.threads = (U32)Max(atoi(arg1), 1);
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-scene") && arg1) {
+      opts.scene_path = arg1;
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-save") && arg1) {
+      opts.save_path = arg1;
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-trace") && arg1) {
+      opts.trace_path = arg1;
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-lod") && arg1) {
+      opts.lod = 1;
+      opts.lod_bias = (F32)atof(arg1);
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-scaling")) {
+      opts.scaling = 1;
+    }
+    else if (cstr_equal(arg, "-brush_bench")) {
+      opts.brush_bench = 1;
+    }
+    else if (cstr_equal(arg, "-mesh_bench")) {
+      opts.mesh_bench = 1;
+    }
+    else if (cstr_equal(arg, "-light")) {
+      opts.light = 1;
+    }
+    else if (cstr_equal(arg, "-distance_bench")) {
+      opts.distance_bench = 1;
+    }
+    else if (cstr_equal(arg, "-tree_bench")) {
+      opts.tree_bench = 1;
+    }
+    else if (cstr_equal(arg, "-raycast_bench")) {
+      opts.raycast_bench = 1;
+    }
+    else if (cstr_equal(arg, "-layout_bench")) {
+      opts.layout_bench = 1;
+    }
+    else if (cstr_equal(arg, "-codec_bench")) {
+      opts.codec_bench = 1;
+    }
+    else if (cstr_equal(arg, "-frame_test")) {
+      opts.frame_test = 1;
+    }
+    else if (cstr_equal(arg, "-palette_test")) {
+      opts.palette_test = 1;
+    }
+    else if (cstr_equal(arg, "-upload_test")) {
+      opts.upload_test = 1;
+    }
+    else if (cstr_equal(arg, "-csg_test")) {
+      opts.csg_test = 1;
+    }
+    else if (cstr_equal(arg, "-undo_test")) {
+      opts.undo_test = 1;
+    }
+    else if (cstr_equal(arg, "-async_test")) {
+      opts.async_test = 1;
+    }
+    else if (cstr_equal(arg, "-vox") && arg1) {
+      opts.vox_path = arg1;
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-save_vox") && arg1) {
+      opts.save_vox_path = arg1;
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-vox_bench") && arg1) {
+      opts.vox_bench_path = arg1;
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-shader_cache_test") && arg1) {
+      opts.shader_cache_test_dir = arg1;
+      n = n->next;
+    }
+    else if (cstr_equal(arg, "-file_watch_test") && arg1) {
+      opts.file_watch_test_dir = arg1;
+      n = n->next;
+    }
+    else {
+      fprintf(stderr, "unknown argument: %s\n", arg);
+    }
+  }
+  
+  // The default view is relative to the image size, just like the shader's.
+  if (!has_view) {
+    opts.view = v2f32(opts.width*0.1f, opts.height*0.25f);
+  }
+  
+  return opts;
+}
+
+// SC_CompileProc standing in for a real compiler: the bytecode spells out what
+// it was compiled from, and sources starting with #error fail. `user` counts calls.
+function String8
+cli_shader_compile_stub(Arena *arena, void *user, String8 source, String8 entry, String8 target, U32 flags, String8 *error)
+{
+  String8 result = {0};
+  *(U32 *)user += 1;
+  if (str8_equal(str8(source.data, Min(source.count, 6)), S8("#error"))) {
+    *error = str8_pushf(arena, (char *)"%.*s: error", (int)entry.count, entry.data);
+  }
+  else {
+    result = str8_pushf(arena, (char *)"bytecode %.*s %.*s %.*s %08x", (int)source.count, source.data,
+                        (int)entry.count, entry.data, (int)target.count, target.data, flags);
+  }
+  return result;
+}
+
+// Fetches the shader through the cache and checks whether it hit and what came
+// back. Returns 1 when either is wrong.
+function U32
+cli_shader_cache_check(char *step, SC_Cache *cache, SC_Shader *shader, B32 expect_hit)
+{
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  U32 compiles = 0;
+  String8 error = {0};
+  String8 bytecode = sc_bytecode_from_shader(scratch.arena, cache, shader, cli_shader_compile_stub, &compiles, &error);
+  
+  String8 expected = {0};
+  String8 expected_error = {0};
+  U32 expected_compiles = 0;
+  expected = cli_shader_compile_stub(scratch.arena, &expected_compiles, shader->source, shader->entry,
+                                     shader->target, shader->flags, &expected_error);
+  B32 hit = (compiles == 0);
+  B32 ok = (hit == expect_hit && str8_equal(bytecode, expected) && error.count == expected_error.count);
+  printf("%-40s %-4s %s\n", step, hit ? "hit" : "miss", ok ? "ok" : "FAILED");
+  
+  arena_scratch_end(scratch);
+  return !ok;
+}
+
+// Overwrites the shader's entry file with `size` bytes of what it holds, and
+// flips one byte at `flip` unless it is past them.
+function void
+cli_shader_cache_damage(SC_Cache *cache, SC_Shader *shader, U64 size, U64 flip)
+{
+  TempArena scratch = arena_scratch_begin(0, 0);
+  String8 path = sc_cache_path_from_key(scratch.arena, cache, sc_key_from_shader(shader));
+  String8 file = os_file_read(scratch.arena, path);
+  file.count = Min(file.count, size);
+  if (flip < file.count) {
+    file.data[flip] ^= 0x5A;
+  }
+  os_file_write(path, file);
+  arena_scratch_end(scratch);
+}
+
+// Returns the number of steps that went wrong.
+function U32
+cli_shader_cache_test(String8 dir)
+{
+  U32 result = 0;
+  SC_Cache *cache = sc_cache_alloc(dir);
+  
+  SC_Shader vs = {0};
+  vs.name = S8("cli_test.hlsl");
+  vs.source = S8("float4 vs_main() { return 0; }");
+  vs.entry = S8("vs_main");
+  vs.target = S8("vs_5_0");
+  SC_Shader ps = vs;
+  ps.entry = S8("ps_main");
+  ps.target = S8("ps_5_0");
+  
+  // Empty files, so that nothing is left from an earlier run
+  cli_shader_cache_damage(cache, &vs, 0, 0);
+  cli_shader_cache_damage(cache, &ps, 0, 0);
+  
+  result += cli_shader_cache_check((char *)"empty file", cache, &vs, 0);
+  result += cli_shader_cache_check((char *)"same shader", cache, &vs, 1);
+  result += cli_shader_cache_check((char *)"other stage, same source", cache, &ps, 0);
+  result += cli_shader_cache_check((char *)"first stage again", cache, &vs, 1);
+  
+  SC_Cache *reopened = sc_cache_alloc(dir);
+  result += cli_shader_cache_check((char *)"cache reopened", reopened, &vs, 1);
+  sc_cache_release(reopened);
+  
+  // An edit overwrites the stage's entry, so going back is a miss too
+  SC_Shader edited = vs;
+  edited.source = S8("float4 vs_main() { return 1; }");
+  result += cli_shader_cache_check((char *)"source edited", cache, &edited, 0);
+  result += cli_shader_cache_check((char *)"edited source again", cache, &edited, 1);
+  result += cli_shader_cache_check((char *)"source reverted", cache, &vs, 0);
+  result += cli_shader_cache_check((char *)"other stage kept", cache, &ps, 1);
+  
+  SC_Shader flagged = vs;
+  flagged.flags = 1;
+  result += cli_shader_cache_check((char *)"flags changed", cache, &flagged, 0);
+  result += cli_shader_cache_check((char *)"flags changed again", cache, &flagged, 1);
+  
+  // Damaged entries are misses, and get rewritten
+  cli_shader_cache_damage(cache, &flagged, MAX_U64, sizeof(SC_FileHeader) + 3);
+  result += cli_shader_cache_check((char *)"bytecode byte flipped", cache, &flagged, 0);
+  result += cli_shader_cache_check((char *)"rewritten", cache, &flagged, 1);
+  cli_shader_cache_damage(cache, &flagged, MAX_U64, OffsetOf(SC_FileHeader, hash));
+  result += cli_shader_cache_check((char *)"header byte flipped", cache, &flagged, 0);
+  cli_shader_cache_damage(cache, &flagged, sizeof(SC_FileHeader) + 4, MAX_U64);
+  result += cli_shader_cache_check((char *)"truncated bytecode", cache, &flagged, 0);
+  cli_shader_cache_damage(cache, &flagged, sizeof(SC_FileHeader) - 1, MAX_U64);
+  result += cli_shader_cache_check((char *)"truncated header", cache, &flagged, 0);
+  result += cli_shader_cache_check((char *)"rewritten", cache, &flagged, 1);
+  
+  // Failed compiles aren't stored, so they fail again
+  SC_Shader broken = vs;
+  broken.source = S8("#error\nfloat4 vs_main() { return 0; }");
+  result += cli_shader_cache_check((char *)"compile error", cache, &broken, 0);
+  result += cli_shader_cache_check((char *)"compile error again", cache, &broken, 0);
+  
+  result += cli_shader_cache_check((char *)"no cache", 0, &vs, 0);
+  
+  printf("%llu hit(s), %llu miss(es), %u step(s) failed\n",
+         (unsigned long long)cache->hits, (unsigned long long)cache->misses, result);
+  sc_cache_release(cache);
+  
+  return result;
+}
+
+// Checks whether the watch reports a change, then that it reports it once.
+// Returns 1 when either is wrong.
+function U32
+cli_file_watch_check(char *mode, char *step, OS_Handle watch, B32 expect_changed)
+{
+  B32 changed = os_file_watch_changed(watch);
+  B32 changed_again = os_file_watch_changed(watch);
+  B32 ok = (changed == expect_changed && !changed_again);
+  printf("%-7s %-28s %-9s %s\n", mode, step, changed ? "changed" : "unchanged", ok ? "ok" : "FAILED");
+  return !ok;
+}
+
+// Writes, replaces through a rename and touches a file in `dir` under a watch,
+// through inotify and through polling its modification time. Linux only; between
+// steps it waits out the file system's timestamp granularity, so polling can
+// tell them apart. Returns the number of steps that went wrong.
+function U32
+cli_file_watch_test(String8 dir)
+{
+  U32 result = 0;
+  
+#if OS_LINUX
+  char *mode_names[] = { (char *)"inotify", (char *)"poll" };
+  OS_FileWatchFlags mode_flags[] = { 0, OS_FileWatch_Poll };
+  struct timespec pause = { 0, 20*1000*1000 };
+  
+  for (U32 mode = 0; mode < ArrayCount(mode_flags); mode += 1) {
+    TempArena scratch = arena_scratch_begin(0, 0);
+    char *name = mode_names[mode];
+    String8 path = str8_pushf(scratch.arena, (char *)"%.*s/watched_%s.txt", (int)dir.count, dir.data, name);
+    String8 temp_path = str8_pushf(scratch.arena, (char *)"%.*s/watched_%s.tmp", (int)dir.count, dir.data, name);
+    String8 other_path = str8_pushf(scratch.arena, (char *)"%.*s/other_%s.txt", (int)dir.count, dir.data, name);
+    
+    os_file_write(path, S8("0"));
+    OS_Handle watch = os_file_watch_open(path, mode_flags[mode]);
+    
+    // The watch must be on the path it was asked for
+    OS_Linux_Entity *entity = os_linux_entity_from_handle(watch);
+    B32 opened = (entity != 0 && (entity->file_watch.inotify_fd < 0) == (mode_flags[mode] == OS_FileWatch_Poll));
+    printf("%-7s %-28s %-9s %s\n", name, "opened", "", opened ? "ok" : "FAILED");
+    result += !opened;
+    
+    if (opened) {
+      result += cli_file_watch_check(name, (char *)"nothing yet", watch, 0);
+      
+      nanosleep(&pause, 0);
+      os_file_write(path, S8("1"));
+      result += cli_file_watch_check(name, (char *)"written", watch, 1);
+      
+      nanosleep(&pause, 0);
+      os_file_write(temp_path, S8("2"));
+      rename((char *)temp_path.data, (char *)path.data);
+      result += cli_file_watch_check(name, (char *)"replaced through a rename", watch, 1);
+      
+      nanosleep(&pause, 0);
+      utimensat(AT_FDCWD, (char *)path.data, 0, 0);
+      result += cli_file_watch_check(name, (char *)"touched", watch, 1);
+      
+      nanosleep(&pause, 0);
+      os_file_write(other_path, S8("3"));
+      result += cli_file_watch_check(name, (char *)"other file written", watch, 0);
+      
+      os_file_watch_close(watch);
+    }
+    
+    arena_scratch_end(scratch);
+  }
+  
+  printf("%u step(s) failed\n", result);
+#else
+  printf("the file watch test runs on Linux only\n");
+  result = 1;
+#endif
+  
+  return result;
+}
+
+// Hashed LCG; good enough for the benches' and tests' random inputs
+function U32
+cli_random(U32 *state)
+{
+  *state = *state*1664525u + 1013904223u;
+  U32 result = *state;
+  result ^= result >> 16;
+  result *= 0x7FEB352Du;
+  result ^= result >> 15;
+  result *= 0x846CA68Bu;
+  result ^= result >> 16;
+  return result;
+}
+
+// In [0, 1)
+function F32
+cli_random_f32(U32 *state)
+{
+  F32 result = (F32)(cli_random(state) >> 8) / (F32)(1u << 24);
+  return result;
+}
+
+// Kinds of random dirty brick mask the upload test plans
+enum CLI_DirtyMask {
+  CLI_DirtyMask_Voxels, // A few edited voxels, marked through vox_dirty_bricks_mark
+  CLI_DirtyMask_Boxes,  // A few random boxes of bricks, as brush strokes leave
+  CLI_DirtyMask_Noise,  // Every brick dirty with some probability
+  CLI_DirtyMask_COUNT,
+};
+
+function void
+cli_dirty_mask_fill(U64 *dirty_bricks, CLI_DirtyMask kind, U32 *state)
+{
+  vox_dirty_bricks_clear(dirty_bricks);
+  switch (kind) {
+    case CLI_DirtyMask_Voxels: {
+      U32 count = 1 + cli_random(state) % 24;
+      for (U32 idx = 0; idx < count; idx += 1) {
+        V3S32 local_coord = v3s32((S32)(cli_random(state) % VOX_SLICE_SIZE), (S32)(cli_random(state) % VOX_SLICE_SIZE),
+                                  (S32)(cli_random(state) % VOX_SLICE_SIZE));
+        vox_dirty_bricks_mark(dirty_bricks, local_coord);
+      }
+    }break;
+    
+    case CLI_DirtyMask_Boxes: {
+      U32 count = 1 + cli_random(state) % 6;
+      for (U32 idx = 0; idx < count; idx += 1) {
+        V3S32 min = {0};
+        V3S32 max = {0};
+        for (U32 axis = 0; axis < 3; axis += 1) {
+          // Min evaluates its arguments twice, so draw the side first
+          S32 side = 1 + (S32)(cli_random(state) % 12);
+          min.e[axis] = (S32)(cli_random(state) % VOX_SLICE_SIZE);
+          max.e[axis] = Min(min.e[axis] + side, VOX_SLICE_SIZE);
+        }
+        for (S32 z = min.z; z < max.z; z += 1) {
+          for (S32 y = min.y; y < max.y; y += 1) {
+            for (S32 x = min.x; x < max.x; x += 1) {
+              vox_dirty_bricks_mark(dirty_bricks, v3s32(x, y, z));
+            }
+          }
+        }
+      }
+    }break;
+    
+    case CLI_DirtyMask_Noise: {
+      U32 threshold = cli_random(state) % 256;
+      for (S32 brick_idx = 0; brick_idx < VOX_BRICKS_PER_CHUNK; brick_idx += 1) {
+        if (cli_random(state) % 256 < threshold) {
+          dirty_bricks[brick_idx / 64] |= (U64)1 << (brick_idx % 64);
+        }
+      }
+    }break;
+    
+    default: {}break;
+  }
+}
+
+// Plans uploads for random dirty masks and checks that the boxes are brick
+// aligned and inside the chunk, cover every dirty brick, don't overlap, count
+// their voxels right, and cover clean bricks only when the plan falls back to
+// one box around every dirty brick. Returns the plans that break any of it.
+function U32
+cli_upload_test(void)
+{
+  char *kind_names[CLI_DirtyMask_COUNT] = { (char *)"voxels", (char *)"boxes", (char *)"noise" };
+  U32 masks_per_kind = 20000;
+  U32 result = 0;
+  U32 state = 1;
+  
+  for (U32 kind = 0; kind < CLI_DirtyMask_COUNT; kind += 1) {
+    U32 failed = 0;
+    U32 fallback_count = 0;
+    U64 boxes_count = 0;
+    U64 dirty_count = 0;
+    U64 uploaded_count = 0;
+    for (U32 mask = 0; mask < masks_per_kind; mask += 1) {
+      U64 dirty_bricks[VOX_BRICK_SUMMARY_WORDS];
+      cli_dirty_mask_fill(dirty_bricks, (CLI_DirtyMask)kind, &state);
+      VOX_UploadPlan plan = vox_upload_plan_from_dirty_bricks(dirty_bricks);
+      
+      // How many boxes cover each brick
+      U8 covered[VOX_BRICKS_PER_CHUNK] = {0};
+      B32 ok = 1;
+      U64 voxels_count = 0;
+      for (U32 idx = 0; idx < plan.boxes_count; idx += 1) {
+        VOX_UploadBox *box = &plan.boxes[idx];
+        for (U32 axis = 0; axis < 3; axis += 1) {
+          ok = ok && (box->min.e[axis] % VOX_BRICK_SIZE == 0 && box->max.e[axis] % VOX_BRICK_SIZE == 0 &&
+                      box->min.e[axis] >= 0 && box->min.e[axis] < box->max.e[axis] && box->max.e[axis] <= VOX_SLICE_SIZE);
+        }
+        if (!ok) {
+          break;
+        }
+        V3S32 size = v3s32_sub(box->max, box->min);
+        voxels_count += (U64)size.x*size.y*size.z;
+        for (S32 z = box->min.z; z < box->max.z; z += VOX_BRICK_SIZE) {
+          for (S32 y = box->min.y; y < box->max.y; y += VOX_BRICK_SIZE) {
+            for (S32 x = box->min.x; x < box->max.x; x += VOX_BRICK_SIZE) {
+              covered[vox_brick_idx_from_local_coord(v3s32(x, y, z))] += 1;
+            }
+          }
+        }
+      }
+      ok = ok && (plan.voxels_count == voxels_count);
+      
+      // The fallback box is the dirty bricks' bounding box
+      V3S32 bounds_min = v3s32(VOX_SLICE_SIZE, VOX_SLICE_SIZE, VOX_SLICE_SIZE);
+      V3S32 bounds_max = v3s32(0, 0, 0);
+      U32 mask_dirty_count = 0;
+      U32 clean_count = 0;
+      for (S32 brick_idx = 0; brick_idx < VOX_BRICKS_PER_CHUNK && ok; brick_idx += 1) {
+        B32 dirty = (dirty_bricks[brick_idx / 64] >> (brick_idx % 64)) & 1;
+        ok = (covered[brick_idx] <= 1 && (!dirty || covered[brick_idx] == 1));
+        mask_dirty_count += dirty;
+        clean_count += (!dirty && covered[brick_idx]);
+        if (dirty) {
+          V3S32 brick_min = v3s32_scale(v3s32(brick_idx % VOX_BRICKS_PER_SLICE, brick_idx / VOX_BRICKS_PER_SLICE % VOX_BRICKS_PER_SLICE,
+                                              brick_idx / (VOX_BRICKS_PER_SLICE*VOX_BRICKS_PER_SLICE)), VOX_BRICK_SIZE);
+          for (U32 axis = 0; axis < 3; axis += 1) {
+            bounds_min.e[axis] = Min(bounds_min.e[axis], brick_min.e[axis]);
+            bounds_max.e[axis] = Max(bounds_max.e[axis], brick_min.e[axis] + VOX_BRICK_SIZE);
+          }
+        }
+      }
+      B32 fallback = (plan.boxes_count == 1 && clean_count > 0);
+      if (fallback) {
+        ok = ok && MemoryMatchStruct(&plan.boxes[0].min, &bounds_min) && MemoryMatchStruct(&plan.boxes[0].max, &bounds_max);
+      }
+      else {
+        ok = ok && (clean_count == 0 && plan.boxes_count <= VOX_UPLOAD_BOXES_MAX);
+      }
+      ok = ok && ((mask_dirty_count == 0) == (plan.boxes_count == 0));
+      
+      failed += !ok;
+      fallback_count += fallback;
+      boxes_count += plan.boxes_count;
+      dirty_count += mask_dirty_count;
+      uploaded_count += mask_dirty_count + clean_count;
+    }
+    
+    printf("%-6s %u mask(s): %.1f dirty brick(s), %.2f box(es) per plan, %u fell back to one box, "
+           "%.2f brick(s) uploaded per dirty one, %u failed\n",
+           kind_names[kind], masks_per_kind, (F64)dirty_count / masks_per_kind, (F64)boxes_count / masks_per_kind,
+           fallback_count, (F64)uploaded_count / Max(dirty_count, 1), failed);
+    result += failed;
+  }
+  
+  return result;
+}
+
+// Returns the number of pixels where any channel differs by more than `tolerance`.
+function U64
+cli_compare_with_golden(VOX_Framebuffer *fb, char *golden_path, U32 tolerance)
+{
+  U64 result = 0;
+  
+  int w = 0, h = 0, n = 0;
+  U8 *golden = stbi_load(golden_path, &w, &h, &n, 4);
+  if (!golden) {
+    fprintf(stderr, "failed to load golden image: %s\n", golden_path);
+    result = (U64)fb->width*fb->height;
+  }
+  else if ((U32)w != fb->width || (U32)h != fb->height) {
+    fprintf(stderr, "golden image is %dx%d, expected %ux%u\n", w, h, fb->width, fb->height);
+    result = (U64)fb->width*fb->height;
+  }
+  else {
+    U8 *pixels = (U8 *)fb->pixels;
+    for (U64 idx = 0; idx < (U64)fb->width*fb->height; idx += 1) {
+      for (U64 c = 0; c < 4; c += 1) {
+        S32 diff = (S32)pixels[idx*4 + c] - (S32)golden[idx*4 + c];
+        if ((U32)(diff < 0 ? -diff : diff) > tolerance) {
+          result += 1;
+          break;
+        }
+      }
+    }
+  }
+  
+  if (golden) {
+    stbi_image_free(golden);
+  }
+  
+  return result;
+}
+
+// Drags a brush 256 voxels along x, with undo recording as in the editor, and
+// reports how many voxels per second the stamps cover.
+function void
+cli_brush_bench(void)
+{
+  char *shape_names[VOX_BrushShape_COUNT] = { (char *)"sphere", (char *)"cube", (char *)"cylinder", (char *)"noise" };
+  char *mode_names[] = { (char *)"remove", (char *)"add", (char *)"paint" };
+  VOX_EditMode modes[] = { VOX_EditMode_Add, VOX_EditMode_Paint, VOX_EditMode_Delete };
+  S32 radii[] = { 1, 2, 4, 8, 16, 32, 64 };
+  
+  VOX_World *world = vox_world_alloc();
+  VOX_UndoHistory *undo = vox_undo_alloc(VOX_UNDO_DEFAULT_BUDGET);
+  F64 freq = os_get_ticks_frequency();
+  
+  for (U32 shape = 0; shape < VOX_BrushShape_COUNT; shape += 1) {
+    for (U32 radius_idx = 0; radius_idx < ArrayCount(radii); radius_idx += 1) {
+      for (U32 mode_idx = 0; mode_idx < ArrayCount(modes); mode_idx += 1) {
+        VOX_Brush brush = {};
+        brush.shape = (VOX_BrushShape)shape;
+        brush.mode = modes[mode_idx];
+        brush.radius = radii[radius_idx];
+        brush.spacing = VOX_BRUSH_DEFAULT_SPACING;
+        brush.voxel.opacity = 255;
+        brush.voxel.color = (U8)(1 + mode_idx);
+        brush.seed = 0x9E3779B9u;
+        
+        F64 start = os_get_ticks();
+        VOX_BrushStroke stroke = {0};
+        vox_brush_stroke_begin(&stroke, world, undo, &brush, 0);
+        for (S32 x = 0; x <= 256; x += 1) {
+          vox_brush_stroke_to(&stroke, v3s32(x, 0, 0));
+        }
+        vox_brush_stroke_end(&stroke);
+        F64 seconds = (os_get_ticks() - start) / freq;
+        
+        printf("%-8s r=%-2d %-6s: %4llu stamps, %9llu voxels in %8.2f ms, %8.1f Mvoxels/s\n",
+               shape_names[shape], brush.radius, mode_names[brush.mode],
+               (unsigned long long)stroke.stamps_count, (unsigned long long)stroke.voxels_count,
+               seconds*1000.0, (F64)stroke.voxels_count / seconds / 1000000.0);
+      }
+    }
+  }
+  
+  vox_undo_release(undo);
+  vox_world_release(world);
+}
+
+// Meshes every chunk once on the calling thread, then through a mesh cache on
+// `threads` threads, then again after a single voxel edit.
+function void
+cli_mesh_bench(VOX_World *world, U32 threads)
+{
+  Arena *arena = arena_alloc_default();
+  F64 freq = os_get_ticks_frequency();
+  
+  U64 quads_count = 0;
+  U64 faces_count = 0;
+  U32 quads_max = 0;
+  F64 chunk_seconds_max = 0;
+  
+  F64 start = os_get_ticks();
+  for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+    TempArena temp = arena_temp_begin(arena);
+    F64 chunk_start = os_get_ticks();
+    VOX_MeshBuild build = vox_mesh_build(temp.arena, world, n);
+    chunk_seconds_max = Max(chunk_seconds_max, (os_get_ticks() - chunk_start) / freq);
+    
+    quads_count += build.quads_count;
+    faces_count += build.faces_count;
+    quads_max = Max(quads_max, build.quads_count);
+    arena_temp_end(temp);
+  }
+  F64 seconds = (os_get_ticks() - start) / freq;
+  
+  U32 chunks_count = Max(world->chunks_count, 1);
+  printf("%u chunk(s): %llu quads from %llu faces (%.1fx fewer), %.1f quads/chunk, %u max, %llu KiB of vertices\n",
+         world->chunks_count, (unsigned long long)quads_count, (unsigned long long)faces_count,
+         (F64)faces_count / (F64)Max(quads_count, 1), (F64)quads_count / chunks_count, quads_max,
+         (unsigned long long)(quads_count*VOX_MESH_VERTICES_PER_QUAD*sizeof(VOX_MeshVertex) / 1024));
+  printf("1 thread: %.2f ms, %.1f us/chunk, %.1f us max\n",
+         seconds*1000.0, seconds*1000000.0 / chunks_count, chunk_seconds_max*1000000.0);
+  
+  async_init(threads - 1);
+  VOX_MeshCache *cache = vox_mesh_cache_alloc();
+  
+  start = os_get_ticks();
+  U32 rebuilt = vox_mesh_cache_update(cache, world);
+  seconds = (os_get_ticks() - start) / freq;
+  printf("%u thread(s), mesh cache: %u mesh(es) in %.2f ms\n", threads, rebuilt, seconds*1000.0);
+  
+  if (world->first) {
+    vox_world_clear_dirty_bricks(world);
+    
+    V3S32 coord = v3s32_add(v3s32_scale(world->first->coord, VOX_SLICE_SIZE), v3s32(VOX_SLICE_SIZE/2, VOX_SLICE_SIZE/2, VOX_SLICE_SIZE/2));
+    VOX_Voxel voxel = vox_world_get_voxel(world, coord);
+    voxel.opacity = voxel.opacity ? 0 : 255;
+    vox_world_set_voxel(world, coord, voxel);
+    
+    start = os_get_ticks();
+    rebuilt = vox_mesh_cache_update(cache, world);
+    seconds = (os_get_ticks() - start) / freq;
+    printf("after one edit: %u mesh(es) in %.2f ms\n", rebuilt, seconds*1000.0);
+  }
+  
+  vox_mesh_cache_release(cache);
+  async_release();
+  arena_release(arena);
+}
+
+// The caches the editor keeps up to date every frame
+struct CLI_FrameCaches {
+  VOX_LightCache *lights;
+  VOX_DistanceCache *distances;
+  VOX_LodCache *lods;
+  VOX_MeshCache *meshes;
+};
+
+// What a frame rebuilt in each cache
+struct CLI_FrameRebuilt {
+  U32 lights;
+  U32 distances;
+  U32 lods;
+  U32 meshes;
+};
+
+// A frame as the editor runs it, with the CPU renderer standing in for the GPU:
+// the caches catch up with the chunks' dirty bricks, the frame is drawn, and the
+// dirty bricks are cleared.
+function CLI_FrameRebuilt
+cli_frame(VOX_World *world, CLI_FrameCaches *caches, VOX_UniformData *uniforms, VOX_Framebuffer *fb)
+{
+  CLI_FrameRebuilt result = {0};
+  result.lights = vox_light_cache_update(caches->lights, world);
+  result.distances = vox_distance_cache_update(caches->distances, world);
+  result.lods = vox_lod_cache_update(caches->lods, world);
+  result.meshes = vox_mesh_cache_update(caches->meshes, world);
+  vox_render_cpu(world, caches->lights, caches->lods, uniforms, fb);
+  vox_world_clear_dirty_bricks(world);
+  return result;
+}
+
+// Edits chunk (1,0,0), away from the origin chunk the GPU path uploads, and
+// renders two frames after each edit: the first rebuilds what the edit touched,
+// the second nothing. The first edit creates the chunk, the second changes it.
+// Returns the number of edits after which either frame did the wrong amount of work.
+function U32
+cli_frame_test(VOX_World *world, VOX_UniformData *uniforms)
+{
+  async_init(0);
+  Arena *arena = arena_alloc_default();
+  VOX_Framebuffer fb = vox_framebuffer_alloc(arena, 160, 90);
+  
+  CLI_FrameCaches caches = {0};
+  caches.lights = vox_light_cache_alloc();
+  caches.distances = vox_distance_cache_alloc();
+  caches.lods = vox_lod_cache_alloc();
+  caches.meshes = vox_mesh_cache_alloc();
+  
+  CLI_FrameRebuilt rebuilt = cli_frame(world, &caches, uniforms, &fb);
+  printf("first frame: %u light volume(s), %u distance field(s), %u LOD pyramid(s), %u mesh(es)\n",
+         rebuilt.lights, rebuilt.distances, rebuilt.lods, rebuilt.meshes);
+  
+  U32 result = 0;
+  for (U32 edit = 0; edit < 2; edit += 1) {
+    VOX_Voxel voxel = {0};
+    voxel.opacity = 255;
+    voxel.color = (U8)(3 + edit);
+    vox_world_set_voxel(world, v3s32(VOX_SLICE_SIZE + 5 + edit, 3, 4), voxel);
+    
+    CLI_FrameRebuilt first = cli_frame(world, &caches, uniforms, &fb);
+    CLI_FrameRebuilt second = cli_frame(world, &caches, uniforms, &fb);
+    printf("edit %u in chunk (1,0,0): next frame %u light volume(s), %u distance field(s), %u LOD pyramid(s), "
+           "%u mesh(es); the one after %u, %u, %u, %u\n", edit, first.lights, first.distances, first.lods,
+           first.meshes, second.lights, second.distances, second.lods, second.meshes);
+    
+    if (first.lights == 0 || first.distances == 0 || first.lods == 0 || first.meshes == 0 ||
+        second.lights != 0 || second.distances != 0 || second.lods != 0 || second.meshes != 0) {
+      result += 1;
+    }
+  }
+  
+  vox_mesh_cache_release(caches.meshes);
+  vox_lod_cache_release(caches.lods);
+  vox_distance_cache_release(caches.distances);
+  vox_light_cache_release(caches.lights);
+  arena_release(arena);
+  async_release();
+  
+  return result;
+}
+
+// Counts the voxels of a field that break its definition: solid voxels are 0, and
+// every empty one is one more than its smallest neighbor within the chunk, up to
+// VOX_DISTANCE_MAX.
+function U32
+cli_distance_errors(U8 *distance, VOX_Occupancy *occ)
+{
+  U32 result = 0;
+  S32 n = VOX_SLICE_SIZE;
+  
+  for (S32 z = 0; z < n; z += 1) {
+    for (S32 y = 0; y < n; y += 1) {
+      for (S32 x = 0; x < n; x += 1) {
+        V3S32 coord = v3s32(x, y, z);
+        S32 expected = 0;
+        if (!vox_occupancy_get(occ, coord)) {
+          S32 nearest = VOX_DISTANCE_MAX;
+          for (S32 dz = -1; dz <= 1; dz += 1) {
+            for (S32 dy = -1; dy <= 1; dy += 1) {
+              for (S32 dx = -1; dx <= 1; dx += 1) {
+                V3S32 nb = v3s32(x + dx, y + dy, z + dz);
+                if ((dx | dy | dz) != 0 &&
+                    nb.x >= 0 && nb.x < n && nb.y >= 0 && nb.y < n && nb.z >= 0 && nb.z < n) {
+                  nearest = Min(nearest, (S32)distance[vox_distance_idx_from_local_coord(nb)]);
+                }
+              }
+            }
+          }
+          expected = Min(nearest + 1, VOX_DISTANCE_MAX);
+        }
+        if (distance[vox_distance_idx_from_local_coord(coord)] != expected) {
+          result += 1;
+        }
+      }
+    }
+  }
+  
+  return result;
+}
+
+// Builds every chunk's distance field once on the calling thread, then through a
+// distance cache on `threads` threads, then again after a single voxel edit, and
+// checks each result. Returns the number of wrong voxels.
+function U32
+cli_distance_bench(VOX_World *world, U32 threads)
+{
+  F64 freq = os_get_ticks_frequency();
+  U32 errors = 0;
+  
+  local U8 distance[VOX_CHUNK_SIZE];
+  F64 seconds = 0;
+  F64 chunk_seconds_max = 0;
+  for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+    F64 chunk_start = os_get_ticks();
+    vox_distance_build(distance, &n->occupancy);
+    F64 chunk_seconds = (os_get_ticks() - chunk_start) / freq;
+    seconds += chunk_seconds;
+    chunk_seconds_max = Max(chunk_seconds_max, chunk_seconds);
+    
+    errors += cli_distance_errors(distance, &n->occupancy);
+  }
+  
+  U32 chunks_count = Max(world->chunks_count, 1);
+  printf("%u chunk(s), 1 thread: %.2f ms, %.1f us/chunk, %.1f us max\n",
+         world->chunks_count, seconds*1000.0, seconds*1000000.0 / chunks_count, chunk_seconds_max*1000000.0);
+  
+  async_init(threads - 1);
+  VOX_DistanceCache *cache = vox_distance_cache_alloc();
+  
+  F64 start = os_get_ticks();
+  U32 rebuilt = vox_distance_cache_update(cache, world);
+  seconds = (os_get_ticks() - start) / freq;
+  printf("%u thread(s), distance cache: %u field(s) in %.2f ms\n", threads, rebuilt, seconds*1000.0);
+  
+  if (world->first) {
+    // The cache leaves the dirty bricks alone; the renderer clears them at the
+    // end of the frame.
+    vox_world_clear_dirty_bricks(world);
+    
+    V3S32 coord = v3s32_add(v3s32_scale(world->first->coord, VOX_SLICE_SIZE), v3s32(VOX_SLICE_SIZE/2, VOX_SLICE_SIZE/2, VOX_SLICE_SIZE/2));
+    VOX_Voxel voxel = vox_world_get_voxel(world, coord);
+    voxel.opacity = voxel.opacity ? 0 : 255;
+    vox_world_set_voxel(world, coord, voxel);
+    
+    start = os_get_ticks();
+    rebuilt = vox_distance_cache_update(cache, world);
+    seconds = (os_get_ticks() - start) / freq;
+    printf("after one edit: %u field(s) in %.2f ms\n", rebuilt, seconds*1000.0);
+  }
+  
+  for (VOX_ChunkDistance *f = cache->first; f != 0; f = f->next) {
+    VOX_ChunkNode *node = vox_world_chunk_from_coord(world, f->coord);
+    errors += cli_distance_errors(f->distance, &node->occupancy);
+  }
+  printf("%u wrong voxel(s)\n", errors);
+  
+  vox_distance_cache_release(cache);
+  async_release();
+  return errors;
+}
+
+// How far apart two t-values around `t` can be and still count as a tie: F32
+// t-values far from the ray's origin are only good to a few ulps of `t`.
+function F32
+cli_raycast_epsilon(F32 t)
+{
+  F32 result = Max(1e-3f, absf32(t)*1e-6f);
+  return result;
+}
+
+// Parametric range a ray spends inside a voxel, and where it enters each axis'
+// slab of it. The range is empty, or nearly, when the ray misses it or only
+// grazes an edge or corner.
+function V2F32
+cli_ray_voxel_range(V3F32 ro, V3F32 rd, V3S32 coord, V3F32 *t_enter_axes)
+{
+  V3F32 min = vox_world_pos_from_voxel_coord(coord);
+  V2F32 result = v2f32(-VOX_RAYCAST_T_FAR, VOX_RAYCAST_T_FAR);
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    F32 t0 = -VOX_RAYCAST_T_FAR;
+    F32 t1 = VOX_RAYCAST_T_FAR;
+    if (rd.e[axis] != 0.f) {
+      t0 = (min.e[axis] - ro.e[axis]) / rd.e[axis];
+      t1 = (min.e[axis] + 1.f - ro.e[axis]) / rd.e[axis];
+    }
+    t_enter_axes->e[axis] = Min(t0, t1);
+    result.x = Max(result.x, Min(t0, t1));
+    result.y = Min(result.y, Max(t0, t1));
+  }
+  return result;
+}
+
+// Whether two hits of the same ray differ only because the ray passes exactly
+// through an edge or corner, where rounding decides which voxel comes first.
+function B32
+cli_raycast_results_tie(V3F32 ro, V3F32 rd, VOX_RaycastResult *a, VOX_RaycastResult *b)
+{
+  V3F32 enter_a = {0};
+  V3F32 enter_b = {0};
+  V2F32 range_a = cli_ray_voxel_range(ro, rd, a->coord, &enter_a);
+  V2F32 range_b = cli_ray_voxel_range(ro, rd, b->coord, &enter_b);
+  F32 epsilon = cli_raycast_epsilon(range_a.x);
+  
+  B32 result = 0;
+  if (!MemoryMatchStruct(&a->coord, &b->coord)) {
+    result = (range_a.y - range_a.x < epsilon || range_b.y - range_b.x < epsilon);
+  }
+  else {
+    // Same voxel, entered through a different face
+    U32 axis_a = (a->normal.x != 0.f) ? 0 : (a->normal.y != 0.f) ? 1 : 2;
+    U32 axis_b = (b->normal.x != 0.f) ? 0 : (b->normal.y != 0.f) ? 1 : 2;
+    result = (absf32(enter_a.e[axis_a] - enter_a.e[axis_b]) < epsilon);
+  }
+  return result;
+}
+
+// Builds the world's 64-tree, reads it back from a copy of its blob, checks every
+// voxel of every chunk against the world, then casts a ray per pixel of the
+// camera's view through both the world and the tree. Returns the number of
+// voxels and rays where they differ.
+function U64
+cli_tree_bench(VOX_World *world, VOX_UniformData *uniforms)
+{
+  Arena *arena = arena_alloc(GiB(4llu));
+  F64 freq = os_get_ticks_frequency();
+  U64 errors = 0;
+  
+  F64 start = os_get_ticks();
+  VOX_Tree64 built = vox_tree64_build(arena, world);
+  F64 seconds = (os_get_ticks() - start) / freq;
+  
+  // Dense chunks keep every voxel plus its occupancy bits
+  U64 dense_size = (U64)world->chunks_count*(sizeof(VOX_Chunk) + sizeof(VOX_Occupancy));
+  U64 solid_count = Max(built.voxels_count, 1);
+  printf("%u chunk(s): depth %u, %u node(s), %u solid voxel(s), built in %.2f ms\n",
+         world->chunks_count, built.depth, built.nodes_count, built.voxels_count, seconds*1000.0);
+  printf("tree %llu KiB, %.2f bytes/solid voxel; chunks %llu KiB, %.2f bytes/solid voxel (%.1fx)\n",
+         (unsigned long long)(built.blob.count / 1024), (F64)built.blob.count / solid_count,
+         (unsigned long long)(dense_size / 1024), (F64)dense_size / solid_count,
+         (F64)dense_size / (F64)Max(built.blob.count, 1));
+  
+  // Everything below goes through the copy, as if the blob had been loaded from disk
+  String8 blob = str8((U8 *)arena_push_nozero(arena, built.blob.count), built.blob.count);
+  MemoryCopy(blob.data, built.blob.data, blob.count);
+  VOX_Tree64 tree = vox_tree64_from_blob(blob);
+  if (tree.nodes_count != built.nodes_count) {
+    errors += 1;
+  }
+  
+  U64 voxel_errors = 0;
+  for (VOX_ChunkNode *n = world->first; n != 0 && tree.nodes_count; n = n->next) {
+    V3S32 chunk_min = v3s32_scale(n->coord, VOX_SLICE_SIZE);
+    for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+      V3S32 coord = v3s32_add(chunk_min, v3s32(idx % VOX_SLICE_SIZE, idx / VOX_SLICE_SIZE % VOX_SLICE_SIZE, idx / (VOX_SLICE_SIZE*VOX_SLICE_SIZE)));
+      VOX_Voxel expected = vox_world_get_voxel(world, coord);
+      VOX_Voxel voxel = vox_tree64_get_voxel(&tree, coord);
+      if (voxel.opacity != expected.opacity || (expected.opacity && !MemoryMatchStruct(&voxel, &expected))) {
+        voxel_errors += 1;
+      }
+    }
+  }
+  printf("%llu wrong voxel(s)\n", (unsigned long long)voxel_errors);
+  errors += voxel_errors;
+  
+  U32 width = (U32)uniforms->client_size.x;
+  U32 height = (U32)uniforms->client_size.y;
+  U64 rays_count = (U64)width*height;
+  VOX_CameraRay *rays = ArenaPushArrayNoZero(arena, VOX_CameraRay, rays_count);
+  VOX_RaycastResult *results = ArenaPushArrayNoZero(arena, VOX_RaycastResult, rays_count);
+  for (U32 y = 0; y < height; y += 1) {
+    for (U32 x = 0; x < width; x += 1) {
+      rays[x + y*width] = vox_camera_ray_from_frag_coord(uniforms, v2f32(x + 0.5f, y + 0.5f));
+    }
+  }
+  
+  U64 hits_count = 0;
+  F64 dense_steps = 0;
+  start = os_get_ticks();
+  for (U64 idx = 0; idx < rays_count; idx += 1) {
+    results[idx] = vox_raycast(world, uniforms->zoom, rays[idx].ro, rays[idx].rd);
+    dense_steps += results[idx].steps;
+  }
+  F64 dense_seconds = (os_get_ticks() - start) / freq;
+  
+  U64 ray_errors = 0;
+  U64 gave_up_count = 0;
+  U64 ties_count = 0;
+  F64 tree_steps = 0;
+  start = os_get_ticks();
+  for (U64 idx = 0; idx < rays_count; idx += 1) {
+    VOX_RaycastResult res = vox_tree64_raycast(&tree, rays[idx].ro, rays[idx].rd);
+    tree_steps += res.steps;
+    hits_count += res.hit;
+    
+    // vox_raycast stops after 256 steps; the tree usually gets further in as many.
+    VOX_RaycastResult *expected = &results[idx];
+    if (!expected->hit && expected->steps >= 256.f) {
+      gave_up_count += 1;
+    }
+    else if (res.hit != expected->hit) {
+      ray_errors += 1;
+    }
+    else if (res.hit && (!MemoryMatchStruct(&res.coord, &expected->coord) || !MemoryMatchStruct(&res.normal, &expected->normal))) {
+      if (cli_raycast_results_tie(rays[idx].ro, rays[idx].rd, &res, expected)) {
+        ties_count += 1;
+      }
+      else {
+        ray_errors += 1;
+      }
+    }
+  }
+  F64 tree_seconds = (os_get_ticks() - start) / freq;
+  
+  printf("%llu ray(s), %llu hit(s)\n", (unsigned long long)rays_count, (unsigned long long)hits_count);
+  printf("dense: %.2f ms, %.2f Mrays/s, %.1f steps/ray\n",
+         dense_seconds*1000.0, rays_count / dense_seconds / 1000000.0, dense_steps / Max(rays_count, 1));
+  printf("tree:  %.2f ms, %.2f Mrays/s, %.1f steps/ray\n",
+         tree_seconds*1000.0, rays_count / tree_seconds / 1000000.0, tree_steps / Max(rays_count, 1));
+  printf("%llu ray(s) disagree, %llu tie(s) on an edge or corner, %llu ray(s) ran out of dense steps\n",
+         (unsigned long long)ray_errors, (unsigned long long)ties_count, (unsigned long long)gave_up_count);
+  errors += ray_errors;
+  
+  arena_release(arena);
+  return errors;
+}
+
+// Times the access patterns the chunk layout is meant to help, over every chunk
+// and on the calling thread: index conversion, the 6 face neighbors of every
+// voxel, 2^3 downsampling, and whole-chunk walks along each axis. Then the light,
+// LOD and mesh builds, which are made of such queries.
+function void
+cli_layout_bench(VOX_World *world)
+{
+  char *layout_names[] = { (char *)"linear", (char *)"morton", (char *)"bricks" };
+  printf("%s layout%s, %u chunk(s)\n", layout_names[VOX_CHUNK_LAYOUT],
+         (VOX_CHUNK_LAYOUT == VOX_CHUNK_LAYOUT_MORTON && VOX_MORTON_BMI2) ? " (bmi2)" : "", world->chunks_count);
+  
+  F64 freq = os_get_ticks_frequency();
+  U64 chunks_count = Max(world->chunks_count, 1);
+  U64 checksum = 0;
+  
+  // Round trip of every index of a chunk, once per chunk
+  F64 start = os_get_ticks();
+  for (U64 chunk_idx = 0; chunk_idx < chunks_count; chunk_idx += 1) {
+    for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+      checksum += (U64)vox_idx_from_local_coord(vox_local_coord_from_idx(idx));
+    }
+  }
+  F64 seconds = (os_get_ticks() - start) / freq;
+  printf("index round trip: %8.2f ms, %8.1f Mvoxels/s\n",
+         seconds*1000.0, chunks_count*VOX_CHUNK_SIZE / seconds / 1000000.0);
+  
+  S32 n = VOX_SLICE_SIZE;
+  start = os_get_ticks();
+  for (VOX_ChunkNode *node = world->first; node != 0; node = node->next) {
+    VOX_Chunk *chunk = &node->chunk;
+    for (S32 z = 1; z < n - 1; z += 1) {
+      for (S32 y = 1; y < n - 1; y += 1) {
+        for (S32 x = 1; x < n - 1; x += 1) {
+          checksum += (chunk->voxels[vox_idx_from_local_coord(v3s32(x - 1, y, z))].opacity > 0);
+          checksum += (chunk->voxels[vox_idx_from_local_coord(v3s32(x + 1, y, z))].opacity > 0);
+          checksum += (chunk->voxels[vox_idx_from_local_coord(v3s32(x, y - 1, z))].opacity > 0);
+          checksum += (chunk->voxels[vox_idx_from_local_coord(v3s32(x, y + 1, z))].opacity > 0);
+          checksum += (chunk->voxels[vox_idx_from_local_coord(v3s32(x, y, z - 1))].opacity > 0);
+          checksum += (chunk->voxels[vox_idx_from_local_coord(v3s32(x, y, z + 1))].opacity > 0);
+        }
+      }
+    }
+  }
+  seconds = (os_get_ticks() - start) / freq;
+  printf("6 neighbors:      %8.2f ms, %8.1f Mvoxels/s\n",
+         seconds*1000.0, chunks_count*(n - 2)*(n - 2)*(n - 2) / seconds / 1000000.0);
+  
+  start = os_get_ticks();
+  for (VOX_ChunkNode *node = world->first; node != 0; node = node->next) {
+    VOX_Chunk *chunk = &node->chunk;
+    for (S32 z = 0; z < n; z += 2) {
+      for (S32 y = 0; y < n; y += 2) {
+        for (S32 x = 0; x < n; x += 2) {
+          U32 solid_count = 0;
+          for (U32 child = 0; child < 8; child += 1) {
+            V3S32 coord = v3s32(x + (child & 1), y + ((child >> 1) & 1), z + (child >> 2));
+            solid_count += (chunk->voxels[vox_idx_from_local_coord(coord)].opacity > 0);
+          }
+          checksum += (solid_count >= 4);
+        }
+      }
+    }
+  }
+  seconds = (os_get_ticks() - start) / freq;
+  printf("2^3 downsample:   %8.2f ms, %8.1f Mvoxels/s\n",
+         seconds*1000.0, chunks_count*VOX_CHUNK_SIZE / seconds / 1000000.0);
+  
+  // Innermost loop along x, then y, then z
+  char *axis_names[] = { (char *)"x", (char *)"y", (char *)"z" };
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    start = os_get_ticks();
+    for (VOX_ChunkNode *node = world->first; node != 0; node = node->next) {
+      VOX_Chunk *chunk = &node->chunk;
+      for (S32 outer = 0; outer < n; outer += 1) {
+        for (S32 middle = 0; middle < n; middle += 1) {
+          for (S32 inner = 0; inner < n; inner += 1) {
+            V3S32 coord = {0};
+            coord.e[axis] = inner;
+            coord.e[(axis + 1) % 3] = middle;
+            coord.e[(axis + 2) % 3] = outer;
+            checksum += chunk->voxels[vox_idx_from_local_coord(coord)].color;
+          }
+        }
+      }
+    }
+    seconds = (os_get_ticks() - start) / freq;
+    printf("walk along %s:     %8.2f ms, %8.1f Mvoxels/s\n",
+           axis_names[axis], seconds*1000.0, chunks_count*VOX_CHUNK_SIZE / seconds / 1000000.0);
+  }
+  
+  async_init(0);
+  
+  VOX_LightCache *lights = vox_light_cache_alloc();
+  start = os_get_ticks();
+  vox_light_cache_update(lights, world);
+  seconds = (os_get_ticks() - start) / freq;
+  printf("light bake:       %8.2f ms\n", seconds*1000.0);
+  vox_light_cache_release(lights);
+  
+  VOX_LodCache *lods = vox_lod_cache_alloc();
+  start = os_get_ticks();
+  vox_lod_cache_update(lods, world);
+  seconds = (os_get_ticks() - start) / freq;
+  printf("lod build:        %8.2f ms\n", seconds*1000.0);
+  vox_lod_cache_release(lods);
+  
+  VOX_MeshCache *meshes = vox_mesh_cache_alloc();
+  start = os_get_ticks();
+  vox_mesh_cache_update(meshes, world);
+  seconds = (os_get_ticks() - start) / freq;
+  printf("mesh build:       %8.2f ms\n", seconds*1000.0);
+  vox_mesh_cache_release(meshes);
+  
+  async_release();
+  
+  // Keeps the loops above from being optimized out
+  printf("checksum %llu\n", (unsigned long long)checksum);
+}
+
+// Fills a cube of `size` voxels from `min`, or the ball inscribed in it, with
+// opaque voxels of every color but 255, which MagicaVoxel has no index for.
+function void
+cli_vox_fill(VOX_World *world, V3S32 min, S32 size, B32 ball)
+{
+  V3S32 chunk_min = vox_chunk_coord_from_voxel_coord(min);
+  V3S32 chunk_max = vox_chunk_coord_from_voxel_coord(v3s32_add(min, v3s32(size - 1, size - 1, size - 1)));
+  S64 radius = size/2;
+  
+  for (S32 cz = chunk_min.z; cz <= chunk_max.z; cz += 1) {
+    for (S32 cy = chunk_min.y; cy <= chunk_max.y; cy += 1) {
+      for (S32 cx = chunk_min.x; cx <= chunk_max.x; cx += 1) {
+        VOX_ChunkNode *node = vox_world_chunk_acquire(world, v3s32(cx, cy, cz));
+        for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+          V3S32 coord = v3s32_add(v3s32_scale(node->coord, VOX_SLICE_SIZE), vox_local_coord_from_idx(idx));
+          V3S32 rel = v3s32_sub(coord, min);
+          B32 inside = (rel.x >= 0 && rel.x < size && rel.y >= 0 && rel.y < size && rel.z >= 0 && rel.z < size);
+          if (inside && ball) {
+            S64 dx = 2*rel.x + 1 - size;
+            S64 dy = 2*rel.y + 1 - size;
+            S64 dz = 2*rel.z + 1 - size;
+            inside = (dx*dx + dy*dy + dz*dz <= 4*radius*radius);
+          }
+          if (inside) {
+            VOX_Voxel voxel = {0};
+            voxel.opacity = 255;
+            voxel.color = (U8)(((coord.x + coord.y*3 + coord.z*7) % 255 + 255) % 255);
+            node->chunk.voxels[idx] = voxel;
+          }
+        }
+      }
+    }
+  }
+  
+  vox_world_rebuild_occupancy(world);
+}
+
+// Counts the voxels whose solidity or color differs between the worlds. Opacity
+// and ids don't survive a .vox file, so they are not compared.
+function U64
+cli_vox_mismatches(VOX_World *a, VOX_World *b)
+{
+  U64 result = 0;
+  
+  VOX_World *worlds[2] = { a, b };
+  for (U32 pass = 0; pass < 2; pass += 1) {
+    VOX_World *world = worlds[pass];
+    VOX_World *other = worlds[1 - pass];
+    for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+      VOX_ChunkNode *other_node = vox_world_chunk_from_coord(other, n->coord);
+      for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+        VOX_Voxel voxel = n->chunk.voxels[idx];
+        VOX_Voxel other_voxel = other_node ? other_node->chunk.voxels[idx] : VOX_Voxel{0};
+        B32 solid = (voxel.opacity != 0);
+        B32 other_solid = (other_voxel.opacity != 0);
+        // Voxels solid in both are only counted on the first pass
+        if (solid != other_solid || (pass == 0 && solid && voxel.color != other_voxel.color)) {
+          result += 1;
+        }
+      }
+    }
+  }
+  
+  return result;
+}
+
+// Writes a world to `path`, loads it back and compares. Returns the mismatches.
+function U64
+cli_vox_round_trip(char *name, VOX_World *world, char *path)
+{
+  F64 freq = os_get_ticks_frequency();
+  String8 vox_path = str8((U8 *)path, cstr_count(path));
+  U64 solid_count = 0;
+  for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+    solid_count += n->solid_count;
+  }
+  
+  F64 start = os_get_ticks();
+  if (!vox_magica_write_world(world, 0, vox_path)) {
+    fprintf(stderr, "failed to write %s\n", path);
+    return Max(solid_count, 1);
+  }
+  F64 write_seconds = (os_get_ticks() - start) / freq;
+  
+  Arena *arena = arena_alloc(GiB(4llu));
+  start = os_get_ticks();
+  String8 data = os_file_read(arena, vox_path);
+  F64 read_seconds = (os_get_ticks() - start) / freq;
+  
+  start = os_get_ticks();
+  VOX_MagicaFile file = vox_magica_file_from_data(arena, data);
+  U32 instances_count = 0;
+  vox_magica_instances_from_file(arena, &file, &instances_count);
+  F64 parse_seconds = (os_get_ticks() - start) / freq;
+  
+  VOX_World *loaded = vox_world_alloc();
+  start = os_get_ticks();
+  VOX_MagicaImport import = vox_magica_import_from_data(loaded, data);
+  F64 import_seconds = (os_get_ticks() - start) / freq;
+  
+  U64 result = import.ok ? cli_vox_mismatches(world, loaded) : Max(solid_count, 1);
+  
+  printf("%-6s %9llu voxels, %3u model(s), %7.2f MiB: write %8.2f ms, read %7.2f ms, parse %6.3f ms, "
+         "import %8.2f ms (%6.1f Mvoxels/s), %llu mismatch(es)\n",
+         name, (unsigned long long)solid_count, import.instances_count, (F64)data.count / (1024.0*1024.0),
+         write_seconds*1000.0, read_seconds*1000.0, parse_seconds*1000.0, import_seconds*1000.0,
+         (F64)import.voxels_count / import_seconds / 1000000.0, (unsigned long long)result);
+  
+  vox_world_release(loaded);
+  arena_release(arena);
+  
+  return result;
+}
+
+// Round trips a solid 256^3 model, which is one model in the file, a ball as wide
+// placed across model boundaries, which is several, and the scene.
+function U64
+cli_vox_bench(VOX_World *world, char *path, U32 threads)
+{
+  async_init(threads - 1);
+  printf("%u thread(s)\n", threads);
+  
+  U64 result = 0;
+  
+  VOX_World *cube = vox_world_alloc();
+  cli_vox_fill(cube, v3s32(0, 0, 0), VOX_MAGICA_MODEL_SIZE_MAX, 0);
+  result += cli_vox_round_trip((char *)"cube", cube, path);
+  vox_world_release(cube);
+  
+  VOX_World *ball = vox_world_alloc();
+  cli_vox_fill(ball, v3s32(-100, 37, 300), VOX_MAGICA_MODEL_SIZE_MAX, 1);
+  result += cli_vox_round_trip((char *)"ball", ball, path);
+  vox_world_release(ball);
+  
+  result += cli_vox_round_trip((char *)"scene", world, path);
+  
+  async_release();
+  
+  return result;
+}
+
+// Kinds of synthetic chunk the codec bench encodes
+enum CLI_CodecChunk {
+  CLI_CodecChunk_Empty,
+  CLI_CodecChunk_Solid,
+  CLI_CodecChunk_Terrain, // Layers of colors under a rolling surface
+  CLI_CodecChunk_Speckle, // Terrain with a random one of 4 colors per voxel
+  CLI_CodecChunk_Noise,   // Random bytes
+  CLI_CodecChunk_COUNT,
+};
+
+function void
+cli_codec_fill(VOX_Chunk *chunk, CLI_CodecChunk kind, U32 seed)
+{
+  U32 state = seed*2654435761u + 1;
+  for (S32 z = 0; z < VOX_SLICE_SIZE; z += 1) {
+    for (S32 y = 0; y < VOX_SLICE_SIZE; y += 1) {
+      for (S32 x = 0; x < VOX_SLICE_SIZE; x += 1) {
+        // The low bits of an LCG repeat too soon to pass for noise, so they are mixed
+        state = state*1664525u + 1013904223u;
+        U32 random = state;
+        random ^= random >> 16;
+        random *= 0x7FEB352Du;
+        random ^= random >> 15;
+        random *= 0x846CA68Bu;
+        random ^= random >> 16;
+        S32 height = 16 + (S32)(6.f*sinf32((x + seed*7)*0.2f) + 4.f*cosf32((z + seed*3)*0.3f));
+        
+        VOX_Voxel voxel = {0};
+        switch (kind) {
+          case CLI_CodecChunk_Solid: {
+            voxel.opacity = 255;
+            voxel.color = 7;
+          }break;
+          
+          case CLI_CodecChunk_Terrain:
+          case CLI_CodecChunk_Speckle: {
+            if (y <= height) {
+              voxel.opacity = 255;
+              voxel.color = (kind == CLI_CodecChunk_Speckle ? (U8)(random & 3) :
+                             y == height ? 2 : y > height - 4 ? 3 : 4);
+            }
+          }break;
+          
+          case CLI_CodecChunk_Noise: {
+            MemoryCopy(&voxel, &random, sizeof(voxel));
+          }break;
+          
+          default: {}break;
+        }
+        chunk->voxels[vox_idx_from_local_coord(v3s32(x, y, z))] = voxel;
+      }
+    }
+  }
+}
+
+// Encodes the chunks into one stream and decodes it back, over and over, and
+// reports how fast both go (in raw bytes) and how much smaller the payloads are
+// (the stream adds a header and padding per chunk). Also sizes the chunks with
+// scene files' codec before the Uniform and Lz codecs were added: Rle where it is
+// smaller than Raw. Returns the voxels that don't come back.
+function U64
+cli_codec_bench_chunks(char *name, VOX_Chunk **chunks, U32 chunks_count)
+{
+  F64 freq = os_get_ticks_frequency();
+  U64 raw_size = (U64)chunks_count*sizeof(VOX_Chunk);
+  U32 passes = Max(1024 / Max(chunks_count, 1), 1);
+  
+  Arena *arena = arena_alloc(GiB(4llu));
+  VOX_Chunk *decoded = ArenaPushStruct(arena, VOX_Chunk);
+  U64 stream_pos = arena->pos;
+  
+  U32 empty_count = 0;
+  U32 solid_count = 0;
+  F64 start = os_get_ticks();
+  for (U32 pass = 0; pass < passes; pass += 1) {
+    empty_count = 0;
+    solid_count = 0;
+    for (U32 idx = 0; idx < chunks_count; idx += 1) {
+      VOX_ChunkClass chunk_class = vox_chunk_classify(chunks[idx]->voxels);
+      empty_count += chunk_class.all_empty;
+      solid_count += chunk_class.all_solid;
+    }
+  }
+  F64 classify_seconds = (os_get_ticks() - start) / freq;
+  
+  String8 stream = {0};
+  start = os_get_ticks();
+  for (U32 pass = 0; pass < passes; pass += 1) {
+    arena_pop_to(arena, stream_pos);
+    VOX_CodecWriter writer = vox_codec_writer_begin(arena);
+    for (U32 idx = 0; idx < chunks_count; idx += 1) {
+      vox_codec_writer_push(&writer, chunks[idx]->voxels);
+    }
+    stream = vox_codec_writer_end(&writer);
+  }
+  F64 encode_seconds = (os_get_ticks() - start) / freq;
+  
+  U32 failed = 0;
+  start = os_get_ticks();
+  for (U32 pass = 0; pass < passes; pass += 1) {
+    VOX_CodecReader reader = vox_codec_reader_begin(stream);
+    for (U32 idx = 0; idx < chunks_count; idx += 1) {
+      failed += !vox_codec_reader_next(&reader, decoded->voxels);
+    }
+  }
+  F64 decode_seconds = (os_get_ticks() - start) / freq;
+  
+  // Checked outside the timed loops
+  U64 result = 0;
+  U32 codec_counts[VOX_ChunkCodec_COUNT] = {0};
+  U64 payload_size = 0;
+  U64 rle_or_raw_size = 0;
+  VOX_CodecReader reader = vox_codec_reader_begin(stream);
+  for (U32 idx = 0; idx < chunks_count; idx += 1) {
+    VOX_CodecChunkHeader header = {0};
+    str8_read(&header, stream, reader.off, sizeof(header));
+    if (vox_codec_reader_next(&reader, decoded->voxels)) {
+      codec_counts[header.codec] += 1;
+      payload_size += header.size;
+      for (S32 i = 0; i < VOX_CHUNK_SIZE; i += 1) {
+        result += !vox_voxel_equal(decoded->voxels[i], chunks[idx]->voxels[i]);
+      }
+    }
+    else {
+      result += VOX_CHUNK_SIZE;
+    }
+    rle_or_raw_size += Min(vox_codec_rle_size(chunks[idx]->voxels), sizeof(VOX_Chunk));
+  }
+  result += (failed != 0);
+  
+  F64 raw_bytes = (F64)raw_size*passes;
+  printf("%-8s %5u chunk(s), %u empty, %u solid: %9.1f KiB -> %8.1f KiB, ratio %7.1fx (rle or raw %7.1fx), "
+         "raw/rle/uniform/lz %u/%u/%u/%u, classify %6.2f GB/s, encode %6.2f GB/s, decode %6.2f GB/s, "
+         "%llu mismatch(es)\n",
+         name, chunks_count, empty_count, solid_count, raw_size / 1024.0, payload_size / 1024.0,
+         (F64)raw_size / Max(payload_size, 1), (F64)raw_size / Max(rle_or_raw_size, 1),
+         codec_counts[VOX_ChunkCodec_Raw], codec_counts[VOX_ChunkCodec_Rle],
+         codec_counts[VOX_ChunkCodec_Uniform], codec_counts[VOX_ChunkCodec_Lz],
+         raw_bytes / classify_seconds / 1e9, raw_bytes / encode_seconds / 1e9, raw_bytes / decode_seconds / 1e9,
+         (unsigned long long)result);
+  
+  arena_release(arena);
+  
+  return result;
+}
+
+// Runs the codec over a few chunks of every synthetic kind, then over the scene's
+// chunks. Returns the voxels that don't come back as they were.
+function U64
+cli_codec_bench(VOX_World *world)
+{
+  char *kind_names[CLI_CodecChunk_COUNT] = {
+    (char *)"empty", (char *)"solid", (char *)"terrain", (char *)"speckle", (char *)"noise",
+  };
+  printf("%s\n", VOX_CODEC_SSE2 ? "sse2" : "scalar");
+  
+  U64 result = 0;
+  Arena *arena = arena_alloc(GiB(4llu));
+  
+  U32 synthetic_count = 16;
+  VOX_Chunk **chunks = ArenaPushArray(arena, VOX_Chunk *, synthetic_count);
+  for (U32 kind = 0; kind < CLI_CodecChunk_COUNT; kind += 1) {
+    for (U32 idx = 0; idx < synthetic_count; idx += 1) {
+      chunks[idx] = ArenaPushStruct(arena, VOX_Chunk);
+      cli_codec_fill(chunks[idx], (CLI_CodecChunk)kind, idx);
+    }
+    result += cli_codec_bench_chunks(kind_names[kind], chunks, synthetic_count);
+  }
+  
+  VOX_Chunk **scene_chunks = ArenaPushArray(arena, VOX_Chunk *, Max(world->chunks_count, 1));
+  U32 scene_count = 0;
+  for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+    scene_chunks[scene_count++] = &n->chunk;
+  }
+  result += cli_codec_bench_chunks((char *)"scene", scene_chunks, scene_count);
+  
+  arena_release(arena);
+  
+  return result;
+}
+
+// Steps voxel by voxel, without skipping anything, from where the ray enters the
+// world until it hits or leaves it.
+function VOX_RaycastResult
+cli_raycast_walk(VOX_World *world, F32 voxel_scale, V3F32 ro, V3F32 rd)
+{
+  VOX_RaycastResult result = {0};
+  
+  V2F32 world_range = vox_raycast_world_range(world, ro, rd);
+  F32 t_start = Max(world_range.x - 1.f, 0.f);
+  VOX_RaycastState s = vox_raycast_state_make(v3f32_add(ro, v3f32_scale(rd, t_start)), rd);
+  while (world_range.x <= world_range.y && t_start + s.t <= world_range.y) {
+    VOX_MapResult map = vox_map(s.pos, voxel_scale);
+    result.steps += 1.f;
+    if (vox_world_get_voxel(world, map.coord).opacity > 0) {
+      result.hit = 1;
+      result.coord = map.coord;
+      result.normal = s.normal;
+      break;
+    }
+    vox_raycast_step(&s);
+  }
+  
+  return result;
+}
+
+// Random rays from all around the world's bounds, `distance` times their
+// diagonal from the center, each aimed at a random point inside them
+function void
+cli_rays_into_world(VOX_World *world, U32 seed, F32 distance, V3F32 *ro, V3F32 *rd, U32 count)
+{
+  V3F32 box_min = vox_world_pos_from_voxel_coord(v3s32_scale(world->chunk_min, VOX_SLICE_SIZE));
+  V3F32 box_max = vox_world_pos_from_voxel_coord(v3s32_scale(v3s32_add(world->chunk_max, v3s32(1,1,1)), VOX_SLICE_SIZE));
+  V3F32 center = v3f32_scale(v3f32_add(box_min, box_max), 0.5f);
+  F32 radius = distance*v3f32_length(v3f32_sub(box_max, box_min));
+  
+  U32 state = seed;
+  for (U32 idx = 0; idx < count; idx += 1) {
+    V3F32 dir = {0};
+    do {
+      dir = v3f32(cli_random_f32(&state)*2.f - 1.f, cli_random_f32(&state)*2.f - 1.f, cli_random_f32(&state)*2.f - 1.f);
+    } while (v3f32_length(dir) < 0.1f || v3f32_length(dir) > 1.f);
+    V3F32 target = {0};
+    for (U32 axis = 0; axis < 3; axis += 1) {
+      target.e[axis] = box_min.e[axis] + cli_random_f32(&state)*(box_max.e[axis] - box_min.e[axis]);
+    }
+    ro[idx] = v3f32_add(center, v3f32_scale(v3f32_normalize(dir), radius));
+    rd[idx] = v3f32_normalize(v3f32_sub(target, ro[idx]));
+  }
+}
+
+// The light bake's shadow rays (see voxel/voxel_light.h): toward the sun from
+// every solid voxel's sunward face that isn't covered, up to `count` of them.
+// Returns how many there are.
+function U32
+cli_shadow_rays(VOX_World *world, V3F32 *ro, V3F32 *rd, U32 count)
+{
+  U32 result = 0;
+  V3F32 sun = vox_light_sun_dir();
+  for (VOX_ChunkNode *n = world->first; n != 0 && result < count; n = n->next) {
+    V3S32 chunk_min = v3s32_scale(n->coord, VOX_SLICE_SIZE);
+    for (S32 idx = 0; idx < VOX_CHUNK_SIZE && result < count; idx += 1) {
+      V3S32 coord = v3s32_add(chunk_min, vox_local_coord_from_idx(idx));
+      if (n->chunk.voxels[idx].opacity == 0) {
+        continue;
+      }
+      for (U32 axis = 0; axis < 3 && result < count; axis += 1) {
+        S32 sign = (vox_light_sun_face(sun, axis) & 1) ? -1 : 1;
+        V3S32 front = coord;
+        front.e[axis] += sign;
+        if (vox_world_get_voxel(world, front).opacity == 0) {
+          V3F32 pos = v3f32_add(vox_world_pos_from_voxel_coord(coord), v3f32(0.5f, 0.5f, 0.5f));
+          pos.e[axis] += (F32)sign*0.52f;
+          ro[result] = pos;
+          rd[result] = sun;
+          result += 1;
+        }
+      }
+    }
+  }
+  return result;
+}
+
+// Times vox_raycast and vox_raycast_packet over the rays, and checks the hits of
+// the first against cli_raycast_walk and the results of the second against the
+// first's. Both count steps from where the ray enters the world's bounds. Rays that run out of vox_raycast's steps are counted, not checked.
+// Returns the rays that disagree.
+function U64
+cli_raycast_bench_rays(char *name, VOX_World *world, F32 voxel_scale, V3F32 *ro, V3F32 *rd, U32 count)
+{
+  Arena *arena = arena_alloc(GiB(4llu));
+  VOX_RaycastResult *results = ArenaPushArrayNoZero(arena, VOX_RaycastResult, count);
+  F64 freq = os_get_ticks_frequency();
+  U32 passes = Max((1u << 20) / Max(count, 1u), 1u);
+  
+  F64 start = os_get_ticks();
+  for (U32 pass = 0; pass < passes; pass += 1) {
+    for (U32 idx = 0; idx < count; idx += 1) {
+      results[idx] = vox_raycast(world, voxel_scale, ro[idx], rd[idx]);
+    }
+  }
+  F64 seconds = (os_get_ticks() - start) / freq;
+  
+  VOX_RaycastResult *packet_results = ArenaPushArrayNoZero(arena, VOX_RaycastResult, count);
+  start = os_get_ticks();
+  for (U32 pass = 0; pass < passes; pass += 1) {
+    vox_raycast_packet(world, voxel_scale, ro, rd, count, packet_results);
+  }
+  F64 packet_seconds = (os_get_ticks() - start) / freq;
+  
+  U64 result = 0;
+  U64 packet_mismatches = 0;
+  U64 hits_count = 0;
+  U64 gave_up_count = 0;
+  F64 steps = 0;
+  F64 walk_steps = 0;
+  for (U32 idx = 0; idx < count; idx += 1) {
+    VOX_RaycastResult *res = &results[idx];
+    VOX_RaycastResult *packet = &packet_results[idx];
+    packet_mismatches += (packet->hit != res->hit || packet->steps != res->steps ||
+                          !MemoryMatchStruct(&packet->coord, &res->coord) || !MemoryMatchStruct(&packet->normal, &res->normal));
+    VOX_RaycastResult walk = cli_raycast_walk(world, voxel_scale, ro[idx], rd[idx]);
+    steps += res->steps;
+    walk_steps += walk.steps;
+    hits_count += res->hit;
+    if (!res->hit && res->steps >= 256.f) {
+      gave_up_count += 1;
+    }
+    else if (res->hit != walk.hit) {
+      // A ray grazing a voxel's edge or corner may or may not hit it
+      V3F32 enter = {0};
+      VOX_RaycastResult *hit = res->hit ? res : &walk;
+      V2F32 range = cli_ray_voxel_range(ro[idx], rd[idx], hit->coord, &enter);
+      result += (range.y - range.x >= cli_raycast_epsilon(range.x));
+    }
+    else if (res->hit && !MemoryMatchStruct(&res->coord, &walk.coord) &&
+             !cli_raycast_results_tie(ro[idx], rd[idx], res, &walk)) {
+      result += 1;
+    }
+  }
+  
+  printf("%-13s %7u ray(s), %6.2f%% hit: %6.1f steps/ray (%6.1f walking in from the bounds), %7.1f ns/ray, "
+         "%llu ran out of steps, %llu disagree\n",
+         name, count, 100.0*hits_count / Max(count, 1u), steps / Max(count, 1u), walk_steps / Max(count, 1u),
+         seconds*1e9 / ((F64)count*passes), (unsigned long long)gave_up_count, (unsigned long long)result);
+  printf("%-13s %u-lane packets: %7.1f ns/ray, %.2fx scalar, %llu differ from scalar\n",
+         "", VOX_RAYCAST_PACKET_LANES, packet_seconds*1e9 / ((F64)count*passes), seconds / packet_seconds,
+         (unsigned long long)packet_mismatches);
+  result += packet_mismatches;
+  
+  arena_release(arena);
+  return result;
+}
+
+// The scene's camera rays, then random rays through a dense scene (a rolling
+// terrain in every chunk) and a sparse one (a few balls in mostly absent
+// chunks), each followed by its shadow rays, and rays into the dense scene from
+// far outside it. Returns the rays where vox_raycast
+// or vox_raycast_packet is wrong.
+function U64
+cli_raycast_bench(VOX_World *world, VOX_UniformData *uniforms)
+{
+  U64 result = 0;
+  Arena *arena = arena_alloc(GiB(4llu));
+  
+  U32 width = (U32)uniforms->client_size.x;
+  U32 height = (U32)uniforms->client_size.y;
+  U32 camera_count = width*height;
+  V3F32 *ro = ArenaPushArrayNoZero(arena, V3F32, camera_count);
+  V3F32 *rd = ArenaPushArrayNoZero(arena, V3F32, camera_count);
+  for (U32 y = 0; y < height; y += 1) {
+    for (U32 x = 0; x < width; x += 1) {
+      VOX_CameraRay ray = vox_camera_ray_from_frag_coord(uniforms, v2f32(x + 0.5f, y + 0.5f));
+      ro[x + y*width] = ray.ro;
+      rd[x + y*width] = ray.rd;
+    }
+  }
+  result += cli_raycast_bench_rays((char *)"scene", world, uniforms->zoom, ro, rd, camera_count);
+  U32 shadow_count = cli_shadow_rays(world, ro, rd, camera_count);
+  result += cli_raycast_bench_rays((char *)"scene shadow", world, 1.f, ro, rd, shadow_count);
+  
+  U32 random_count = Min(camera_count, 1u << 17);
+  VOX_World *dense = vox_world_alloc();
+  for (S32 z = 0; z < 4; z += 1) {
+    for (S32 y = 0; y < 2; y += 1) {
+      for (S32 x = 0; x < 4; x += 1) {
+        VOX_ChunkNode *node = vox_world_chunk_acquire(dense, v3s32(x, y, z));
+        cli_codec_fill(&node->chunk, CLI_CodecChunk_Terrain, (U32)(x + y*4 + z*8));
+      }
+    }
+  }
+  vox_world_rebuild_occupancy(dense);
+  cli_rays_into_world(dense, 1, 1.f, ro, rd, random_count);
+  result += cli_raycast_bench_rays((char *)"dense", dense, 1.f, ro, rd, random_count);
+  shadow_count = cli_shadow_rays(dense, ro, rd, random_count);
+  result += cli_raycast_bench_rays((char *)"dense shadow", dense, 1.f, ro, rd, shadow_count);
+  
+  // From far enough that walking up to the bounds would take more than all of
+  // vox_raycast's steps
+  cli_rays_into_world(dense, 4, 64.f, ro, rd, random_count);
+  result += cli_raycast_bench_rays((char *)"dense far", dense, 1.f, ro, rd, random_count);
+  vox_world_release(dense);
+  
+  VOX_World *sparse = vox_world_alloc();
+  vox_world_chunk_acquire(sparse, v3s32(0, 0, 0));
+  vox_world_chunk_acquire(sparse, v3s32(7, 3, 7));
+  U32 state = 2;
+  for (U32 ball = 0; ball < 48; ball += 1) {
+    V3S32 min = v3s32((S32)(cli_random(&state) % 248), (S32)(cli_random(&state) % 120), (S32)(cli_random(&state) % 248));
+    cli_vox_fill(sparse, min, 8, 1);
+  }
+  cli_rays_into_world(sparse, 3, 1.f, ro, rd, random_count);
+  result += cli_raycast_bench_rays((char *)"sparse", sparse, 1.f, ro, rd, random_count);
+  shadow_count = cli_shadow_rays(sparse, ro, rd, random_count);
+  result += cli_raycast_bench_rays((char *)"sparse shadow", sparse, 1.f, ro, rd, shadow_count);
+  printf("sparse: %u of 256 chunk(s) present\n", sparse->chunks_count);
+  vox_world_release(sparse);
+  
+  arena_release(arena);
+  return result;
+}
+
+// Returns the voxels of the palette chunk that differ from the dense one.
+function U64
+cli_palette_mismatches(VOX_PaletteChunk *pc, VOX_Chunk *chunk, VOX_Chunk *decoded)
+{
+  U64 result = 0;
+  vox_chunk_from_palette_chunk(pc, decoded);
+  for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+    result += !vox_voxel_equal(decoded->voxels[idx], chunk->voxels[idx]);
+    result += !vox_voxel_equal(vox_palette_chunk_get(pc, idx), chunk->voxels[idx]);
+  }
+  return result;
+}
+
+// Index width a palette of `live_count` entries needs at least
+function U32
+cli_palette_bits_min(U32 live_count)
+{
+  U32 result = VOX_PALETTE_BITS_MIN;
+  while (((U32)1 << result) < live_count) {
+    result *= 2;
+  }
+  return result;
+}
+
+// Converts chunks to palette chunks and back, then edits one through every index
+// width up and down again, and at random, against a dense copy. Returns the
+// voxels and index widths that come out wrong.
+function U64
+cli_palette_test(VOX_World *world)
+{
+  char *kind_names[CLI_CodecChunk_COUNT] = {
+    (char *)"empty", (char *)"solid", (char *)"terrain", (char *)"speckle", (char *)"noise",
+  };
+  
+  U64 result = 0;
+  Arena *arena = arena_alloc(GiB(4llu));
+  VOX_PaletteStore *store = vox_palette_store_alloc();
+  VOX_Chunk *chunk = ArenaPushStruct(arena, VOX_Chunk);
+  VOX_Chunk *decoded = ArenaPushStruct(arena, VOX_Chunk);
+  
+  // Round trips, and bytes per chunk against sizeof(VOX_Chunk)
+  for (U32 kind = 0; kind <= CLI_CodecChunk_COUNT; kind += 1) {
+    U32 chunks_count = 0;
+    U64 palette_size = 0;
+    U32 bits_max = 0;
+    U64 mismatches = 0;
+    if (kind < CLI_CodecChunk_COUNT) {
+      for (U32 seed = 0; seed < 16; seed += 1) {
+        cli_codec_fill(chunk, (CLI_CodecChunk)kind, seed);
+        VOX_PaletteChunk pc = vox_palette_chunk_from_chunk(store, chunk);
+        mismatches += cli_palette_mismatches(&pc, chunk, decoded);
+        palette_size += vox_palette_chunk_memory_size(&pc);
+        bits_max = Max(bits_max, pc.bits);
+        chunks_count += 1;
+        vox_palette_chunk_release(&pc);
+      }
+    }
+    else {
+      for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+        VOX_PaletteChunk pc = vox_palette_chunk_from_chunk(store, &n->chunk);
+        mismatches += cli_palette_mismatches(&pc, &n->chunk, decoded);
+        palette_size += vox_palette_chunk_memory_size(&pc);
+        bits_max = Max(bits_max, pc.bits);
+        chunks_count += 1;
+        vox_palette_chunk_release(&pc);
+      }
+    }
+    
+    U64 dense_size = (U64)chunks_count*sizeof(VOX_Chunk);
+    printf("%-8s %4u chunk(s): %8.1f KiB dense, %8.1f KiB palette (%7.1f B/chunk, %5.1fx), "
+           "up to %2u-bit indices, %llu mismatch(es)\n",
+           kind < CLI_CodecChunk_COUNT ? kind_names[kind] : "scene", chunks_count,
+           dense_size / 1024.0, palette_size / 1024.0, (F64)palette_size / Max(chunks_count, 1),
+           (F64)dense_size / Max(palette_size, 1), bits_max, (unsigned long long)mismatches);
+    result += mismatches;
+  }
+  
+  // Widening: every new value at a voxel of its own keeps every entry live, so
+  // the width is always the least that fits them.
+  VOX_Voxel fill = {0};
+  MemorySet(chunk->voxels, 0, sizeof(chunk->voxels));
+  VOX_PaletteChunk pc = vox_palette_chunk_make(store, fill);
+  U32 values_count = 1024;
+  U32 widths_wrong = 0;
+  U32 bits_last = pc.bits;
+  for (U32 value = 1; value <= values_count; value += 1) {
+    S32 idx = (S32)((value*7919) % VOX_CHUNK_SIZE);
+    VOX_Voxel voxel = {255, (U8)value, (U8)(value >> 8), 0};
+    vox_palette_chunk_set(&pc, idx, voxel);
+    chunk->voxels[idx] = voxel;
+    widths_wrong += (pc.bits != cli_palette_bits_min(value + 1) || pc.live_count != value + 1);
+    if (pc.bits != bits_last) {
+      printf("grow: %u-bit indices at %u values, %llu B\n", pc.bits, value + 1,
+             (unsigned long long)vox_palette_chunk_memory_size(&pc));
+      bits_last = pc.bits;
+    }
+  }
+  U64 grow_mismatches = cli_palette_mismatches(&pc, chunk, decoded);
+  
+  // Narrowing: a width is dropped once the live entries fit in half the next
+  // narrower one, and not before.
+  for (U32 value = 1; value <= values_count; value += 1) {
+    S32 idx = (S32)((value*7919) % VOX_CHUNK_SIZE);
+    vox_palette_chunk_set(&pc, idx, fill);
+    chunk->voxels[idx] = fill;
+    U32 live_count = values_count + 1 - value;
+    U32 narrow_cap = (pc.bits > VOX_PALETTE_BITS_MIN) ? ((U32)1 << (pc.bits / 2)) : 0;
+    widths_wrong += (pc.live_count != live_count || ((U32)1 << pc.bits) < live_count ||
+                     live_count <= narrow_cap / 2);
+    if (pc.bits != bits_last) {
+      printf("shrink: %u-bit indices at %u values, %llu B\n", pc.bits, live_count,
+             (unsigned long long)vox_palette_chunk_memory_size(&pc));
+      bits_last = pc.bits;
+    }
+  }
+  widths_wrong += (pc.bits != VOX_PALETTE_BITS_MIN);
+  U64 shrink_mismatches = cli_palette_mismatches(&pc, chunk, decoded);
+  
+  // Random edits from a set of values that grows and shrinks, so entries die, get
+  // retargeted and repacked along the way
+  U32 state = 1;
+  U64 random_mismatches = 0;
+  for (U32 round = 0; round < 64; round += 1) {
+    U32 round_values = 1 + (round % 16)*(round % 16);
+    for (U32 edit = 0; edit < 4096; edit += 1) {
+      state = state*1664525u + 1013904223u;
+      S32 idx = (S32)((state >> 8) % VOX_CHUNK_SIZE);
+      state = state*1664525u + 1013904223u;
+      U32 value = (state >> 8) % round_values;
+      VOX_Voxel voxel = {(U8)(value ? 255 : 0), (U8)value, (U8)(value >> 8), 0};
+      vox_palette_chunk_set(&pc, idx, voxel);
+      chunk->voxels[idx] = voxel;
+    }
+    random_mismatches += cli_palette_mismatches(&pc, chunk, decoded);
+    widths_wrong += (((U32)1 << pc.bits) < pc.live_count);
+  }
+  printf("edits: %llu mismatch(es) after growing, %llu after shrinking, %llu after random edits, "
+         "%u wrong width(s), %u-bit indices at the end\n",
+         (unsigned long long)grow_mismatches, (unsigned long long)shrink_mismatches,
+         (unsigned long long)random_mismatches, widths_wrong, pc.bits);
+  result += grow_mismatches + shrink_mismatches + random_mismatches + widths_wrong;
+  vox_palette_chunk_release(&pc);
+  
+  vox_palette_store_release(store);
+  arena_release(arena);
+  
+  return result;
+}
+
+// Fills a world with `count` random cubes and balls of 8 to 39 voxels in
+// [0, extent)^3.
+function void
+cli_csg_fill(VOX_World *world, S32 extent, U32 count, U32 *state)
+{
+  vox_world_clear(world);
+  for (U32 idx = 0; idx < count; idx += 1) {
+    S32 size = 8 + (S32)(cli_random(state) % 32);
+    V3S32 min = v3s32((S32)(cli_random(state) % (extent - size)), (S32)(cli_random(state) % (extent - size)),
+                      (S32)(cli_random(state) % (extent - size)));
+    cli_vox_fill(world, min, size, cli_random(state) & 1);
+  }
+}
+
+// Checks a CSG operation's result against one worked out voxel by voxel, over
+// every chunk either operand touches. `src` is 0 for an SDF operation. `before`
+// holds copies of the destination's chunks from before the operation. Chunks
+// that existed before must have exactly the bricks that changed marked dirty;
+// new ones are all dirty. Returns the voxels and bricks that are wrong, and adds
+// the bricks that changed and that were marked to the counters.
+function U64
+cli_csg_check(VOX_World *dst, VOX_ChunkNode *before, U32 before_count, V3S32 chunk_min, V3S32 chunk_max,
+              VOX_World *src, V3S32 offset, VOX_Sdf *sdf, VOX_CsgOp op, U64 *changed_bricks, U64 *marked_bricks)
+{
+  U64 result = 0;
+  VOX_Voxel empty = {0};
+  
+  for (S32 cz = chunk_min.z; cz <= chunk_max.z; cz += 1) {
+    for (S32 cy = chunk_min.y; cy <= chunk_max.y; cy += 1) {
+      for (S32 cx = chunk_min.x; cx <= chunk_max.x; cx += 1) {
+        V3S32 coord = v3s32(cx, cy, cz);
+        V3S32 base = v3s32_scale(coord, VOX_SLICE_SIZE);
+        VOX_ChunkNode *node = vox_world_chunk_from_coord(dst, coord);
+        VOX_ChunkNode *old = 0;
+        for (U32 idx = 0; idx < before_count && !old; idx += 1) {
+          if (MemoryMatchStruct(&before[idx].coord, &coord)) {
+            old = &before[idx];
+          }
+        }
+        
+        U64 changed[VOX_BRICK_SUMMARY_WORDS] = {0};
+        U32 solid_count = 0;
+        for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+          V3S32 local_coord = vox_local_coord_from_idx(idx);
+          VOX_Voxel was = old ? old->chunk.voxels[idx] : empty;
+          VOX_Voxel is = node ? node->chunk.voxels[idx] : empty;
+          
+          B32 inside = 0;
+          VOX_Voxel operand = empty;
+          if (src) {
+            operand = vox_world_get_voxel(src, v3s32_sub(v3s32_add(base, local_coord), offset));
+            inside = (operand.opacity > 0);
+          }
+          else {
+            V3F32 origin = v3f32_sub(v3f32((F32)base.x + 0.5f, (F32)base.y + 0.5f, (F32)base.z + 0.5f), sdf->center);
+            inside = (vox_sdf_distance(sdf, v3f32_add(origin, v3f32((F32)local_coord.x, (F32)local_coord.y, (F32)local_coord.z))) <= 0.f);
+            operand = sdf->voxel;
+          }
+          
+          VOX_Voxel expected = was;
+          switch (op) {
+            case VOX_CsgOp_Union:     { if (inside)  { expected = operand; } }break;
+            case VOX_CsgOp_Subtract:  { if (inside)  { expected = empty;   } }break;
+            case VOX_CsgOp_Intersect: { if (!inside) { expected = empty;   } }break;
+            default: {}break;
+          }
+          
+          result += !vox_voxel_equal(is, expected);
+          solid_count += (is.opacity > 0);
+          if (!vox_voxel_equal(is, was)) {
+            vox_dirty_bricks_mark(changed, local_coord);
+          }
+        }
+        
+        if (node) {
+          // Emptied chunks are released, and the rest know their solid voxels
+          result += (node->solid_count == 0 || node->solid_count != solid_count);
+          if (old) {
+            for (U32 word = 0; word < VOX_BRICK_SUMMARY_WORDS; word += 1) {
+              result += count_bits_set_u64(changed[word] ^ node->dirty_bricks[word]);
+              *changed_bricks += count_bits_set_u64(changed[word]);
+              *marked_bricks += count_bits_set_u64(node->dirty_bricks[word]);
+            }
+          }
+        }
+      }
+    }
+  }
+  
+  return result;
+}
+
+// Runs random world and SDF operations of every kind against a reference worked
+// out voxel by voxel. Some world operations take a copy of the destination as
+// the operand, which leaves union and intersect nothing to change. Returns the
+// voxels and bricks that come out wrong.
+function U64
+cli_csg_test(U32 threads)
+{
+  char *op_names[VOX_CsgOp_COUNT] = { (char *)"union", (char *)"subtract", (char *)"intersect" };
+  U32 trials_per_set = 24;
+  U64 result = 0;
+  U32 state = 1;
+  
+  async_init(threads - 1);
+  Arena *arena = arena_alloc(GiB(4llu));
+  VOX_World *dst = vox_world_alloc();
+  VOX_World *src = vox_world_alloc();
+  
+  for (U32 op = 0; op < VOX_CsgOp_COUNT; op += 1) {
+    for (U32 with_sdf = 0; with_sdf < 2; with_sdf += 1) {
+      U64 errors = 0;
+      U64 changed_bricks = 0;
+      U64 marked_bricks = 0;
+      F64 ticks = 0;
+      
+      for (U32 trial = 0; trial < trials_per_set; trial += 1) {
+        TempArena temp = arena_temp_begin(arena);
+        U32 dst_state = state;
+        cli_csg_fill(dst, 96, 6, &state);
+        
+        V3S32 chunk_min = dst->chunk_min;
+        V3S32 chunk_max = dst->chunk_max;
+        V3S32 offset = {0};
+        VOX_Sdf sdf = {};
+        if (with_sdf) {
+          sdf.kind = (VOX_SdfKind)(cli_random(&state) % VOX_SdfKind_COUNT);
+          sdf.center = v3f32(cli_random_f32(&state)*96.f, cli_random_f32(&state)*96.f, cli_random_f32(&state)*96.f);
+          sdf.half_size = v3f32(4.f + cli_random_f32(&state)*16.f, 4.f + cli_random_f32(&state)*16.f, 4.f + cli_random_f32(&state)*16.f);
+          sdf.radius = 4.f + cli_random_f32(&state)*20.f;
+          sdf.voxel.opacity = 255;
+          sdf.voxel.color = (U8)(cli_random(&state) % 255);
+          
+          V3S32 voxel_min = {0};
+          V3S32 voxel_max = {0};
+          vox_sdf_voxel_bounds(&sdf, &voxel_min, &voxel_max);
+          V3S32 sdf_chunk_min = vox_chunk_coord_from_voxel_coord(voxel_min);
+          V3S32 sdf_chunk_max = vox_chunk_coord_from_voxel_coord(voxel_max);
+          for (U32 axis = 0; axis < 3; axis += 1) {
+            chunk_min.e[axis] = Min(chunk_min.e[axis], sdf_chunk_min.e[axis]);
+            chunk_max.e[axis] = Max(chunk_max.e[axis], sdf_chunk_max.e[axis]);
+          }
+        }
+        else {
+          // Every fourth operand is the destination itself
+          if (trial % 4 == 0) {
+            cli_csg_fill(src, 96, 6, &dst_state);
+          }
+          else {
+            cli_csg_fill(src, 48, 4, &state);
+            offset = v3s32((S32)(cli_random(&state) % 80) - 24, (S32)(cli_random(&state) % 80) - 24,
+                           (S32)(cli_random(&state) % 80) - 24);
+          }
+          V3S32 src_chunk_min = vox_chunk_coord_from_voxel_coord(v3s32_add(v3s32_scale(src->chunk_min, VOX_SLICE_SIZE), offset));
+          V3S32 src_chunk_max = vox_chunk_coord_from_voxel_coord(v3s32_add(v3s32_scale(src->chunk_max, VOX_SLICE_SIZE),
+                                                                           v3s32_add(offset, v3s32(VOX_SLICE_SIZE - 1, VOX_SLICE_SIZE - 1, VOX_SLICE_SIZE - 1))));
+          for (U32 axis = 0; axis < 3; axis += 1) {
+            chunk_min.e[axis] = Min(chunk_min.e[axis], src_chunk_min.e[axis]);
+            chunk_max.e[axis] = Max(chunk_max.e[axis], src_chunk_max.e[axis]);
+          }
+        }
+        
+        // Copies of the destination, and a clean slate to mark dirty bricks on
+        VOX_ChunkNode *before = ArenaPushArrayNoZero(temp.arena, VOX_ChunkNode, dst->chunks_count);
+        U32 before_count = 0;
+        for (VOX_ChunkNode *n = dst->first; n != 0; n = n->next) {
+          before[before_count++] = *n;
+        }
+        vox_world_clear_dirty_bricks(dst);
+        
+        F64 start = os_get_ticks();
+        if (with_sdf) {
+          vox_csg_sdf(dst, 0, &sdf, (VOX_CsgOp)op);
+        }
+        else {
+          vox_csg_world(dst, 0, src, offset, (VOX_CsgOp)op);
+        }
+        ticks += os_get_ticks() - start;
+        
+        errors += cli_csg_check(dst, before, before_count, chunk_min, chunk_max, with_sdf ? 0 : src, offset,
+                                &sdf, (VOX_CsgOp)op, &changed_bricks, &marked_bricks);
+        arena_temp_end(temp);
+      }
+      
+      printf("%-9s %-5s %u op(s) in %7.2f ms: %6llu brick(s) changed, %6llu marked dirty, %llu error(s)\n",
+             op_names[op], with_sdf ? "sdf" : "world", trials_per_set, ticks*1000.0 / os_get_ticks_frequency(),
+             (unsigned long long)changed_bricks, (unsigned long long)marked_bricks, (unsigned long long)errors);
+      result += errors;
+    }
+  }
+  
+  vox_world_release(src);
+  vox_world_release(dst);
+  arena_release(arena);
+  async_release();
+  
+  return result;
+}
+
+// The undo test edits the voxels of [-CLI_UNDO_EXTENT, CLI_UNDO_EXTENT)^3, which
+// straddles 8 chunks, and keeps a copy of them per step.
+#define CLI_UNDO_EXTENT 16
+#define CLI_UNDO_SIDE   (2*CLI_UNDO_EXTENT)
+#define CLI_UNDO_COPIES 512
+
+function void
+cli_undo_copy(VOX_World *world, VOX_Voxel *copy)
+{
+  for (S32 z = 0; z < CLI_UNDO_SIDE; z += 1) {
+    for (S32 y = 0; y < CLI_UNDO_SIDE; y += 1) {
+      for (S32 x = 0; x < CLI_UNDO_SIDE; x += 1) {
+        V3S32 coord = v3s32(x - CLI_UNDO_EXTENT, y - CLI_UNDO_EXTENT, z - CLI_UNDO_EXTENT);
+        copy[x + y*CLI_UNDO_SIDE + z*CLI_UNDO_SIDE*CLI_UNDO_SIDE] = vox_world_get_voxel(world, coord);
+      }
+    }
+  }
+}
+
+// Returns the voxels that differ from the copy.
+function U64
+cli_undo_mismatches(VOX_World *world, VOX_Voxel *copy)
+{
+  U64 result = 0;
+  for (S32 z = 0; z < CLI_UNDO_SIDE; z += 1) {
+    for (S32 y = 0; y < CLI_UNDO_SIDE; y += 1) {
+      for (S32 x = 0; x < CLI_UNDO_SIDE; x += 1) {
+        V3S32 coord = v3s32(x - CLI_UNDO_EXTENT, y - CLI_UNDO_EXTENT, z - CLI_UNDO_EXTENT);
+        result += !vox_voxel_equal(vox_world_get_voxel(world, coord), copy[x + y*CLI_UNDO_SIDE + z*CLI_UNDO_SIDE*CLI_UNDO_SIDE]);
+      }
+    }
+  }
+  return result;
+}
+
+// Random voxel within `margin` of the edited region's faces
+function V3S32
+cli_undo_coord(U32 *state, S32 margin)
+{
+  S32 span = CLI_UNDO_SIDE - 2*margin;
+  V3S32 result = v3s32((S32)(cli_random(state) % span) + margin - CLI_UNDO_EXTENT,
+                       (S32)(cli_random(state) % span) + margin - CLI_UNDO_EXTENT,
+                       (S32)(cli_random(state) % span) + margin - CLI_UNDO_EXTENT);
+  return result;
+}
+
+function VOX_Voxel
+cli_undo_voxel(U32 *state)
+{
+  VOX_Voxel result = {0};
+  if (cli_random(state) % 4) {
+    result.opacity = 255;
+    result.color = (U8)cli_random(state);
+    result.id0 = (U8)cli_random(state);
+  }
+  return result;
+}
+
+// Edits a world at random through the undo history, with single voxels, merged
+// strokes, brush stamps, merged brush drags and CSG, and undoes and redoes some steps along the way.
+// Every step's result is kept as a full copy of the edited region, indexed by the
+// step's number since the start, which counts the steps eviction dropped. Every
+// undo and redo must bring back the copy of the step it lands on, and at
+// checkpoints the whole history is undone and redone. The budget is small, so
+// the byte ring wraps and evicts many times. Returns the voxels and steps that
+// come out wrong.
+function U64
+cli_undo_test(void)
+{
+  U64 budget = KiB(64);
+  U32 ops_count = 4000;
+  U32 checkpoint_every = 500;
+  
+  U64 result = 0;
+  U32 state = 1;
+  async_init(0);
+  Arena *arena = arena_alloc(GiB(4llu));
+  VOX_Voxel *copies = ArenaPushArrayNoZero(arena, VOX_Voxel, (U64)CLI_UNDO_COPIES*CLI_UNDO_SIDE*CLI_UNDO_SIDE*CLI_UNDO_SIDE);
+  VOX_World *world = vox_world_alloc();
+  VOX_UndoHistory *undo = vox_undo_alloc(budget);
+  
+  // Steps evicted so far, so `evicted + applied_count` numbers the current state
+  U64 evicted = 0;
+  U32 wraps = 0;
+  U64 undone = 0;
+  U64 redone = 0;
+  U64 mismatches = 0;
+  U64 steps_wrong = 0;
+  cli_undo_copy(world, copies);
+  
+  for (U32 op_idx = 1; op_idx <= ops_count; op_idx += 1) {
+    U32 entries_first = undo->entries_first;
+    B32 newest_at_start = (undo->applied_count > 0 && vox_undo_entry_from_idx(undo, undo->applied_count - 1)->offset == 0);
+    U32 kind = cli_random(&state) % 10;
+    
+    switch (kind) {
+      case 0: case 1: case 2: {
+        vox_undo_set_voxel(undo, world, cli_undo_coord(&state, 0), cli_undo_voxel(&state));
+      }break;
+      
+      // Strokes of a few voxels, which merge into the previous one with the same key
+      case 3: case 4: {
+        vox_undo_begin_stroke(undo, 1 + cli_random(&state) % 2);
+        U32 count = 1 + cli_random(&state) % 32;
+        for (U32 idx = 0; idx < count; idx += 1) {
+          vox_undo_set_voxel(undo, world, cli_undo_coord(&state, 0), cli_undo_voxel(&state));
+        }
+        vox_undo_end_stroke(undo, world);
+      }break;
+      
+      case 5: case 6: {
+        VOX_EditMode modes[] = { VOX_EditMode_Add, VOX_EditMode_Paint, VOX_EditMode_Delete };
+        VOX_Brush brush = {};
+        brush.shape = (VOX_BrushShape)(cli_random(&state) % VOX_BrushShape_COUNT);
+        brush.mode = modes[cli_random(&state) % ArrayCount(modes)];
+        brush.radius = 1 + (S32)(cli_random(&state) % 6);
+        brush.voxel = cli_undo_voxel(&state);
+        brush.voxel.opacity = 255;
+        brush.seed = cli_random(&state);
+        if (kind == 5) {
+          vox_brush_stamp(world, undo, &brush, cli_undo_coord(&state, brush.radius + 1));
+        }
+        else {
+          // A segment of a drag, as the editor records one, merging into the
+          // previous segment
+          brush.spacing = VOX_BRUSH_DEFAULT_SPACING;
+          VOX_BrushStroke stroke = {0};
+          vox_brush_stroke_begin(&stroke, world, undo, &brush, 3);
+          for (U32 idx = 0; idx < 3; idx += 1) {
+            vox_brush_stroke_to(&stroke, cli_undo_coord(&state, brush.radius + 1));
+          }
+          vox_brush_stroke_end(&stroke);
+        }
+      }break;
+      
+      case 7: {
+        VOX_Sdf sdf = {};
+        sdf.kind = (VOX_SdfKind)(cli_random(&state) % VOX_SdfKind_COUNT);
+        sdf.radius = 2.f + cli_random_f32(&state)*4.f;
+        sdf.half_size = v3f32(sdf.radius, sdf.radius, sdf.radius);
+        V3S32 center = cli_undo_coord(&state, 7);
+        sdf.center = v3f32((F32)center.x, (F32)center.y, (F32)center.z);
+        sdf.voxel = cli_undo_voxel(&state);
+        sdf.voxel.opacity = 255;
+        vox_csg_sdf(world, undo, &sdf, (cli_random(&state) & 1) ? VOX_CsgOp_Union : VOX_CsgOp_Subtract);
+      }break;
+      
+      // Undo or redo a few steps; the next edit drops whatever is left to redo
+      case 8: case 9: {
+        U32 count = 1 + cli_random(&state) % 4;
+        for (U32 idx = 0; idx < count; idx += 1) {
+          B32 moved = (kind == 8) ? vox_undo(undo, world) : vox_redo(undo, world);
+          if (!moved) {
+            break;
+          }
+          undone += (kind == 8);
+          redone += (kind == 9);
+          U64 step = evicted + undo->applied_count;
+          mismatches += cli_undo_mismatches(world, &copies[(step % CLI_UNDO_COPIES)*CLI_UNDO_SIDE*CLI_UNDO_SIDE*CLI_UNDO_SIDE]);
+        }
+      }break;
+    }
+    
+    if (kind < 8) {
+      evicted += (undo->entries_first + VOX_UNDO_ENTRIES_MAX - entries_first) % VOX_UNDO_ENTRIES_MAX;
+      // A step that doesn't fit at the end of the ring goes back to its start
+      B32 wrapped = (undo->applied_count > 1 && vox_undo_entry_from_idx(undo, undo->applied_count - 1)->offset == 0);
+      wraps += (wrapped && !newest_at_start);
+      U64 step = evicted + undo->applied_count;
+      cli_undo_copy(world, &copies[(step % CLI_UNDO_COPIES)*CLI_UNDO_SIDE*CLI_UNDO_SIDE*CLI_UNDO_SIDE]);
+      
+      // The copies only reach back so far
+      steps_wrong += (undo->applied_count >= CLI_UNDO_COPIES);
+    }
+    
+    // Undo everything kept, one more, redo everything, one more
+    if (op_idx % checkpoint_every == 0) {
+      U32 kept = undo->applied_count;
+      for (U32 idx = 0; idx < kept; idx += 1) {
+        steps_wrong += !vox_undo(undo, world);
+        U64 step = evicted + undo->applied_count;
+        mismatches += cli_undo_mismatches(world, &copies[(step % CLI_UNDO_COPIES)*CLI_UNDO_SIDE*CLI_UNDO_SIDE*CLI_UNDO_SIDE]);
+      }
+      steps_wrong += vox_undo(undo, world);
+      for (U32 idx = 0; idx < kept; idx += 1) {
+        steps_wrong += !vox_redo(undo, world);
+        U64 step = evicted + undo->applied_count;
+        mismatches += cli_undo_mismatches(world, &copies[(step % CLI_UNDO_COPIES)*CLI_UNDO_SIDE*CLI_UNDO_SIDE*CLI_UNDO_SIDE]);
+      }
+      steps_wrong += (undo->entries_count > kept) ? 0 : vox_redo(undo, world);
+      undone += kept;
+      redone += kept;
+      
+      printf("op %4u: %4llu step(s) so far, %3u kept in %5llu byte(s), %llu evicted, %u wrap(s); "
+             "%llu undone, %llu redone, %llu voxel(s) and %llu step(s) wrong\n",
+             op_idx, (unsigned long long)(evicted + kept), kept,
+             (unsigned long long)vox_undo_bytes_used(undo), (unsigned long long)evicted, wraps,
+             (unsigned long long)undone, (unsigned long long)redone,
+             (unsigned long long)mismatches, (unsigned long long)steps_wrong);
+    }
+  }
+  
+  // The point is to replay across eviction
+  if (evicted == 0 || wraps == 0) {
+    printf("the history never wrapped\n");
+    steps_wrong += 1;
+  }
+  result = mismatches + steps_wrong;
+  
+  vox_undo_release(undo);
+  vox_world_release(world);
+  arena_release(arena);
+  async_release();
+  
+  return result;
+}
+
+// Binary tree of jobs, each pushing its children from whichever thread runs it
+struct CLI_AsyncTree;
+struct CLI_AsyncNode {
+  CLI_AsyncTree *tree;
+  U32 idx; // Children at 2*idx + 1 and 2*idx + 2
+};
+
+struct CLI_AsyncTree {
+  ASYNC_Counter counter;
+  CLI_AsyncNode *nodes;
+  U32 nodes_count;
+  volatile U32 ran_count;
+};
+
+function void
+cli_async_tree_job(void *data)
+{
+  CLI_AsyncNode *node = (CLI_AsyncNode *)data;
+  CLI_AsyncTree *tree = node->tree;
+  
+  // Some work first, so that the release finds workers in the middle of jobs
+  for (U32 idx = 0; idx < 256; idx += 1) {
+    os_cpu_pause();
+  }
+  
+  for (U32 child = 2*node->idx + 1; child <= 2*node->idx + 2; child += 1) {
+    if (child < tree->nodes_count) {
+      async_job_push(cli_async_tree_job, &tree->nodes[child], &tree->counter);
+    }
+  }
+  os_interlocked_increment_32(&tree->ran_count);
+}
+
+// Pushes the root of a tree of jobs, whose children workers push to their own
+// deques, and releases the async layer right away, `rounds` times. Returns the
+// rounds where a job was dropped.
+function U32
+cli_async_test(U32 threads)
+{
+  U32 rounds = 200;
+  U32 result = 0;
+  Arena *arena = arena_alloc_default();
+  CLI_AsyncTree *tree = ArenaPushStruct(arena, CLI_AsyncTree);
+  tree->nodes_count = 1023;
+  tree->nodes = ArenaPushArray(arena, CLI_AsyncNode, tree->nodes_count);
+  for (U32 idx = 0; idx < tree->nodes_count; idx += 1) {
+    tree->nodes[idx].tree = tree;
+    tree->nodes[idx].idx = idx;
+  }
+  
+  U64 dropped = 0;
+  for (U32 round = 0; round < rounds; round += 1) {
+    tree->counter.count = 0;
+    tree->ran_count = 0;
+    
+    async_init(threads - 1);
+    async_job_push(cli_async_tree_job, &tree->nodes[0], &tree->counter);
+    async_release();
+    
+    if (tree->counter.count != 0 || tree->ran_count != tree->nodes_count) {
+      dropped += tree->nodes_count - tree->ran_count;
+      result += 1;
+    }
+  }
+  printf("%u thread(s), %u round(s) of %u job(s): %llu job(s) dropped in %u round(s)\n",
+         threads, rounds, tree->nodes_count, (unsigned long long)dropped, result);
+  
+  arena_release(arena);
+  return result;
+}
+
+void
+entry_point(void)
+{
+  os_init();
+  prof_init();
+  prof_thread_set_name(S8("main"));
+  
+  Arena *arena = arena_alloc_default();
+  String8List args = os_get_command_line_args(arena);
+  CLI_Options opts = cli_options_from_args(&args);
+  
+  if (opts.brush_bench) {
+    cli_brush_bench();
+    os_exit_process(0);
+  }
+  
+  if (opts.upload_test) {
+    os_exit_process(cli_upload_test() != 0);
+  }
+  
+  if (opts.csg_test) {
+    os_exit_process(cli_csg_test(opts.threads) != 0);
+  }
+  
+  if (opts.undo_test) {
+    os_exit_process(cli_undo_test() != 0);
+  }
+  
+  if (opts.async_test) {
+    os_exit_process(cli_async_test(opts.threads) != 0);
+  }
+  
+  if (opts.shader_cache_test_dir) {
+    String8 dir = str8((U8 *)opts.shader_cache_test_dir, cstr_count(opts.shader_cache_test_dir));
+    os_exit_process(cli_shader_cache_test(dir) != 0);
+  }
+  
+  if (opts.file_watch_test_dir) {
+    String8 dir = str8((U8 *)opts.file_watch_test_dir, cstr_count(opts.file_watch_test_dir));
+    os_exit_process(cli_file_watch_test(dir) != 0);
+  }
+  
+  S32 exit_code = 0;
+  
+  VOX_World *world = vox_world_alloc();
+  if (opts.scene_path) {
+    F64 start = os_get_ticks();
+    String8 scene_path = str8((U8 *)opts.scene_path, cstr_count(opts.scene_path));
+    VOX_Scene *scene = vox_scene_open(scene_path);
+    if (scene) {
+      F64 opened = os_get_ticks();
+      U32 loaded = vox_world_load_scene(world, scene, scene->chunk_min, scene->chunk_max);
+      F64 freq = os_get_ticks_frequency();
+      printf("%s: %u chunk(s), opened in %.2f ms, loaded %u in %.2f ms\n",
+             opts.scene_path, scene->chunks_count, (opened - start)*1000.0 / freq,
+             loaded, (os_get_ticks() - opened)*1000.0 / freq);
+      vox_scene_close(scene);
+    }
+    else {
+      fprintf(stderr, "failed to open scene %s\n", opts.scene_path);
+      os_exit_process(1);
+    }
+  }
+  else if (opts.vox_path) {
+    async_init(opts.threads - 1);
+    F64 start = os_get_ticks();
+    String8 vox_path = str8((U8 *)opts.vox_path, cstr_count(opts.vox_path));
+    VOX_MagicaImport import = vox_magica_import(world, vox_path);
+    async_release();
+    if (import.ok) {
+      printf("%s: %u model(s), %u placed, %llu voxels, %u chunk(s), imported in %.2f ms\n",
+             opts.vox_path, import.models_count, import.instances_count,
+             (unsigned long long)import.voxels_count, world->chunks_count,
+             (os_get_ticks() - start)*1000.0 / os_get_ticks_frequency());
+    }
+    else {
+      fprintf(stderr, "failed to import %s\n", opts.vox_path);
+      os_exit_process(1);
+    }
+  }
+  else {
+    vox_world_make_test_scene(world);
+  }
+  
+  if (opts.save_path) {
+    String8 save_path = str8((U8 *)opts.save_path, cstr_count(opts.save_path));
+    if (!vox_scene_write_world(world, save_path)) {
+      fprintf(stderr, "failed to write %s\n", opts.save_path);
+      exit_code = 1;
+    }
+  }
+  
+  if (opts.save_vox_path) {
+    String8 save_vox_path = str8((U8 *)opts.save_vox_path, cstr_count(opts.save_vox_path));
+    if (!vox_magica_write_world(world, 0, save_vox_path)) {
+      fprintf(stderr, "failed to write %s\n", opts.save_vox_path);
+      exit_code = 1;
+    }
+  }
+  
+  if (opts.vox_bench_path) {
+    if (cli_vox_bench(world, opts.vox_bench_path, opts.threads) != 0) {
+      exit_code = 1;
+    }
+    os_exit_process(exit_code);
+  }
+  
+  if (opts.mesh_bench) {
+    cli_mesh_bench(world, opts.threads);
+    os_exit_process(exit_code);
+  }
+  
+  if (opts.layout_bench) {
+    cli_layout_bench(world);
+    os_exit_process(exit_code);
+  }
+  
+  if (opts.codec_bench) {
+    if (cli_codec_bench(world) != 0) {
+      exit_code = 1;
+    }
+    os_exit_process(exit_code);
+  }
+  
+  if (opts.palette_test) {
+    if (cli_palette_test(world) != 0) {
+      exit_code = 1;
+    }
+    os_exit_process(exit_code);
+  }
+  
+  if (opts.distance_bench) {
+    if (cli_distance_bench(world, opts.threads) != 0) {
+      exit_code = 1;
+    }
+    os_exit_process(exit_code);
+  }
+  
+  VOX_UniformData uniforms = {0};
+  uniforms.client_size = v2f32((F32)opts.width, (F32)opts.height);
+  uniforms.view = opts.view;
+  uniforms.zoom = 1.f;
+  uniforms.lod_bias = opts.lod_bias;
+  
+  if (opts.tree_bench) {
+    if (cli_tree_bench(world, &uniforms) != 0) {
+      exit_code = 1;
+    }
+    os_exit_process(exit_code);
+  }
+  
+  if (opts.raycast_bench) {
+    if (cli_raycast_bench(world, &uniforms) != 0) {
+      exit_code = 1;
+    }
+    os_exit_process(exit_code);
+  }
+  
+  if (opts.frame_test) {
+    if (cli_frame_test(world, &uniforms) != 0) {
+      exit_code = 1;
+    }
+    os_exit_process(exit_code);
+  }
+  
+  VOX_Framebuffer fb = vox_framebuffer_alloc(arena, opts.width, opts.height);
+  
+  VOX_LightCache *lights = 0;
+  if (opts.light) {
+    async_init(opts.threads - 1);
+    lights = vox_light_cache_alloc();
+    F64 start = os_get_ticks();
+    U32 baked = vox_light_cache_update(lights, world);
+    printf("light: %u chunk(s) baked in %.2f ms on %u thread(s)\n",
+           baked, (os_get_ticks() - start)*1000.0 / os_get_ticks_frequency(), opts.threads);
+    async_release();
+  }
+  
+  VOX_LodCache *lods = 0;
+  if (opts.lod) {
+    async_init(opts.threads - 1);
+    lods = vox_lod_cache_alloc();
+    F64 start = os_get_ticks();
+    U32 built = vox_lod_cache_update(lods, world);
+    printf("lod: %u pyramid(s) built in %.2f ms on %u thread(s)\n",
+           built, (os_get_ticks() - start)*1000.0 / os_get_ticks_frequency(), opts.threads);
+    async_release();
+  }
+  
+  // Without -scaling only the last (requested) thread count is run.
+  U32 threads_first = opts.scaling ? 1 : opts.threads;
+  for (U32 threads = threads_first; threads <= opts.threads; threads += 1) {
+    async_init(threads - 1);
+    
+    F64 start = os_get_ticks();
+    for (U32 frame = 0; frame < opts.frames; frame += 1) {
+      vox_render_cpu(world, lights, lods, &uniforms, &fb);
+      prof_frame_end();
+    }
+    F64 seconds = (os_get_ticks() - start) / os_get_ticks_frequency();
+    
+    F64 pixels = (F64)opts.width*opts.height*opts.frames;
+    printf("%ux%u, %u frame(s), %u thread(s): %.2f ms/frame, %.2f Mpixels/s\n",
+           opts.width, opts.height, opts.frames, threads,
+           seconds*1000.0 / opts.frames, pixels / seconds / 1000000.0);
+    
+    async_release();
+  }
+  
+  String8 png = vox_png_from_framebuffer(arena, &fb);
+  String8 out_path = str8((U8 *)opts.out_path, cstr_count(opts.out_path));
+  if (!os_file_write(out_path, png)) {
+    fprintf(stderr, "failed to write %s\n", opts.out_path);
+    exit_code = 1;
+  }
+  
+  if (opts.trace_path) {
+    String8List lines = prof_stats_lines(arena);
+    for (String8Node *n = lines.first; n != 0; n = n->next) {
+      printf("%.*s\n", (int)n->str.count, n->str.data);
+    }
+    
+    String8 trace_path = str8((U8 *)opts.trace_path, cstr_count(opts.trace_path));
+    if (!prof_write_chrome_trace(trace_path)) {
+      fprintf(stderr, "failed to write %s\n", opts.trace_path);
+      exit_code = 1;
+    }
+  }
+  
+  if (opts.golden_path) {
+    U64 mismatches = cli_compare_with_golden(&fb, opts.golden_path, opts.tolerance);
+    printf("golden %s: %llu pixel(s) differ\n", opts.golden_path, (unsigned long long)mismatches);
+    if (mismatches > 0) {
+      exit_code = 1;
+    }
+  }
+  
+  os_exit_process(exit_code);
+}
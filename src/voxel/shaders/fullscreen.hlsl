@@ -27,6 +27,7 @@ struct RaymarchResult {
 	float3 normal;
 	float steps;
 	uint id;
+	uint level; // Mip level of the hit; above 0, pos is where the ray entered its cell
 };
 
 cbuffer PerFrameData : register(b0) {
@@ -40,14 +41,27 @@ cbuffer PerFrameData : register(b0) {
 
 	float zoom; // [1, float_max]
 	float time;
-	float2 pad3;
+	float lod_bias; // Added to log2 of a ray's footprint when picking a mip level
+	float pad3;
 }
 
 SamplerState chunk_sampler : register(s0);
+
+// Mips are the chunk's LOD pyramid, see voxel/voxel_lod.h
 Texture3D<float4> chunk_texture : register(t0);
 
+// Baked ambient occlusion and sun visibility per voxel face, see voxel/voxel_light.h
+Texture3D<uint> light_texture : register(t1);
+
+// Chebyshev distance to the nearest solid voxel of the chunk, see voxel/voxel_distance.h
+Texture3D<uint> distance_texture : register(t2);
+
 static const float chunk_slice_size = 32;
 
+// The cells map() reads the chunk from
+static const float3 chunk_min = float3(0, -chunk_slice_size, 0);
+static const float3 chunk_max = float3(chunk_slice_size, 0, chunk_slice_size);
+
 static const float3 palette[4] = {
 	float3(0.2, 0.2, 0.2),
 	float3(0.24, 0.38, 0.1),
@@ -55,8 +69,12 @@ static const float3 palette[4] = {
 	float3(0.123, 0.22, 0.24),
 };
 
+static const float ao_curve[4] = { 0.45, 0.65, 0.85, 1.0 };
+
 static const float steps_max = 512.0;
 
+static const float lod_levels = 6.0;
+
 PS_INPUT 
 vs_main(VS_INPUT input)
 {
@@ -67,7 +85,7 @@ vs_main(VS_INPUT input)
 }
 
 Voxel
-get_voxel(float3 pos) 
+get_voxel(float3 pos, uint level) 
 {
 	float3 chunk_origin = float3(0,0,0);
 #if 0
@@ -77,7 +95,7 @@ get_voxel(float3 pos)
 
 	//float4 s = chunk_texture.Load(int4(chunk_coord.xyz, 0));
 #endif	
-	float4 s = chunk_texture.Load(int4(pos.xyz, 0));
+	float4 s = chunk_texture.Load(int4(pos.xyz, level));
 
 	Voxel result;
 	result.opacity = s.x;
@@ -136,7 +154,7 @@ map(float3 pos)
 
 	pos.y += (chunk_slice_size);
 
-	Voxel v = get_voxel(pos);
+	Voxel v = get_voxel(pos, 0);
 
 	result.d = v.opacity;
 	result.color = palette[v.palette_idx];
@@ -145,66 +163,167 @@ map(float3 pos)
 	return result;
 }
 
+float
+get_distance(float3 pos)
+{
+	// Same cell map() samples the chunk texture at
+	return (float)distance_texture.Load(int4(pos + float3(0, chunk_slice_size, 0), 0));
+}
+
+// Distance along the ray to the boundary of each cell ahead of pos
+float3
+cell_t_max(float3 pos, float3 ro, float3 rd)
+{
+	float3 t_max;
+	t_max.x = (rd.x > 0.0) ? (pos.x + 1.0 - ro.x) / rd.x : (ro.x - pos.x) / -rd.x;
+	t_max.y = (rd.y > 0.0) ? (pos.y + 1.0 - ro.y) / rd.y : (ro.y - pos.y) / -rd.y;
+	t_max.z = (rd.z > 0.0) ? (pos.z + 1.0 - ro.z) / rd.z : (ro.z - pos.z) / -rd.z;
+	return t_max;
+}
+
+// Mip level for a ray whose cone is footprint cells wide: floor(log2), clamped
+uint
+lod_level(float footprint)
+{
+	return (uint)clamp(floor(log2(max(footprint, 1e-6))), 0.0, lod_levels - 1.0);
+}
+
+// Moves pos to the first cell past the box [box_min, box_max), on the face the
+// ray leaves it through. The other axes are clamped into the box so rounding
+// can't skip a cell beside it.
+void
+leap(inout float3 pos, inout float3 normal, inout float t, float3 box_min, float3 box_max, float3 ro, float3 rd, float3 inv_rd, float3 stp)
+{
+	float3 t_leave = ((stp > 0.0 ? box_max : box_min) - ro) * inv_rd;
+	t = min(min(t_leave.x, t_leave.y), t_leave.z);
+
+	pos = clamp(floor(ro + rd*t), box_min, box_max - 1.0);
+	if (t_leave.x < t_leave.y && t_leave.x < t_leave.z) {
+		pos.x = (stp.x > 0.0) ? box_max.x : box_min.x - 1.0;
+		normal = float3(-stp.x, 0, 0);
+	}
+	else if (t_leave.y < t_leave.z) {
+		pos.y = (stp.y > 0.0) ? box_max.y : box_min.y - 1.0;
+		normal = float3(0, -stp.y, 0);
+	}
+	else {
+		pos.z = (stp.z > 0.0) ? box_max.z : box_min.z - 1.0;
+		normal = float3(0, 0, -stp.z);
+	}
+}
+
+// cone is the width of the pixel's cone per unit of t
 RaymarchResult
-raymarch(float3 ro, float3 rd)
+raymarch(float3 ro, float3 rd, float cone)
 {
+	RaymarchResult res;
+	res.hit = 0;
+	res.pos = float3(0,0,0);
+	res.color = float3(0,0,0);
+	res.normal = float3(0,0,0);
+	res.steps = 0.0;
+	res.id = -1;
+	res.level = 0;
+
 	// Step direction (+1 or -1 for each)
 	float3 stp = sign(rd);
+	float3 inv_rd = 1.0 / rd;
+
+	// Rays that miss the chunk's box can't hit anything
+	float3 t_box0 = (chunk_min - ro) * inv_rd;
+	float3 t_box1 = (chunk_max - ro) * inv_rd;
+	float3 t_near = min(t_box0, t_box1);
+	float3 t_far = max(t_box0, t_box1);
+	float t_enter = max(max(max(t_near.x, t_near.y), t_near.z), 0.0);
+	float t_exit = min(min(t_far.x, t_far.y), t_far.z);
+	if (t_exit < t_enter) {
+		return res;
+	}
 
-	float3 pos = floor(ro);
-
-  // Initial distance to next voxel boundary, in the appropriate direction
-  float3 dist_to_vox = pos - ro;
-  dist_to_vox *= stp;
-    
-  // Convert stp to a value between 0 and 1 so we can use it to scale the ray
-  // direction vector below.
-  float3 stp_positive = (stp * 0.5) + 0.5;
+	// Start in the cell where the ray enters the box, on the face it crosses
+	float t = t_enter;
+	float3 pos = clamp(floor(ro + rd*t_enter), chunk_min, chunk_max - 1.0);
+	float3 normal = float3(0,0,0);
+	if (t_enter > 0.0) {
+		if (t_near.x > t_near.y && t_near.x > t_near.z) {
+			normal = float3(-stp.x, 0, 0);
+		}
+		else if (t_near.y > t_near.z) {
+			normal = float3(0, -stp.y, 0);
+		}
+		else {
+			normal = float3(0, 0, -stp.z);
+		}
+	}
 
   // Distance to next voxel boundary expressed as a parametric 
   // t-value along the current pixel's ray.
-	float3 t_max;
-	t_max.x = (rd.x > 0.0) ? (pos.x + 1.0 - ro.x) / rd.x : (ro.x - pos.x) / -rd.x;
-	t_max.y = (rd.y > 0.0) ? (pos.y + 1.0 - ro.y) / rd.y : (ro.y - pos.y) / -rd.y;
-	t_max.z = (rd.z > 0.0) ? (pos.z + 1.0 - ro.z) / rd.z : (ro.z - pos.z) / -rd.z;
+	float3 t_max = cell_t_max(pos, ro, rd);
 	
   // Distance needed to move by one voxel in each axis along the 
   // current pixel's ray. 
-  float3 t_delta = abs(float3(1.0,1.0,1.0) / rd);
+  float3 t_delta = abs(inv_rd);
+
+	float footprint_scale = cone * exp2(lod_bias);
     
   float steps = 0.0;
-	float3 normal = float3(0,0,0);
-	
-	RaymarchResult res;
 	
-	// DDA loop
-  float t = 0.0;
+	// DDA loop, leaping over the empty space the distance field vouches for,
+	// and once the cone is wide enough, over whole cells of a coarser mip
   int hit = 0;
+	uint level = 0;
 	MapResult map_res;
 	map_res.color = float3(0,0,0);
 	map_res.id = -1;
 
   for (float idx = 0.0; idx < steps_max; idx += 1.0) {
-		map_res = map(pos);
+		if (any(pos < chunk_min) || any(pos >= chunk_max)) {
+			break;
+		}
+
+		level = lod_level(t * footprint_scale);
+		float cell_size = exp2((float)level);
+		float3 cell_min = chunk_min + floor((pos - chunk_min) / cell_size) * cell_size;
+		if (level > 0) {
+			Voxel v = get_voxel((cell_min - chunk_min) / cell_size, level);
+			map_res.d = v.opacity;
+			map_res.color = palette[v.palette_idx];
+			map_res.id = v.id;
+		}
+		else {
+			map_res = map(pos);
+		}
     if (map_res.d > 0.0) {
       hit = 1;
       break;
     }
 
-    // Advance to next voxel boundary in the dimension in which
-    // the distance to the next voxel boundary is smallest
-    if (t_max.x < t_max.y && t_max.x < t_max.z ) { 
-      t = t_max.x; t_max.x += t_delta.x; pos.x += stp.x; 
-			normal = float3(-stp.x,0,0);
-    }
-    else if(t_max.y < t_max.z ) { 
-      t = t_max.y; t_max.y += t_delta.y; pos.y += stp.y; 
-			normal = float3(0, -stp.y, 0);
-    }
-    else { 
-      t = t_max.z; t_max.z += t_delta.z; pos.z += stp.z; 
-			normal = float3(0, 0, -stp.z);
-    }     
+		// Every cell less than d away is empty
+		float d = get_distance(pos);
+		if (d > 1.0 && 2.0*d - 1.0 > cell_size) {
+			leap(pos, normal, t, pos - (d - 1.0), pos + d, ro, rd, inv_rd, stp);
+			t_max = cell_t_max(pos, ro, rd);
+		}
+		else if (level > 0) {
+			leap(pos, normal, t, cell_min, cell_min + cell_size, ro, rd, inv_rd, stp);
+			t_max = cell_t_max(pos, ro, rd);
+		}
+		else {
+			// Advance to next voxel boundary in the dimension in which
+			// the distance to the next voxel boundary is smallest
+			if (t_max.x < t_max.y && t_max.x < t_max.z ) { 
+				t = t_max.x; t_max.x += t_delta.x; pos.x += stp.x; 
+				normal = float3(-stp.x,0,0);
+			}
+			else if(t_max.y < t_max.z ) { 
+				t = t_max.y; t_max.y += t_delta.y; pos.y += stp.y; 
+				normal = float3(0, -stp.y, 0);
+			}
+			else { 
+				t = t_max.z; t_max.z += t_delta.z; pos.z += stp.z; 
+				normal = float3(0, 0, -stp.z);
+			}     
+		}
 
     steps += 1.0;
   }
@@ -215,6 +334,7 @@ raymarch(float3 ro, float3 rd)
 	res.normal = normal;
 	res.steps = steps;
 	res.id = map_res.id;
+	res.level = level;
 
 	return res;
 }
@@ -280,7 +400,7 @@ ps_main(PS_INPUT input) : SV_TARGET
     color = apply_fog(color, bg_color, tmp*t);
 	}
 
-	RaymarchResult res = raymarch(ro, rd);
+	RaymarchResult res = raymarch(ro, rd, 1.0 / (client_size.y*fov));
 	if (res.hit) {
 		color = res.color;
 		normal = res.normal;
@@ -295,7 +415,20 @@ ps_main(PS_INPUT input) : SV_TARGET
 		float3 ind_col = float3(0.40,0.28,0.20);
 		float ind = clamp(dot(normal, normalize(key_dir*float3(-1.0,0.0,-1.0))), 0.0, 1.0);
 
-		float3 lin = key_col*key + sky_col*sky + ind_col*ind;
+		// Same cell map() samples the chunk texture at
+		uint texel = light_texture.Load(int4(res.pos + float3(0, chunk_slice_size, 0), 0));
+		uint axis = (normal.x != 0.0) ? 0 : (normal.y != 0.0) ? 1 : 2;
+		uint face = axis*2 + ((normal.x + normal.y + normal.z < 0.0) ? 1 : 0);
+		float ao = ao_curve[(texel >> (face*2)) & 3];
+		float sun = (float)((texel >> (12 + axis)) & 1);
+
+		// Light is baked per voxel, so coarse cells go without it
+		if (res.level > 0) {
+			ao = 1.0;
+			sun = 1.0;
+		}
+
+		float3 lin = key_col*key*sun + (sky_col*sky + ind_col*ind)*ao;
 		color = color*lin;
 
 		float gamma = 1.0/2.2;
@@ -0,0 +1,134 @@
+// Rasterizes the quads of voxel/voxel_mesh.h with the same camera and lighting
+// as fullscreen.hlsl.
+
+struct VS_INPUT {
+	uint packed : PACKED;
+};
+
+struct PS_INPUT {
+	float4 pos : SV_POSITION;
+	float3 normal : NORMAL;
+	float3 color : COLOR;
+	float ao : AO;
+};
+
+cbuffer PerFrameData : register(b0) {
+	float2 client_size;
+	float2 pad0;
+
+	float2 view;
+	float2 pad1;
+
+	float4 mouse;
+
+	float zoom;
+	float time;
+	float lod_bias;
+	float pad3;
+}
+
+cbuffer PerChunkData : register(b1) {
+	float3 chunk_origin; // In voxels
+	float pad4;
+}
+
+static const float chunk_slice_size = 32;
+
+static const float3 palette[4] = {
+	float3(0.2, 0.2, 0.2),
+	float3(0.24, 0.38, 0.1),
+	float3(0.1, 0.23, 0.14),
+	float3(0.123, 0.22, 0.24),
+};
+
+// VOX_MeshFace order
+static const float3 face_normals[6] = {
+	float3( 1, 0, 0),
+	float3(-1, 0, 0),
+	float3( 0, 1, 0),
+	float3( 0,-1, 0),
+	float3( 0, 0, 1),
+	float3( 0, 0,-1),
+};
+
+// Indexed by the vertex's occlusion, 0 (fully occluded) to 3 (open)
+static const float ao_curve[4] = { 0.45, 0.65, 0.85, 1.0 };
+
+static const float near_plane = 0.1;
+static const float far_plane = 1000.0;
+
+PS_INPUT
+vs_main(VS_INPUT input)
+{
+	uint x = input.packed & 63;
+	uint y = (input.packed >> 6) & 63;
+	uint z = (input.packed >> 12) & 63;
+	uint face = (input.packed >> 18) & 7;
+	uint ao = (input.packed >> 21) & 3;
+	uint color = (input.packed >> 23) & 255;
+
+	// The raymarcher draws voxel v of the chunk at cell v - (0, chunk_slice_size, 0)
+	float3 pos = chunk_origin + float3(x, y, z) - float3(0, chunk_slice_size, 0);
+
+	// Camera of fullscreen.hlsl
+	float view_angle = 10.*view.x / client_size.x;
+	float ray_y = 120.*view.y / client_size.y;
+	float orbit_radius = 100.;
+
+	float3 rb = float3(0.0, 0.0, 0.0);
+	float3 ro = rb + float3(
+		orbit_radius*cos(view_angle), 
+		-ray_y, 
+		orbit_radius*sin(view_angle)
+	);
+
+	float fov = 3.14159/1.2;
+	float3 up = float3(0.0,1.0,0.0);
+
+	float3 cw = normalize(rb - ro);
+	float3 cu = normalize(cross(cw, up));
+	float3 cv = cross(cu, cw);
+
+	// The raymarcher's ray through p = (frag_coord - client_size*0.5) / client_size.y
+	// runs along p.x*cu + p.y*cv + fov*cw, so a point at e in camera space lands
+	// on p = fov*e.xy / e.z.
+	float3 d = pos - ro;
+	float3 e = float3(dot(d, cu), dot(d, cv), dot(d, cw));
+
+	PS_INPUT output;
+	output.pos = float4(
+		2.0*fov*e.x*client_size.y / client_size.x,
+		-2.0*fov*e.y,
+		(e.z - near_plane)*far_plane / (far_plane - near_plane),
+		e.z
+	);
+	output.normal = face_normals[face];
+	output.color = palette[color & 3];
+	output.ao = ao_curve[ao];
+	return output;
+}
+
+float4
+ps_main(PS_INPUT input) : SV_TARGET
+{
+	float3 normal = input.normal;
+	float3 color = input.color;
+
+	float3 key_dir = normalize(float3(-0.35, -0.6, -0.5));
+	float3 key_col = float3(1.64, 1.27, 0.99);
+	float  key = clamp(dot(normal, key_dir), 0.0, 1.0);
+
+	float3 sky_col = float3(0.16,0.20,0.28);
+	float sky = clamp(0.5 - 0.5*normal.y, 0.0, 1.0);
+
+	float3 ind_col = float3(0.40,0.28,0.20);
+	float ind = clamp(dot(normal, normalize(key_dir*float3(-1.0,0.0,-1.0))), 0.0, 1.0);
+
+	float3 lin = key_col*key + sky_col*sky + ind_col*ind;
+	color = color*lin*input.ao;
+
+	float gamma = 1.0/2.2;
+	color = pow(color, float3(gamma,gamma,gamma));
+
+	return float4(color.xyz, 1.0);
+}
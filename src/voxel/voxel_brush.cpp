@@ -0,0 +1,338 @@
+//
+// Shapes
+//
+
+function S32
+vox_brush_isqrt(S32 n)
+{
+  S32 result = (S32)sqrtf32((F32)n);
+  while ((result + 1)*(result + 1) <= n) {
+    result += 1;
+  }
+  while (result*result > n) {
+    result -= 1;
+  }
+  return result;
+}
+
+function F32
+vox_brush_lattice_value(U32 seed, S32 x, S32 y, S32 z)
+{
+  U32 h = seed ^ ((U32)x*0x8da6b343u) ^ ((U32)y*0xd8163841u) ^ ((U32)z*0xcb1ab31fu);
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  h *= 0x846ca68bu;
+  h ^= h >> 16;
+  F32 result = (F32)(h >> 8) * (1.f / 16777216.f);
+  return result;
+}
+
+// Trilinear value noise in [0, 1) for the voxels [x0, x1] of a row, in world
+// space so that overlapping stamps agree about which voxels are eroded. The
+// lattice is interpolated in y and z once per cell along the row, leaving one
+// lerp per voxel.
+function void
+vox_brush_noise_row(U32 seed, S32 x0, S32 x1, S32 y, S32 z, F32 *out)
+{
+  S32 cy = vox_floor_div(y, VOX_BRUSH_NOISE_CELL);
+  S32 cz = vox_floor_div(z, VOX_BRUSH_NOISE_CELL);
+  F32 fy = (F32)(y - cy*VOX_BRUSH_NOISE_CELL) / VOX_BRUSH_NOISE_CELL;
+  F32 fz = (F32)(z - cz*VOX_BRUSH_NOISE_CELL) / VOX_BRUSH_NOISE_CELL;
+  fy = fy*fy*(3.f - 2.f*fy);
+  fz = fz*fz*(3.f - 2.f*fz);
+  
+  S32 cx = vox_floor_div(x0, VOX_BRUSH_NOISE_CELL);
+  F32 lattice[2] = {0};
+  for (S32 idx = 0; idx < 2; idx += 1) {
+    F32 c00 = vox_brush_lattice_value(seed, cx + idx, cy,     cz);
+    F32 c10 = vox_brush_lattice_value(seed, cx + idx, cy + 1, cz);
+    F32 c01 = vox_brush_lattice_value(seed, cx + idx, cy,     cz + 1);
+    F32 c11 = vox_brush_lattice_value(seed, cx + idx, cy + 1, cz + 1);
+    lattice[idx] = lerpf32(lerpf32(c00, c10, fy), lerpf32(c01, c11, fy), fz);
+  }
+  
+  for (S32 x = x0; x <= x1; x += 1) {
+    S32 x_cell = vox_floor_div(x, VOX_BRUSH_NOISE_CELL);
+    if (x_cell != cx) {
+      cx = x_cell;
+      lattice[0] = lattice[1];
+      F32 c00 = vox_brush_lattice_value(seed, cx + 1, cy,     cz);
+      F32 c10 = vox_brush_lattice_value(seed, cx + 1, cy + 1, cz);
+      F32 c01 = vox_brush_lattice_value(seed, cx + 1, cy,     cz + 1);
+      F32 c11 = vox_brush_lattice_value(seed, cx + 1, cy + 1, cz + 1);
+      lattice[1] = lerpf32(lerpf32(c00, c10, fy), lerpf32(c01, c11, fy), fz);
+    }
+    F32 fx = (F32)(x - cx*VOX_BRUSH_NOISE_CELL) / VOX_BRUSH_NOISE_CELL;
+    fx = fx*fx*(3.f - 2.f*fx);
+    out[x - x0] = lerpf32(lattice[0], lattice[1], fx);
+  }
+}
+
+//
+// Stamps
+//
+
+function void
+vox_voxel_fill(VOX_Voxel *dst, VOX_Voxel voxel, U64 count)
+{
+  U32 value = vox_u32_from_voxel(voxel);
+  if (value == voxel.opacity*0x01010101u) {
+    MemorySet(dst, voxel.opacity, sizeof(VOX_Voxel)*count);
+  }
+  else {
+    for (U64 idx = 0; idx < count; idx += 1) {
+      dst[idx] = voxel;
+    }
+  }
+}
+
+// Writes `count` voxels along x starting at `local_coord` and brings the chunk's
+// bookkeeping up to date. Returns the number of voxels covered.
+function U64
+vox_brush_span_apply(VOX_ChunkNode *node, VOX_UndoHistory *undo, VOX_Brush *brush, V3S32 local_coord, S32 count)
+{
+  U32 solid_before = 0;
+  U32 solid_after = 0;
+  
+  // Voxels along x are only consecutive in memory a run at a time, unless the
+  // chunk layout is linear (see VOX_CHUNK_LAYOUT)
+  for (S32 run_x = 0, run_count = 0; run_x < count; run_x += run_count) {
+    V3S32 run_coord = v3s32(local_coord.x + run_x, local_coord.y, local_coord.z);
+    run_count = vox_idx_run_from_local_coord(run_coord, count - run_x);
+    S32 first_idx = vox_idx_from_local_coord(run_coord);
+    VOX_Voxel *voxels = vox_get_voxel(&node->chunk, first_idx);
+    
+    if (undo) {
+      vox_undo_touch_span(undo, node->coord, &node->chunk, (U32)first_idx, (U32)run_count);
+    }
+    
+    U32 run_solid = 0;
+    for (S32 idx = 0; idx < run_count; idx += 1) {
+      run_solid += (voxels[idx].opacity > 0);
+    }
+    solid_before += run_solid;
+    
+    switch (brush->mode) {
+      case VOX_EditMode_Add: {
+        vox_voxel_fill(voxels, brush->voxel, (U64)run_count);
+        solid_after += (brush->voxel.opacity > 0) ? (U32)run_count : 0;
+      }break;
+      case VOX_EditMode_Delete: {
+        MemoryZero(voxels, sizeof(VOX_Voxel)*run_count);
+      }break;
+      case VOX_EditMode_Paint: {
+        for (S32 idx = 0; idx < run_count; idx += 1) {
+          if (voxels[idx].opacity > 0) {
+            voxels[idx].color = brush->voxel.color;
+          }
+        }
+        solid_after += run_solid;
+      }break;
+    }
+  }
+  
+  if (brush->mode != VOX_EditMode_Paint) {
+    B32 solid = (brush->mode == VOX_EditMode_Add && brush->voxel.opacity > 0);
+    vox_occupancy_set_span(&node->occupancy, local_coord, count, solid);
+  }
+  
+  for (S32 x = local_coord.x; x < local_coord.x + count; x = (x / VOX_BRICK_SIZE + 1)*VOX_BRICK_SIZE) {
+    vox_dirty_bricks_mark(node->dirty_bricks, v3s32(x, local_coord.y, local_coord.z));
+  }
+  
+  node->solid_count = node->solid_count - solid_before + solid_after;
+  
+  return (U64)count;
+}
+
+function U64
+vox_brush_stamp(VOX_World *world, VOX_UndoHistory *undo, VOX_Brush *brush, V3S32 center)
+{
+  ProfBegin("vox_brush_stamp");
+  U64 result = 0;
+  
+  B32 implicit_stroke = (undo && !undo->stroke_active);
+  if (implicit_stroke) {
+    vox_undo_begin_stroke(undo, 0);
+  }
+  
+  // r*r + r rather than r*r keeps single voxels from poking out of the sphere's
+  // poles at small radii
+  S32 radius = Clamp(brush->radius, 0, VOX_BRUSH_RADIUS_MAX);
+  S32 radius_sq = radius*radius + radius;
+  
+  V3S32 min = v3s32(center.x - radius, center.y - radius, center.z - radius);
+  V3S32 max = v3s32(center.x + radius, center.y + radius, center.z + radius);
+  V3S32 chunk_min = vox_chunk_coord_from_voxel_coord(min);
+  V3S32 chunk_max = vox_chunk_coord_from_voxel_coord(max);
+  
+  for (S32 cz = chunk_min.z; cz <= chunk_max.z; cz += 1) {
+    for (S32 cy = chunk_min.y; cy <= chunk_max.y; cy += 1) {
+      for (S32 cx = chunk_min.x; cx <= chunk_max.x; cx += 1) {
+        V3S32 chunk_coord = v3s32(cx, cy, cz);
+        
+        // Only adding can bring a chunk into existence
+        VOX_ChunkNode *node = 0;
+        if (brush->mode == VOX_EditMode_Add && brush->voxel.opacity > 0) {
+          node = vox_world_chunk_acquire(world, chunk_coord);
+        }
+        else {
+          node = vox_world_chunk_from_coord(world, chunk_coord);
+        }
+        if (!node) {
+          continue;
+        }
+        
+        V3S32 base = v3s32_scale(chunk_coord, VOX_SLICE_SIZE);
+        V3S32 lo = v3s32(Max(min.x - base.x, 0), Max(min.y - base.y, 0), Max(min.z - base.z, 0));
+        V3S32 hi = v3s32(Min(max.x - base.x, VOX_SLICE_SIZE - 1), Min(max.y - base.y, VOX_SLICE_SIZE - 1), Min(max.z - base.z, VOX_SLICE_SIZE - 1));
+        
+        for (S32 z = lo.z; z <= hi.z; z += 1) {
+          S32 dz = base.z + z - center.z;
+          for (S32 y = lo.y; y <= hi.y; y += 1) {
+            S32 dy = base.y + y - center.y;
+            
+            // Row extent in world x, inclusive
+            S32 half = 0;
+            B32 row_empty = 0;
+            switch (brush->shape) {
+              case VOX_BrushShape_Sphere:
+              case VOX_BrushShape_Noise: {
+                S32 rem = radius_sq - dy*dy - dz*dz;
+                row_empty = (rem < 0);
+                half = row_empty ? 0 : vox_brush_isqrt(rem);
+              }break;
+              case VOX_BrushShape_Cube: {
+                half = radius;
+              }break;
+              case VOX_BrushShape_Cylinder: {
+                S32 rem = radius_sq - dz*dz;
+                row_empty = (rem < 0);
+                half = row_empty ? 0 : vox_brush_isqrt(rem);
+              }break;
+              default: {}break;
+            }
+            if (row_empty) {
+              continue;
+            }
+            
+            S32 x0 = Max(center.x - half - base.x, lo.x);
+            S32 x1 = Min(center.x + half - base.x, hi.x);
+            if (x0 > x1) {
+              continue;
+            }
+            
+            if (brush->shape == VOX_BrushShape_Noise) {
+              // A sphere whose radius shrinks to half of the brush's where the
+              // noise is low
+              F32 noise[VOX_SLICE_SIZE];
+              vox_brush_noise_row(brush->seed, base.x + x0, base.x + x1, base.y + y, base.z + z, noise);
+              
+              S32 dist_sq_yz = dy*dy + dz*dz;
+              S32 run_first = -1;
+              for (S32 x = x0; x <= x1 + 1; x += 1) {
+                B32 inside = 0;
+                if (x <= x1) {
+                  S32 dx = base.x + x - center.x;
+                  F32 falloff = 0.5f + 0.5f*noise[x - x0];
+                  inside = ((F32)(dx*dx + dist_sq_yz) <= (F32)radius_sq*falloff*falloff);
+                }
+                if (inside && run_first < 0) {
+                  run_first = x;
+                }
+                else if (!inside && run_first >= 0) {
+                  result += vox_brush_span_apply(node, undo, brush, v3s32(run_first, y, z), x - run_first);
+                  run_first = -1;
+                }
+              }
+            }
+            else {
+              result += vox_brush_span_apply(node, undo, brush, v3s32(x0, y, z), x1 - x0 + 1);
+            }
+          }
+        }
+        
+        if (node->solid_count == 0) {
+          vox_world_chunk_release(world, node);
+        }
+      }
+    }
+  }
+  
+  if (implicit_stroke) {
+    vox_undo_end_stroke(undo, world);
+  }
+  
+  ProfEnd();
+  return result;
+}
+
+function VOX_Brush
+vox_brush_from_edit_state(VOX_EditState *edit)
+{
+  VOX_Brush brush = {};
+  brush.shape = edit->brush_shape;
+  brush.mode = edit->mode;
+  brush.radius = Clamp(edit->brush_size - 1, 0, VOX_BRUSH_RADIUS_MAX);
+  brush.spacing = VOX_BRUSH_DEFAULT_SPACING;
+  brush.voxel.opacity = 255;
+  brush.voxel.color = edit->brush_color;
+  brush.seed = 0x9E3779B9u;
+  return brush;
+}
+
+//
+// Strokes
+//
+
+function void
+vox_brush_stroke_begin(VOX_BrushStroke *stroke, VOX_World *world, VOX_UndoHistory *undo, VOX_Brush *brush, U32 merge_key)
+{
+  MemoryZeroStruct(stroke);
+  stroke->world = world;
+  stroke->undo = undo;
+  stroke->brush = *brush;
+  if (undo) {
+    vox_undo_begin_stroke(undo, merge_key);
+  }
+}
+
+function void
+vox_brush_stroke_to(VOX_BrushStroke *stroke, V3S32 voxel_coord)
+{
+  VOX_Brush *brush = &stroke->brush;
+  V3F32 target = v3f32((F32)voxel_coord.x, (F32)voxel_coord.y, (F32)voxel_coord.z);
+  
+  if (!stroke->has_last) {
+    stroke->voxels_count += vox_brush_stamp(stroke->world, stroke->undo, brush, voxel_coord);
+    stroke->stamps_count += 1;
+    stroke->last_stamp = target;
+    stroke->has_last = 1;
+  }
+  else {
+    // Stamps land every `step` along the path; what is left over carries into
+    // the next segment, so spacing doesn't depend on how often this is called.
+    F32 step = Max(1.f, brush->spacing*(F32)(2*Clamp(brush->radius, 0, VOX_BRUSH_RADIUS_MAX) + 1));
+    V3F32 delta = v3f32_sub(target, stroke->last_stamp);
+    F32 dist = v3f32_length(delta);
+    S32 steps = (S32)(dist / step);
+    for (S32 idx = 1; idx <= steps; idx += 1) {
+      V3F32 p = v3f32_add(stroke->last_stamp, v3f32_scale(delta, (F32)idx*step / dist));
+      V3S32 center = v3s32((S32)floorf32(p.x + 0.5f), (S32)floorf32(p.y + 0.5f), (S32)floorf32(p.z + 0.5f));
+      stroke->voxels_count += vox_brush_stamp(stroke->world, stroke->undo, brush, center);
+      stroke->stamps_count += 1;
+    }
+    if (steps > 0) {
+      stroke->last_stamp = v3f32_add(stroke->last_stamp, v3f32_scale(delta, (F32)steps*step / dist));
+    }
+  }
+}
+
+function void
+vox_brush_stroke_end(VOX_BrushStroke *stroke)
+{
+  if (stroke->undo) {
+    vox_undo_end_stroke(stroke->undo, stroke->world);
+  }
+}
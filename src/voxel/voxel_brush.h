@@ -0,0 +1,47 @@
+#pragma once
+
+// NOTE: Volumetric brush. A stamp rasterizes its shape one x-row at a time; the
+// part of a row that falls inside a chunk is a run of consecutive voxel indices,
+// so it is filled in one go, and occupancy, dirty bricks, solid counts and the
+// undo record are updated once per span instead of once per voxel. Noise brushes
+// split rows into several spans where the noise erodes them.
+//
+// A stroke places stamps along the path between the positions it is given,
+// `spacing` apart, so fast drags don't leave gaps between frames.
+
+#define VOX_BRUSH_RADIUS_MAX      64
+#define VOX_BRUSH_DEFAULT_SPACING 0.25f // Fraction of the diameter
+#define VOX_BRUSH_NOISE_CELL      4     // Lattice spacing of the noise, in voxels
+
+struct VOX_Brush {
+  VOX_BrushShape shape;
+  VOX_EditMode mode;
+  S32 radius;      // In voxels; 0 stamps a single voxel
+  F32 spacing;     // Distance between stamps along a stroke, as a fraction of the diameter
+  VOX_Voxel voxel; // Written by add; paint only takes its color
+  U32 seed;        // For VOX_BrushShape_Noise
+};
+
+struct VOX_BrushStroke {
+  VOX_World *world;
+  VOX_UndoHistory *undo;
+  VOX_Brush brush;
+  
+  B32 has_last;
+  V3F32 last_stamp;
+  
+  U64 stamps_count;
+  U64 voxels_count; // Voxels covered by all stamps so far
+};
+
+function VOX_Brush vox_brush_from_edit_state(VOX_EditState *edit);
+
+// Returns the number of voxels the stamp covered. `undo` may be 0; otherwise the
+// stamp is recorded into the active stroke, or becomes its own step.
+function U64 vox_brush_stamp(VOX_World *world, VOX_UndoHistory *undo, VOX_Brush *brush, V3S32 center);
+
+// A brush stroke is one undo step, merged with the previous stroke when both
+// share a non-zero `merge_key` (see voxel/voxel_undo.h). `undo` may be 0.
+function void vox_brush_stroke_begin(VOX_BrushStroke *stroke, VOX_World *world, VOX_UndoHistory *undo, VOX_Brush *brush, U32 merge_key);
+function void vox_brush_stroke_to(VOX_BrushStroke *stroke, V3S32 voxel_coord);
+function void vox_brush_stroke_end(VOX_BrushStroke *stroke);
@@ -0,0 +1,580 @@
+//
+// Classification
+//
+
+// Voxels between checks for a chunk that is none of the three
+#define VOX_CODEC_CLASSIFY_BLOCK 1024
+
+function VOX_ChunkClass
+vox_chunk_classify(VOX_Voxel *voxels)
+{
+  VOX_ChunkClass result = {0};
+  U32 *values = (U32 *)voxels;
+  
+#if VOX_CODEC_SSE2
+  __m128i first     = _mm_set1_epi32((int)values[0]);
+  __m128i opacities = _mm_set1_epi32(0xFF);
+  __m128i zero      = _mm_setzero_si128();
+  __m128i equal     = _mm_set1_epi32(-1); // Lanes that matched the first voxel every time
+  __m128i solid     = zero;               // Opacities ORed together
+  __m128i empty     = zero;               // Lanes that saw an opacity of 0
+  for (U32 block = 0; block < VOX_CHUNK_SIZE; block += VOX_CODEC_CLASSIFY_BLOCK) {
+    for (U32 idx = block; idx < block + VOX_CODEC_CLASSIFY_BLOCK; idx += 8) {
+      __m128i a = _mm_loadu_si128((__m128i *)(values + idx));
+      __m128i b = _mm_loadu_si128((__m128i *)(values + idx + 4));
+      __m128i oa = _mm_and_si128(a, opacities);
+      __m128i ob = _mm_and_si128(b, opacities);
+      equal = _mm_and_si128(equal, _mm_and_si128(_mm_cmpeq_epi32(a, first), _mm_cmpeq_epi32(b, first)));
+      solid = _mm_or_si128(solid, _mm_or_si128(oa, ob));
+      empty = _mm_or_si128(empty, _mm_or_si128(_mm_cmpeq_epi32(oa, zero), _mm_cmpeq_epi32(ob, zero)));
+    }
+    result.uniform   = (_mm_movemask_epi8(equal) == 0xFFFF);
+    result.all_empty = (_mm_movemask_epi8(_mm_cmpeq_epi32(solid, zero)) == 0xFFFF);
+    result.all_solid = (_mm_movemask_epi8(empty) == 0);
+    if (!result.uniform && !result.all_empty && !result.all_solid) {
+      break;
+    }
+  }
+#else
+  U32 differ = 0;
+  U32 solid = 0;
+  U32 empty = 0;
+  for (U32 block = 0; block < VOX_CHUNK_SIZE; block += VOX_CODEC_CLASSIFY_BLOCK) {
+    for (U32 idx = block; idx < block + VOX_CODEC_CLASSIFY_BLOCK; idx += 1) {
+      U32 opacity = values[idx] & 0xFF;
+      differ |= values[idx] ^ values[0];
+      solid |= opacity;
+      empty |= (opacity == 0);
+    }
+    result.uniform   = (differ == 0);
+    result.all_empty = (solid == 0);
+    result.all_solid = (empty == 0);
+    if (!result.uniform && !result.all_empty && !result.all_solid) {
+      break;
+    }
+  }
+#endif
+  
+  return result;
+}
+
+//
+// Rle
+//
+
+function U64
+vox_codec_rle_size(VOX_Voxel *voxels)
+{
+  U32 *values = (U32 *)voxels;
+  
+  // Every voxel that differs from the one before it starts a run
+  U32 runs = 1;
+  U32 idx = 1;
+#if VOX_CODEC_SSE2
+  // Counts matching neighbours: cmpeq lanes are -1 where they match
+  __m128i matches = _mm_setzero_si128();
+  for (; idx + 4 <= VOX_CHUNK_SIZE; idx += 4) {
+    __m128i v    = _mm_loadu_si128((__m128i *)(values + idx));
+    __m128i prev = _mm_loadu_si128((__m128i *)(values + idx - 1));
+    matches = _mm_sub_epi32(matches, _mm_cmpeq_epi32(v, prev));
+  }
+  U32 lanes[4];
+  _mm_storeu_si128((__m128i *)lanes, matches);
+  runs += (idx - 1) - (lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+#endif
+  for (; idx < VOX_CHUNK_SIZE; idx += 1) {
+    runs += (values[idx] != values[idx - 1]);
+  }
+  
+  U64 result = (U64)runs*(sizeof(U16) + sizeof(U32));
+  return result;
+}
+
+function U64
+vox_codec_rle_encode(VOX_Voxel *voxels, U8 *dst)
+{
+  U32 *values = (U32 *)voxels;
+  U64 at = 0;
+  for (U32 idx = 0; idx < VOX_CHUNK_SIZE;) {
+    U32 value = values[idx];
+    U32 run = 1;
+    while (idx + run < VOX_CHUNK_SIZE && values[idx + run] == value) {
+      run += 1;
+    }
+    
+    U16 run_minus_one = (U16)(run - 1);
+    MemoryCopy(dst + at, &run_minus_one, sizeof(run_minus_one));
+    MemoryCopy(dst + at + sizeof(U16), &value, sizeof(value));
+    at += sizeof(U16) + sizeof(U32);
+    idx += run;
+  }
+  return at;
+}
+
+function B32
+vox_codec_rle_decode(String8 payload, VOX_Voxel *voxels)
+{
+  U32 *values = (U32 *)voxels;
+  U32 idx = 0;
+  U64 at = 0;
+  B32 result = 1;
+  while (at + sizeof(U16) + sizeof(U32) <= payload.count) {
+    U16 run_minus_one = 0;
+    U32 value = 0;
+    MemoryCopy(&run_minus_one, payload.data + at, sizeof(run_minus_one));
+    MemoryCopy(&value, payload.data + at + sizeof(U16), sizeof(value));
+    at += sizeof(U16) + sizeof(U32);
+    
+    U32 run = (U32)run_minus_one + 1;
+    if (idx + run > VOX_CHUNK_SIZE) {
+      result = 0;
+      break;
+    }
+    for (U32 i = 0; i < run; i += 1) {
+      values[idx + i] = value;
+    }
+    idx += run;
+  }
+  result = result && (idx == VOX_CHUNK_SIZE) && (at == payload.count);
+  return result;
+}
+
+//
+// Byte planes
+//
+
+function void
+vox_codec_planes_from_voxels(U8 *planes, VOX_Voxel *voxels)
+{
+  U32 *values = (U32 *)voxels;
+  U32 idx = 0;
+#if VOX_CODEC_SSE2
+  __m128i low_byte = _mm_set1_epi32(0xFF);
+  for (; idx + 16 <= VOX_CHUNK_SIZE; idx += 16) {
+    __m128i v0 = _mm_loadu_si128((__m128i *)(values + idx));
+    __m128i v1 = _mm_loadu_si128((__m128i *)(values + idx + 4));
+    __m128i v2 = _mm_loadu_si128((__m128i *)(values + idx + 8));
+    __m128i v3 = _mm_loadu_si128((__m128i *)(values + idx + 12));
+    for (U32 plane = 0; plane < 4; plane += 1) {
+      // Byte `plane` of each voxel, narrowed 32 -> 16 -> 8 bits; the values fit,
+      // so the saturating packs never saturate
+      __m128i shift = _mm_cvtsi32_si128((int)(plane*8));
+      __m128i b0 = _mm_and_si128(_mm_srl_epi32(v0, shift), low_byte);
+      __m128i b1 = _mm_and_si128(_mm_srl_epi32(v1, shift), low_byte);
+      __m128i b2 = _mm_and_si128(_mm_srl_epi32(v2, shift), low_byte);
+      __m128i b3 = _mm_and_si128(_mm_srl_epi32(v3, shift), low_byte);
+      __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(b0, b1), _mm_packs_epi32(b2, b3));
+      _mm_storeu_si128((__m128i *)(planes + plane*VOX_CHUNK_SIZE + idx), bytes);
+    }
+  }
+#endif
+  for (; idx < VOX_CHUNK_SIZE; idx += 1) {
+    for (U32 plane = 0; plane < 4; plane += 1) {
+      planes[plane*VOX_CHUNK_SIZE + idx] = (U8)(values[idx] >> (plane*8));
+    }
+  }
+}
+
+function void
+vox_codec_voxels_from_planes(VOX_Voxel *voxels, U8 *planes)
+{
+  U32 *values = (U32 *)voxels;
+  U32 idx = 0;
+#if VOX_CODEC_SSE2
+  for (; idx + 16 <= VOX_CHUNK_SIZE; idx += 16) {
+    __m128i p0 = _mm_loadu_si128((__m128i *)(planes + 0*VOX_CHUNK_SIZE + idx));
+    __m128i p1 = _mm_loadu_si128((__m128i *)(planes + 1*VOX_CHUNK_SIZE + idx));
+    __m128i p2 = _mm_loadu_si128((__m128i *)(planes + 2*VOX_CHUNK_SIZE + idx));
+    __m128i p3 = _mm_loadu_si128((__m128i *)(planes + 3*VOX_CHUNK_SIZE + idx));
+    // (opacity, color) and (id0, id1) byte pairs, then the pairs interleaved
+    __m128i lo01 = _mm_unpacklo_epi8(p0, p1);
+    __m128i hi01 = _mm_unpackhi_epi8(p0, p1);
+    __m128i lo23 = _mm_unpacklo_epi8(p2, p3);
+    __m128i hi23 = _mm_unpackhi_epi8(p2, p3);
+    _mm_storeu_si128((__m128i *)(values + idx),      _mm_unpacklo_epi16(lo01, lo23));
+    _mm_storeu_si128((__m128i *)(values + idx + 4),  _mm_unpackhi_epi16(lo01, lo23));
+    _mm_storeu_si128((__m128i *)(values + idx + 8),  _mm_unpacklo_epi16(hi01, hi23));
+    _mm_storeu_si128((__m128i *)(values + idx + 12), _mm_unpackhi_epi16(hi01, hi23));
+  }
+#endif
+  for (; idx < VOX_CHUNK_SIZE; idx += 1) {
+    values[idx] = ((U32)planes[0*VOX_CHUNK_SIZE + idx] |
+                   ((U32)planes[1*VOX_CHUNK_SIZE + idx] << 8) |
+                   ((U32)planes[2*VOX_CHUNK_SIZE + idx] << 16) |
+                   ((U32)planes[3*VOX_CHUNK_SIZE + idx] << 24));
+  }
+}
+
+//
+// Lz
+//
+
+function U32
+vox_codec_lz_read_u32(U8 *p)
+{
+  U32 result = 0;
+  MemoryCopy(&result, p, sizeof(result));
+  return result;
+}
+
+function U32
+vox_codec_lz_hash(U32 sequence)
+{
+  U32 result = (sequence*2654435761u) >> (32 - VOX_CODEC_LZ_HASH_BITS);
+  return result;
+}
+
+// Bytes a length field takes past its nibble
+function U64
+vox_codec_lz_length_extra(U64 length)
+{
+  U64 result = (length >= 15) ? (length - 15)/255 + 1 : 0;
+  return result;
+}
+
+function void
+vox_codec_lz_put_length(U8 *dst, U64 *at, U64 length)
+{
+  if (length >= 15) {
+    length -= 15;
+    while (length >= 255) {
+      dst[(*at)++] = 255;
+      length -= 255;
+    }
+    dst[(*at)++] = (U8)length;
+  }
+}
+
+// A match length of 0 writes the last sequence, which has literals only.
+function B32
+vox_codec_lz_put_sequence(U8 *dst, U64 dst_cap, U64 *at, U8 *literals, U64 literals_count, U64 distance, U64 match_length)
+{
+  U64 match_code = match_length ? match_length - VOX_CODEC_LZ_MATCH_MIN : 0;
+  U64 size = (1 + vox_codec_lz_length_extra(literals_count) + literals_count +
+              (match_length ? sizeof(U16) + vox_codec_lz_length_extra(match_code) : 0));
+  B32 result = (size <= dst_cap - *at);
+  if (result) {
+    dst[(*at)++] = (U8)((Min(literals_count, 15) << 4) | Min(match_code, 15));
+    vox_codec_lz_put_length(dst, at, literals_count);
+    MemoryCopy(dst + *at, literals, literals_count);
+    *at += literals_count;
+    if (match_length) {
+      U16 distance16 = (U16)distance;
+      MemoryCopy(dst + *at, &distance16, sizeof(distance16));
+      *at += sizeof(distance16);
+      vox_codec_lz_put_length(dst, at, match_code);
+    }
+  }
+  return result;
+}
+
+function U64
+vox_codec_lz_encode(U8 *src, U64 size, U8 *dst, U64 dst_cap, U32 *table)
+{
+  MemoryZero(table, sizeof(U32)*VOX_CODEC_LZ_HASH_COUNT);
+  
+  // Matches start where 4 bytes can still be read
+  U64 search_opl = (size >= VOX_CODEC_LZ_MATCH_MIN) ? size - VOX_CODEC_LZ_MATCH_MIN + 1 : 0;
+  U64 at = 0;
+  U64 anchor = 0; // First byte not yet written out
+  U64 misses = 0;
+  B32 fits = 1;
+  for (U64 pos = 0; pos < search_opl && fits;) {
+    U32 sequence = vox_codec_lz_read_u32(src + pos);
+    U32 hash = vox_codec_lz_hash(sequence);
+    U64 candidate = table[hash];
+    table[hash] = (U32)pos;
+    
+    if (candidate < pos && pos - candidate <= VOX_CODEC_LZ_DISTANCE_MAX &&
+        vox_codec_lz_read_u32(src + candidate) == sequence) {
+      U64 length = VOX_CODEC_LZ_MATCH_MIN;
+      while (pos + length + 8 <= size) {
+        U64 a = 0, b = 0;
+        MemoryCopy(&a, src + pos + length, sizeof(a));
+        MemoryCopy(&b, src + candidate + length, sizeof(b));
+        if (a != b) {
+          break;
+        }
+        length += 8;
+      }
+      while (pos + length < size && src[pos + length] == src[candidate + length]) {
+        length += 1;
+      }
+      
+      fits = vox_codec_lz_put_sequence(dst, dst_cap, &at, src + anchor, pos - anchor, pos - candidate, length);
+      pos += length;
+      anchor = pos;
+      misses = 0;
+      
+      // Index a position near the end of the match, so the next one can continue from it
+      if (pos - 2 < search_opl) {
+        table[vox_codec_lz_hash(vox_codec_lz_read_u32(src + pos - 2))] = (U32)(pos - 2);
+      }
+    }
+    else {
+      // Step further the longer nothing matches, so incompressible data is given up on quickly
+      misses += 1;
+      pos += 1 + (misses >> 5);
+    }
+  }
+  
+  if (fits) {
+    fits = vox_codec_lz_put_sequence(dst, dst_cap, &at, src + anchor, size - anchor, 0, 0);
+  }
+  
+  U64 result = fits ? at : 0;
+  return result;
+}
+
+function B32
+vox_codec_lz_get_length(String8 payload, U64 *at, U64 *length)
+{
+  B32 result = 1;
+  if (*length == 15) {
+    for (;;) {
+      if (*at >= payload.count) {
+        result = 0;
+        break;
+      }
+      U8 byte = payload.data[(*at)++];
+      *length += byte;
+      if (byte < 255) {
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+function B32
+vox_codec_lz_decode(String8 payload, U8 *dst, U64 size)
+{
+  B32 result = 0;
+  U64 at = 0;
+  U64 out = 0;
+  for (;;) {
+    if (at >= payload.count) {
+      break;
+    }
+    U8 token = payload.data[at++];
+    
+    U64 literals_count = token >> 4;
+    if (!vox_codec_lz_get_length(payload, &at, &literals_count) ||
+        literals_count > payload.count - at || literals_count > size - out) {
+      break;
+    }
+    MemoryCopy(dst + out, payload.data + at, literals_count);
+    at += literals_count;
+    out += literals_count;
+    
+    if (at == payload.count) {
+      result = (out == size);
+      break;
+    }
+    
+    if (sizeof(U16) > payload.count - at) {
+      break;
+    }
+    U16 distance = 0;
+    MemoryCopy(&distance, payload.data + at, sizeof(distance));
+    at += sizeof(distance);
+    U64 length = token & 15;
+    if (!vox_codec_lz_get_length(payload, &at, &length)) {
+      break;
+    }
+    length += VOX_CODEC_LZ_MATCH_MIN;
+    if (distance == 0 || distance > out || length > size - out) {
+      break;
+    }
+    
+    // Matches may overlap what they copy. From 16 bytes back, whole 16-byte blocks
+    // only read bytes already written, and the last block runs into the slack.
+    // Closer than that the match repeats a pattern of `distance` bytes, which is
+    // copied from as far back as the bytes already written allow, so each copy
+    // doubles the next.
+    U8 *to = dst + out;
+    if (distance >= 16) {
+      for (U64 idx = 0; idx < length; idx += 16) {
+        MemoryCopy(to + idx, to + idx - distance, 16);
+      }
+    }
+    else if (distance == 1) {
+      MemorySet(to, to[-1], length);
+    }
+    else {
+      for (U64 copied = 0; copied < length;) {
+        U64 back = (copied/distance + 1)*distance;
+        U64 count = Min(back, length - copied);
+        MemoryCopy(to + copied, to + copied - back, count);
+        copied += count;
+      }
+    }
+    out += length;
+  }
+  return result;
+}
+
+//
+// Chunks
+//
+
+function U64
+vox_chunk_encode(VOX_Voxel *voxels, U8 *dst, VOX_ChunkCodec *codec_out)
+{
+  U64 result = 0;
+  
+  VOX_ChunkClass chunk_class = vox_chunk_classify(voxels);
+  U64 rle_size = chunk_class.uniform ? 0 : vox_codec_rle_size(voxels);
+  
+  if (chunk_class.uniform) {
+    *codec_out = VOX_ChunkCodec_Uniform;
+    MemoryCopy(dst, voxels, sizeof(VOX_Voxel));
+    result = sizeof(VOX_Voxel);
+  }
+  else if (rle_size <= VOX_CODEC_RLE_SIZE_MAX) {
+    *codec_out = VOX_ChunkCodec_Rle;
+    result = vox_codec_rle_encode(voxels, dst);
+  }
+  else {
+    TempArena scratch = arena_scratch_begin(0, 0);
+    U8 *planes = ArenaPushArray(scratch.arena, U8, sizeof(VOX_Chunk));
+    U32 *table = ArenaPushArray(scratch.arena, U32, VOX_CODEC_LZ_HASH_COUNT);
+    vox_codec_planes_from_voxels(planes, voxels);
+    
+    // Only worth it if it beats Rle as well as Raw
+    U64 lz_cap = Min(rle_size, sizeof(VOX_Chunk)) - 1;
+    U64 lz_size = vox_codec_lz_encode(planes, sizeof(VOX_Chunk), dst, lz_cap, table);
+    if (lz_size) {
+      *codec_out = VOX_ChunkCodec_Lz;
+      result = lz_size;
+    }
+    else if (rle_size < sizeof(VOX_Chunk)) {
+      *codec_out = VOX_ChunkCodec_Rle;
+      result = vox_codec_rle_encode(voxels, dst);
+    }
+    else {
+      *codec_out = VOX_ChunkCodec_Raw;
+      MemoryCopy(dst, voxels, sizeof(VOX_Chunk));
+      result = sizeof(VOX_Chunk);
+    }
+    
+    arena_scratch_end(scratch);
+  }
+  
+  return result;
+}
+
+function B32
+vox_chunk_decode(VOX_ChunkCodec codec, String8 payload, VOX_Voxel *voxels)
+{
+  B32 result = 0;
+  
+  switch (codec) {
+    case VOX_ChunkCodec_Raw: {
+      if (payload.count == sizeof(VOX_Chunk)) {
+        MemoryCopy(voxels, payload.data, sizeof(VOX_Chunk));
+        result = 1;
+      }
+    }break;
+    
+    case VOX_ChunkCodec_Rle: {
+      result = vox_codec_rle_decode(payload, voxels);
+    }break;
+    
+    case VOX_ChunkCodec_Uniform: {
+      if (payload.count == sizeof(VOX_Voxel)) {
+        U32 value = vox_codec_lz_read_u32(payload.data);
+        U32 *values = (U32 *)voxels;
+        for (U32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+          values[idx] = value;
+        }
+        result = 1;
+      }
+    }break;
+    
+    case VOX_ChunkCodec_Lz: {
+      TempArena scratch = arena_scratch_begin(0, 0);
+      U8 *planes = ArenaPushArray(scratch.arena, U8, sizeof(VOX_Chunk) + VOX_CODEC_LZ_SLACK);
+      result = vox_codec_lz_decode(payload, planes, sizeof(VOX_Chunk));
+      if (result) {
+        vox_codec_voxels_from_planes(voxels, planes);
+      }
+      arena_scratch_end(scratch);
+    }break;
+    
+    default: {}break;
+  }
+  
+  return result;
+}
+
+//
+// Streams
+//
+
+function VOX_CodecWriter
+vox_codec_writer_begin(Arena *arena)
+{
+  VOX_CodecWriter writer = {0};
+  writer.arena = arena;
+  writer.first = (U8 *)arena_push_nozero(arena, 0);
+  return writer;
+}
+
+function void
+vox_codec_writer_push(VOX_CodecWriter *writer, VOX_Voxel *voxels)
+{
+  // Room for the worst case, given back once the payload's size is known
+  U8 *record = (U8 *)arena_push_nozero(writer->arena, sizeof(VOX_CodecChunkHeader) + sizeof(VOX_Chunk));
+  Assert(record == writer->first + writer->size);
+  
+  VOX_ChunkCodec codec = VOX_ChunkCodec_Raw;
+  U64 payload_size = vox_chunk_encode(voxels, record + sizeof(VOX_CodecChunkHeader), &codec);
+  
+  VOX_CodecChunkHeader header = {0};
+  header.codec = codec;
+  header.size = (U32)payload_size;
+  MemoryCopy(record, &header, sizeof(header));
+  
+  U64 record_size = sizeof(VOX_CodecChunkHeader) + AlignPow2(payload_size, 8);
+  U64 record_pos = (U64)(record - (U8 *)writer->arena);
+  arena_pop_to(writer->arena, record_pos + record_size);
+  writer->size += record_size;
+  writer->chunks_count += 1;
+}
+
+function String8
+vox_codec_writer_end(VOX_CodecWriter *writer)
+{
+  String8 result = str8(writer->first, writer->size);
+  return result;
+}
+
+function VOX_CodecReader
+vox_codec_reader_begin(String8 data)
+{
+  VOX_CodecReader reader = {0};
+  reader.data = data;
+  return reader;
+}
+
+function B32
+vox_codec_reader_next(VOX_CodecReader *reader, VOX_Voxel *voxels)
+{
+  B32 result = 0;
+  
+  VOX_CodecChunkHeader header = {0};
+  if (str8_read(&header, reader->data, reader->off, sizeof(header))) {
+    U64 payload_off = reader->off + sizeof(header);
+    U64 record_size = sizeof(header) + AlignPow2((U64)header.size, 8);
+    if (header.codec < VOX_ChunkCodec_COUNT && record_size <= reader->data.count - reader->off) {
+      String8 payload = str8(reader->data.data + payload_off, header.size);
+      result = vox_chunk_decode((VOX_ChunkCodec)header.codec, payload, voxels);
+      if (result) {
+        reader->off += record_size;
+      }
+    }
+  }
+  
+  return result;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+// NOTE: Chunk codec, for anything that stores or moves chunks: scene files, and
+// snapshots or transfers of chunks. A chunk is 128 KiB raw. The encoder picks,
+// per chunk:
+//
+//   Uniform  every voxel is the same, as in empty and fully solid chunks: 4 B
+//   Rle      runs of equal voxels: (U16 run - 1, U32 voxel) per run
+//   Lz       chunks with too many runs: the voxels split into byte planes (every
+//            opacity, then every color, id0 and id1), which compress far better
+//            than interleaved voxels, then LZ77-compressed
+//   Raw      the voxels as they are, when nothing else is smaller
+//
+// Uniform chunks are caught by one SIMD compare pass (vox_chunk_classify), which
+// also tells whether every voxel is empty or solid. Rle is taken without trying
+// Lz while its runs fit in VOX_CODEC_RLE_SIZE_MAX bytes; past that, whichever of
+// the two is smaller wins.
+//
+// Lz is a sequence of LZ4-style matches. A token byte holds the literal count in
+// its high nibble and the match length minus 4 in its low one (15 means more
+// length bytes follow, each added to it, until one is below 255). The literals
+// come next, then the U16 distance back to the match. The last sequence ends
+// after its literals.
+//
+// Voxels are encoded in whatever order they are given; scene files hand them over
+// in linear order, and in-memory streams may keep the chunk layout's order.
+
+#define VOX_CODEC_RLE_SIZE_MAX (sizeof(VOX_Chunk) / 32)
+
+#define VOX_CODEC_LZ_MATCH_MIN    4
+#define VOX_CODEC_LZ_DISTANCE_MAX 0xFFFF
+#define VOX_CODEC_LZ_HASH_BITS    14
+#define VOX_CODEC_LZ_HASH_COUNT   (1 << VOX_CODEC_LZ_HASH_BITS)
+// Match copies go 16 bytes at a time, so the decoder's output has room for that
+// much past its end.
+#define VOX_CODEC_LZ_SLACK        16
+
+#if (ARCH_X64 || ARCH_X86) && (COMPILER_MSVC || defined(__SSE2__))
+# define VOX_CODEC_SSE2 1
+# include <emmintrin.h>
+#else
+# define VOX_CODEC_SSE2 0
+#endif
+
+// The values are stored in scene files (see VOX_SceneCodec).
+enum VOX_ChunkCodec {
+  VOX_ChunkCodec_Raw,
+  VOX_ChunkCodec_Rle,
+  VOX_ChunkCodec_Uniform,
+  VOX_ChunkCodec_Lz,
+  VOX_ChunkCodec_COUNT,
+};
+
+struct VOX_ChunkClass {
+  B32 uniform;   // Every voxel equals the first
+  B32 all_empty; // Every opacity is 0
+  B32 all_solid; // No opacity is 0
+};
+
+// One pass over VOX_CHUNK_SIZE voxels. Stops early once the chunk is known to be
+// none of the three.
+function VOX_ChunkClass vox_chunk_classify(VOX_Voxel *voxels);
+
+// Encodes VOX_CHUNK_SIZE voxels into `dst`, which must hold sizeof(VOX_Chunk)
+// bytes, and returns the payload size.
+function U64 vox_chunk_encode(VOX_Voxel *voxels, U8 *dst, VOX_ChunkCodec *codec_out);
+// Returns 0 if the payload is corrupt; `voxels` is then partly written.
+function B32 vox_chunk_decode(VOX_ChunkCodec codec, String8 payload, VOX_Voxel *voxels);
+
+//
+// Codec parts
+//
+
+// Payload size of the voxels as Rle
+function U64 vox_codec_rle_size(VOX_Voxel *voxels);
+
+// Splits voxels into 4 planes of VOX_CHUNK_SIZE bytes, and back.
+function void vox_codec_planes_from_voxels(U8 *planes, VOX_Voxel *voxels);
+function void vox_codec_voxels_from_planes(VOX_Voxel *voxels, U8 *planes);
+
+// Returns the compressed size, or 0 if it would not fit in `dst_cap` bytes.
+// `table` holds VOX_CODEC_LZ_HASH_COUNT entries.
+function U64 vox_codec_lz_encode(U8 *src, U64 size, U8 *dst, U64 dst_cap, U32 *table);
+// `dst` holds `size` bytes plus VOX_CODEC_LZ_SLACK. Returns 0 unless the payload
+// decodes to exactly `size` bytes.
+function B32 vox_codec_lz_decode(String8 payload, U8 *dst, U64 size);
+
+//
+// Streams
+//
+
+// Every chunk of a stream is a header, then the payload padded to 8 bytes so the
+// next header stays aligned.
+struct VOX_CodecChunkHeader {
+  U32 codec;
+  U32 size;
+};
+
+// Pushes encoded chunks onto the arena one after the other, so the whole stream
+// is one buffer. Nothing else may be pushed onto the arena until the end.
+struct VOX_CodecWriter {
+  Arena *arena;
+  U8 *first;
+  U64 size;
+  U32 chunks_count;
+};
+
+struct VOX_CodecReader {
+  String8 data;
+  U64 off;
+};
+
+function VOX_CodecWriter vox_codec_writer_begin(Arena *arena);
+function void vox_codec_writer_push(VOX_CodecWriter *writer, VOX_Voxel *voxels);
+function String8 vox_codec_writer_end(VOX_CodecWriter *writer);
+
+function VOX_CodecReader vox_codec_reader_begin(String8 data);
+// Decodes the next chunk. Returns 0 at the end of the stream or when it is corrupt.
+function B32 vox_codec_reader_next(VOX_CodecReader *reader, VOX_Voxel *voxels);
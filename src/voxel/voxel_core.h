@@ -3,8 +3,47 @@
 // @Todo: Why make these static? Just pass them to init and allow chunk size (slice size)
 // to be changed.
 #define VOX_SLICE_SIZE (32)
+#define VOX_SLICE_SIZE_LOG2 (5)
 #define VOX_CHUNK_SIZE (VOX_SLICE_SIZE * VOX_SLICE_SIZE * VOX_SLICE_SIZE)
 
+// NOTE: Order of the voxels within a chunk, picked at build time by defining
+// VOX_CHUNK_LAYOUT (build.sh/build.bat take `morton` or `bricks`).
+//
+//   LINEAR  x + y*32 + z*32^2, which is also the order of the GPU's 3D textures
+//           and of scene files
+//   MORTON  Z-order curve: the bits of x, y and z interleaved, x lowest
+//   BRICKS  4^3 bricks in the occupancy's brick order, 64 voxels each in the
+//           order of the brick's occupancy bits
+//
+// Linear rows are 128 B apart in y and 4 KiB apart in z, so neighborhood queries
+// (ambient occlusion, brushes, downsampling) touch a cache line per row. The
+// other two layouts keep a small cube of voxels within a few lines.
+//
+// Only vox_idx_from_local_coord and vox_local_coord_from_idx know the layout.
+// Code that walks voxels along x through memory goes a run at a time (see
+// vox_idx_run_from_local_coord), and code that hands voxels to the GPU or to a
+// file converts to linear order first.
+#define VOX_CHUNK_LAYOUT_LINEAR 0
+#define VOX_CHUNK_LAYOUT_MORTON 1
+#define VOX_CHUNK_LAYOUT_BRICKS 2
+
+#if !defined(VOX_CHUNK_LAYOUT)
+# define VOX_CHUNK_LAYOUT VOX_CHUNK_LAYOUT_LINEAR
+#endif
+
+#if VOX_CHUNK_LAYOUT != VOX_CHUNK_LAYOUT_LINEAR && VOX_SLICE_SIZE != 32
+# error "The Morton and brick layouts are written for 32^3 chunks"
+#endif
+
+// Morton codes are one pdep/pext per axis where the build targets BMI2 (MSVC has
+// no BMI2 switch, but every AVX2 CPU has it), and table lookups otherwise.
+#if ARCH_X64 && (defined(__BMI2__) || (COMPILER_MSVC && defined(__AVX2__)))
+# define VOX_MORTON_BMI2 1
+# include <immintrin.h>
+#else
+# define VOX_MORTON_BMI2 0
+#endif
+
 // @Todo: Can pack into single U8
 struct VOX_Voxel {
   U8 opacity;
@@ -17,6 +56,21 @@ struct VOX_Chunk {
   VOX_Voxel voxels[VOX_CHUNK_SIZE];
 };
 
+// NOTE: Mirrors the PerFrameData constant buffer in shaders/fullscreen.hlsl.
+// Shared by the D3D11 renderer and the CPU reference renderer.
+struct VOX_UniformData {
+  // @Todo: fov, view angle instead of view, orbit radius/distance, view height (ray_y)
+  V2F32 client_size;
+  F32 pad0[2];
+  V2F32 view; 
+  F32 pad1[2];
+  V4F32 mouse; // x-position, y-position, left btn (0/1), right btn (0/1)
+  F32 zoom = 1;
+  F32 time;
+  F32 lod_bias; // Added to log2 of a ray's footprint when picking an LOD level (see voxel_lod.h)
+  F32 pad3;
+};
+
 enum VOX_Key {
   VOX_Key_Null,
   VOX_Key_Esc,
@@ -80,16 +134,30 @@ struct VOX_Input {
 enum VOX_EditMode {
   VOX_EditMode_Delete,
   VOX_EditMode_Add,
+  VOX_EditMode_Paint, // Recolors solid voxels, leaves empty ones alone
+};
+
+enum VOX_BrushShape {
+  VOX_BrushShape_Sphere,
+  VOX_BrushShape_Cube,
+  VOX_BrushShape_Cylinder, // Upright, as tall as it is wide
+  VOX_BrushShape_Noise,    // Sphere whose surface is eroded by 3D noise
+  VOX_BrushShape_COUNT,
 };
 
 struct VOX_EditState {
-  S32 selected_voxel_idx = -1;  
-  S32 nearest_empty_voxel_idx = -1;
+  B32 has_selected_voxel;
+  V3S32 selected_voxel;
+  V3S32 nearest_empty_voxel;
   S32 brush_size = 1;
 	VOX_EditMode mode;
+  VOX_BrushShape brush_shape;
+  U8 brush_color;
 };
 
 function VOX_Voxel *vox_get_voxel(VOX_Chunk *chunk, S32 idx);
+function U32 vox_u32_from_voxel(VOX_Voxel voxel);
+function B32 vox_voxel_equal(VOX_Voxel a, VOX_Voxel b);
 
 function B32 vox_key_pressed(VOX_Input *input, VOX_Key key);
 function B32 vox_key_down(VOX_Input *input, VOX_Key key);
@@ -0,0 +1,425 @@
+//
+// SDF primitives
+//
+
+function F32
+vox_sdf_distance(VOX_Sdf *sdf, V3F32 p)
+{
+  F32 result = 0;
+  
+  switch (sdf->kind) {
+    case VOX_SdfKind_Sphere: {
+      result = v3f32_length(p) - sdf->radius;
+    }break;
+    case VOX_SdfKind_Box: {
+      V3F32 q = v3f32(absf32(p.x) - sdf->half_size.x, absf32(p.y) - sdf->half_size.y, absf32(p.z) - sdf->half_size.z);
+      V3F32 outside = v3f32(Max(q.x, 0.f), Max(q.y, 0.f), Max(q.z, 0.f));
+      result = v3f32_length(outside) + Min(Max(q.x, Max(q.y, q.z)), 0.f);
+    }break;
+    case VOX_SdfKind_Cylinder: {
+      F32 dr = sqrtf32(p.x*p.x + p.z*p.z) - sdf->radius;
+      F32 dy = absf32(p.y) - sdf->half_size.y;
+      F32 out_r = Max(dr, 0.f);
+      F32 out_y = Max(dy, 0.f);
+      result = sqrtf32(out_r*out_r + out_y*out_y) + Min(Max(dr, dy), 0.f);
+    }break;
+    default: {}break;
+  }
+  
+  return result;
+}
+
+// Voxels whose centers may be inside the primitive, inclusive.
+function void
+vox_sdf_voxel_bounds(VOX_Sdf *sdf, V3S32 *min_out, V3S32 *max_out)
+{
+  V3F32 extent = {0};
+  switch (sdf->kind) {
+    case VOX_SdfKind_Sphere:   { extent = v3f32(sdf->radius, sdf->radius, sdf->radius);       }break;
+    case VOX_SdfKind_Box:      { extent = sdf->half_size;                                      }break;
+    case VOX_SdfKind_Cylinder: { extent = v3f32(sdf->radius, sdf->half_size.y, sdf->radius);  }break;
+    default: {}break;
+  }
+  
+  V3F32 min = v3f32_sub(sdf->center, extent);
+  V3F32 max = v3f32_add(sdf->center, extent);
+  *min_out = v3s32((S32)floorf32(min.x - 0.5f), (S32)floorf32(min.y - 0.5f), (S32)floorf32(min.z - 0.5f));
+  *max_out = v3s32((S32)ceilf32(max.x - 0.5f), (S32)ceilf32(max.y - 0.5f), (S32)ceilf32(max.z - 0.5f));
+}
+
+//
+// Jobs
+//
+
+function void
+vox_csg_world_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_CsgWork *work = (VOX_CsgWork *)user;
+  
+  for (U64 job_idx = first; job_idx < opl; job_idx += 1) {
+    VOX_CsgJob *job = &work->jobs[job_idx];
+    VOX_ChunkNode *node = job->node;
+    V3S32 base = v3s32_scale(node->coord, VOX_SLICE_SIZE);
+    VOX_Voxel empty = {0};
+    B32 changed = 0;
+    
+    // Intersection keeps the voxels some source chunk covers with solid ones
+    TempArena temp = arena_temp_begin(scratch);
+    U64 *keep = 0;
+    if (work->op == VOX_CsgOp_Intersect) {
+      keep = ArenaPushArray(temp.arena, U64, VOX_CHUNK_SIZE / 64);
+    }
+    
+    for (U32 src_idx = 0; src_idx < job->src_count; src_idx += 1) {
+      VOX_ChunkNode *src = job->src[src_idx];
+      
+      // The source chunk's origin and overlap, in destination local coordinates
+      V3S32 src_base = v3s32_sub(v3s32_add(v3s32_scale(src->coord, VOX_SLICE_SIZE), work->offset), base);
+      V3S32 lo = v3s32(Max(src_base.x, 0), Max(src_base.y, 0), Max(src_base.z, 0));
+      V3S32 hi = v3s32(Min(src_base.x + VOX_SLICE_SIZE - 1, VOX_SLICE_SIZE - 1),
+                       Min(src_base.y + VOX_SLICE_SIZE - 1, VOX_SLICE_SIZE - 1),
+                       Min(src_base.z + VOX_SLICE_SIZE - 1, VOX_SLICE_SIZE - 1));
+      
+      for (S32 z = lo.z; z <= hi.z; z += 1) {
+        for (S32 y = lo.y; y <= hi.y; y += 1) {
+          // Runs that are consecutive in memory in both chunks (see VOX_CHUNK_LAYOUT)
+          for (S32 x = lo.x, count = 0; x <= hi.x; x += count) {
+            V3S32 dst_coord = v3s32(x, y, z);
+            V3S32 src_coord = v3s32(x - src_base.x, y - src_base.y, z - src_base.z);
+            count = vox_idx_run_from_local_coord(dst_coord, hi.x - x + 1);
+            count = vox_idx_run_from_local_coord(src_coord, count);
+            S32 dst_first = vox_idx_from_local_coord(dst_coord);
+            S32 src_first = vox_idx_from_local_coord(src_coord);
+            VOX_Voxel *d = &node->chunk.voxels[dst_first];
+            VOX_Voxel *s = &src->chunk.voxels[src_first];
+            
+            switch (work->op) {
+              // Only bricks with a voxel that changed are marked dirty
+              case VOX_CsgOp_Union: {
+                for (S32 idx = 0; idx < count; idx += 1) {
+                  if (s[idx].opacity > 0 && !vox_voxel_equal(d[idx], s[idx])) {
+                    d[idx] = s[idx];
+                    vox_dirty_bricks_mark(node->dirty_bricks, v3s32(x + idx, y, z));
+                    changed = 1;
+                  }
+                }
+              }break;
+              case VOX_CsgOp_Subtract: {
+                for (S32 idx = 0; idx < count; idx += 1) {
+                  if (s[idx].opacity > 0 && !vox_voxel_equal(d[idx], empty)) {
+                    d[idx] = empty;
+                    vox_dirty_bricks_mark(node->dirty_bricks, v3s32(x + idx, y, z));
+                    changed = 1;
+                  }
+                }
+              }break;
+              case VOX_CsgOp_Intersect: {
+                for (S32 idx = 0; idx < count; idx += 1) {
+                  U32 bit_idx = (U32)(dst_first + idx);
+                  keep[bit_idx / 64] |= (U64)(s[idx].opacity > 0) << (bit_idx % 64);
+                }
+              }break;
+              default: {}break;
+            }
+          }
+        }
+      }
+    }
+    
+    if (keep) {
+      for (U32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+        VOX_Voxel *v = &node->chunk.voxels[idx];
+        if (v->opacity > 0 && !((keep[idx / 64] >> (idx % 64)) & 1)) {
+          MemoryZeroStruct(v);
+          vox_dirty_bricks_mark(node->dirty_bricks, vox_local_coord_from_idx((S32)idx));
+          changed = 1;
+        }
+      }
+    }
+    arena_temp_end(temp);
+    
+    if (changed) {
+      node->solid_count = vox_occupancy_build(&node->occupancy, &node->chunk);
+    }
+  }
+}
+
+function void
+vox_csg_sdf_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_CsgWork *work = (VOX_CsgWork *)user;
+  VOX_Sdf *sdf = work->sdf;
+  VOX_Voxel empty = {0};
+  
+  // Distance from a brick's center to its farthest voxel center
+  F32 brick_bound = 1.5f*sqrtf32(3.f);
+  
+  for (U64 job_idx = first; job_idx < opl; job_idx += 1) {
+    VOX_ChunkNode *node = work->jobs[job_idx].node;
+    V3S32 base = v3s32_scale(node->coord, VOX_SLICE_SIZE);
+    V3F32 origin = v3f32_sub(v3f32((F32)base.x + 0.5f, (F32)base.y + 0.5f, (F32)base.z + 0.5f), sdf->center);
+    B32 changed = 0;
+    
+    for (S32 brick_idx = 0; brick_idx < VOX_BRICKS_PER_CHUNK; brick_idx += 1) {
+      // Nothing to clear in an empty brick
+      if (work->op != VOX_CsgOp_Union && node->occupancy.bricks[brick_idx] == 0) {
+        continue;
+      }
+      
+      V3S32 brick_min = v3s32_scale(v3s32(brick_idx % VOX_BRICKS_PER_SLICE,
+                                          (brick_idx / VOX_BRICKS_PER_SLICE) % VOX_BRICKS_PER_SLICE,
+                                          brick_idx / (VOX_BRICKS_PER_SLICE*VOX_BRICKS_PER_SLICE)), VOX_BRICK_SIZE);
+      F32 half_brick = 0.5f*(VOX_BRICK_SIZE - 1);
+      V3F32 brick_center = v3f32_add(origin, v3f32(brick_min.x + half_brick, brick_min.y + half_brick, brick_min.z + half_brick));
+      F32 center_dist = vox_sdf_distance(sdf, brick_center);
+      
+      // 0: outside, 1: inside, 2: per voxel
+      U32 coverage = 2;
+      if (center_dist > brick_bound) {
+        coverage = 0;
+      }
+      else if (center_dist < -brick_bound) {
+        coverage = 1;
+      }
+      
+      // Settled bricks the operation leaves alone
+      if ((coverage == 0 && work->op != VOX_CsgOp_Intersect) || (coverage == 1 && work->op == VOX_CsgOp_Intersect)) {
+        continue;
+      }
+      
+      B32 brick_changed = 0;
+      for (S32 z = brick_min.z; z < brick_min.z + VOX_BRICK_SIZE; z += 1) {
+        for (S32 y = brick_min.y; y < brick_min.y + VOX_BRICK_SIZE; y += 1) {
+          for (S32 x = brick_min.x; x < brick_min.x + VOX_BRICK_SIZE; x += 1) {
+            B32 inside = (coverage == 1);
+            if (coverage == 2) {
+              inside = (vox_sdf_distance(sdf, v3f32_add(origin, v3f32((F32)x, (F32)y, (F32)z))) <= 0.f);
+            }
+            
+            VOX_Voxel *v = &node->chunk.voxels[vox_idx_from_local_coord(v3s32(x, y, z))];
+            VOX_Voxel result = *v;
+            switch (work->op) {
+              case VOX_CsgOp_Union:     { if (inside)                    { result = sdf->voxel; } }break;
+              case VOX_CsgOp_Subtract:  { if (inside)                    { result = empty;      } }break;
+              case VOX_CsgOp_Intersect: { if (!inside && v->opacity > 0) { result = empty;      } }break;
+              default: {}break;
+            }
+            if (!vox_voxel_equal(result, *v)) {
+              *v = result;
+              brick_changed = 1;
+            }
+          }
+        }
+      }
+      
+      if (brick_changed) {
+        vox_dirty_bricks_mark(node->dirty_bricks, brick_min);
+        changed = 1;
+      }
+    }
+    
+    if (changed) {
+      node->solid_count = vox_occupancy_build(&node->occupancy, &node->chunk);
+    }
+  }
+}
+
+//
+// Operations
+//
+
+// Finds the source chunks overlapping a destination chunk. With an offset that
+// isn't chunk-aligned a destination chunk straddles up to 8 of them.
+function void
+vox_csg_job_find_sources(VOX_CsgJob *job, VOX_World *src, V3S32 offset)
+{
+  V3S32 min = v3s32_sub(v3s32_scale(job->node->coord, VOX_SLICE_SIZE), offset);
+  V3S32 max = v3s32_add(min, v3s32(VOX_SLICE_SIZE - 1, VOX_SLICE_SIZE - 1, VOX_SLICE_SIZE - 1));
+  V3S32 chunk_min = vox_chunk_coord_from_voxel_coord(min);
+  V3S32 chunk_max = vox_chunk_coord_from_voxel_coord(max);
+  
+  job->src_count = 0;
+  for (S32 z = chunk_min.z; z <= chunk_max.z; z += 1) {
+    for (S32 y = chunk_min.y; y <= chunk_max.y; y += 1) {
+      for (S32 x = chunk_min.x; x <= chunk_max.x; x += 1) {
+        VOX_ChunkNode *node = vox_world_chunk_from_coord(src, v3s32(x, y, z));
+        if (node) {
+          job->src[job->src_count++] = node;
+        }
+      }
+    }
+  }
+}
+
+function void
+vox_csg_touch_undo(VOX_UndoHistory *undo, VOX_ChunkNode *node)
+{
+  if (undo) {
+    vox_undo_touch_span(undo, node->coord, &node->chunk, 0, VOX_CHUNK_SIZE);
+  }
+}
+
+function U32
+vox_csg_world(VOX_World *dst, VOX_UndoHistory *undo, VOX_World *src, V3S32 offset, VOX_CsgOp op)
+{
+  ProfBegin("vox_csg_world");
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  B32 implicit_stroke = (undo && !undo->stroke_active);
+  if (implicit_stroke) {
+    vox_undo_begin_stroke(undo, 0);
+  }
+  
+  // Union creates destination chunks wherever a source chunk lands; the others
+  // only change chunks that already exist.
+  U32 jobs_cap = (op == VOX_CsgOp_Union) ? src->chunks_count*VOX_CSG_SRC_MAX : dst->chunks_count;
+  VOX_CsgJob *jobs = ArenaPushArray(scratch.arena, VOX_CsgJob, jobs_cap);
+  U32 jobs_count = 0;
+  
+  if (op == VOX_CsgOp_Union) {
+    // Open-addressed set of the destination chunks already queued
+    U32 set_cap = 16;
+    while (set_cap < jobs_cap*2) {
+      set_cap *= 2;
+    }
+    VOX_ChunkNode **set = ArenaPushArray(scratch.arena, VOX_ChunkNode *, set_cap);
+    
+    for (VOX_ChunkNode *s = src->first; s != 0; s = s->next) {
+      V3S32 min = v3s32_add(v3s32_scale(s->coord, VOX_SLICE_SIZE), offset);
+      V3S32 max = v3s32_add(min, v3s32(VOX_SLICE_SIZE - 1, VOX_SLICE_SIZE - 1, VOX_SLICE_SIZE - 1));
+      V3S32 chunk_min = vox_chunk_coord_from_voxel_coord(min);
+      V3S32 chunk_max = vox_chunk_coord_from_voxel_coord(max);
+      for (S32 z = chunk_min.z; z <= chunk_max.z; z += 1) {
+        for (S32 y = chunk_min.y; y <= chunk_max.y; y += 1) {
+          for (S32 x = chunk_min.x; x <= chunk_max.x; x += 1) {
+            VOX_ChunkNode *node = vox_world_chunk_acquire(dst, v3s32(x, y, z));
+            U32 slot = (U32)vox_hash_from_chunk_coord(node->coord) & (set_cap - 1);
+            while (set[slot] && set[slot] != node) {
+              slot = (slot + 1) & (set_cap - 1);
+            }
+            if (!set[slot]) {
+              set[slot] = node;
+              jobs[jobs_count++].node = node;
+            }
+          }
+        }
+      }
+    }
+  }
+  else {
+    for (VOX_ChunkNode *n = dst->first; n != 0; n = n->next) {
+      jobs[jobs_count++].node = n;
+    }
+  }
+  
+  // Pair chunks up. Destination chunks with no source chunk are untouched by
+  // union and subtract, and emptied outright by intersect.
+  U32 kept_count = 0;
+  for (U32 idx = 0; idx < jobs_count; idx += 1) {
+    VOX_CsgJob job = jobs[idx];
+    vox_csg_job_find_sources(&job, src, offset);
+    if (job.src_count > 0) {
+      vox_csg_touch_undo(undo, job.node);
+      jobs[kept_count++] = job;
+    }
+    else if (op == VOX_CsgOp_Intersect) {
+      vox_csg_touch_undo(undo, job.node);
+      job.node->solid_count = 0;
+    }
+  }
+  
+  VOX_CsgWork work = {};
+  work.op = op;
+  work.jobs = jobs;
+  work.offset = offset;
+  async_parallel_for(kept_count, 1, vox_csg_world_work, &work);
+  
+  // Emptied chunks go back to the free list
+  for (VOX_ChunkNode *n = dst->first, *next = 0; n != 0; n = next) {
+    next = n->next;
+    if (n->solid_count == 0) {
+      vox_world_chunk_release(dst, n);
+    }
+  }
+  
+  if (implicit_stroke) {
+    vox_undo_end_stroke(undo, dst);
+  }
+  
+  arena_scratch_end(scratch);
+  ProfEnd();
+  return kept_count;
+}
+
+function U32
+vox_csg_sdf(VOX_World *dst, VOX_UndoHistory *undo, VOX_Sdf *sdf, VOX_CsgOp op)
+{
+  ProfBegin("vox_csg_sdf");
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  B32 implicit_stroke = (undo && !undo->stroke_active);
+  if (implicit_stroke) {
+    vox_undo_begin_stroke(undo, 0);
+  }
+  
+  V3S32 voxel_min = {0};
+  V3S32 voxel_max = {0};
+  vox_sdf_voxel_bounds(sdf, &voxel_min, &voxel_max);
+  V3S32 chunk_min = vox_chunk_coord_from_voxel_coord(voxel_min);
+  V3S32 chunk_max = vox_chunk_coord_from_voxel_coord(voxel_max);
+  
+  U32 jobs_count = 0;
+  VOX_CsgJob *jobs = 0;
+  if (op == VOX_CsgOp_Union) {
+    U64 jobs_cap = (U64)(chunk_max.x - chunk_min.x + 1)*(chunk_max.y - chunk_min.y + 1)*(chunk_max.z - chunk_min.z + 1);
+    jobs = ArenaPushArray(scratch.arena, VOX_CsgJob, jobs_cap);
+    for (S32 z = chunk_min.z; z <= chunk_max.z; z += 1) {
+      for (S32 y = chunk_min.y; y <= chunk_max.y; y += 1) {
+        for (S32 x = chunk_min.x; x <= chunk_max.x; x += 1) {
+          VOX_ChunkNode *node = vox_world_chunk_acquire(dst, v3s32(x, y, z));
+          vox_csg_touch_undo(undo, node);
+          jobs[jobs_count++].node = node;
+        }
+      }
+    }
+  }
+  else {
+    // Existing chunks only; past the primitive's bounds, subtract has nothing to
+    // do and intersect clears the whole chunk.
+    jobs = ArenaPushArray(scratch.arena, VOX_CsgJob, dst->chunks_count);
+    for (VOX_ChunkNode *n = dst->first; n != 0; n = n->next) {
+      B32 overlaps = (n->coord.x >= chunk_min.x && n->coord.x <= chunk_max.x &&
+                      n->coord.y >= chunk_min.y && n->coord.y <= chunk_max.y &&
+                      n->coord.z >= chunk_min.z && n->coord.z <= chunk_max.z);
+      if (overlaps) {
+        vox_csg_touch_undo(undo, n);
+        jobs[jobs_count++].node = n;
+      }
+      else if (op == VOX_CsgOp_Intersect) {
+        vox_csg_touch_undo(undo, n);
+        n->solid_count = 0;
+      }
+    }
+  }
+  
+  VOX_CsgWork work = {};
+  work.op = op;
+  work.jobs = jobs;
+  work.sdf = sdf;
+  async_parallel_for(jobs_count, 1, vox_csg_sdf_work, &work);
+  
+  for (VOX_ChunkNode *n = dst->first, *next = 0; n != 0; n = next) {
+    next = n->next;
+    if (n->solid_count == 0) {
+      vox_world_chunk_release(dst, n);
+    }
+  }
+  
+  if (implicit_stroke) {
+    vox_undo_end_stroke(undo, dst);
+  }
+  
+  arena_scratch_end(scratch);
+  ProfEnd();
+  return jobs_count;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// NOTE: Boolean operations on voxel volumes. The right-hand side is another
+// world translated by a voxel offset, or an analytic SDF primitive, and the
+// result replaces the left-hand world's contents. Work is split by destination
+// chunk and runs on the async workers.
+//
+// Chunks are paired up front, so pairs where either side is empty are never
+// visited: worlds only hold non-empty chunks, so a missing chunk is empty space.
+// SDF operations also skip bricks whose occupancy says there is nothing to
+// remove, and settle whole 4^3 bricks at once where the distance at the brick's
+// center puts all of it inside or outside the primitive.
+
+#define VOX_CSG_SRC_MAX 8 // Source chunks one destination chunk can overlap
+
+enum VOX_CsgOp {
+  VOX_CsgOp_Union,     // Solid voxels of the right-hand side overwrite the world
+  VOX_CsgOp_Subtract,  // Solid voxels of the right-hand side are cleared from the world
+  VOX_CsgOp_Intersect, // World voxels outside the right-hand side are cleared
+  VOX_CsgOp_COUNT,
+};
+
+enum VOX_SdfKind {
+  VOX_SdfKind_Sphere,   // radius
+  VOX_SdfKind_Box,      // half_size
+  VOX_SdfKind_Cylinder, // radius and half_size.y, upright
+  VOX_SdfKind_COUNT,
+};
+
+struct VOX_Sdf {
+  VOX_SdfKind kind;
+  V3F32 center; // In voxels; voxel v spans [v, v + 1)
+  V3F32 half_size;
+  F32 radius;
+  VOX_Voxel voxel; // Written by union
+};
+
+struct VOX_CsgJob {
+  VOX_ChunkNode *node;
+  VOX_ChunkNode *src[VOX_CSG_SRC_MAX];
+  U32 src_count;
+};
+
+struct VOX_CsgWork {
+  VOX_CsgOp op;
+  VOX_CsgJob *jobs;
+  
+  // World operand
+  V3S32 offset;
+  
+  // SDF operand
+  VOX_Sdf *sdf;
+};
+
+// Exact distance, negative inside; p is relative to the primitive's center.
+function F32 vox_sdf_distance(VOX_Sdf *sdf, V3F32 p);
+
+// Both return the number of destination chunks visited. `undo` may be 0;
+// otherwise the operation is recorded into the active stroke, or becomes its
+// own step. `src` must not be `dst`.
+function U32 vox_csg_world(VOX_World *dst, VOX_UndoHistory *undo, VOX_World *src, V3S32 offset, VOX_CsgOp op);
+function U32 vox_csg_sdf(VOX_World *dst, VOX_UndoHistory *undo, VOX_Sdf *sdf, VOX_CsgOp op);
@@ -6,10 +6,88 @@ vox_ctx_make(OS_Handle window)
   VOX_Renderer *r = vox_render_alloc();
   vox_render_init(r, window, S8("../src/voxel/shaders/fullscreen.hlsl"));
   ctx.renderer = r;
+  ctx.world = vox_world_alloc();
+  ctx.undo = vox_undo_alloc(VOX_UNDO_DEFAULT_BUDGET);
+  ctx.meshes = vox_mesh_cache_alloc();
+  ctx.meshes->backend_release = vox_render_mesh_release;
+  ctx.meshes->backend_user = r;
+  ctx.lights = vox_light_cache_alloc();
+  ctx.distances = vox_distance_cache_alloc();
+  ctx.lods = vox_lod_cache_alloc();
   
   return ctx;
 }
 
+function void
+vox_get_input(VOX_Context *ctx, OS_EventList *events)
+{
+  VOX_Input *input = &ctx->input;
+  OS_Handle window = ctx->renderer->window;
+  
+  for (OS_Event *e = events->first; e != 0; e = e->next) {
+    VOX_Key slot = VOX_Key_Null;
+    VOX_MouseButton mouse_slot = VOX_MouseButton_Null;
+    
+    switch (e->key) {
+      case OS_Key_Esc:   { slot = VOX_Key_Esc;   }break;
+      case OS_Key_Space: { slot = VOX_Key_Space; }break;
+      case OS_Key_Enter: { slot = VOX_Key_Enter; }break;
+      case OS_Key_Up:    { slot = VOX_Key_Up;    }break;
+      case OS_Key_Down:  { slot = VOX_Key_Down;  }break;
+      case OS_Key_Left:  { slot = VOX_Key_Left;  }break;
+      case OS_Key_Right: { slot = VOX_Key_Right; }break;
+      case OS_Key_W:     { slot = VOX_Key_W;     }break;
+      case OS_Key_A:     { slot = VOX_Key_A;     }break;
+      case OS_Key_S:     { slot = VOX_Key_S;     }break;
+      case OS_Key_D:     { slot = VOX_Key_D;     }break;
+      case OS_Key_Q:     { slot = VOX_Key_Q;     }break;
+      case OS_Key_E:     { slot = VOX_Key_E;     }break;
+      case OS_Key_R:     { slot = VOX_Key_R;     }break;
+      case OS_Key_Z:     { slot = VOX_Key_Z;     }break;
+      case OS_Key_0:     { slot = VOX_Key_0;     }break;
+      case OS_Key_1:     { slot = VOX_Key_1;     }break;
+      case OS_Key_2:     { slot = VOX_Key_2;     }break;
+      case OS_Key_3:     { slot = VOX_Key_3;     }break;
+      case OS_Key_4:     { slot = VOX_Key_4;     }break;
+      case OS_Key_5:     { slot = VOX_Key_5;     }break;
+      case OS_Key_6:     { slot = VOX_Key_6;     }break;
+      case OS_Key_7:     { slot = VOX_Key_7;     }break;
+      case OS_Key_8:     { slot = VOX_Key_8;     }break;
+      case OS_Key_9:     { slot = VOX_Key_9;     }break;
+      case OS_Key_F1:    { slot = VOX_Key_F1;    }break;
+      case OS_Key_F2:    { slot = VOX_Key_F2;    }break;
+      case OS_Key_F3:    { slot = VOX_Key_F3;    }break;
+      case OS_Key_F4:    { slot = VOX_Key_F4;    }break;
+      case OS_Key_F5:    { slot = VOX_Key_F5;    }break;
+      case OS_Key_F6:    { slot = VOX_Key_F6;    }break;
+      case OS_Key_F7:    { slot = VOX_Key_F7;    }break;
+      case OS_Key_F8:    { slot = VOX_Key_F8;    }break;
+      case OS_Key_F9:    { slot = VOX_Key_F9;    }break;
+      case OS_Key_F10:   { slot = VOX_Key_F10;   }break;
+      case OS_Key_F11:   { slot = VOX_Key_F11;   }break;
+      case OS_Key_F12:   { slot = VOX_Key_F12;   }break;
+      case OS_Key_Minus: { slot = VOX_Key_Minus; }break;
+      case OS_Key_Equal: { slot = VOX_Key_Equal; }break;
+      
+      case OS_Key_MouseLeft:   { mouse_slot = VOX_MouseButton_Left;   }break;
+      case OS_Key_MouseMiddle: { mouse_slot = VOX_MouseButton_Middle; }break;
+      case OS_Key_MouseRight:  { mouse_slot = VOX_MouseButton_Right;  }break;
+    }
+    
+    switch (e->kind) {
+      case OS_EventKind_KeyPress:   { input->keys[slot] = 1; }break;
+      case OS_EventKind_KeyRelease: { input->keys[slot] = 0; }break;
+      
+      case OS_EventKind_MousePress:   { input->mouse.buttons[mouse_slot] = 1; }break;
+      case OS_EventKind_MouseRelease: { input->mouse.buttons[mouse_slot] = 0; }break;
+    }
+  }
+  
+  V2S32 mouse_pos = os_window_cursor_pos(window);
+  input->mouse.pos.x = mouse_pos.x;
+  input->mouse.pos.y = mouse_pos.y;
+}
+
 function void
 vox_update_uniforms(VOX_Context *ctx)
 {
@@ -21,7 +99,7 @@ vox_update_uniforms(VOX_Context *ctx)
   VOX_Renderer *r = ctx->renderer;
   
   B32 r_mouse = vox_mouse_down(input, VOX_MouseButton_Right);
-  B32 l_mouse = vox_mouse_pressed(input, VOX_MouseButton_Left);
+  B32 l_mouse = vox_mouse_down(input, VOX_MouseButton_Left);
   V2S32 mouse_s32 = vox_mouse_position(input);
   
   // Client size, time, zoom
@@ -30,6 +108,8 @@ vox_update_uniforms(VOX_Context *ctx)
     uniforms->time = time;
     uniforms->zoom += vox_key_pressed(input, VOX_Key_Equal)*0.1f;
     uniforms->zoom -= vox_key_pressed(input, VOX_Key_Minus)*0.1f;
+    uniforms->lod_bias += vox_key_pressed(input, VOX_Key_F6) - vox_key_pressed(input, VOX_Key_F5);
+    uniforms->lod_bias = Clamp(uniforms->lod_bias, 0.f, 8.f);
   }
   
   // View angle (@Todo)
@@ -65,15 +145,16 @@ vox_update_edit_state(VOX_Context *ctx)
   VOX_Input *input = &ctx->input;
   
   VOX_UniformData *uniforms = &ctx->uniforms;
-  VOX_Chunk *chunk = &ctx->chunk;
+  VOX_World *world = ctx->world;
   
-  S32 selected_voxel_idx = -1;
-  S32 nearest_empty_voxel_idx = -1;
+  B32 has_selected_voxel = 0;
+  V3S32 selected_voxel = {0};
+  V3S32 nearest_empty_voxel = {0};
   
-  B32 l_mouse_pressed = (B32)uniforms->mouse.w;
+  B32 l_mouse_down = (B32)uniforms->mouse.w;
   V2F32 client_size = uniforms->client_size;
   
-  if (l_mouse_pressed) {
+  if (l_mouse_down) {
     F32 mx = (uniforms->mouse.x - client_size.x*0.5f) / client_size.y;
     F32 my = (uniforms->mouse.y - client_size.y*0.5f) / client_size.y;
     
@@ -97,15 +178,17 @@ vox_update_edit_state(VOX_Context *ctx)
     V3F32 rd = v3f32_normalize(v3f32_add(v3f32_add(dx, dy), dz));
     
     F32 voxel_scale = uniforms->zoom;
-    VOX_RaycastResult raycast = vox_raycast(chunk, voxel_scale, ro, rd);
+    VOX_RaycastResult raycast = vox_raycast(world, voxel_scale, ro, rd);
     if (raycast.hit) {
-      selected_voxel_idx = raycast.idx;
-      nearest_empty_voxel_idx = raycast.prev_idx;
+      has_selected_voxel = 1;
+      selected_voxel = raycast.coord;
+      nearest_empty_voxel = raycast.prev_coord;
     }
   }
   
-  edit->selected_voxel_idx = selected_voxel_idx;
-  edit->nearest_empty_voxel_idx = nearest_empty_voxel_idx;
+  edit->has_selected_voxel = has_selected_voxel;
+  edit->selected_voxel = selected_voxel;
+  edit->nearest_empty_voxel = nearest_empty_voxel;
   
   if (0) {}
   else if (vox_key_pressed(input, VOX_Key_F1)) {
@@ -114,54 +197,114 @@ vox_update_edit_state(VOX_Context *ctx)
   else if (vox_key_pressed(input, VOX_Key_F2)) {
     edit->mode = VOX_EditMode_Add;
   }
+  else if (vox_key_pressed(input, VOX_Key_F3)) {
+    edit->mode = VOX_EditMode_Paint;
+  }
+  
+  // Brush shape, size and color
+  {
+    VOX_Key shape_keys[VOX_BrushShape_COUNT] = { VOX_Key_1, VOX_Key_2, VOX_Key_3, VOX_Key_4 };
+    for (S32 idx = 0; idx < VOX_BrushShape_COUNT; idx += 1) {
+      if (vox_key_pressed(input, shape_keys[idx])) {
+        edit->brush_shape = (VOX_BrushShape)idx;
+      }
+    }
+    
+    VOX_Key color_keys[] = { VOX_Key_5, VOX_Key_6, VOX_Key_7, VOX_Key_8 };
+    for (U32 idx = 0; idx < ArrayCount(color_keys); idx += 1) {
+      if (vox_key_pressed(input, color_keys[idx])) {
+        edit->brush_color = (U8)idx;
+      }
+    }
+    
+    edit->brush_size -= vox_key_pressed(input, VOX_Key_Q);
+    edit->brush_size += vox_key_pressed(input, VOX_Key_E);
+    edit->brush_size = Clamp(edit->brush_size, 1, VOX_BRUSH_RADIUS_MAX + 1);
+  }
 }
 
 function void
 vox_update_chunk(VOX_Context *ctx)
 {
   VOX_EditState *edit = &ctx->edit;
-  VOX_Chunk *chunk = &ctx->chunk;
+  VOX_Input *input = &ctx->input;
+  VOX_World *world = ctx->world;
+  VOX_UndoHistory *undo = ctx->undo;
+  
+  // Zero is the key of strokes that never merge
+  if (vox_mouse_pressed(input, VOX_MouseButton_Left)) {
+    ctx->brush_drag_key = Max(ctx->brush_drag_key + 1, 1u);
+  }
   
-  S32 selected_voxel_idx = edit->selected_voxel_idx;
-  S32 nearest_empty_voxel_idx = edit->nearest_empty_voxel_idx;
+  // Stamps follow the cursor for as long as the button is held; the strokes of
+  // a drag share its key, so the whole drag undoes as one step
+  if (edit->has_selected_voxel) {
+    if (!ctx->brush_stroke_active) {
+      VOX_Brush brush = vox_brush_from_edit_state(edit);
+      vox_brush_stroke_begin(&ctx->brush_stroke, world, undo, &brush, ctx->brush_drag_key);
+      ctx->brush_stroke_active = 1;
+    }
+    V3S32 center = (edit->mode == VOX_EditMode_Add) ? edit->nearest_empty_voxel : edit->selected_voxel;
+    vox_brush_stroke_to(&ctx->brush_stroke, center);
+  }
   
-  switch (edit->mode) {
-    case VOX_EditMode_Delete: {
-      if (selected_voxel_idx >= 0) {
-        VOX_Voxel *v = vox_get_voxel(chunk, selected_voxel_idx);
-        v->opacity = 0;
-      }
-    }break;
-    case VOX_EditMode_Add: {
-      if (nearest_empty_voxel_idx >= 0) {
-        VOX_Voxel *v = vox_get_voxel(chunk, nearest_empty_voxel_idx);
-        v->opacity = 255;
-      }
-    }break;
+  B32 undo_pressed = vox_key_pressed(input, VOX_Key_Z);
+  B32 redo_pressed = vox_key_pressed(input, VOX_Key_R);
+  if (ctx->brush_stroke_active && (!vox_mouse_down(input, VOX_MouseButton_Left) || !edit->has_selected_voxel ||
+                                   undo_pressed || redo_pressed)) {
+    vox_brush_stroke_end(&ctx->brush_stroke);
+    ctx->brush_stroke_active = 0;
   }
   
-  edit->selected_voxel_idx = -1;
+  if (undo_pressed) {
+    vox_undo(undo, world);
+  }
+  else if (redo_pressed) {
+    vox_redo(undo, world);
+  }
+  
+  edit->has_selected_voxel = 0;
 }
 
+// NOTE: Only polls; reading and compiling the file happen on an async worker.
 function void 
 vox_reload_shader(VOX_Context *ctx)
 {
   VOX_Renderer *r = ctx->renderer;
-  U32 compile_flags = r->shader_compile_flags; 
+  VOX_ShaderReload *reload = &r->shader_reload;
   
-  TempArena scratch = arena_scratch_begin(0,0);
-  {
-    String8 source = os_file_read(scratch.arena, r->shader_path);
-    if (source.count > 0) {
-      ID3DBlob *error;
-      ID3DBlob *pblob;
-      D3DCompile(source.data, source.count, 0, 0, 0, "ps_main", "ps_5_0", 
-                 compile_flags, 0, &pblob, &error);
-      r->device->CreatePixelShader(pblob->GetBufferPointer(), pblob->GetBufferSize(), 0, &r->pixel_shader);
-      pblob->Release();
+  if (!reload->pending && os_file_watch_changed(r->shader_watch)) {
+    reload->pending = 1;
+    async_job_push(vox_shader_reload_work, reload, &reload->counter);
+  }
+  
+  if (reload->pending && reload->counter.count == 0) {
+    reload->pending = 0;
+    
+    ID3D11PixelShader *pixel_shader = 0;
+    String8 error = reload->error;
+    if (reload->bytecode.count > 0) {
+      HRESULT hr = r->device->CreatePixelShader(reload->bytecode.data, reload->bytecode.count, 0, &pixel_shader);
+      if (FAILED(hr)) {
+        pixel_shader = 0;
+        error = S8("CreatePixelShader failed");
+      }
+    }
+    
+    arena_clear(r->shader_error_arena);
+    r->shader_error = str8(0, 0);
+    if (pixel_shader) {
+      // Nothing is drawing between frames, so the old shader can go right away
+      if (r->pixel_shader) {
+        r->pixel_shader->Release();
+      }
+      r->pixel_shader = pixel_shader;
+    }
+    else {
+      r->shader_error = str8_pushf(r->shader_error_arena, (char *)"%.*s", (int)error.count, error.data);
+      OutputDebugStringA((char *)r->shader_error.data);
     }
   }
-  arena_scratch_end(scratch);
 }
 
 function void
@@ -217,7 +360,120 @@ vox_render(VOX_Context *ctx)
     }
   }
   
-  if (r->rt_view) {
+  // Nothing below clears the chunks' dirty bricks; that happens once at the end
+  // of the frame, after every one of them has read them
+  vox_light_cache_update(ctx->lights, ctx->world);
+  vox_distance_cache_update(ctx->distances, ctx->world);
+  vox_lod_cache_update(ctx->lods, ctx->world);
+  
+  // The path switched to missed every edit made while it was off, so it starts
+  // from scratch
+  if (vox_key_pressed(&ctx->input, VOX_Key_F4)) {
+    ctx->render_meshes = !ctx->render_meshes;
+    if (ctx->render_meshes) {
+      vox_mesh_cache_clear(ctx->meshes);
+    }
+    else {
+      vox_dirty_bricks_mark_all(r->chunk_upload_bricks);
+      r->chunk_texture_cleared = 0;
+    }
+  }
+  
+  // The chunk upload collects the edits of the chunk it shows until a frame
+  // uploads them, so frames without a render target lose none
+  VOX_ChunkNode *origin = vox_world_chunk_from_coord(ctx->world, v3s32(0,0,0));
+  if (origin) {
+    for (U32 idx = 0; idx < VOX_BRICK_SUMMARY_WORDS; idx += 1) {
+      r->chunk_upload_bricks[idx] |= origin->dirty_bricks[idx];
+    }
+  }
+  
+  if (ctx->render_meshes) {
+    vox_mesh_cache_update(ctx->meshes, ctx->world);
+  }
+  
+  if (r->rt_view && ctx->render_meshes) {
+    F32 clear_color[] = { 0.392f, 0.584f, 0.929f, 1.f };
+    r->context->ClearRenderTargetView(r->rt_view, clear_color);
+    r->context->ClearDepthStencilView(r->ds_view, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.f, 0);
+    
+    D3D11_VIEWPORT viewport = {0};
+    viewport.Width = (F32)client_width;
+    viewport.Height = (F32)client_height;
+    viewport.MinDepth = 0;
+    viewport.MaxDepth = 1;
+    
+    {
+      D3D11_MAPPED_SUBRESOURCE mapped;
+      r->context->Map((ID3D11Resource *)r->constant_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+      MemoryCopy(mapped.pData, uniforms, sizeof(VOX_UniformData));
+      r->context->Unmap((ID3D11Resource *)r->constant_buffer, 0);
+    }
+    
+    // Replace the vertex buffers of the meshes that were rebuilt
+    ProfScope("mesh upload") {
+      for (VOX_ChunkMesh *mesh = ctx->meshes->first; mesh != 0; mesh = mesh->next) {
+        if (mesh->backend_version != mesh->version) {
+          vox_render_mesh_release(r, mesh);
+          if (mesh->quads_count > 0) {
+            D3D11_BUFFER_DESC desc = {0};
+            desc.ByteWidth = mesh->quads_count*VOX_MESH_VERTICES_PER_QUAD*sizeof(VOX_MeshVertex);
+            desc.Usage = D3D11_USAGE_IMMUTABLE;
+            desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+            
+            D3D11_SUBRESOURCE_DATA initial_data = {0};
+            initial_data.pSysMem = mesh->vertices;
+            
+            ID3D11Buffer *vertex_buffer = 0;
+            r->device->CreateBuffer(&desc, &initial_data, &vertex_buffer);
+            mesh->backend = vertex_buffer;
+          }
+          mesh->backend_version = mesh->version;
+        }
+      }
+    }
+    
+    r->context->IASetInputLayout(r->mesh_input_layout);
+    r->context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    r->context->IASetIndexBuffer(r->mesh_index_buffer, DXGI_FORMAT_R32_UINT, 0);
+    
+    ID3D11Buffer *constant_buffers[] = { r->constant_buffer, r->mesh_constant_buffer };
+    r->context->VSSetShader(r->mesh_vertex_shader, 0, 0);
+    r->context->VSSetConstantBuffers(0, ArrayCount(constant_buffers), constant_buffers);
+    
+    r->context->RSSetViewports(1, &viewport);
+    r->context->RSSetState(r->rasterizer_state);
+    
+    r->context->PSSetShader(r->mesh_pixel_shader, 0, 0);
+    
+    r->context->OMSetBlendState(r->blend_state, 0, ~0U);
+    r->context->OMSetDepthStencilState(r->mesh_depth_state, 0);
+    r->context->OMSetRenderTargets(1, &r->rt_view, r->ds_view);
+    
+    U32 quads_drawn = 0;
+    for (VOX_ChunkMesh *mesh = ctx->meshes->first; mesh != 0; mesh = mesh->next) {
+      ID3D11Buffer *vertex_buffer = (ID3D11Buffer *)mesh->backend;
+      if (!vertex_buffer) {
+        continue;
+      }
+      
+      D3D11_MAPPED_SUBRESOURCE mapped;
+      r->context->Map((ID3D11Resource *)r->mesh_constant_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+      VOX_MeshUniformData *mesh_uniforms = (VOX_MeshUniformData *)mapped.pData;
+      mesh_uniforms->chunk_origin = v3f32((F32)(mesh->coord.x*VOX_SLICE_SIZE),
+                                          (F32)(mesh->coord.y*VOX_SLICE_SIZE),
+                                          (F32)(mesh->coord.z*VOX_SLICE_SIZE));
+      r->context->Unmap((ID3D11Resource *)r->mesh_constant_buffer, 0);
+      
+      U32 stride = sizeof(VOX_MeshVertex);
+      U32 offset = 0;
+      r->context->IASetVertexBuffers(0, 1, &vertex_buffer, &stride, &offset);
+      r->context->DrawIndexed(mesh->quads_count*VOX_MESH_INDICES_PER_QUAD, 0, 0);
+      quads_drawn += mesh->quads_count;
+    }
+    ProfCounter("quads drawn", quads_drawn);
+  }
+  else if (r->rt_view) {
     // Clear screen
     F32 clear_color[] = { 0.392f, 0.584f, 0.929f, 1.f };
     r->context->ClearRenderTargetView(r->rt_view, clear_color);
@@ -240,12 +496,121 @@ vox_render(VOX_Context *ctx)
     }
     
     // Upload updated chunk data to 3D texture
-    {
-      S32 row_pitch = sizeof(VOX_Voxel) * VOX_SLICE_SIZE;
+    ProfScope("chunk upload") {
+      // @Todo: The shader only knows about a single chunk texture for now, so only
+      // the chunk at the world origin is uploaded.
+      VOX_ChunkNode *node = vox_world_chunk_from_coord(ctx->world, v3s32(0,0,0));
+      if (!node) {
+        if (!r->chunk_texture_cleared) {
+          local VOX_Chunk empty_chunk = {0};
+          for (U32 level = 0; level < VOX_LOD_LEVELS; level += 1) {
+            S32 size = vox_lod_level_size(level);
+            S32 level_row_pitch = sizeof(VOX_Voxel) * size;
+            r->context->UpdateSubresource(r->chunk_texture, level, 0, (void *)empty_chunk.voxels, level_row_pitch, level_row_pitch * size);
+          }
+          r->chunk_texture_cleared = 1;
+          r->chunk_lod_version = 0;
+        }
+      }
+      else {
+        if (r->chunk_texture_cleared) {
+          vox_dirty_bricks_mark_all(r->chunk_upload_bricks);
+          r->chunk_texture_cleared = 0;
+        }
+        
+        // Only the boxes covering edited bricks are sent; a clean chunk uploads nothing.
+        VOX_UploadPlan plan = vox_upload_plan_from_dirty_bricks(r->chunk_upload_bricks);
+        ProfCounter("upload boxes", plan.boxes_count);
+        for (U32 idx = 0; idx < plan.boxes_count; idx += 1) {
+          VOX_UploadBox *box = &plan.boxes[idx];
+          
+          D3D11_BOX d3d_box = {0};
+          d3d_box.left   = (UINT)box->min.x;
+          d3d_box.top    = (UINT)box->min.y;
+          d3d_box.front  = (UINT)box->min.z;
+          d3d_box.right  = (UINT)box->max.x;
+          d3d_box.bottom = (UINT)box->max.y;
+          d3d_box.back   = (UINT)box->max.z;
+          
+          TempArena scratch = arena_scratch_begin(0, 0);
+          VOX_UploadSource src = vox_upload_source_from_box(scratch.arena, node->chunk.voxels, sizeof(VOX_Voxel), box);
+          r->context->UpdateSubresource(r->chunk_texture, 0, &d3d_box, src.data, src.row_pitch, src.depth_pitch);
+          arena_scratch_end(scratch);
+        }
+        vox_dirty_bricks_clear(r->chunk_upload_bricks);
+        
+        // The coarse levels are small, so a rebuilt pyramid is sent whole
+        VOX_ChunkLod *lod = vox_lod_from_chunk_coord(ctx->lods, v3s32(0,0,0));
+        if (lod && lod->version != r->chunk_lod_version) {
+          for (U32 level = 1; level < VOX_LOD_LEVELS; level += 1) {
+            S32 size = vox_lod_level_size(level);
+            S32 level_row_pitch = sizeof(VOX_Voxel) * size;
+            VOX_Voxel *data = vox_lod_level_voxels(lod, level);
+            r->context->UpdateSubresource(r->chunk_texture, level, 0, (void *)data, level_row_pitch, level_row_pitch * size);
+          }
+          r->chunk_lod_version = lod->version;
+        }
+      }
+    }
+    
+    ProfScope("light upload") {
+      S32 row_pitch = sizeof(VOX_LightTexel) * VOX_SLICE_SIZE;
+      S32 depth_pitch = row_pitch * VOX_SLICE_SIZE;
+      
+      VOX_ChunkLight *light = vox_light_from_chunk_coord(ctx->lights, v3s32(0,0,0));
+      if (!light) {
+        if (!r->light_texture_cleared) {
+          local VOX_LightTexel empty_light[VOX_CHUNK_SIZE] = {0};
+          r->context->UpdateSubresource(r->light_texture, 0, 0, (void *)empty_light, row_pitch, depth_pitch);
+          r->light_texture_cleared = 1;
+        }
+      }
+      else {
+        if (r->light_texture_cleared) {
+          vox_dirty_bricks_mark_all(light->upload_bricks);
+          r->light_texture_cleared = 0;
+        }
+        
+        VOX_UploadPlan plan = vox_upload_plan_from_dirty_bricks(light->upload_bricks);
+        for (U32 idx = 0; idx < plan.boxes_count; idx += 1) {
+          VOX_UploadBox *box = &plan.boxes[idx];
+          
+          D3D11_BOX d3d_box = {0};
+          d3d_box.left   = (UINT)box->min.x;
+          d3d_box.top    = (UINT)box->min.y;
+          d3d_box.front  = (UINT)box->min.z;
+          d3d_box.right  = (UINT)box->max.x;
+          d3d_box.bottom = (UINT)box->max.y;
+          d3d_box.back   = (UINT)box->max.z;
+          
+          TempArena scratch = arena_scratch_begin(0, 0);
+          VOX_UploadSource src = vox_upload_source_from_box(scratch.arena, light->texels, sizeof(VOX_LightTexel), box);
+          r->context->UpdateSubresource(r->light_texture, 0, &d3d_box, src.data, src.row_pitch, src.depth_pitch);
+          arena_scratch_end(scratch);
+        }
+        vox_dirty_bricks_clear(light->upload_bricks);
+      }
+    }
+    
+    ProfScope("distance upload") {
+      S32 row_pitch = VOX_SLICE_SIZE;
       S32 depth_pitch = row_pitch * VOX_SLICE_SIZE;
       
-      VOX_Voxel *data = ctx->chunk.voxels;
-      r->context->UpdateSubresource(r->chunk_texture, 0, 0, (void *)data, row_pitch, depth_pitch);
+      // Missing chunks are empty all the way to the chunk's boundary
+      VOX_ChunkDistance *field = vox_distance_from_chunk_coord(ctx->distances, v3s32(0,0,0));
+      if (!field) {
+        if (!r->distance_texture_cleared) {
+          local U8 empty_distance[VOX_CHUNK_SIZE];
+          MemorySet(empty_distance, VOX_DISTANCE_MAX, sizeof(empty_distance));
+          r->context->UpdateSubresource(r->distance_texture, 0, 0, (void *)empty_distance, row_pitch, depth_pitch);
+          r->distance_texture_cleared = 1;
+        }
+      }
+      else if (r->distance_texture_cleared || r->distance_texture_version != field->version) {
+        r->context->UpdateSubresource(r->distance_texture, 0, 0, (void *)field->distance, row_pitch, depth_pitch);
+        r->distance_texture_version = field->version;
+        r->distance_texture_cleared = 0;
+      }
     }
     
     // Input Assembler
@@ -265,7 +630,8 @@ vox_render(VOX_Context *ctx)
     // Pixel Shader
     r->context->PSSetConstantBuffers(0, 1, &r->constant_buffer);
     r->context->PSSetSamplers(0, 1, &r->chunk_texture_sampler);
-    r->context->PSSetShaderResources(0, 1, &r->chunk_texture_view);
+    ID3D11ShaderResourceView *views[] = { r->chunk_texture_view, r->light_texture_view, r->distance_texture_view };
+    r->context->PSSetShaderResources(0, ArrayCount(views), views);
     r->context->PSSetShader(r->pixel_shader, 0, 0);
     
     // Output Merger
@@ -277,6 +643,8 @@ vox_render(VOX_Context *ctx)
     r->context->Draw(6, 0);
   }
   
+  vox_world_clear_dirty_bricks(ctx->world);
+  
   B32 vsync = 1;
   HRESULT hr = r->swapchain->Present(vsync, 0);
   if (hr == DXGI_STATUS_OCCLUDED) {
@@ -5,12 +5,35 @@ struct VOX_Context {
   VOX_UniformData uniforms;
   VOX_Input input;
   VOX_EditState edit;
-  VOX_Chunk chunk;
+  VOX_World *world;
+  VOX_UndoHistory *undo;
+  
+  // F4 switches from raymarching the chunk texture to rasterizing chunk meshes
+  B32 render_meshes;
+  VOX_MeshCache *meshes;
+  
+  // Ambient occlusion and sun shadows, baked on edit for the raymarcher
+  VOX_LightCache *lights;
+  
+  // Chebyshev distance to the nearest solid voxel, for the raymarcher to skip empty space
+  VOX_DistanceCache *distances;
+  
+  // Coarser copies of the chunks, for the raymarcher to traverse far geometry
+  // with. F5 and F6 lower and raise uniforms.lod_bias.
+  VOX_LodCache *lods;
+  
+  // Held while the left button is down and the cursor is on the world. Each
+  // press of the button starts a new drag key, so that the strokes of one drag
+  // merge into one undo step when the cursor leaves the world and comes back.
+  B32 brush_stroke_active;
+  VOX_BrushStroke brush_stroke;
+  U32 brush_drag_key;
 };
 
 function VOX_Context vox_ctx_make(OS_Handle window);
 function void vox_ctx_release(VOX_Context *ctx);
 
+function void vox_get_input(VOX_Context *ctx, OS_EventList *events);
 function void vox_update_uniforms(VOX_Context *ctx);
 function void vox_update_edit_state(VOX_Context *ctx);
 function void vox_update_chunk(VOX_Context *ctx);
@@ -0,0 +1,230 @@
+//
+// Distance transform
+//
+
+function S32
+vox_distance_idx_from_local_coord(V3S32 local_coord)
+{
+  S32 result = local_coord.x + local_coord.y*VOX_SLICE_SIZE + local_coord.z*VOX_SLICE_SIZE*VOX_SLICE_SIZE;
+  return result;
+}
+
+// Solid voxels of a row along x, one bit per voxel, read from the bricks it
+// crosses: each brick holds VOX_BRICK_SIZE of them as consecutive bits.
+function U32
+vox_distance_row_bits(VOX_Occupancy *occ, S32 y, S32 z)
+{
+  U32 result = 0;
+  S32 bit_shift = (y % VOX_BRICK_SIZE)*VOX_BRICK_SIZE + (z % VOX_BRICK_SIZE)*VOX_BRICK_SIZE*VOX_BRICK_SIZE;
+  for (S32 bx = 0; bx < VOX_BRICKS_PER_SLICE; bx += 1) {
+    S32 brick_idx = vox_brick_idx_from_local_coord(v3s32(bx*VOX_BRICK_SIZE, y, z));
+    U32 bits = (U32)(occ->bricks[brick_idx] >> bit_shift) & ((1u << VOX_BRICK_SIZE) - 1);
+    result |= bits << (bx*VOX_BRICK_SIZE);
+  }
+  return result;
+}
+
+// Combines the distances along lines `line_stride` apart, VOX_SLICE_SIZE lines
+// of a plane at a time: each voxel takes the smallest max(offset, distance) over
+// its line. Candidates are never closer than their offset, so the search stops
+// at the largest distance of the row. Rows are contiguous along x, which keeps
+// the inner loop over x vectorizable.
+function void
+vox_distance_pass(U8 *distance, S32 line_stride, S32 plane_stride)
+{
+  S32 n = VOX_SLICE_SIZE;
+  U8 prev[VOX_SLICE_SIZE][VOX_SLICE_SIZE];
+  
+  for (S32 plane = 0; plane < n; plane += 1) {
+    U8 *base = distance + plane*plane_stride;
+    for (S32 i = 0; i < n; i += 1) {
+      MemoryCopy(prev[i], base + i*line_stride, n);
+    }
+    
+    for (S32 i = 0; i < n; i += 1) {
+      U8 *row = base + i*line_stride;
+      
+      S32 bound = 0;
+      for (S32 x = 0; x < n; x += 1) {
+        bound = Max(bound, (S32)row[x]);
+      }
+      
+      for (S32 offset = 1; offset < bound; offset += 1) {
+        if (i - offset >= 0) {
+          U8 *src = prev[i - offset];
+          for (S32 x = 0; x < n; x += 1) {
+            row[x] = Min(row[x], Max((U8)offset, src[x]));
+          }
+        }
+        if (i + offset < n) {
+          U8 *src = prev[i + offset];
+          for (S32 x = 0; x < n; x += 1) {
+            row[x] = Min(row[x], Max((U8)offset, src[x]));
+          }
+        }
+      }
+    }
+  }
+}
+
+function void
+vox_distance_build(U8 *distance, VOX_Occupancy *occ)
+{
+  S32 n = VOX_SLICE_SIZE;
+  
+  // Along x: distance to the nearest solid voxel of the row, from both sides
+  for (S32 z = 0; z < n; z += 1) {
+    for (S32 y = 0; y < n; y += 1) {
+      U8 *row = distance + vox_distance_idx_from_local_coord(v3s32(0, y, z));
+      U32 bits = vox_distance_row_bits(occ, y, z);
+      
+      S32 d = VOX_DISTANCE_MAX;
+      for (S32 x = 0; x < n; x += 1) {
+        d = ((bits >> x) & 1) ? 0 : Min(d + 1, VOX_DISTANCE_MAX);
+        row[x] = (U8)d;
+      }
+      d = VOX_DISTANCE_MAX;
+      for (S32 x = n - 1; x >= 0; x -= 1) {
+        d = (row[x] == 0) ? 0 : Min(d + 1, VOX_DISTANCE_MAX);
+        row[x] = (U8)Min((S32)row[x], d);
+      }
+    }
+  }
+  
+  // Along y within each z slice, then along z within each y slice
+  vox_distance_pass(distance, n, n*n);
+  vox_distance_pass(distance, n*n, n);
+}
+
+//
+// Distance cache
+//
+
+function VOX_DistanceCache *
+vox_distance_cache_alloc(void)
+{
+  // 32 KiB per chunk
+  Arena *arena = arena_alloc(GiB(4llu));
+  VOX_DistanceCache *cache = ArenaPushStruct(arena, VOX_DistanceCache);
+  cache->arena = arena;
+  return cache;
+}
+
+function void
+vox_distance_cache_release(VOX_DistanceCache *cache)
+{
+  if (cache) {
+    arena_release(cache->arena);
+  }
+}
+
+function VOX_ChunkDistance *
+vox_distance_from_chunk_coord(VOX_DistanceCache *cache, V3S32 chunk_coord)
+{
+  VOX_ChunkDistance *result = 0;
+  
+  U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % VOX_DISTANCE_CACHE_SLOTS;
+  VOX_DistanceSlot *slot = &cache->slots[slot_idx];
+  for (VOX_ChunkDistance *f = slot->first; f != 0; f = f->hash_next) {
+    if (f->coord.x == chunk_coord.x && f->coord.y == chunk_coord.y && f->coord.z == chunk_coord.z) {
+      result = f;
+      break;
+    }
+  }
+  
+  return result;
+}
+
+function VOX_ChunkDistance *
+vox_distance_acquire(VOX_DistanceCache *cache, V3S32 chunk_coord)
+{
+  VOX_ChunkDistance *field = cache->free;
+  if (field) {
+    SLLStackPop(cache->free);
+    MemoryZeroStruct(field);
+  }
+  else {
+    field = ArenaPushStruct(cache->arena, VOX_ChunkDistance);
+  }
+  field->coord = chunk_coord;
+  field->dirty = 1;
+  
+  U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % VOX_DISTANCE_CACHE_SLOTS;
+  VOX_DistanceSlot *slot = &cache->slots[slot_idx];
+  DLLPushBackNP(slot->first, slot->last, field, hash_next, hash_prev);
+  DLLPushBack(cache->first, cache->last, field);
+  cache->fields_count += 1;
+  
+  return field;
+}
+
+function void
+vox_distance_release(VOX_DistanceCache *cache, VOX_ChunkDistance *field)
+{
+  U64 slot_idx = vox_hash_from_chunk_coord(field->coord) % VOX_DISTANCE_CACHE_SLOTS;
+  VOX_DistanceSlot *slot = &cache->slots[slot_idx];
+  DLLRemoveNP(slot->first, slot->last, field, hash_next, hash_prev);
+  DLLRemove(cache->first, cache->last, field);
+  cache->fields_count -= 1;
+  
+  SLLStackPush(cache->free, field);
+}
+
+function void
+vox_distance_build_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_DistanceJob *job = (VOX_DistanceJob *)user;
+  
+  for (U64 idx = first; idx < opl; idx += 1) {
+    VOX_ChunkDistance *field = job->fields[idx];
+    VOX_ChunkNode *node = vox_world_chunk_from_coord(job->world, field->coord);
+    vox_distance_build(field->distance, &node->occupancy);
+    field->version += 1;
+    field->dirty = 0;
+  }
+}
+
+function U32
+vox_distance_cache_update(VOX_DistanceCache *cache, VOX_World *world)
+{
+  ProfBegin("distance update");
+  
+  for (VOX_ChunkDistance *f = cache->first, *next = 0; f != 0; f = next) {
+    next = f->next;
+    if (!vox_world_chunk_from_coord(world, f->coord)) {
+      vox_distance_release(cache, f);
+    }
+  }
+  
+  for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+    VOX_ChunkDistance *field = vox_distance_from_chunk_coord(cache, n->coord);
+    if (!field) {
+      field = vox_distance_acquire(cache, n->coord);
+    }
+    if (vox_dirty_bricks_any(n->dirty_bricks)) {
+      field->dirty = 1;
+    }
+  }
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  VOX_ChunkDistance **fields = ArenaPushArray(scratch.arena, VOX_ChunkDistance *, cache->fields_count);
+  U32 fields_count = 0;
+  for (VOX_ChunkDistance *f = cache->first; f != 0; f = f->next) {
+    if (f->dirty) {
+      fields[fields_count++] = f;
+    }
+  }
+  
+  VOX_DistanceJob job = {0};
+  job.world = world;
+  job.fields = fields;
+  async_parallel_for(fields_count, 1, vox_distance_build_work, &job);
+  
+  arena_scratch_end(scratch);
+  
+  ProfCounter("distance fields rebuilt", fields_count);
+  ProfEnd();
+  
+  return fields_count;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// NOTE: Distance fields for empty-space skipping. Every voxel of a chunk stores
+// its Chebyshev (L-infinity) distance to the nearest solid voxel of the same
+// chunk: 0 for solid voxels, and d when every voxel less than d away on all
+// axes is empty. A ray in a voxel with d > 1 can therefore jump straight out of
+// the (2d - 1)^3 box centered on it without missing anything.
+//
+// Only the chunk's own voxels count, so a leap must not carry a ray past the
+// chunk's boundary; the neighbors' fields take over there. Chunks without any
+// solid voxel read VOX_DISTANCE_MAX everywhere.
+//
+// The transform is separable: the distance along x is found per row, then each
+// pass along y and z combines a line of the previous pass's results, taking for
+// each voxel the smallest max(offset, previous distance) along the line.
+//
+// Fields live in a cache keyed by chunk coordinate. Like the light cache,
+// vox_distance_cache_update reads the chunks' dirty bricks without clearing
+// them, and rebuilds the field of every chunk that has any, so a chunk left
+// dirty past the end of a frame is rebuilt again on the next.
+
+#define VOX_DISTANCE_MAX VOX_SLICE_SIZE
+
+#define VOX_DISTANCE_CACHE_SLOTS 1024
+
+struct VOX_ChunkDistance {
+  // Cache list
+  VOX_ChunkDistance *next;
+  VOX_ChunkDistance *prev;
+  
+  // Hash slot chain
+  VOX_ChunkDistance *hash_next;
+  VOX_ChunkDistance *hash_prev;
+  
+  V3S32 coord;
+  B32 dirty;
+  U64 version; // Bumped by every rebuild, so a renderer can tell its copy is stale
+  
+  // x + y*VOX_SLICE_SIZE + z*VOX_SLICE_SIZE^2, the layout of a 3D texture,
+  // whatever the layout of the chunk's voxels
+  U8 distance[VOX_CHUNK_SIZE];
+};
+
+struct VOX_DistanceSlot {
+  VOX_ChunkDistance *first;
+  VOX_ChunkDistance *last;
+};
+
+struct VOX_DistanceCache {
+  Arena *arena;
+  
+  VOX_DistanceSlot slots[VOX_DISTANCE_CACHE_SLOTS];
+  VOX_ChunkDistance *first;
+  VOX_ChunkDistance *last;
+  U32 fields_count;
+  VOX_ChunkDistance *free;
+};
+
+struct VOX_DistanceJob {
+  VOX_World *world;
+  VOX_ChunkDistance **fields;
+};
+
+function S32 vox_distance_idx_from_local_coord(V3S32 local_coord);
+
+// Builds the field of one chunk from its occupancy into `distance`.
+function void vox_distance_build(U8 *distance, VOX_Occupancy *occ);
+
+function VOX_DistanceCache *vox_distance_cache_alloc(void);
+function void vox_distance_cache_release(VOX_DistanceCache *cache);
+
+function VOX_ChunkDistance *vox_distance_from_chunk_coord(VOX_DistanceCache *cache, V3S32 chunk_coord);
+
+// Brings the cache in line with the world: adds fields for new chunks, drops
+// those of released chunks, and rebuilds those of chunks with dirty bricks, in
+// parallel on the async workers. Leaves the dirty bricks set. Returns the number
+// of fields rebuilt.
+function U32 vox_distance_cache_update(VOX_DistanceCache *cache, VOX_World *world);
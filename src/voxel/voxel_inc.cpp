@@ -1,4 +1,23 @@
 #include "voxel/voxel_core.cpp"
+#include "voxel/voxel_occupancy.cpp"
+#include "voxel/voxel_codec.cpp"
+#include "voxel/voxel_upload.cpp"
+#include "voxel/voxel_world.cpp"
+#include "voxel/voxel_scene.cpp"
+#include "voxel/voxel_undo.cpp"
+#include "voxel/voxel_brush.cpp"
+#include "voxel/voxel_csg.cpp"
+#include "voxel/voxel_palette.cpp"
+#include "voxel/voxel_mesh.cpp"
+#include "voxel/voxel_light.cpp"
+#include "voxel/voxel_distance.cpp"
+#include "voxel/voxel_lod.cpp"
 #include "voxel/voxel_raycast.cpp"
-#include "voxel/voxel_render.cpp"
-#include "voxel/voxel_ctx.cpp"
\ No newline at end of file
+#include "voxel/voxel_raycast_packet.cpp"
+#include "voxel/voxel_tree64.cpp"
+#include "voxel/voxel_render_cpu.cpp"
+#include "voxel/voxel_magica.cpp"
+#if !BUILD_HEADLESS
+# include "voxel/voxel_render.cpp"
+# include "voxel/voxel_ctx.cpp"
+#endif
\ No newline at end of file
@@ -1,6 +1,25 @@
 #pragma once
 
 #include "voxel/voxel_core.h"
+#include "voxel/voxel_occupancy.h"
+#include "voxel/voxel_codec.h"
+#include "voxel/voxel_upload.h"
+#include "voxel/voxel_world.h"
+#include "voxel/voxel_scene.h"
+#include "voxel/voxel_undo.h"
+#include "voxel/voxel_brush.h"
+#include "voxel/voxel_csg.h"
+#include "voxel/voxel_palette.h"
+#include "voxel/voxel_mesh.h"
+#include "voxel/voxel_light.h"
+#include "voxel/voxel_distance.h"
+#include "voxel/voxel_lod.h"
 #include "voxel/voxel_raycast.h"
-#include "voxel/voxel_render.h"
-#include "voxel/voxel_ctx.h"
\ No newline at end of file
+#include "voxel/voxel_raycast_packet.h"
+#include "voxel/voxel_tree64.h"
+#include "voxel/voxel_render_cpu.h"
+#include "voxel/voxel_magica.h"
+#if !BUILD_HEADLESS
+# include "voxel/voxel_render.h"
+# include "voxel/voxel_ctx.h"
+#endif
\ No newline at end of file
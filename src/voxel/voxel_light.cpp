@@ -0,0 +1,464 @@
+//
+// Texels
+//
+
+function V3F32
+vox_light_sun_dir(void)
+{
+  V3F32 result = v3f32_normalize(v3f32(-0.35f, -0.6f, -0.5f));
+  return result;
+}
+
+// The face on `axis` whose normal has the same sign as the sun direction
+function VOX_MeshFace
+vox_light_sun_face(V3F32 sun, U32 axis)
+{
+  VOX_MeshFace result = (VOX_MeshFace)(axis*2 + (sun.e[axis] < 0.f ? 1 : 0));
+  return result;
+}
+
+function U32
+vox_light_texel_ao(VOX_LightTexel texel, VOX_MeshFace face)
+{
+  U32 result = (texel >> (face*VOX_LIGHT_AO_BITS)) & 3;
+  return result;
+}
+
+function U32
+vox_light_texel_sun(VOX_LightTexel texel, VOX_MeshFace face)
+{
+  U32 result = 0;
+  U32 axis = face / 2;
+  if (vox_light_sun_face(vox_light_sun_dir(), axis) == face) {
+    result = (texel >> (VOX_LIGHT_SUN_SHIFT + axis)) & 1;
+  }
+  return result;
+}
+
+//
+// Baking
+//
+
+// Fills `solid` (VOX_LIGHT_PADDED_SIZE^3, zeroed) with 1 for every solid voxel of
+// the chunk and of the VOX_LIGHT_REACH layers of its 26 neighbors around it.
+function void
+vox_light_padded_volume(U8 *solid, VOX_World *world, VOX_ChunkNode *node)
+{
+  S32 p = VOX_LIGHT_PADDED_SIZE;
+  S32 r = VOX_LIGHT_REACH;
+  
+  for (S32 oz = -1; oz <= 1; oz += 1) {
+    for (S32 oy = -1; oy <= 1; oy += 1) {
+      for (S32 ox = -1; ox <= 1; ox += 1) {
+        V3S32 offset = v3s32(ox, oy, oz);
+        VOX_ChunkNode *src = node;
+        if (ox != 0 || oy != 0 || oz != 0) {
+          src = vox_world_chunk_from_coord(world, v3s32_add(node->coord, offset));
+        }
+        if (!src) {
+          continue;
+        }
+        
+        S32 min[3];
+        S32 opl[3];
+        for (S32 axis = 0; axis < 3; axis += 1) {
+          S32 o = offset.e[axis];
+          min[axis] = (o < 0) ? 0 : (o == 0) ? r : r + VOX_SLICE_SIZE;
+          opl[axis] = (o < 0) ? r : (o == 0) ? r + VOX_SLICE_SIZE : p;
+        }
+        
+        for (S32 z = min[2]; z < opl[2]; z += 1) {
+          for (S32 y = min[1]; y < opl[1]; y += 1) {
+            for (S32 x = min[0]; x < opl[0]; x += 1) {
+              V3S32 local_coord = v3s32(x - r - ox*VOX_SLICE_SIZE,
+                                        y - r - oy*VOX_SLICE_SIZE,
+                                        z - r - oz*VOX_SLICE_SIZE);
+              VOX_Voxel *v = vox_get_voxel(&src->chunk, vox_idx_from_local_coord(local_coord));
+              solid[x + y*p + z*p*p] = (v->opacity > 0);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Occlusion of the face whose front voxel is `front` in the padded volume:
+// the 3x3 layer in front of the face, edge neighbors counting twice as much as
+// corners, and the 3x3 layer behind it.
+function U32
+vox_light_face_ao(U8 *solid, S32 front, S32 normal_step, S32 u_step, S32 v_step)
+{
+  S32 occlusion = 0;
+  for (S32 dv = -1; dv <= 1; dv += 1) {
+    for (S32 du = -1; du <= 1; du += 1) {
+      S32 side = du*u_step + dv*v_step;
+      if (du != 0 || dv != 0) {
+        occlusion += solid[front + side]*((du == 0 || dv == 0) ? 2 : 1);
+      }
+      occlusion += solid[front + normal_step + side];
+    }
+  }
+  
+  // 4 edges, 4 corners and 9 behind make 21 when fully occluded
+  F32 open = 1.f - (F32)occlusion / 21.f;
+  U32 result = (U32)(open*3.f + 0.5f);
+  return result;
+}
+
+function U32
+vox_light_bake(Arena *scratch, VOX_World *world, VOX_ChunkLight *light)
+{
+  VOX_ChunkNode *node = vox_world_chunk_from_coord(world, light->coord);
+  
+  S32 p = VOX_LIGHT_PADDED_SIZE;
+  S32 r = VOX_LIGHT_REACH;
+  S32 steps[3] = { 1, p, p*p };
+  
+  U8 *solid = ArenaPushArray(scratch, U8, (U64)p*p*p);
+  if (node) {
+    vox_light_padded_volume(solid, world, node);
+  }
+  
+  U32 dirty_count = 0;
+  for (U32 idx = 0; idx < VOX_BRICK_SUMMARY_WORDS; idx += 1) {
+    for (U64 w = light->dirty_bricks[idx]; w != 0; w &= w - 1) {
+      dirty_count += 1;
+    }
+  }
+  
+  // At most one shadow ray per axis for every voxel of the dirty bricks
+  U32 rays_max = dirty_count*VOX_BRICK_SIZE*VOX_BRICK_SIZE*VOX_BRICK_SIZE*3;
+  V3F32 *ro = ArenaPushArrayNoZero(scratch, V3F32, rays_max);
+  V3F32 *rd = ArenaPushArrayNoZero(scratch, V3F32, rays_max);
+  U32 *ray_texels = ArenaPushArrayNoZero(scratch, U32, rays_max);
+  U32 rays_count = 0;
+  
+  V3F32 sun = vox_light_sun_dir();
+  V3S32 chunk_min = v3s32_scale(light->coord, VOX_SLICE_SIZE);
+  
+  for (S32 brick_idx = 0; brick_idx < VOX_BRICKS_PER_CHUNK; brick_idx += 1) {
+    if (((light->dirty_bricks[brick_idx / 64] >> (brick_idx % 64)) & 1) == 0) {
+      continue;
+    }
+    
+    V3S32 brick_min = v3s32((brick_idx % VOX_BRICKS_PER_SLICE)*VOX_BRICK_SIZE,
+                            (brick_idx / VOX_BRICKS_PER_SLICE % VOX_BRICKS_PER_SLICE)*VOX_BRICK_SIZE,
+                            (brick_idx / (VOX_BRICKS_PER_SLICE*VOX_BRICKS_PER_SLICE))*VOX_BRICK_SIZE);
+    for (S32 z = brick_min.z; z < brick_min.z + VOX_BRICK_SIZE; z += 1) {
+      for (S32 y = brick_min.y; y < brick_min.y + VOX_BRICK_SIZE; y += 1) {
+        for (S32 x = brick_min.x; x < brick_min.x + VOX_BRICK_SIZE; x += 1) {
+          V3S32 local_coord = v3s32(x, y, z);
+          S32 texel_idx = vox_idx_from_local_coord(local_coord);
+          S32 cell = (x + r) + (y + r)*p + (z + r)*p*p;
+          
+          VOX_LightTexel texel = 0;
+          if (solid[cell]) {
+            for (U32 face = 0; face < VOX_MeshFace_COUNT; face += 1) {
+              U32 axis = face / 2;
+              S32 sign = (face & 1) ? -1 : 1;
+              S32 normal_step = sign*steps[axis];
+              S32 front = cell + normal_step;
+              if (solid[front]) {
+                continue;
+              }
+              
+              U32 ao = vox_light_face_ao(solid, front, normal_step, steps[(axis + 1) % 3], steps[(axis + 2) % 3]);
+              texel |= (VOX_LightTexel)(ao << (face*VOX_LIGHT_AO_BITS));
+              
+              // Cast from just in front of the face's center, so the ray starts in
+              // the empty voxel the face looks into
+              if (vox_light_sun_face(sun, axis) == face) {
+                V3F32 pos = vox_world_pos_from_voxel_coord(v3s32_add(chunk_min, local_coord));
+                pos = v3f32_add(pos, v3f32(0.5f, 0.5f, 0.5f));
+                pos.e[axis] += (F32)sign*0.52f;
+                ro[rays_count] = pos;
+                rd[rays_count] = sun;
+                ray_texels[rays_count] = ((U32)texel_idx << 2) | axis;
+                rays_count += 1;
+              }
+            }
+          }
+          light->texels[texel_idx] = texel;
+        }
+      }
+    }
+  }
+  
+  VOX_RaycastResult *results = ArenaPushArrayNoZero(scratch, VOX_RaycastResult, rays_count);
+  // Packets of more than one lane beat vox_raycast on shadow rays through dense
+  // and sparse chunks alike (see -raycast_bench)
+  if (VOX_RAYCAST_PACKET_LANES > 1) {
+    vox_raycast_packet(world, 1.f, ro, rd, rays_count, results);
+  }
+  else {
+    for (U32 idx = 0; idx < rays_count; idx += 1) {
+      results[idx] = vox_raycast(world, 1.f, ro[idx], rd[idx]);
+    }
+  }
+  
+  F32 distance_max = (F32)VOX_LIGHT_SHADOW_DISTANCE;
+  for (U32 idx = 0; idx < rays_count; idx += 1) {
+    V3F32 occluder = vox_world_pos_from_voxel_coord(results[idx].coord);
+    occluder = v3f32_add(occluder, v3f32(0.5f, 0.5f, 0.5f));
+    B32 shadowed = (results[idx].hit && v3f32_length(v3f32_sub(occluder, ro[idx])) <= distance_max);
+    if (!shadowed) {
+      U32 texel_idx = ray_texels[idx] >> 2;
+      U32 axis = ray_texels[idx] & 3;
+      light->texels[texel_idx] |= (VOX_LightTexel)(1u << (VOX_LIGHT_SUN_SHIFT + axis));
+    }
+  }
+  
+  for (U32 idx = 0; idx < VOX_BRICK_SUMMARY_WORDS; idx += 1) {
+    light->upload_bricks[idx] |= light->dirty_bricks[idx];
+  }
+  vox_dirty_bricks_clear(light->dirty_bricks);
+  
+  return rays_count;
+}
+
+//
+// Light cache
+//
+
+function VOX_LightCache *
+vox_light_cache_alloc(void)
+{
+  // 64 KiB of texels per chunk
+  Arena *arena = arena_alloc(GiB(4llu));
+  VOX_LightCache *cache = ArenaPushStruct(arena, VOX_LightCache);
+  cache->arena = arena;
+  return cache;
+}
+
+function void
+vox_light_cache_release(VOX_LightCache *cache)
+{
+  if (cache) {
+    arena_release(cache->arena);
+  }
+}
+
+function VOX_ChunkLight *
+vox_light_from_chunk_coord(VOX_LightCache *cache, V3S32 chunk_coord)
+{
+  VOX_ChunkLight *result = 0;
+  
+  U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % VOX_LIGHT_CACHE_SLOTS;
+  VOX_LightSlot *slot = &cache->slots[slot_idx];
+  for (VOX_ChunkLight *l = slot->first; l != 0; l = l->hash_next) {
+    if (l->coord.x == chunk_coord.x && l->coord.y == chunk_coord.y && l->coord.z == chunk_coord.z) {
+      result = l;
+      break;
+    }
+  }
+  
+  return result;
+}
+
+function VOX_ChunkLight *
+vox_light_acquire(VOX_LightCache *cache, V3S32 chunk_coord)
+{
+  VOX_ChunkLight *light = cache->free;
+  if (light) {
+    SLLStackPop(cache->free);
+    MemoryZeroStruct(light);
+  }
+  else {
+    light = ArenaPushStruct(cache->arena, VOX_ChunkLight);
+  }
+  light->coord = chunk_coord;
+  vox_dirty_bricks_mark_all(light->dirty_bricks);
+  
+  U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % VOX_LIGHT_CACHE_SLOTS;
+  VOX_LightSlot *slot = &cache->slots[slot_idx];
+  DLLPushBackNP(slot->first, slot->last, light, hash_next, hash_prev);
+  DLLPushBack(cache->first, cache->last, light);
+  cache->lights_count += 1;
+  
+  return light;
+}
+
+function void
+vox_light_release(VOX_LightCache *cache, VOX_ChunkLight *light)
+{
+  U64 slot_idx = vox_hash_from_chunk_coord(light->coord) % VOX_LIGHT_CACHE_SLOTS;
+  VOX_LightSlot *slot = &cache->slots[slot_idx];
+  DLLRemoveNP(slot->first, slot->last, light, hash_next, hash_prev);
+  DLLRemove(cache->first, cache->last, light);
+  cache->lights_count -= 1;
+  
+  SLLStackPush(cache->free, light);
+}
+
+function B32
+vox_light_bricks_all(U64 *bricks)
+{
+  U64 all = ~(U64)0;
+  for (U32 idx = 0; idx < VOX_BRICK_SUMMARY_WORDS; idx += 1) {
+    all &= bricks[idx];
+  }
+  B32 result = (all == ~(U64)0);
+  return result;
+}
+
+// Marks every brick overlapping [min, max], in world voxel coordinates.
+function void
+vox_light_mark_box(VOX_LightCache *cache, V3F32 min, V3F32 max)
+{
+  V3S32 brick_min = {0};
+  V3S32 brick_max = {0};
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    brick_min.e[axis] = (S32)floorf32(min.e[axis] / VOX_BRICK_SIZE);
+    brick_max.e[axis] = (S32)floorf32(max.e[axis] / VOX_BRICK_SIZE);
+  }
+  V3S32 chunk_min = vox_chunk_coord_from_voxel_coord(v3s32_scale(brick_min, VOX_BRICK_SIZE));
+  V3S32 chunk_max = vox_chunk_coord_from_voxel_coord(v3s32_scale(brick_max, VOX_BRICK_SIZE));
+  
+  for (S32 cz = chunk_min.z; cz <= chunk_max.z; cz += 1) {
+    for (S32 cy = chunk_min.y; cy <= chunk_max.y; cy += 1) {
+      for (S32 cx = chunk_min.x; cx <= chunk_max.x; cx += 1) {
+        VOX_ChunkLight *light = vox_light_from_chunk_coord(cache, v3s32(cx, cy, cz));
+        if (!light || vox_light_bricks_all(light->dirty_bricks)) {
+          continue;
+        }
+        
+        // Bricks of the box within this chunk
+        V3S32 chunk_brick = v3s32_scale(v3s32(cx, cy, cz), VOX_BRICKS_PER_SLICE);
+        V3S32 lo = v3s32_sub(brick_min, chunk_brick);
+        V3S32 hi = v3s32_sub(brick_max, chunk_brick);
+        for (U32 axis = 0; axis < 3; axis += 1) {
+          lo.e[axis] = Max(lo.e[axis], 0);
+          hi.e[axis] = Min(hi.e[axis], VOX_BRICKS_PER_SLICE - 1);
+        }
+        
+        for (S32 bz = lo.z; bz <= hi.z; bz += 1) {
+          for (S32 by = lo.y; by <= hi.y; by += 1) {
+            for (S32 bx = lo.x; bx <= hi.x; bx += 1) {
+              S32 brick_idx = bx + by*VOX_BRICKS_PER_SLICE + bz*VOX_BRICKS_PER_SLICE*VOX_BRICKS_PER_SLICE;
+              light->dirty_bricks[brick_idx / 64] |= (U64)1 << (brick_idx % 64);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+function void
+vox_light_mark_edit(VOX_LightCache *cache, V3S32 min, V3S32 max)
+{
+  V3F32 sun = vox_light_sun_dir();
+  F32 reach = (F32)VOX_LIGHT_REACH;
+  
+  // A face is affected when its occlusion reads an edited voxel, or its shadow ray
+  // passes one: then the face lies somewhere along the ray back from the edit,
+  // away from the sun.
+  for (S32 t = 0; t <= VOX_LIGHT_SHADOW_DISTANCE + VOX_LIGHT_SWEEP_STEP; t += VOX_LIGHT_SWEEP_STEP) {
+    V3F32 offset = v3f32_scale(sun, -(F32)t);
+    V3F32 box_min = v3f32((F32)min.x - reach, (F32)min.y - reach, (F32)min.z - reach);
+    V3F32 box_max = v3f32((F32)max.x + reach, (F32)max.y + reach, (F32)max.z + reach);
+    vox_light_mark_box(cache, v3f32_add(box_min, offset), v3f32_add(box_max, offset));
+  }
+}
+
+// Box around the dirty bricks, in world voxel coordinates
+function void
+vox_light_edit_from_dirty_bricks(V3S32 chunk_coord, U64 *dirty_bricks, V3S32 *min_out, V3S32 *max_out)
+{
+  V3S32 min = v3s32(VOX_BRICKS_PER_SLICE, VOX_BRICKS_PER_SLICE, VOX_BRICKS_PER_SLICE);
+  V3S32 max = v3s32(0, 0, 0);
+  for (S32 brick_idx = 0; brick_idx < VOX_BRICKS_PER_CHUNK; brick_idx += 1) {
+    if ((dirty_bricks[brick_idx / 64] >> (brick_idx % 64)) & 1) {
+      V3S32 b = v3s32(brick_idx % VOX_BRICKS_PER_SLICE,
+                      brick_idx / VOX_BRICKS_PER_SLICE % VOX_BRICKS_PER_SLICE,
+                      brick_idx / (VOX_BRICKS_PER_SLICE*VOX_BRICKS_PER_SLICE));
+      for (U32 axis = 0; axis < 3; axis += 1) {
+        min.e[axis] = Min(min.e[axis], b.e[axis]);
+        max.e[axis] = Max(max.e[axis], b.e[axis] + 1);
+      }
+    }
+  }
+  
+  V3S32 chunk_min = v3s32_scale(chunk_coord, VOX_SLICE_SIZE);
+  *min_out = v3s32_add(chunk_min, v3s32_scale(min, VOX_BRICK_SIZE));
+  *max_out = v3s32_add(chunk_min, v3s32_scale(max, VOX_BRICK_SIZE));
+}
+
+function void
+vox_light_bake_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_LightJob *job = (VOX_LightJob *)user;
+  
+  for (U64 idx = first; idx < opl; idx += 1) {
+    TempArena temp = arena_temp_begin(scratch);
+    U32 rays_count = vox_light_bake(temp.arena, job->world, job->lights[idx]);
+    arena_temp_end(temp);
+    
+    // Only read once the jobs are done
+    U32 before = job->rays_count;
+    for (;;) {
+      U32 prev = os_interlocked_compare_exchange_32(&job->rays_count, before + rays_count, before);
+      if (prev == before) {
+        break;
+      }
+      before = prev;
+    }
+  }
+}
+
+function U32
+vox_light_cache_update(VOX_LightCache *cache, VOX_World *world)
+{
+  ProfBegin("light update");
+  
+  // Chunks that were released: whatever they occluded or shadowed is now open
+  for (VOX_ChunkLight *l = cache->first, *next = 0; l != 0; l = next) {
+    next = l->next;
+    if (!vox_world_chunk_from_coord(world, l->coord)) {
+      V3S32 min = v3s32_scale(l->coord, VOX_SLICE_SIZE);
+      V3S32 max = v3s32_add(min, v3s32(VOX_SLICE_SIZE, VOX_SLICE_SIZE, VOX_SLICE_SIZE));
+      vox_light_release(cache, l);
+      vox_light_mark_edit(cache, min, max);
+    }
+  }
+  
+  // New chunks are baked whole. Their voxels are dirty too, so like any other
+  // edit they also rebake what they occlude and shadow.
+  for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+    if (!vox_light_from_chunk_coord(cache, n->coord)) {
+      vox_light_acquire(cache, n->coord);
+    }
+  }
+  for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+    if (vox_dirty_bricks_any(n->dirty_bricks)) {
+      V3S32 min = {0};
+      V3S32 max = {0};
+      vox_light_edit_from_dirty_bricks(n->coord, n->dirty_bricks, &min, &max);
+      vox_light_mark_edit(cache, min, max);
+    }
+  }
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  VOX_ChunkLight **lights = ArenaPushArray(scratch.arena, VOX_ChunkLight *, cache->lights_count);
+  U32 lights_count = 0;
+  for (VOX_ChunkLight *l = cache->first; l != 0; l = l->next) {
+    if (vox_dirty_bricks_any(l->dirty_bricks)) {
+      lights[lights_count++] = l;
+    }
+  }
+  
+  VOX_LightJob job = {0};
+  job.world = world;
+  job.lights = lights;
+  async_parallel_for(lights_count, 1, vox_light_bake_work, &job);
+  
+  arena_scratch_end(scratch);
+  
+  ProfCounter("light volumes baked", lights_count);
+  ProfCounter("shadow rays", job.rays_count);
+  ProfEnd();
+  
+  return lights_count;
+}
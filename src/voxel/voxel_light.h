@@ -0,0 +1,106 @@
+#pragma once
+
+// NOTE: Baked lighting. Ambient occlusion and sun visibility are computed on the
+// CPU once per voxel face and stored per voxel, so the raymarcher only has to
+// look them up for the voxel it hits instead of sampling the neighborhood or
+// casting shadow rays per pixel.
+//
+// Occlusion looks at two layers of voxels in front of each face. Sun visibility
+// is a shadow ray toward the key light, cast through vox_raycast or
+// vox_raycast_packet, whichever is faster there, and cut off at
+// VOX_LIGHT_SHADOW_DISTANCE. Only the face on each axis that turns toward
+// the sun can be lit, so a voxel needs one visibility bit per axis.
+//
+// Volumes live in a cache keyed by chunk coordinate. vox_light_cache_update reads
+// the chunks' dirty bricks without clearing them; every consumer of them runs
+// before the renderer clears them once per frame (vox_world_clear_dirty_bricks).
+// An edit rebakes the bricks within VOX_LIGHT_REACH of it, and those whose shadow
+// rays can pass through it: a box swept away from the sun up to the shadow
+// distance.
+
+// A texel is packed into 16 bits:
+//   bits  0..11  ambient occlusion per face (VOX_MeshFace order), 2 bits each,
+//                0 (fully occluded) to 3 (open)
+//   bits 12..14  sun visibility of the sunward face on the x, y and z axis
+// Faces that touch another solid voxel, and empty voxels, are 0.
+typedef U16 VOX_LightTexel;
+
+#define VOX_LIGHT_AO_BITS   2
+#define VOX_LIGHT_SUN_SHIFT 12
+
+// Occlusion reads voxels up to 2 away from the face's voxel; the bake's padded
+// volume and the rebake around edits both cover that much.
+#define VOX_LIGHT_REACH 2
+#define VOX_LIGHT_PADDED_SIZE (VOX_SLICE_SIZE + 2*VOX_LIGHT_REACH)
+
+// In voxels. Occluders further along a shadow ray don't count, which bounds how
+// far an edit's shadow reaches and thus how much of the world it rebakes.
+#define VOX_LIGHT_SHADOW_DISTANCE 128
+
+// The box an edit rebakes is swept in steps of this many voxels; VOX_LIGHT_REACH
+// covers what lies between the steps.
+#define VOX_LIGHT_SWEEP_STEP 2
+
+#define VOX_LIGHT_CACHE_SLOTS 1024
+
+struct VOX_ChunkLight {
+  // Cache list
+  VOX_ChunkLight *next;
+  VOX_ChunkLight *prev;
+  
+  // Hash slot chain
+  VOX_ChunkLight *hash_next;
+  VOX_ChunkLight *hash_prev;
+  
+  V3S32 coord;
+  U64 dirty_bricks[VOX_BRICK_SUMMARY_WORDS];  // Bricks to rebake
+  U64 upload_bricks[VOX_BRICK_SUMMARY_WORDS]; // Bricks rebaked since the renderer last copied them
+  VOX_LightTexel texels[VOX_CHUNK_SIZE];      // Same layout as the chunk's voxels
+};
+
+struct VOX_LightSlot {
+  VOX_ChunkLight *first;
+  VOX_ChunkLight *last;
+};
+
+struct VOX_LightCache {
+  Arena *arena;
+  
+  VOX_LightSlot slots[VOX_LIGHT_CACHE_SLOTS];
+  VOX_ChunkLight *first;
+  VOX_ChunkLight *last;
+  U32 lights_count;
+  VOX_ChunkLight *free;
+};
+
+struct VOX_LightJob {
+  VOX_World *world;
+  VOX_ChunkLight **lights;
+  volatile U32 rays_count;
+};
+
+// Direction toward the key light of shaders/fullscreen.hlsl, normalized.
+function V3F32 vox_light_sun_dir(void);
+
+function U32 vox_light_texel_ao(VOX_LightTexel texel, VOX_MeshFace face);
+// 1 when the face turns toward the sun and nothing blocks it, 0 otherwise
+function U32 vox_light_texel_sun(VOX_LightTexel texel, VOX_MeshFace face);
+
+function VOX_LightCache *vox_light_cache_alloc(void);
+function void vox_light_cache_release(VOX_LightCache *cache);
+
+function VOX_ChunkLight *vox_light_from_chunk_coord(VOX_LightCache *cache, V3S32 chunk_coord);
+
+// Rebakes the bricks whose occlusion or shadow rays can see the voxels in
+// [min, max), in world voxel coordinates.
+function void vox_light_mark_edit(VOX_LightCache *cache, V3S32 min, V3S32 max);
+
+// Bakes one chunk's dirty bricks; `scratch` holds the padded volume and the rays.
+// Returns the number of shadow rays cast.
+function U32 vox_light_bake(Arena *scratch, VOX_World *world, VOX_ChunkLight *light);
+
+// Brings the cache in line with the world: adds volumes for new chunks, drops
+// those of released chunks, and rebakes everything the world's dirty bricks can
+// affect, in parallel on the async workers. Leaves the dirty bricks set. Returns
+// the number of volumes rebaked.
+function U32 vox_light_cache_update(VOX_LightCache *cache, VOX_World *world);
@@ -0,0 +1,258 @@
+//
+// Pyramid
+//
+
+function S32
+vox_lod_level_size(U32 level)
+{
+  S32 result = VOX_SLICE_SIZE >> level;
+  return result;
+}
+
+function VOX_Voxel *
+vox_lod_level_voxels(VOX_ChunkLod *lod, U32 level)
+{
+  U64 offset = 0;
+  for (U32 l = 1; l < level; l += 1) {
+    U64 size = (U64)vox_lod_level_size(l);
+    offset += size*size*size;
+  }
+  VOX_Voxel *result = lod->voxels + offset;
+  return result;
+}
+
+function S32
+vox_lod_idx_from_cell(U32 level, V3S32 cell)
+{
+  S32 size = vox_lod_level_size(level);
+  S32 result = cell.x + cell.y*size + cell.z*size*size;
+  return result;
+}
+
+function VOX_Voxel
+vox_lod_get_voxel(VOX_ChunkLod *lod, U32 level, V3S32 cell)
+{
+  VOX_Voxel result = vox_lod_level_voxels(lod, level)[vox_lod_idx_from_cell(level, cell)];
+  return result;
+}
+
+function VOX_Voxel
+vox_lod_reduce(VOX_Voxel *children)
+{
+  VOX_Voxel result = {0};
+  
+  U32 solid_count = 0;
+  for (U32 idx = 0; idx < 8; idx += 1) {
+    solid_count += (children[idx].opacity != 0);
+  }
+  
+  if (solid_count*2 >= 8) {
+    U32 best_count = 0;
+    for (U32 idx = 0; idx < 8; idx += 1) {
+      if (children[idx].opacity == 0) {
+        continue;
+      }
+      U32 count = 0;
+      for (U32 other = 0; other < 8; other += 1) {
+        count += (children[other].opacity != 0 && children[other].color == children[idx].color);
+      }
+      if (count > best_count) {
+        best_count = count;
+        result = children[idx];
+      }
+    }
+  }
+  
+  return result;
+}
+
+// Reduces the level's cell from the 2^3 cells below it; level 1 reads the chunk.
+function void
+vox_lod_build_cell(VOX_ChunkLod *lod, VOX_Chunk *chunk, U32 level, V3S32 cell)
+{
+  VOX_Voxel children[8];
+  for (U32 idx = 0; idx < 8; idx += 1) {
+    V3S32 child = v3s32(cell.x*2 + (idx & 1), cell.y*2 + ((idx >> 1) & 1), cell.z*2 + (idx >> 2));
+    if (level == 1) {
+      children[idx] = *vox_get_voxel(chunk, vox_idx_from_local_coord(child));
+    }
+    else {
+      children[idx] = vox_lod_get_voxel(lod, level - 1, child);
+    }
+  }
+  vox_lod_level_voxels(lod, level)[vox_lod_idx_from_cell(level, cell)] = vox_lod_reduce(children);
+}
+
+function void
+vox_lod_build(VOX_ChunkLod *lod, VOX_Chunk *chunk)
+{
+  // A brick covers 2^3 cells of level 1 and one cell of level 2
+  for (S32 brick_idx = 0; brick_idx < VOX_BRICKS_PER_CHUNK; brick_idx += 1) {
+    if (((lod->dirty_bricks[brick_idx / 64] >> (brick_idx % 64)) & 1) == 0) {
+      continue;
+    }
+    V3S32 b = v3s32(brick_idx % VOX_BRICKS_PER_SLICE,
+                    brick_idx / VOX_BRICKS_PER_SLICE % VOX_BRICKS_PER_SLICE,
+                    brick_idx / (VOX_BRICKS_PER_SLICE*VOX_BRICKS_PER_SLICE));
+    for (U32 idx = 0; idx < 8; idx += 1) {
+      V3S32 cell = v3s32(b.x*2 + (idx & 1), b.y*2 + ((idx >> 1) & 1), b.z*2 + (idx >> 2));
+      vox_lod_build_cell(lod, chunk, 1, cell);
+    }
+    vox_lod_build_cell(lod, chunk, 2, b);
+  }
+  
+  for (U32 level = 3; level < VOX_LOD_LEVELS; level += 1) {
+    S32 size = vox_lod_level_size(level);
+    for (S32 z = 0; z < size; z += 1) {
+      for (S32 y = 0; y < size; y += 1) {
+        for (S32 x = 0; x < size; x += 1) {
+          vox_lod_build_cell(lod, chunk, level, v3s32(x, y, z));
+        }
+      }
+    }
+  }
+  
+  vox_dirty_bricks_clear(lod->dirty_bricks);
+  lod->version += 1;
+}
+
+function U32
+vox_lod_level_from_footprint(F32 footprint)
+{
+  U32 result = 0;
+  while (result + 1 < VOX_LOD_LEVELS && footprint >= (F32)(2u << result)) {
+    result += 1;
+  }
+  return result;
+}
+
+//
+// Pyramid cache
+//
+
+function VOX_LodCache *
+vox_lod_cache_alloc(void)
+{
+  // ~18 KiB per chunk
+  Arena *arena = arena_alloc(GiB(4llu));
+  VOX_LodCache *cache = ArenaPushStruct(arena, VOX_LodCache);
+  cache->arena = arena;
+  return cache;
+}
+
+function void
+vox_lod_cache_release(VOX_LodCache *cache)
+{
+  if (cache) {
+    arena_release(cache->arena);
+  }
+}
+
+function VOX_ChunkLod *
+vox_lod_from_chunk_coord(VOX_LodCache *cache, V3S32 chunk_coord)
+{
+  VOX_ChunkLod *result = 0;
+  
+  U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % VOX_LOD_CACHE_SLOTS;
+  VOX_LodSlot *slot = &cache->slots[slot_idx];
+  for (VOX_ChunkLod *l = slot->first; l != 0; l = l->hash_next) {
+    if (l->coord.x == chunk_coord.x && l->coord.y == chunk_coord.y && l->coord.z == chunk_coord.z) {
+      result = l;
+      break;
+    }
+  }
+  
+  return result;
+}
+
+function VOX_ChunkLod *
+vox_lod_acquire(VOX_LodCache *cache, V3S32 chunk_coord)
+{
+  VOX_ChunkLod *lod = cache->free;
+  if (lod) {
+    SLLStackPop(cache->free);
+    MemoryZeroStruct(lod);
+  }
+  else {
+    lod = ArenaPushStruct(cache->arena, VOX_ChunkLod);
+  }
+  lod->coord = chunk_coord;
+  vox_dirty_bricks_mark_all(lod->dirty_bricks);
+  
+  U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % VOX_LOD_CACHE_SLOTS;
+  VOX_LodSlot *slot = &cache->slots[slot_idx];
+  DLLPushBackNP(slot->first, slot->last, lod, hash_next, hash_prev);
+  DLLPushBack(cache->first, cache->last, lod);
+  cache->lods_count += 1;
+  
+  return lod;
+}
+
+function void
+vox_lod_release(VOX_LodCache *cache, VOX_ChunkLod *lod)
+{
+  U64 slot_idx = vox_hash_from_chunk_coord(lod->coord) % VOX_LOD_CACHE_SLOTS;
+  VOX_LodSlot *slot = &cache->slots[slot_idx];
+  DLLRemoveNP(slot->first, slot->last, lod, hash_next, hash_prev);
+  DLLRemove(cache->first, cache->last, lod);
+  cache->lods_count -= 1;
+  
+  SLLStackPush(cache->free, lod);
+}
+
+function void
+vox_lod_build_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_LodJob *job = (VOX_LodJob *)user;
+  
+  for (U64 idx = first; idx < opl; idx += 1) {
+    VOX_ChunkLod *lod = job->lods[idx];
+    VOX_ChunkNode *node = vox_world_chunk_from_coord(job->world, lod->coord);
+    vox_lod_build(lod, &node->chunk);
+  }
+}
+
+function U32
+vox_lod_cache_update(VOX_LodCache *cache, VOX_World *world)
+{
+  ProfBegin("lod update");
+  
+  for (VOX_ChunkLod *l = cache->first, *next = 0; l != 0; l = next) {
+    next = l->next;
+    if (!vox_world_chunk_from_coord(world, l->coord)) {
+      vox_lod_release(cache, l);
+    }
+  }
+  
+  for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+    VOX_ChunkLod *lod = vox_lod_from_chunk_coord(cache, n->coord);
+    if (!lod) {
+      lod = vox_lod_acquire(cache, n->coord);
+    }
+    for (U32 idx = 0; idx < VOX_BRICK_SUMMARY_WORDS; idx += 1) {
+      lod->dirty_bricks[idx] |= n->dirty_bricks[idx];
+    }
+  }
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  VOX_ChunkLod **lods = ArenaPushArray(scratch.arena, VOX_ChunkLod *, cache->lods_count);
+  U32 lods_count = 0;
+  for (VOX_ChunkLod *l = cache->first; l != 0; l = l->next) {
+    if (vox_dirty_bricks_any(l->dirty_bricks)) {
+      lods[lods_count++] = l;
+    }
+  }
+  
+  VOX_LodJob job = {0};
+  job.world = world;
+  job.lods = lods;
+  async_parallel_for(lods_count, 1, vox_lod_build_work, &job);
+  
+  arena_scratch_end(scratch);
+  
+  ProfCounter("lod pyramids rebuilt", lods_count);
+  ProfEnd();
+  
+  return lods_count;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+// NOTE: Level-of-detail pyramid. Every chunk gets a mip chain of coarser copies of
+// itself, 32^3 (level 0, the chunk) down to 1^3, so far geometry can be traversed
+// in a handful of big cells instead of many voxels that are smaller than a pixel.
+//
+// A coarse voxel reduces the 2^3 voxels of the level below by majority vote: it is
+// solid when at least half of them are, and then copies the first solid child of
+// the color most of the solid children share.
+//
+// Pyramids live in a cache keyed by chunk coordinate. Like the light cache,
+// vox_lod_cache_update reads the chunks' dirty bricks without clearing them, and
+// relies on the renderer clearing them at the end of every frame. A dirty brick
+// rebuilds the level 1 and 2 voxels it covers, and the levels above, which are
+// tiny, are rebuilt whole.
+//
+// Which level a ray uses is picked from its footprint: the width of the pixel's
+// cone at the distance travelled. A level's cells are 2^level voxels wide, so
+// the level is log2 of the footprint, plus a bias to trade detail for speed.
+
+#define VOX_LOD_LEVELS 6
+
+// Voxels of levels 1 to VOX_LOD_LEVELS - 1
+#define VOX_LOD_VOXELS_COUNT (16*16*16 + 8*8*8 + 4*4*4 + 2*2*2 + 1)
+
+#define VOX_LOD_CACHE_SLOTS 1024
+
+struct VOX_ChunkLod {
+  // Cache list
+  VOX_ChunkLod *next;
+  VOX_ChunkLod *prev;
+  
+  // Hash slot chain
+  VOX_ChunkLod *hash_next;
+  VOX_ChunkLod *hash_prev;
+  
+  V3S32 coord;
+  U64 dirty_bricks[VOX_BRICK_SUMMARY_WORDS]; // Bricks whose coarse voxels need rebuilding
+  U64 version; // Bumped by every rebuild, so a renderer can tell its copy is stale
+  
+  // Level 1 first. Within a level, x + y*size + z*size^2 like a 3D texture's mip.
+  VOX_Voxel voxels[VOX_LOD_VOXELS_COUNT];
+};
+
+struct VOX_LodSlot {
+  VOX_ChunkLod *first;
+  VOX_ChunkLod *last;
+};
+
+struct VOX_LodCache {
+  Arena *arena;
+  
+  VOX_LodSlot slots[VOX_LOD_CACHE_SLOTS];
+  VOX_ChunkLod *first;
+  VOX_ChunkLod *last;
+  U32 lods_count;
+  VOX_ChunkLod *free;
+};
+
+struct VOX_LodJob {
+  VOX_World *world;
+  VOX_ChunkLod **lods;
+};
+
+// Cells per side of a level: VOX_SLICE_SIZE >> level
+function S32 vox_lod_level_size(U32 level);
+// Voxels of a level (1 to VOX_LOD_LEVELS - 1)
+function VOX_Voxel *vox_lod_level_voxels(VOX_ChunkLod *lod, U32 level);
+function VOX_Voxel vox_lod_get_voxel(VOX_ChunkLod *lod, U32 level, V3S32 cell);
+
+// Coarse voxel of 8 children, by majority vote
+function VOX_Voxel vox_lod_reduce(VOX_Voxel *children);
+
+// Rebuilds the coarse voxels covered by the pyramid's dirty bricks and clears them.
+function void vox_lod_build(VOX_ChunkLod *lod, VOX_Chunk *chunk);
+
+// Level to traverse a ray at when its cone is `footprint` voxels wide, bias
+// included: floor(log2(footprint)), clamped to the levels there are
+function U32 vox_lod_level_from_footprint(F32 footprint);
+
+function VOX_LodCache *vox_lod_cache_alloc(void);
+function void vox_lod_cache_release(VOX_LodCache *cache);
+
+function VOX_ChunkLod *vox_lod_from_chunk_coord(VOX_LodCache *cache, V3S32 chunk_coord);
+
+// Brings the cache in line with the world: adds pyramids for new chunks, drops
+// those of released chunks, and rebuilds what the world's dirty bricks cover, in
+// parallel on the async workers. Leaves the dirty bricks set. Returns the number
+// of pyramids rebuilt.
+function U32 vox_lod_cache_update(VOX_LodCache *cache, VOX_World *world);
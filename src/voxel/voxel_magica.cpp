@@ -0,0 +1,854 @@
+//
+// Chunk contents
+//
+
+function U32
+vox_magica_read_u32(VOX_MagicaReader *reader)
+{
+  U32 result = 0;
+  if (!str8_read(&result, reader->data, reader->off, sizeof(result))) {
+    reader->failed = 1;
+  }
+  reader->off += sizeof(result);
+  return result;
+}
+
+function String8
+vox_magica_read_str8(VOX_MagicaReader *reader)
+{
+  String8 result = {0};
+  U64 count = vox_magica_read_u32(reader);
+  if (!reader->failed && count <= reader->data.count - reader->off) {
+    result = str8(reader->data.data + reader->off, count);
+  }
+  else {
+    reader->failed = 1;
+  }
+  reader->off += count;
+  return result;
+}
+
+// Skips a dictionary and returns the value of `key` in it, or an empty string.
+function String8
+vox_magica_read_dict(VOX_MagicaReader *reader, String8 key)
+{
+  String8 result = {0};
+  U32 pairs_count = vox_magica_read_u32(reader);
+  for (U32 idx = 0; idx < pairs_count && !reader->failed; idx += 1) {
+    String8 pair_key = vox_magica_read_str8(reader);
+    String8 pair_value = vox_magica_read_str8(reader);
+    if (str8_equal(pair_key, key)) {
+      result = pair_value;
+    }
+  }
+  return result;
+}
+
+// Parses the next integer of a space-separated list such as "_t" values.
+function S32
+vox_magica_s32_from_str8(String8 str, U64 *off)
+{
+  U64 at = *off;
+  while (at < str.count && str.data[at] == ' ') {
+    at += 1;
+  }
+  
+  B32 negative = 0;
+  if (at < str.count && str.data[at] == '-') {
+    negative = 1;
+    at += 1;
+  }
+  
+  S32 result = 0;
+  while (at < str.count && is_numeric((char)str.data[at])) {
+    result = result*10 + (S32)(str.data[at] - '0');
+    at += 1;
+  }
+  
+  *off = at;
+  return negative ? -result : result;
+}
+
+function VOX_MagicaTransform
+vox_magica_transform_identity(void)
+{
+  VOX_MagicaTransform result = {0};
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    result.r[axis][axis] = 1;
+  }
+  return result;
+}
+
+// Row i has its non-zero entry in column bits[2i..2i+1] for the first two rows
+// and in the remaining column for the third; bit 4 + i makes it -1.
+function VOX_MagicaTransform
+vox_magica_transform_from_frame(String8 translation, String8 rotation)
+{
+  VOX_MagicaTransform result = vox_magica_transform_identity();
+  
+  U64 off = 0;
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    result.t[axis] = vox_magica_s32_from_str8(translation, &off);
+  }
+  
+  if (rotation.count > 0) {
+    U64 rotation_off = 0;
+    U32 bits = (U32)vox_magica_s32_from_str8(rotation, &rotation_off);
+    U32 col0 = bits & 3;
+    U32 col1 = (bits >> 2) & 3;
+    if (col0 < 3 && col1 < 3 && col0 != col1) {
+      U32 cols[3] = { col0, col1, 3 - col0 - col1 };
+      MemoryZero(result.r, sizeof(result.r));
+      for (U32 row = 0; row < 3; row += 1) {
+        result.r[row][cols[row]] = ((bits >> (4 + row)) & 1) ? -1 : 1;
+      }
+    }
+  }
+  
+  return result;
+}
+
+// parent * child: the child's transform applied first
+function VOX_MagicaTransform
+vox_magica_transform_mul(VOX_MagicaTransform *parent, VOX_MagicaTransform *child)
+{
+  VOX_MagicaTransform result = {0};
+  for (U32 row = 0; row < 3; row += 1) {
+    result.t[row] = parent->t[row];
+    for (U32 k = 0; k < 3; k += 1) {
+      result.t[row] += parent->r[row][k]*child->t[k];
+      for (U32 col = 0; col < 3; col += 1) {
+        result.r[row][col] += parent->r[row][k]*child->r[k][col];
+      }
+    }
+  }
+  return result;
+}
+
+// floor(a / 2)
+function S32
+vox_magica_floor_half(S32 a)
+{
+  S32 result = (a - (a < 0)) / 2;
+  return result;
+}
+
+//
+// Reader
+//
+
+function VOX_MagicaFile
+vox_magica_file_from_data(Arena *arena, String8 data)
+{
+  VOX_MagicaFile file = {0};
+  file.data = data;
+  
+  U32 header[5] = {0};
+  B32 valid = (str8_read(header, data, 0, sizeof(header)) &&
+               header[0] == VOX_MAGICA_MAGIC &&
+               header[1] >= VOX_MAGICA_VERSION &&
+               header[2] == VOX_MAGICA_CHUNK_ID('M', 'A', 'I', 'N') &&
+               header[3] <= data.count - sizeof(header));
+  U64 children_first = sizeof(header) + (U64)header[3];
+  U64 children_opl = children_first + (U64)header[4];
+  valid = valid && children_opl <= data.count;
+  
+  // The first pass counts models and nodes, the second records them. Both only
+  // read chunk headers, plus the few bytes that identify a model or node.
+  for (U32 pass = 0; pass < 2 && valid; pass += 1) {
+    if (pass == 1) {
+      file.models = ArenaPushArray(arena, VOX_MagicaModel, file.models_count);
+      file.nodes = ArenaPushArray(arena, VOX_MagicaNode, file.nodes_count);
+    }
+    
+    U32 models_count = 0;
+    U32 nodes_count = 0;
+    S32 size[3] = {0};
+    B32 has_size = 0;
+    
+    for (U64 off = children_first; off < children_opl && valid;) {
+      U32 chunk[3] = {0};
+      if (sizeof(chunk) > children_opl - off ||
+          !str8_read(chunk, data, off, sizeof(chunk)) ||
+          (U64)chunk[1] + chunk[2] > children_opl - off - sizeof(chunk)) {
+        valid = 0;
+        break;
+      }
+      String8 content = str8(data.data + off + sizeof(chunk), chunk[1]);
+      
+      switch (chunk[0]) {
+        case VOX_MAGICA_CHUNK_ID('S', 'I', 'Z', 'E'): {
+          valid = str8_read(size, content, 0, sizeof(size));
+          for (U32 axis = 0; axis < 3; axis += 1) {
+            valid = valid && size[axis] > 0 && size[axis] <= VOX_MAGICA_MODEL_SIZE_MAX;
+          }
+          has_size = 1;
+        }break;
+        
+        case VOX_MAGICA_CHUNK_ID('X', 'Y', 'Z', 'I'): {
+          U32 voxels_count = 0;
+          valid = (has_size && str8_read(&voxels_count, content, 0, sizeof(voxels_count)) &&
+                   (U64)voxels_count*4 <= content.count - sizeof(voxels_count));
+          if (valid && pass == 1) {
+            VOX_MagicaModel *model = &file.models[models_count];
+            MemoryCopy(model->size, size, sizeof(size));
+            model->voxels_count = voxels_count;
+            model->voxels = content.data + sizeof(voxels_count);
+          }
+          models_count += 1;
+          has_size = 0;
+        }break;
+        
+        case VOX_MAGICA_CHUNK_ID('R', 'G', 'B', 'A'): {
+          file.has_palette = str8_read(file.palette, content, 0, sizeof(file.palette));
+        }break;
+        
+        case VOX_MAGICA_CHUNK_ID('n', 'T', 'R', 'N'):
+        case VOX_MAGICA_CHUNK_ID('n', 'G', 'R', 'P'):
+        case VOX_MAGICA_CHUNK_ID('n', 'S', 'H', 'P'): {
+          S32 node_id = 0;
+          valid = str8_read(&node_id, content, 0, sizeof(node_id));
+          if (valid && pass == 1) {
+            VOX_MagicaNode *node = &file.nodes[nodes_count];
+            node->chunk_id = chunk[0];
+            node->node_id = node_id;
+            node->content = content;
+          }
+          nodes_count += 1;
+        }break;
+      }
+      
+      off += sizeof(chunk) + (U64)chunk[1] + chunk[2];
+    }
+    
+    file.models_count = models_count;
+    file.nodes_count = nodes_count;
+  }
+  
+  file.valid = valid;
+  return file;
+}
+
+function VOX_MagicaNode *
+vox_magica_node_from_id(VOX_MagicaFile *file, S32 node_id)
+{
+  VOX_MagicaNode *result = 0;
+  
+  // Writers number nodes in file order, so that is the first guess
+  if (node_id >= 0 && (U32)node_id < file->nodes_count && file->nodes[node_id].node_id == node_id) {
+    result = &file->nodes[node_id];
+  }
+  else {
+    for (U32 idx = 0; idx < file->nodes_count; idx += 1) {
+      if (file->nodes[idx].node_id == node_id) {
+        result = &file->nodes[idx];
+        break;
+      }
+    }
+  }
+  
+  return result;
+}
+
+function void
+vox_magica_instance_push(Arena *arena, VOX_MagicaInstanceList *list, VOX_MagicaModel *model, VOX_MagicaTransform *transform)
+{
+  VOX_MagicaInstance *instance = ArenaPushStruct(arena, VOX_MagicaInstance);
+  instance->model = model;
+  instance->transform = *transform;
+  SLLQueuePush(list->first, list->last, instance);
+  list->count += 1;
+}
+
+function void
+vox_magica_walk(Arena *arena, VOX_MagicaFile *file, S32 node_id, VOX_MagicaTransform *parent, U32 depth, VOX_MagicaInstanceList *list)
+{
+  // The graph is a tree, so no node is walked twice unless the file is broken
+  VOX_MagicaNode *node = vox_magica_node_from_id(file, node_id);
+  if (!node || depth >= VOX_MAGICA_GRAPH_DEPTH_MAX || list->nodes_walked >= file->nodes_count) {
+    return;
+  }
+  list->nodes_walked += 1;
+  
+  VOX_MagicaReader reader = {0};
+  reader.data = node->content;
+  vox_magica_read_u32(&reader);
+  String8 hidden = vox_magica_read_dict(&reader, S8("_hidden"));
+  if (str8_equal(hidden, S8("1"))) {
+    return;
+  }
+  
+  switch (node->chunk_id) {
+    case VOX_MAGICA_CHUNK_ID('n', 'T', 'R', 'N'): {
+      S32 child_id = (S32)vox_magica_read_u32(&reader);
+      vox_magica_read_u32(&reader); // Reserved
+      vox_magica_read_u32(&reader); // Layer
+      U32 frames_count = vox_magica_read_u32(&reader);
+      
+      // Animated transforms are placed at their first frame
+      String8 translation = {0};
+      String8 rotation = {0};
+      if (frames_count > 0) {
+        VOX_MagicaReader frame = reader;
+        translation = vox_magica_read_dict(&frame, S8("_t"));
+        frame = reader;
+        rotation = vox_magica_read_dict(&frame, S8("_r"));
+        reader.failed |= frame.failed;
+      }
+      
+      if (!reader.failed) {
+        VOX_MagicaTransform frame_transform = vox_magica_transform_from_frame(translation, rotation);
+        VOX_MagicaTransform transform = vox_magica_transform_mul(parent, &frame_transform);
+        vox_magica_walk(arena, file, child_id, &transform, depth + 1, list);
+      }
+    }break;
+    
+    case VOX_MAGICA_CHUNK_ID('n', 'G', 'R', 'P'): {
+      U32 children_count = vox_magica_read_u32(&reader);
+      for (U32 idx = 0; idx < children_count; idx += 1) {
+        S32 child_id = (S32)vox_magica_read_u32(&reader);
+        if (reader.failed) {
+          break;
+        }
+        vox_magica_walk(arena, file, child_id, parent, depth + 1, list);
+      }
+    }break;
+    
+    case VOX_MAGICA_CHUNK_ID('n', 'S', 'H', 'P'): {
+      // Animated shapes show their first model
+      U32 models_count = vox_magica_read_u32(&reader);
+      U32 model_idx = vox_magica_read_u32(&reader);
+      if (!reader.failed && models_count > 0 && model_idx < file->models_count) {
+        vox_magica_instance_push(arena, list, &file->models[model_idx], parent);
+      }
+    }break;
+  }
+}
+
+function VOX_MagicaInstance *
+vox_magica_instances_from_file(Arena *arena, VOX_MagicaFile *file, U32 *instances_count)
+{
+  VOX_MagicaInstanceList list = {0};
+  VOX_MagicaTransform identity = vox_magica_transform_identity();
+  
+  if (file->nodes_count > 0) {
+    vox_magica_walk(arena, file, 0, &identity, 0, &list);
+  }
+  else {
+    for (U32 idx = 0; idx < file->models_count; idx += 1) {
+      VOX_MagicaModel *model = &file->models[idx];
+      VOX_MagicaTransform transform = identity;
+      for (U32 axis = 0; axis < 3; axis += 1) {
+        transform.t[axis] = model->size[axis] / 2;
+      }
+      vox_magica_instance_push(arena, &list, model, &transform);
+    }
+  }
+  
+  *instances_count = list.count;
+  return list.first;
+}
+
+// A signed permutation moves each model axis onto one scene axis, so every world
+// axis is an offset plus or minus one model coordinate.
+function void
+vox_magica_instance_place(VOX_MagicaInstance *instance)
+{
+  VOX_MagicaTransform *transform = &instance->transform;
+  S32 *size = instance->model->size;
+  
+  S32 scene_offset[3];
+  S32 scene_step[3];
+  U32 scene_source[3];
+  for (U32 row = 0; row < 3; row += 1) {
+    S32 centered_min = 0; // Twice voxel 0's center, relative to the model's center
+    for (U32 col = 0; col < 3; col += 1) {
+      if (transform->r[row][col] != 0) {
+        scene_source[row] = col;
+        scene_step[row] = transform->r[row][col];
+        centered_min = transform->r[row][col]*(1 - size[col]);
+      }
+    }
+    scene_offset[row] = transform->t[row] + vox_magica_floor_half(centered_min);
+  }
+  
+  // z-up to y-up
+  U32 scene_from_world[3] = { 0, 2, 1 };
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    U32 row = scene_from_world[axis];
+    instance->offset.e[axis] = scene_offset[row];
+    instance->step.e[axis] = scene_step[row];
+    instance->source[axis] = scene_source[row];
+    
+    S32 last = scene_offset[row] + scene_step[row]*(size[scene_source[row]] - 1);
+    instance->voxel_min.e[axis] = Min(scene_offset[row], last);
+    instance->voxel_max.e[axis] = Max(scene_offset[row], last);
+  }
+  
+  instance->chunk_min = vox_chunk_coord_from_voxel_coord(instance->voxel_min);
+  V3S32 chunk_max = vox_chunk_coord_from_voxel_coord(instance->voxel_max);
+  instance->chunk_dim = v3s32_add(v3s32_sub(chunk_max, instance->chunk_min), v3s32(1, 1, 1));
+}
+
+// Color index 0 is empty, and voxels outside the model's size are dropped
+function B32
+vox_magica_voxel_in_model(VOX_MagicaModel *model, U8 *v)
+{
+  B32 result = (v[3] != 0 && v[0] < model->size[0] && v[1] < model->size[1] && v[2] < model->size[2]);
+  return result;
+}
+
+function void
+vox_magica_scatter_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_MagicaScatterItem *items = (VOX_MagicaScatterItem *)user;
+  
+  for (U64 item_idx = first; item_idx < opl; item_idx += 1) {
+    VOX_MagicaScatterItem *item = &items[item_idx];
+    VOX_MagicaInstance *instance = item->instance;
+    
+    // Relative to the min corner of the chunk grid, so chunk and local coordinates
+    // are a shift and a mask
+    V3S32 offset = v3s32_sub(instance->offset, v3s32_scale(instance->chunk_min, VOX_SLICE_SIZE));
+    V3S32 step = instance->step;
+    U32 sx = instance->source[0];
+    U32 sy = instance->source[1];
+    U32 sz = instance->source[2];
+    S32 dim_x = instance->chunk_dim.x;
+    S32 dim_xy = instance->chunk_dim.x*instance->chunk_dim.y;
+    
+    U8 *voxels = instance->model->voxels;
+    for (U32 idx = item->first; idx < item->opl; idx += 1) {
+      U8 *v = &voxels[idx*4];
+      if (!vox_magica_voxel_in_model(instance->model, v)) {
+        continue;
+      }
+      S32 x = offset.x + step.x*v[sx];
+      S32 y = offset.y + step.y*v[sy];
+      S32 z = offset.z + step.z*v[sz];
+      
+      S32 chunk_idx = (x >> VOX_SLICE_SIZE_LOG2) + (y >> VOX_SLICE_SIZE_LOG2)*dim_x + (z >> VOX_SLICE_SIZE_LOG2)*dim_xy;
+      V3S32 local_coord = v3s32(x & (VOX_SLICE_SIZE - 1), y & (VOX_SLICE_SIZE - 1), z & (VOX_SLICE_SIZE - 1));
+      
+      VOX_Voxel voxel = {0};
+      voxel.opacity = 255;
+      voxel.color = (U8)(v[3] - 1);
+      instance->chunks[chunk_idx]->chunk.voxels[vox_idx_from_local_coord(local_coord)] = voxel;
+    }
+  }
+}
+
+function void
+vox_magica_mark_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_MagicaScatterItem *items = (VOX_MagicaScatterItem *)user;
+  
+  for (U64 item_idx = first; item_idx < opl; item_idx += 1) {
+    VOX_MagicaScatterItem *item = &items[item_idx];
+    VOX_MagicaInstance *instance = item->instance;
+    V3S32 offset = v3s32_sub(instance->offset, v3s32_scale(instance->chunk_min, VOX_SLICE_SIZE));
+    S32 dim_x = instance->chunk_dim.x;
+    S32 dim_xy = instance->chunk_dim.x*instance->chunk_dim.y;
+    
+    U8 *voxels = instance->model->voxels;
+    for (U32 idx = item->first; idx < item->opl; idx += 1) {
+      U8 *v = &voxels[idx*4];
+      if (!vox_magica_voxel_in_model(instance->model, v)) {
+        continue;
+      }
+      S32 x = (offset.x + instance->step.x*v[instance->source[0]]) >> VOX_SLICE_SIZE_LOG2;
+      S32 y = (offset.y + instance->step.y*v[instance->source[1]]) >> VOX_SLICE_SIZE_LOG2;
+      S32 z = (offset.z + instance->step.z*v[instance->source[2]]) >> VOX_SLICE_SIZE_LOG2;
+      item->touched[x + y*dim_x + z*dim_xy] = 1;
+    }
+  }
+}
+
+function B32
+vox_magica_instances_overlap(VOX_MagicaInstance *a, VOX_MagicaInstance *b)
+{
+  B32 result = 1;
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    result = result && a->voxel_min.e[axis] <= b->voxel_max.e[axis] && b->voxel_min.e[axis] <= a->voxel_max.e[axis];
+  }
+  return result;
+}
+
+function VOX_MagicaImport
+vox_magica_import_from_data(VOX_World *world, String8 data)
+{
+  ProfBegin("vox_magica_import");
+  
+  VOX_MagicaImport result = {0};
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  VOX_MagicaFile file = vox_magica_file_from_data(scratch.arena, data);
+  if (file.valid) {
+    U32 instances_count = 0;
+    VOX_MagicaInstance *instances = vox_magica_instances_from_file(scratch.arena, &file, &instances_count);
+    
+    U32 waves_count = 0;
+    U32 items_count = 0;
+    for (VOX_MagicaInstance *instance = instances; instance != 0; instance = instance->next) {
+      vox_magica_instance_place(instance);
+      for (VOX_MagicaInstance *earlier = instances; earlier != instance; earlier = earlier->next) {
+        if (earlier->wave >= instance->wave && vox_magica_instances_overlap(earlier, instance)) {
+          instance->wave = earlier->wave + 1;
+        }
+      }
+      waves_count = Max(waves_count, instance->wave + 1);
+      items_count += (instance->model->voxels_count + VOX_MAGICA_SCATTER_GRAIN - 1) / VOX_MAGICA_SCATTER_GRAIN;
+      result.voxels_count += instance->model->voxels_count;
+    }
+    
+    // Items are grouped by wave, and those of an instance follow each other
+    VOX_MagicaScatterItem *items = ArenaPushArray(scratch.arena, VOX_MagicaScatterItem, items_count);
+    U32 *wave_first_item = ArenaPushArray(scratch.arena, U32, waves_count + 1);
+    U32 item_idx = 0;
+    for (U32 wave = 0; wave < waves_count; wave += 1) {
+      wave_first_item[wave] = item_idx;
+      for (VOX_MagicaInstance *instance = instances; instance != 0; instance = instance->next) {
+        if (instance->wave != wave) {
+          continue;
+        }
+        V3S32 dim = instance->chunk_dim;
+        instance->chunks = ArenaPushArray(scratch.arena, VOX_ChunkNode *, dim.x*dim.y*dim.z);
+        instance->first_item = item_idx;
+        for (U32 first = 0; first < instance->model->voxels_count; first += VOX_MAGICA_SCATTER_GRAIN) {
+          VOX_MagicaScatterItem *item = &items[item_idx++];
+          item->instance = instance;
+          item->first = first;
+          item->opl = Min(first + VOX_MAGICA_SCATTER_GRAIN, instance->model->voxels_count);
+          item->touched = ArenaPushArray(scratch.arena, B8, dim.x*dim.y*dim.z);
+        }
+        instance->items_count = item_idx - instance->first_item;
+      }
+    }
+    wave_first_item[waves_count] = item_idx;
+    
+    // The chunks each item lands in are found in parallel, then acquired on this
+    // thread: only those a model has voxels in, so sparse models don't fill their
+    // bounds with empty chunks.
+    async_parallel_for(items_count, 1, vox_magica_mark_work, items);
+    for (VOX_MagicaInstance *instance = instances; instance != 0; instance = instance->next) {
+      V3S32 dim = instance->chunk_dim;
+      for (S32 chunk_idx = 0; chunk_idx < dim.x*dim.y*dim.z; chunk_idx += 1) {
+        B8 touched = 0;
+        for (U32 idx = 0; idx < instance->items_count; idx += 1) {
+          touched |= items[instance->first_item + idx].touched[chunk_idx];
+        }
+        if (touched) {
+          V3S32 chunk_coord = v3s32_add(instance->chunk_min, v3s32(chunk_idx % dim.x, chunk_idx / dim.x % dim.y, chunk_idx / (dim.x*dim.y)));
+          instance->chunks[chunk_idx] = vox_world_chunk_acquire(world, chunk_coord);
+        }
+      }
+    }
+    
+    for (U32 wave = 0; wave < waves_count; wave += 1) {
+      U32 first = wave_first_item[wave];
+      async_parallel_for(wave_first_item[wave + 1] - first, 1, vox_magica_scatter_work, items + first);
+    }
+    
+    vox_world_rebuild_occupancy(world);
+    
+    result.ok = 1;
+    result.models_count = file.models_count;
+    result.instances_count = instances_count;
+    result.has_palette = file.has_palette;
+    MemoryCopy(result.palette, file.palette, sizeof(result.palette));
+    
+    ProfCounter("vox models placed", instances_count);
+  }
+  
+  arena_scratch_end(scratch);
+  ProfEnd();
+  
+  return result;
+}
+
+function VOX_MagicaImport
+vox_magica_import(VOX_World *world, String8 path)
+{
+  VOX_MagicaImport result = {0};
+  
+  OS_Handle file = os_file_open(path, OS_FileAccess_Read);
+  if (!os_handle_is_null(file)) {
+    U64 size = os_file_size(file);
+    U8 *base = 0;
+    if (size > 0) {
+      base = (U8 *)os_file_map_view(file, size);
+    }
+    os_file_close(file);
+    
+    if (base) {
+      result = vox_magica_import_from_data(world, str8(base, size));
+      os_file_unmap_view(base, size);
+    }
+  }
+  
+  return result;
+}
+
+//
+// Writer
+//
+
+function void
+vox_magica_put(VOX_MagicaWriter *writer, void *data, U64 size)
+{
+  Assert(writer->count + size <= writer->cap);
+  MemoryCopy(writer->data + writer->count, data, size);
+  writer->count += size;
+}
+
+function void
+vox_magica_put_u32(VOX_MagicaWriter *writer, U32 value)
+{
+  vox_magica_put(writer, &value, sizeof(value));
+}
+
+function void
+vox_magica_put_str8(VOX_MagicaWriter *writer, String8 str)
+{
+  vox_magica_put_u32(writer, (U32)str.count);
+  vox_magica_put(writer, str.data, str.count);
+}
+
+// Chunks the writer makes have no children; the content size is filled in by
+// vox_magica_chunk_end.
+function U64
+vox_magica_chunk_begin(VOX_MagicaWriter *writer, U32 chunk_id)
+{
+  U64 result = writer->count;
+  vox_magica_put_u32(writer, chunk_id);
+  vox_magica_put_u32(writer, 0);
+  vox_magica_put_u32(writer, 0);
+  return result;
+}
+
+function void
+vox_magica_chunk_end(VOX_MagicaWriter *writer, U64 chunk_at)
+{
+  U32 content_size = (U32)(writer->count - chunk_at - 12);
+  MemoryCopy(writer->data + chunk_at + 4, &content_size, sizeof(content_size));
+}
+
+function VOX_MagicaWriter
+vox_magica_writer_alloc(Arena *arena, U64 cap)
+{
+  VOX_MagicaWriter result = {0};
+  result.data = ArenaPushArrayNoZero(arena, U8, cap);
+  result.cap = cap;
+  return result;
+}
+
+// Writes the solid voxels of a region of chunks as SIZE and XYZI at `offset`, one
+// chunk's voxels at a time. Returns the bytes written, 0 when the region has none.
+function U64
+vox_magica_write_region(OS_Handle file, U64 offset, VOX_World *world, V3S32 region, V3S32 *voxel_min, V3S32 *voxel_size, B32 *failed)
+{
+  S32 region_chunks = VOX_MAGICA_MODEL_SIZE_MAX / VOX_SLICE_SIZE;
+  VOX_ChunkNode *nodes[(VOX_MAGICA_MODEL_SIZE_MAX / VOX_SLICE_SIZE)*(VOX_MAGICA_MODEL_SIZE_MAX / VOX_SLICE_SIZE)*(VOX_MAGICA_MODEL_SIZE_MAX / VOX_SLICE_SIZE)];
+  U32 nodes_count = 0;
+  U64 voxels_count = 0;
+  V3S32 min = v3s32(MAX_S32, MAX_S32, MAX_S32);
+  V3S32 max = v3s32(MIN_S32, MIN_S32, MIN_S32);
+  
+  for (S32 z = 0; z < region_chunks; z += 1) {
+    for (S32 y = 0; y < region_chunks; y += 1) {
+      for (S32 x = 0; x < region_chunks; x += 1) {
+        V3S32 chunk_coord = v3s32_add(v3s32_scale(region, region_chunks), v3s32(x, y, z));
+        VOX_ChunkNode *node = vox_world_chunk_from_coord(world, chunk_coord);
+        if (!node || node->solid_count == 0) {
+          continue;
+        }
+        nodes[nodes_count++] = node;
+        voxels_count += node->solid_count;
+        
+        for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+          if (node->chunk.voxels[idx].opacity == 0) {
+            continue;
+          }
+          V3S32 coord = v3s32_add(v3s32_scale(chunk_coord, VOX_SLICE_SIZE), vox_local_coord_from_idx(idx));
+          min = v3s32(Min(min.x, coord.x), Min(min.y, coord.y), Min(min.z, coord.z));
+          max = v3s32(Max(max.x, coord.x), Max(max.y, coord.y), Max(max.z, coord.z));
+        }
+      }
+    }
+  }
+  
+  U64 result = 0;
+  if (voxels_count > 0) {
+    TempArena scratch = arena_scratch_begin(0, 0);
+    VOX_MagicaWriter writer = vox_magica_writer_alloc(scratch.arena, 12 + 12 + 16);
+    
+    // y-up to z-up
+    V3S32 size = v3s32_add(v3s32_sub(max, min), v3s32(1, 1, 1));
+    U64 size_at = vox_magica_chunk_begin(&writer, VOX_MAGICA_CHUNK_ID('S', 'I', 'Z', 'E'));
+    vox_magica_put_u32(&writer, (U32)size.x);
+    vox_magica_put_u32(&writer, (U32)size.z);
+    vox_magica_put_u32(&writer, (U32)size.y);
+    vox_magica_chunk_end(&writer, size_at);
+    
+    vox_magica_put_u32(&writer, VOX_MAGICA_CHUNK_ID('X', 'Y', 'Z', 'I'));
+    vox_magica_put_u32(&writer, (U32)(4 + voxels_count*4));
+    vox_magica_put_u32(&writer, 0);
+    vox_magica_put_u32(&writer, (U32)voxels_count);
+    
+    if (!os_file_write_at(file, offset, str8(writer.data, writer.count))) {
+      *failed = 1;
+    }
+    result += writer.count;
+    
+    for (U32 node_idx = 0; node_idx < nodes_count; node_idx += 1) {
+      VOX_ChunkNode *node = nodes[node_idx];
+      TempArena temp = arena_temp_begin(scratch.arena);
+      VOX_MagicaWriter chunk_writer = vox_magica_writer_alloc(temp.arena, (U64)node->solid_count*4);
+      
+      V3S32 chunk_origin = v3s32_sub(v3s32_scale(node->coord, VOX_SLICE_SIZE), min);
+      for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+        VOX_Voxel voxel = node->chunk.voxels[idx];
+        if (voxel.opacity == 0) {
+          continue;
+        }
+        V3S32 coord = v3s32_add(chunk_origin, vox_local_coord_from_idx(idx));
+        U8 v[4] = { (U8)coord.x, (U8)coord.z, (U8)coord.y, (U8)(Min(voxel.color, 254) + 1) };
+        vox_magica_put(&chunk_writer, v, sizeof(v));
+      }
+      
+      if (!os_file_write_at(file, offset + result, str8(chunk_writer.data, chunk_writer.count))) {
+        *failed = 1;
+      }
+      result += chunk_writer.count;
+      arena_temp_end(temp);
+    }
+    
+    arena_scratch_end(scratch);
+    *voxel_min = min;
+    *voxel_size = size;
+  }
+  
+  return result;
+}
+
+function B32
+vox_magica_write_world(VOX_World *world, U32 *palette, String8 path)
+{
+  B32 result = 0;
+  
+  OS_Handle file = os_file_open(path, OS_FileAccess_Write);
+  if (!os_handle_is_null(file)) {
+    TempArena scratch = arena_scratch_begin(0, 0);
+    B32 failed = 0;
+    U64 offset = 20; // Magic, version and the MAIN header, which are written last
+    
+    S32 region_chunks = VOX_MAGICA_MODEL_SIZE_MAX / VOX_SLICE_SIZE;
+    V3S32 region_min = {0};
+    V3S32 region_dim = {0};
+    if (world->has_bounds) {
+      V3S32 region_max = {0};
+      for (U32 axis = 0; axis < 3; axis += 1) {
+        region_min.e[axis] = vox_floor_div(world->chunk_min.e[axis], region_chunks);
+        region_max.e[axis] = vox_floor_div(world->chunk_max.e[axis], region_chunks);
+      }
+      region_dim = v3s32_add(v3s32_sub(region_max, region_min), v3s32(1, 1, 1));
+    }
+    
+    // Scene translation of every model, which goes to its transform node
+    U32 models_cap = (U32)(region_dim.x*region_dim.y*region_dim.z);
+    V3S32 *translations = ArenaPushArray(scratch.arena, V3S32, models_cap);
+    U32 models_count = 0;
+    
+    for (S32 z = 0; z < region_dim.z; z += 1) {
+      for (S32 y = 0; y < region_dim.y; y += 1) {
+        for (S32 x = 0; x < region_dim.x; x += 1) {
+          V3S32 min = {0};
+          V3S32 size = {0};
+          U64 written = vox_magica_write_region(file, offset, world, v3s32_add(region_min, v3s32(x, y, z)), &min, &size, &failed);
+          if (written > 0) {
+            offset += written;
+            translations[models_count++] = v3s32(min.x + size.x/2, min.z + size.z/2, min.y + size.y/2);
+          }
+        }
+      }
+    }
+    
+    // Root transform, a group, and a transform and shape per model
+    VOX_MagicaWriter writer = vox_magica_writer_alloc(scratch.arena, 2048 + (U64)models_count*256);
+    
+    U64 at = vox_magica_chunk_begin(&writer, VOX_MAGICA_CHUNK_ID('n', 'T', 'R', 'N'));
+    vox_magica_put_u32(&writer, 0);          // Node
+    vox_magica_put_u32(&writer, 0);          // Attributes
+    vox_magica_put_u32(&writer, 1);          // Child
+    vox_magica_put_u32(&writer, MAX_U32); // Reserved
+    vox_magica_put_u32(&writer, MAX_U32); // Layer
+    vox_magica_put_u32(&writer, 1);          // Frames
+    vox_magica_put_u32(&writer, 0);
+    vox_magica_chunk_end(&writer, at);
+    
+    at = vox_magica_chunk_begin(&writer, VOX_MAGICA_CHUNK_ID('n', 'G', 'R', 'P'));
+    vox_magica_put_u32(&writer, 1);
+    vox_magica_put_u32(&writer, 0);
+    vox_magica_put_u32(&writer, models_count);
+    for (U32 idx = 0; idx < models_count; idx += 1) {
+      vox_magica_put_u32(&writer, 2 + idx*2);
+    }
+    vox_magica_chunk_end(&writer, at);
+    
+    for (U32 idx = 0; idx < models_count; idx += 1) {
+      V3S32 t = translations[idx];
+      at = vox_magica_chunk_begin(&writer, VOX_MAGICA_CHUNK_ID('n', 'T', 'R', 'N'));
+      vox_magica_put_u32(&writer, 2 + idx*2);
+      vox_magica_put_u32(&writer, 0);
+      vox_magica_put_u32(&writer, 3 + idx*2);
+      vox_magica_put_u32(&writer, MAX_U32);
+      vox_magica_put_u32(&writer, 0);
+      vox_magica_put_u32(&writer, 1);
+      vox_magica_put_u32(&writer, 1);
+      vox_magica_put_str8(&writer, S8("_t"));
+      vox_magica_put_str8(&writer, str8_pushf(scratch.arena, (char *)"%d %d %d", t.x, t.y, t.z));
+      vox_magica_chunk_end(&writer, at);
+      
+      at = vox_magica_chunk_begin(&writer, VOX_MAGICA_CHUNK_ID('n', 'S', 'H', 'P'));
+      vox_magica_put_u32(&writer, 3 + idx*2);
+      vox_magica_put_u32(&writer, 0);
+      vox_magica_put_u32(&writer, 1);  // Models
+      vox_magica_put_u32(&writer, idx);
+      vox_magica_put_u32(&writer, 0);
+      vox_magica_chunk_end(&writer, at);
+    }
+    
+    // The renderer's colors, gamma corrected as it does; it clamps higher colors
+    // to the last one.
+    U32 default_palette[256];
+    if (!palette) {
+      for (U32 idx = 0; idx < ArrayCount(default_palette); idx += 1) {
+        V3F32 color = vox_render_cpu_palette[Min(idx, ArrayCount(vox_render_cpu_palette) - 1)];
+        U32 r = (U32)(powf32(color.x, 1.f/2.2f)*255.f + 0.5f);
+        U32 g = (U32)(powf32(color.y, 1.f/2.2f)*255.f + 0.5f);
+        U32 b = (U32)(powf32(color.z, 1.f/2.2f)*255.f + 0.5f);
+        default_palette[idx] = r | (g << 8) | (b << 16) | (255u << 24);
+      }
+      palette = default_palette;
+    }
+    at = vox_magica_chunk_begin(&writer, VOX_MAGICA_CHUNK_ID('R', 'G', 'B', 'A'));
+    vox_magica_put(&writer, palette, 256*sizeof(U32));
+    vox_magica_chunk_end(&writer, at);
+    
+    if (!os_file_write_at(file, offset, str8(writer.data, writer.count))) {
+      failed = 1;
+    }
+    offset += writer.count;
+    
+    U32 header[5] = { VOX_MAGICA_MAGIC, VOX_MAGICA_VERSION, VOX_MAGICA_CHUNK_ID('M', 'A', 'I', 'N'), 0, (U32)(offset - 20) };
+    if (!os_file_write_at(file, 0, str8((U8 *)header, sizeof(header)))) {
+      failed = 1;
+    }
+    
+    arena_scratch_end(scratch);
+    os_file_close(file);
+    result = !failed;
+  }
+  
+  return result;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+// NOTE: MagicaVoxel .vox files. All values are little-endian.
+//
+//   "VOX " version
+//   MAIN chunk, whose children are:
+//     SIZE + XYZI per model: dimensions, then (x, y, z, color index) per voxel
+//     nTRN / nGRP / nSHP: the scene graph that places models in the scene
+//     RGBA: 256 colors, the color of index i being rgba[i - 1]
+//     and others (MATL, LAYR, rOBJ, ...), which are skipped
+//
+// Every chunk is a 4-byte id, the size of its content, the size of its children,
+// then the content and the children. Graph nodes carry dictionaries: a count,
+// then that many key and value strings, each a size and that many bytes.
+//
+// The reader maps the file and walks the chunk headers. Models and graph nodes are
+// recorded as pointers into the mapping, and node contents are only parsed when
+// the graph is walked from the root, so nothing is copied out of the file. Every
+// placed model is then scattered straight into the world's chunks, in parallel
+// over ranges of its voxels.
+//
+// A transform node holds a translation ("_t", "x y z") and a rotation ("_r", a
+// signed permutation packed in a byte) in the frame dictionary. A model is
+// centered on its translation: voxel v lands at t + floor(R*(2v + 1 - size) / 2).
+//
+// MagicaVoxel is z-up and the world is y-up, so y and z are swapped on the way in
+// and out. Color index i becomes voxel color i - 1 and back, which makes the
+// palette's rgba[c] the color of voxel color c. Imported voxels are fully opaque
+// and have no id.
+
+#define VOX_MAGICA_MAGIC   0x20584F56 // "VOX "
+#define VOX_MAGICA_VERSION 150
+
+#define VOX_MAGICA_CHUNK_ID(a, b, c, d) ((U32)(a) | ((U32)(b) << 8) | ((U32)(c) << 16) | ((U32)(d) << 24))
+
+// Largest model MagicaVoxel opens; the writer cuts the world into models this big.
+#define VOX_MAGICA_MODEL_SIZE_MAX 256
+
+#define VOX_MAGICA_GRAPH_DEPTH_MAX 64
+
+// Voxels per parallel scatter job
+#define VOX_MAGICA_SCATTER_GRAIN (64*1024)
+
+struct VOX_MagicaModel {
+  S32 size[3];
+  U32 voxels_count;
+  U8 *voxels; // (x, y, z, color index) per voxel, in the file
+};
+
+struct VOX_MagicaNode {
+  U32 chunk_id; // nTRN, nGRP or nSHP
+  S32 node_id;
+  String8 content;
+};
+
+// Maps MagicaVoxel model space to MagicaVoxel scene space.
+struct VOX_MagicaTransform {
+  S32 r[3][3];
+  S32 t[3];
+};
+
+struct VOX_MagicaInstance {
+  VOX_MagicaInstance *next;
+  VOX_MagicaModel *model;
+  VOX_MagicaTransform transform;
+  
+  // World coordinate `axis` of voxel v is offset[axis] + step[axis]*v[source[axis]]
+  V3S32 offset;
+  V3S32 step;
+  U32 source[3];
+  
+  // World voxel bounds (inclusive) and the grid of chunks covering them
+  V3S32 voxel_min;
+  V3S32 voxel_max;
+  V3S32 chunk_min;
+  V3S32 chunk_dim;
+  VOX_ChunkNode **chunks;
+  U32 first_item;
+  U32 items_count;
+  
+  // Instances of a wave don't overlap and are scattered together; an instance
+  // comes in a later wave than every earlier one it overlaps, so where models
+  // overlap the one later in the file wins.
+  U32 wave;
+};
+
+struct VOX_MagicaInstanceList {
+  VOX_MagicaInstance *first;
+  VOX_MagicaInstance *last;
+  U32 count;
+  U32 nodes_walked;
+};
+
+struct VOX_MagicaReader {
+  String8 data;
+  U64 off;
+  B32 failed; // Set by reads past the end, which return zeros
+};
+
+// Fixed-capacity output buffer
+struct VOX_MagicaWriter {
+  U8 *data;
+  U64 count;
+  U64 cap;
+};
+
+struct VOX_MagicaFile {
+  B32 valid;
+  String8 data;
+  
+  VOX_MagicaModel *models;
+  U32 models_count;
+  VOX_MagicaNode *nodes;
+  U32 nodes_count;
+  
+  B32 has_palette;
+  U32 palette[256];
+};
+
+// A range of an instance's voxels
+struct VOX_MagicaScatterItem {
+  VOX_MagicaInstance *instance;
+  U32 first;
+  U32 opl;
+  B8 *touched; // Per chunk of the instance's grid, whether the range has voxels in it
+};
+
+struct VOX_MagicaImport {
+  B32 ok;
+  U32 models_count;
+  U32 instances_count;
+  U64 voxels_count;
+  B32 has_palette;  // Files without RGBA use MagicaVoxel's default palette
+  U32 palette[256]; // RGBA8 (R in the lowest byte) of each voxel color
+};
+
+// Reads the chunk headers of a file's contents. Returns a file that is not valid
+// if the magic or version is wrong, or a chunk runs past the end.
+function VOX_MagicaFile vox_magica_file_from_data(Arena *arena, String8 data);
+
+// Walks the scene graph from the root. Files without one place every model with
+// its min corner at the origin.
+function VOX_MagicaInstance *vox_magica_instances_from_file(Arena *arena, VOX_MagicaFile *file, U32 *instances_count);
+
+// Scatters the file's placed models into the world, in parallel on the async
+// workers, and rebuilds its occupancy.
+function VOX_MagicaImport vox_magica_import_from_data(VOX_World *world, String8 data);
+// Maps the file and imports it.
+function VOX_MagicaImport vox_magica_import(VOX_World *world, String8 path);
+
+// Writes every solid voxel of the world as one model per 256^3 region, each
+// placed by a translation under a single group. Without a palette, the colors
+// are the renderer's.
+function B32 vox_magica_write_world(VOX_World *world, U32 *palette, String8 path);
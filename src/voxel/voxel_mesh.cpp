@@ -0,0 +1,564 @@
+//
+// Packed vertices
+//
+
+function VOX_MeshVertex
+vox_mesh_vertex_pack(V3S32 pos, VOX_MeshFace face, U32 ao, U8 color)
+{
+  VOX_MeshVertex result =
+    ((U32)pos.x) |
+    ((U32)pos.y << VOX_MESH_VERTEX_POS_BITS) |
+    ((U32)pos.z << (2*VOX_MESH_VERTEX_POS_BITS)) |
+    ((U32)face << VOX_MESH_VERTEX_FACE_SHIFT) |
+    ((ao & 3) << VOX_MESH_VERTEX_AO_SHIFT) |
+    ((U32)color << VOX_MESH_VERTEX_COLOR_SHIFT);
+  return result;
+}
+
+function V3S32
+vox_mesh_vertex_position(VOX_MeshVertex v)
+{
+  U32 mask = (1u << VOX_MESH_VERTEX_POS_BITS) - 1;
+  V3S32 result = v3s32((S32)(v & mask),
+                       (S32)((v >> VOX_MESH_VERTEX_POS_BITS) & mask),
+                       (S32)((v >> (2*VOX_MESH_VERTEX_POS_BITS)) & mask));
+  return result;
+}
+
+function VOX_MeshFace
+vox_mesh_vertex_face(VOX_MeshVertex v)
+{
+  VOX_MeshFace result = (VOX_MeshFace)((v >> VOX_MESH_VERTEX_FACE_SHIFT) & 7);
+  return result;
+}
+
+function U32
+vox_mesh_vertex_ao(VOX_MeshVertex v)
+{
+  U32 result = (v >> VOX_MESH_VERTEX_AO_SHIFT) & 3;
+  return result;
+}
+
+function U8
+vox_mesh_vertex_color(VOX_MeshVertex v)
+{
+  U8 result = (U8)((v >> VOX_MESH_VERTEX_COLOR_SHIFT) & 255);
+  return result;
+}
+
+//
+// Greedy meshing
+//
+
+// Cells of the padded volume: 0 when empty, otherwise VOX_MESH_CELL_SOLID | color
+#define VOX_MESH_CELL_SOLID 0x100
+
+// Keys of the face mask. Faces only merge when their keys match, which keeps
+// the occlusion of every corner exact after merging.
+#define VOX_MESH_KEY_FACE     (1u << 16)
+#define VOX_MESH_KEY_AO_SHIFT 8
+
+// Fills `cells` (VOX_MESH_PADDED_SIZE^3, zeroed) and `columns`, which hold the
+// solid cells of every line through the volume as bits: for each axis, one U64
+// per position in the plane spanned by the other two, in the same (u, v) order
+// as the faces use.
+function void
+vox_mesh_padded_volume(U16 *cells, U64 *columns, VOX_World *world, VOX_ChunkNode *node)
+{
+  S32 p = VOX_MESH_PADDED_SIZE;
+  U64 *x_columns = columns;
+  U64 *y_columns = columns + p*p;
+  U64 *z_columns = columns + 2*p*p;
+  
+  // The chunk and the single layer of each of its 26 neighbors that touches it.
+  // Offset -1 covers padded coordinate 0, offset 0 covers 1..VOX_SLICE_SIZE and
+  // offset 1 covers VOX_SLICE_SIZE + 1.
+  for (S32 oz = -1; oz <= 1; oz += 1) {
+    for (S32 oy = -1; oy <= 1; oy += 1) {
+      for (S32 ox = -1; ox <= 1; ox += 1) {
+        V3S32 offset = v3s32(ox, oy, oz);
+        VOX_ChunkNode *src = node;
+        if (ox != 0 || oy != 0 || oz != 0) {
+          src = vox_world_chunk_from_coord(world, v3s32_add(node->coord, offset));
+        }
+        if (!src) {
+          continue;
+        }
+        
+        S32 min[3];
+        S32 opl[3];
+        for (S32 axis = 0; axis < 3; axis += 1) {
+          S32 o = offset.e[axis];
+          min[axis] = (o < 0) ? 0 : (o == 0) ? 1 : VOX_SLICE_SIZE + 1;
+          opl[axis] = (o < 0) ? 1 : (o == 0) ? VOX_SLICE_SIZE + 1 : VOX_SLICE_SIZE + 2;
+        }
+        
+        for (S32 z = min[2]; z < opl[2]; z += 1) {
+          for (S32 y = min[1]; y < opl[1]; y += 1) {
+            for (S32 x = min[0]; x < opl[0]; x += 1) {
+              V3S32 local_coord = v3s32(x - 1 - ox*VOX_SLICE_SIZE,
+                                        y - 1 - oy*VOX_SLICE_SIZE,
+                                        z - 1 - oz*VOX_SLICE_SIZE);
+              VOX_Voxel *v = vox_get_voxel(&src->chunk, vox_idx_from_local_coord(local_coord));
+              if (v->opacity > 0) {
+                cells[x + y*p + z*p*p] = (U16)(VOX_MESH_CELL_SOLID | v->color);
+                x_columns[y + z*p] |= (U64)1 << x;
+                y_columns[z + x*p] |= (U64)1 << y;
+                z_columns[x + y*p] |= (U64)1 << z;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+function VOX_MeshBuild
+vox_mesh_build(Arena *arena, VOX_World *world, VOX_ChunkNode *node)
+{
+  VOX_MeshBuild result = {0};
+  
+  S32 p = VOX_MESH_PADDED_SIZE;
+  S32 strides[3] = { 1, p, p*p };
+  
+  TempArena scratch = arena_scratch_begin(&arena, 1);
+  U16 *cells = ArenaPushArray(scratch.arena, U16, p*p*p);
+  U64 *columns = ArenaPushArray(scratch.arena, U64, 3*p*p);
+  U32 *face_bits = ArenaPushArray(scratch.arena, U32, VOX_SLICE_SIZE*VOX_SLICE_SIZE);
+  U32 *mask = ArenaPushArray(scratch.arena, U32, VOX_SLICE_SIZE*VOX_SLICE_SIZE);
+  vox_mesh_padded_volume(cells, columns, world, node);
+  
+  // Quads are pushed one at a time and nothing else goes on `arena` meanwhile,
+  // so they end up contiguous
+  VOX_MeshVertex *vertices = 0;
+  U32 quads_count = 0;
+  U32 faces_count = 0;
+  
+  for (U32 face = 0; face < VOX_MeshFace_COUNT; face += 1) {
+    // The face's normal runs along `axis`; u and v span its plane, with u x v
+    // pointing along +axis.
+    S32 axis = face / 2;
+    S32 sign = (face % 2 == 0) ? 1 : -1;
+    S32 u_axis = (axis + 1) % 3;
+    S32 v_axis = (axis + 2) % 3;
+    S32 n_off = sign*strides[axis];
+    S32 u_off = strides[u_axis];
+    S32 v_off = strides[v_axis];
+    
+    // Which voxels of each line along the axis have this face: solid ones
+    // followed by an empty one. Bit `slice` of face_bits, for the slices inside
+    // the chunk.
+    U64 *axis_columns = columns + axis*p*p;
+    U32 slices_any = 0;
+    for (S32 j = 0; j < VOX_SLICE_SIZE; j += 1) {
+      for (S32 i = 0; i < VOX_SLICE_SIZE; i += 1) {
+        U64 column = axis_columns[(i + 1) + (j + 1)*p];
+        U64 bits = (sign > 0) ? (column & ~(column >> 1)) : (column & ~(column << 1));
+        face_bits[i + j*VOX_SLICE_SIZE] = (U32)(bits >> 1);
+        slices_any |= (U32)(bits >> 1);
+      }
+    }
+    
+    for (S32 slice = 0; slice < VOX_SLICE_SIZE; slice += 1) {
+      if (((slices_any >> slice) & 1) == 0) {
+        continue;
+      }
+      
+      // Faces of this slice, keyed by color and the occlusion of their corners
+      S32 slice_base = (slice + 1)*strides[axis] + u_off + v_off;
+      for (S32 j = 0; j < VOX_SLICE_SIZE; j += 1) {
+        for (S32 i = 0; i < VOX_SLICE_SIZE; i += 1) {
+          U32 key = 0;
+          if ((face_bits[i + j*VOX_SLICE_SIZE] >> slice) & 1) {
+            S32 cell_idx = slice_base + i*u_off + j*v_off;
+            U16 cell = cells[cell_idx];
+            S32 n = cell_idx + n_off;
+            
+            // Corners (-u,-v), (+u,-v), (+u,+v), (-u,+v), each occluded by the two
+            // edge neighbors and the corner neighbor in front of the face
+            B32 um = cells[n - u_off] != 0;
+            B32 up = cells[n + u_off] != 0;
+            B32 vm = cells[n - v_off] != 0;
+            B32 vp = cells[n + v_off] != 0;
+            B32 c0 = cells[n - u_off - v_off] != 0;
+            B32 c1 = cells[n + u_off - v_off] != 0;
+            B32 c2 = cells[n + u_off + v_off] != 0;
+            B32 c3 = cells[n - u_off + v_off] != 0;
+            U32 ao0 = (um && vm) ? 0 : 3 - (um + vm + c0);
+            U32 ao1 = (up && vm) ? 0 : 3 - (up + vm + c1);
+            U32 ao2 = (up && vp) ? 0 : 3 - (up + vp + c2);
+            U32 ao3 = (um && vp) ? 0 : 3 - (um + vp + c3);
+            
+            key = VOX_MESH_KEY_FACE | (cell & 255) |
+              (ao0 << VOX_MESH_KEY_AO_SHIFT) | (ao1 << (VOX_MESH_KEY_AO_SHIFT + 2)) |
+              (ao2 << (VOX_MESH_KEY_AO_SHIFT + 4)) | (ao3 << (VOX_MESH_KEY_AO_SHIFT + 6));
+            faces_count += 1;
+          }
+          mask[i + j*VOX_SLICE_SIZE] = key;
+        }
+      }
+      
+      // Grow a rectangle of equal keys along u, then along v while whole rows
+      // match, and clear it from the mask.
+      for (S32 j = 0; j < VOX_SLICE_SIZE; j += 1) {
+        for (S32 i = 0; i < VOX_SLICE_SIZE;) {
+          U32 key = mask[i + j*VOX_SLICE_SIZE];
+          if (key == 0) {
+            i += 1;
+            continue;
+          }
+          
+          S32 w = 1;
+          while (i + w < VOX_SLICE_SIZE && mask[i + w + j*VOX_SLICE_SIZE] == key) {
+            w += 1;
+          }
+          
+          S32 h = 1;
+          for (; j + h < VOX_SLICE_SIZE; h += 1) {
+            B32 row_matches = 1;
+            for (S32 k = 0; k < w && row_matches; k += 1) {
+              row_matches = (mask[i + k + (j + h)*VOX_SLICE_SIZE] == key);
+            }
+            if (!row_matches) {
+              break;
+            }
+          }
+          
+          for (S32 y = 0; y < h; y += 1) {
+            for (S32 x = 0; x < w; x += 1) {
+              mask[i + x + (j + y)*VOX_SLICE_SIZE] = 0;
+            }
+          }
+          
+          // Corners in the same order as the occlusion in the key
+          S32 corner_u[4] = { i, i + w, i + w, i };
+          S32 corner_v[4] = { j, j, j + h, j + h };
+          U32 corner_ao[4];
+          V3S32 corner_pos[4];
+          for (U32 k = 0; k < 4; k += 1) {
+            S32 pos[3];
+            pos[axis] = slice + (sign > 0 ? 1 : 0);
+            pos[u_axis] = corner_u[k];
+            pos[v_axis] = corner_v[k];
+            corner_pos[k] = v3s32(pos[0], pos[1], pos[2]);
+            corner_ao[k] = (key >> (VOX_MESH_KEY_AO_SHIFT + 2*k)) & 3;
+          }
+          
+          // Negative faces are seen from the other side, so reverse the winding
+          U32 order[4] = { 0, 1, 2, 3 };
+          if (sign < 0) {
+            order[1] = 3;
+            order[3] = 1;
+          }
+          
+          // Split along the brighter diagonal, so a dark corner doesn't bleed
+          // across the whole quad. Rotating keeps the winding.
+          U32 first = 0;
+          if (corner_ao[order[1]] + corner_ao[order[3]] > corner_ao[order[0]] + corner_ao[order[2]]) {
+            first = 1;
+          }
+          
+          VOX_MeshVertex *quad = ArenaPushArrayNoZero(arena, VOX_MeshVertex, VOX_MESH_VERTICES_PER_QUAD);
+          if (!vertices) {
+            vertices = quad;
+          }
+          for (U32 k = 0; k < 4; k += 1) {
+            U32 corner = order[(first + k) % 4];
+            quad[k] = vox_mesh_vertex_pack(corner_pos[corner], (VOX_MeshFace)face, corner_ao[corner], (U8)(key & 255));
+          }
+          quads_count += 1;
+          
+          i += w;
+        }
+      }
+    }
+  }
+  
+  arena_scratch_end(scratch);
+  
+  result.vertices = vertices;
+  result.quads_count = quads_count;
+  result.faces_count = faces_count;
+  return result;
+}
+
+//
+// Vertex buffer blocks
+//
+
+function void
+vox_mesh_blocks_lock(VOX_MeshCache *cache)
+{
+  while (os_interlocked_compare_exchange_32(&cache->blocks_lock, 1, 0) != 0) {
+  }
+}
+
+function void
+vox_mesh_blocks_unlock(VOX_MeshCache *cache)
+{
+  os_memory_barrier();
+  cache->blocks_lock = 0;
+}
+
+function U32
+vox_mesh_block_class_from_size(U64 size)
+{
+  U32 result = 0;
+  while (((U64)1 << (result + VOX_MESH_BLOCK_CLASS_MIN)) < size) {
+    result += 1;
+  }
+  Assert(result < VOX_MESH_BLOCK_CLASS_COUNT);
+  return result;
+}
+
+function void *
+vox_mesh_block_alloc(VOX_MeshCache *cache, U64 size)
+{
+  U32 block_class = vox_mesh_block_class_from_size(size);
+  
+  vox_mesh_blocks_lock(cache);
+  void *result = cache->free_blocks[block_class];
+  if (result) {
+    SLLStackPop(cache->free_blocks[block_class]);
+  }
+  else {
+    U64 block_size = (U64)1 << (block_class + VOX_MESH_BLOCK_CLASS_MIN);
+    result = arena_push_nozero(cache->arena, block_size);
+  }
+  vox_mesh_blocks_unlock(cache);
+  
+  return result;
+}
+
+function void
+vox_mesh_block_release(VOX_MeshCache *cache, void *block, U64 size)
+{
+  if (block) {
+    U32 block_class = vox_mesh_block_class_from_size(size);
+    VOX_MeshBlock *b = (VOX_MeshBlock *)block;
+    vox_mesh_blocks_lock(cache);
+    SLLStackPush(cache->free_blocks[block_class], b);
+    vox_mesh_blocks_unlock(cache);
+  }
+}
+
+function U64
+vox_mesh_vertices_size(U32 quads_count)
+{
+  U64 result = (U64)quads_count*VOX_MESH_VERTICES_PER_QUAD*sizeof(VOX_MeshVertex);
+  return result;
+}
+
+//
+// Mesh cache
+//
+
+function VOX_MeshCache *
+vox_mesh_cache_alloc(void)
+{
+  // Worst-case chunks take a 2 MiB block each, so leave room for plenty of them
+  Arena *arena = arena_alloc(GiB(4llu));
+  VOX_MeshCache *cache = ArenaPushStruct(arena, VOX_MeshCache);
+  cache->arena = arena;
+  return cache;
+}
+
+function void
+vox_mesh_cache_release(VOX_MeshCache *cache)
+{
+  if (cache) {
+    vox_mesh_cache_clear(cache);
+    arena_release(cache->arena);
+  }
+}
+
+function VOX_ChunkMesh *
+vox_mesh_from_chunk_coord(VOX_MeshCache *cache, V3S32 chunk_coord)
+{
+  VOX_ChunkMesh *result = 0;
+  
+  U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % VOX_MESH_CACHE_SLOTS;
+  VOX_MeshSlot *slot = &cache->slots[slot_idx];
+  for (VOX_ChunkMesh *m = slot->first; m != 0; m = m->hash_next) {
+    if (m->coord.x == chunk_coord.x && m->coord.y == chunk_coord.y && m->coord.z == chunk_coord.z) {
+      result = m;
+      break;
+    }
+  }
+  
+  return result;
+}
+
+function VOX_ChunkMesh *
+vox_mesh_acquire(VOX_MeshCache *cache, V3S32 chunk_coord)
+{
+  VOX_ChunkMesh *mesh = cache->free;
+  if (mesh) {
+    SLLStackPop(cache->free);
+    MemoryZeroStruct(mesh);
+  }
+  else {
+    mesh = ArenaPushStruct(cache->arena, VOX_ChunkMesh);
+  }
+  mesh->coord = chunk_coord;
+  mesh->dirty = 1;
+  
+  U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % VOX_MESH_CACHE_SLOTS;
+  VOX_MeshSlot *slot = &cache->slots[slot_idx];
+  DLLPushBackNP(slot->first, slot->last, mesh, hash_next, hash_prev);
+  DLLPushBack(cache->first, cache->last, mesh);
+  cache->meshes_count += 1;
+  
+  return mesh;
+}
+
+function void
+vox_mesh_release(VOX_MeshCache *cache, VOX_ChunkMesh *mesh)
+{
+  if (mesh->backend && cache->backend_release) {
+    cache->backend_release(cache->backend_user, mesh);
+  }
+  vox_mesh_block_release(cache, mesh->vertices, vox_mesh_vertices_size(mesh->quads_count));
+  
+  U64 slot_idx = vox_hash_from_chunk_coord(mesh->coord) % VOX_MESH_CACHE_SLOTS;
+  VOX_MeshSlot *slot = &cache->slots[slot_idx];
+  DLLRemoveNP(slot->first, slot->last, mesh, hash_next, hash_prev);
+  DLLRemove(cache->first, cache->last, mesh);
+  cache->meshes_count -= 1;
+  
+  SLLStackPush(cache->free, mesh);
+}
+
+function void
+vox_mesh_cache_clear(VOX_MeshCache *cache)
+{
+  for (VOX_ChunkMesh *m = cache->first, *next = 0; m != 0; m = next) {
+    next = m->next;
+    vox_mesh_release(cache, m);
+  }
+}
+
+// Marks the meshes of the neighbors in `neighbors`, one bit per offset in
+// [-1, 1]^3 (bit (x+1) + (y+1)*3 + (z+1)*9).
+function void
+vox_mesh_mark_neighbors(VOX_MeshCache *cache, V3S32 chunk_coord, U32 neighbors)
+{
+  for (U32 bit = 0; bit < 27; bit += 1) {
+    if (bit != 13 && (neighbors >> bit) & 1) {
+      V3S32 offset = v3s32((S32)(bit % 3) - 1, (S32)(bit / 3 % 3) - 1, (S32)(bit / 9) - 1);
+      VOX_ChunkMesh *mesh = vox_mesh_from_chunk_coord(cache, v3s32_add(chunk_coord, offset));
+      if (mesh) {
+        mesh->dirty = 1;
+      }
+    }
+  }
+}
+
+// Neighbors whose meshes can see the dirty bricks: those across every chunk
+// face, edge or corner that a dirty brick touches.
+function U32
+vox_mesh_neighbors_from_dirty_bricks(U64 *dirty_bricks)
+{
+  U32 result = 0;
+  
+  S32 last = VOX_BRICKS_PER_SLICE - 1;
+  for (S32 brick_idx = 0; brick_idx < VOX_BRICKS_PER_CHUNK; brick_idx += 1) {
+    if (((dirty_bricks[brick_idx / 64] >> (brick_idx % 64)) & 1) == 0) {
+      continue;
+    }
+    
+    S32 bx = brick_idx % VOX_BRICKS_PER_SLICE;
+    S32 by = brick_idx / VOX_BRICKS_PER_SLICE % VOX_BRICKS_PER_SLICE;
+    S32 bz = brick_idx / (VOX_BRICKS_PER_SLICE*VOX_BRICKS_PER_SLICE);
+    for (S32 z = (bz == 0 ? -1 : 0); z <= (bz == last ? 1 : 0); z += 1) {
+      for (S32 y = (by == 0 ? -1 : 0); y <= (by == last ? 1 : 0); y += 1) {
+        for (S32 x = (bx == 0 ? -1 : 0); x <= (bx == last ? 1 : 0); x += 1) {
+          result |= 1u << ((x + 1) + (y + 1)*3 + (z + 1)*9);
+        }
+      }
+    }
+  }
+  
+  return result;
+}
+
+function void
+vox_mesh_build_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_MeshJob *job = (VOX_MeshJob *)user;
+  VOX_MeshCache *cache = job->cache;
+  
+  for (U64 idx = first; idx < opl; idx += 1) {
+    VOX_ChunkMesh *mesh = job->meshes[idx];
+    VOX_ChunkNode *node = vox_world_chunk_from_coord(job->world, mesh->coord);
+    
+    TempArena temp = arena_temp_begin(scratch);
+    VOX_MeshBuild build = vox_mesh_build(temp.arena, job->world, node);
+    
+    vox_mesh_block_release(cache, mesh->vertices, vox_mesh_vertices_size(mesh->quads_count));
+    mesh->vertices = 0;
+    if (build.quads_count > 0) {
+      U64 size = vox_mesh_vertices_size(build.quads_count);
+      mesh->vertices = (VOX_MeshVertex *)vox_mesh_block_alloc(cache, size);
+      MemoryCopy(mesh->vertices, build.vertices, size);
+    }
+    mesh->quads_count = build.quads_count;
+    mesh->faces_count = build.faces_count;
+    mesh->version += 1;
+    mesh->dirty = 0;
+    
+    arena_temp_end(temp);
+  }
+}
+
+function U32
+vox_mesh_cache_update(VOX_MeshCache *cache, VOX_World *world)
+{
+  ProfBegin("mesh update");
+  
+  // Chunks that were released: their neighbors may have gained faces
+  for (VOX_ChunkMesh *m = cache->first, *next = 0; m != 0; m = next) {
+    next = m->next;
+    if (!vox_world_chunk_from_coord(world, m->coord)) {
+      vox_mesh_mark_neighbors(cache, m->coord, ~0u);
+      vox_mesh_release(cache, m);
+    }
+  }
+  
+  // New chunks, and edits, which may also change faces and occlusion of neighbors
+  for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+    VOX_ChunkMesh *mesh = vox_mesh_from_chunk_coord(cache, n->coord);
+    if (!mesh) {
+      mesh = vox_mesh_acquire(cache, n->coord);
+    }
+    if (vox_dirty_bricks_any(n->dirty_bricks)) {
+      mesh->dirty = 1;
+      vox_mesh_mark_neighbors(cache, n->coord, vox_mesh_neighbors_from_dirty_bricks(n->dirty_bricks));
+    }
+  }
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  VOX_ChunkMesh **meshes = ArenaPushArray(scratch.arena, VOX_ChunkMesh *, cache->meshes_count);
+  U32 meshes_count = 0;
+  for (VOX_ChunkMesh *m = cache->first; m != 0; m = m->next) {
+    if (m->dirty) {
+      meshes[meshes_count++] = m;
+    }
+  }
+  
+  // A backend's copy of a rebuilt mesh is stale, but kept until it sees the new version
+  VOX_MeshJob job = {0};
+  job.cache = cache;
+  job.world = world;
+  job.meshes = meshes;
+  async_parallel_for(meshes_count, 1, vox_mesh_build_work, &job);
+  
+  arena_scratch_end(scratch);
+  
+  ProfCounter("meshes rebuilt", meshes_count);
+  ProfEnd();
+  
+  return meshes_count;
+}
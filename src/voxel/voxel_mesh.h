@@ -0,0 +1,137 @@
+#pragma once
+
+// NOTE: Greedy meshing, for rasterizing chunks instead of raymarching them. Each
+// chunk becomes a set of quads covering the faces between its solid voxels and
+// empty space; coplanar faces of the same color and ambient occlusion are merged
+// into as few rectangles as possible. Faces on the chunk's border, and the
+// occlusion of every face, look at the neighboring chunks, so a chunk's mesh also
+// goes stale when voxels next to it change.
+//
+// Meshes live in a cache keyed by chunk coordinate. Like the light cache,
+// vox_mesh_cache_update reads the chunks' dirty bricks without clearing them;
+// the renderer clears them at the end of the frame.
+
+// A vertex is packed into 32 bits:
+//   bits  0..17  x, y, z: corner within the chunk, 0..VOX_SLICE_SIZE, 6 bits each
+//   bits 18..20  face (VOX_MeshFace), which gives the normal
+//   bits 21..22  ambient occlusion, 0 (corner fully occluded) to 3 (open)
+//   bits 23..30  voxel color (palette index)
+typedef U32 VOX_MeshVertex;
+
+#define VOX_MESH_VERTEX_POS_BITS   6
+#define VOX_MESH_VERTEX_FACE_SHIFT 18
+#define VOX_MESH_VERTEX_AO_SHIFT   21
+#define VOX_MESH_VERTEX_COLOR_SHIFT 23
+
+// Quads are 4 vertices, wound counter-clockwise when seen from outside the solid
+// (in a right-handed frame), to be drawn as triangles 0 1 2 and 0 2 3.
+#define VOX_MESH_VERTICES_PER_QUAD 4
+#define VOX_MESH_INDICES_PER_QUAD  6
+
+// A checkerboard chunk is the worst case: every face of every other voxel.
+#define VOX_MESH_QUADS_MAX (VOX_CHUNK_SIZE / 2 * VOX_MeshFace_COUNT)
+
+// The chunk plus a one voxel border taken from its neighbors
+#define VOX_MESH_PADDED_SIZE (VOX_SLICE_SIZE + 2)
+
+// Vertex buffers come from a size-class allocator, as palette chunks do.
+// Classes are powers of two from 1 KiB up to a worst-case chunk.
+#define VOX_MESH_BLOCK_CLASS_MIN   10
+#define VOX_MESH_BLOCK_CLASS_COUNT 12
+
+#define VOX_MESH_CACHE_SLOTS 1024
+
+enum VOX_MeshFace {
+  VOX_MeshFace_PosX,
+  VOX_MeshFace_NegX,
+  VOX_MeshFace_PosY,
+  VOX_MeshFace_NegY,
+  VOX_MeshFace_PosZ,
+  VOX_MeshFace_NegZ,
+  VOX_MeshFace_COUNT,
+};
+
+struct VOX_MeshBlock {
+  VOX_MeshBlock *next;
+};
+
+struct VOX_ChunkMesh {
+  // Cache list
+  VOX_ChunkMesh *next;
+  VOX_ChunkMesh *prev;
+  
+  // Hash slot chain
+  VOX_ChunkMesh *hash_next;
+  VOX_ChunkMesh *hash_prev;
+  
+  V3S32 coord;
+  B32 dirty;
+  U64 version; // Bumped by every rebuild, so a backend can tell its copy is stale
+  
+  VOX_MeshVertex *vertices; // VOX_MESH_VERTICES_PER_QUAD per quad
+  U32 quads_count;
+  U32 faces_count; // Voxel faces the quads cover, i.e. the quads before merging
+  
+  void *backend; // Owned by the renderer, see VOX_MeshCache::backend_release
+  U64 backend_version; // Version the backend last copied
+};
+
+struct VOX_MeshSlot {
+  VOX_ChunkMesh *first;
+  VOX_ChunkMesh *last;
+};
+
+typedef void VOX_MeshBackendReleaseProc(void *user, VOX_ChunkMesh *mesh);
+
+struct VOX_MeshCache {
+  Arena *arena;
+  
+  VOX_MeshSlot slots[VOX_MESH_CACHE_SLOTS];
+  VOX_ChunkMesh *first;
+  VOX_ChunkMesh *last;
+  U32 meshes_count;
+  VOX_ChunkMesh *free;
+  
+  // Build jobs allocate vertex buffers concurrently
+  volatile U32 blocks_lock;
+  VOX_MeshBlock *free_blocks[VOX_MESH_BLOCK_CLASS_COUNT];
+  
+  // Called before a mesh with a non-zero `backend` is dropped
+  VOX_MeshBackendReleaseProc *backend_release;
+  void *backend_user;
+};
+
+// Output of meshing a single chunk
+struct VOX_MeshBuild {
+  VOX_MeshVertex *vertices;
+  U32 quads_count;
+  U32 faces_count;
+};
+
+struct VOX_MeshJob {
+  VOX_MeshCache *cache;
+  VOX_World *world;
+  VOX_ChunkMesh **meshes;
+};
+
+function VOX_MeshVertex vox_mesh_vertex_pack(V3S32 pos, VOX_MeshFace face, U32 ao, U8 color);
+function V3S32 vox_mesh_vertex_position(VOX_MeshVertex v);
+function VOX_MeshFace vox_mesh_vertex_face(VOX_MeshVertex v);
+function U32 vox_mesh_vertex_ao(VOX_MeshVertex v);
+function U8 vox_mesh_vertex_color(VOX_MeshVertex v);
+
+// Meshes one chunk into `arena`; `world` supplies the neighbors.
+function VOX_MeshBuild vox_mesh_build(Arena *arena, VOX_World *world, VOX_ChunkNode *node);
+
+function VOX_MeshCache *vox_mesh_cache_alloc(void);
+function void vox_mesh_cache_release(VOX_MeshCache *cache);
+// Drops every mesh; the next update rebuilds all chunks.
+function void vox_mesh_cache_clear(VOX_MeshCache *cache);
+
+function VOX_ChunkMesh *vox_mesh_from_chunk_coord(VOX_MeshCache *cache, V3S32 chunk_coord);
+
+// Brings the cache in line with the world: adds meshes for new chunks, drops
+// those of released chunks, and rebuilds every mesh that a dirty brick touches,
+// in parallel on the async workers. Leaves the dirty bricks set. Returns the
+// number of meshes rebuilt.
+function U32 vox_mesh_cache_update(VOX_MeshCache *cache, VOX_World *world);
@@ -0,0 +1,118 @@
+function S32
+vox_brick_idx_from_local_coord(V3S32 local_coord)
+{
+  S32 bx = local_coord.x / VOX_BRICK_SIZE;
+  S32 by = local_coord.y / VOX_BRICK_SIZE;
+  S32 bz = local_coord.z / VOX_BRICK_SIZE;
+  S32 result = bx + by*VOX_BRICKS_PER_SLICE + bz*VOX_BRICKS_PER_SLICE*VOX_BRICKS_PER_SLICE;
+  return result;
+}
+
+function U32
+vox_brick_bit_from_local_coord(V3S32 local_coord)
+{
+  U32 lx = (U32)local_coord.x % VOX_BRICK_SIZE;
+  U32 ly = (U32)local_coord.y % VOX_BRICK_SIZE;
+  U32 lz = (U32)local_coord.z % VOX_BRICK_SIZE;
+  U32 result = lx + ly*VOX_BRICK_SIZE + lz*VOX_BRICK_SIZE*VOX_BRICK_SIZE;
+  return result;
+}
+
+function U32
+vox_occupancy_build(VOX_Occupancy *occ, VOX_Chunk *chunk)
+{
+  MemoryZeroStruct(occ);
+  U32 solid_count = 0;
+  
+  // Empty and fully solid chunks, such as the ones underground, don't need the
+  // per-voxel walk
+  VOX_ChunkClass chunk_class = vox_chunk_classify(chunk->voxels);
+  if (chunk_class.all_solid) {
+    MemorySet(occ, 0xFF, sizeof(*occ));
+    solid_count = VOX_CHUNK_SIZE;
+  }
+  else if (!chunk_class.all_empty) {
+    for (S32 z = 0; z < VOX_SLICE_SIZE; z += 1) {
+      for (S32 y = 0; y < VOX_SLICE_SIZE; y += 1) {
+        for (S32 x = 0; x < VOX_SLICE_SIZE; x += 1) {
+          V3S32 local_coord = v3s32(x, y, z);
+          VOX_Voxel *v = vox_get_voxel(chunk, vox_idx_from_local_coord(local_coord));
+          if (v->opacity > 0) {
+            S32 brick_idx = vox_brick_idx_from_local_coord(local_coord);
+            occ->bricks[brick_idx] |= (U64)1 << vox_brick_bit_from_local_coord(local_coord);
+            solid_count += 1;
+          }
+        }
+      }
+    }
+    
+    for (S32 brick_idx = 0; brick_idx < VOX_BRICKS_PER_CHUNK; brick_idx += 1) {
+      if (occ->bricks[brick_idx]) {
+        occ->summary[brick_idx / 64] |= (U64)1 << (brick_idx % 64);
+      }
+    }
+  }
+  
+  return solid_count;
+}
+
+function void
+vox_occupancy_set(VOX_Occupancy *occ, V3S32 local_coord, B32 solid)
+{
+  S32 brick_idx = vox_brick_idx_from_local_coord(local_coord);
+  U64 bit = (U64)1 << vox_brick_bit_from_local_coord(local_coord);
+  U64 summary_bit = (U64)1 << (brick_idx % 64);
+  
+  if (solid) {
+    occ->bricks[brick_idx] |= bit;
+    occ->summary[brick_idx / 64] |= summary_bit;
+  }
+  else {
+    occ->bricks[brick_idx] &= ~bit;
+    if (occ->bricks[brick_idx] == 0) {
+      occ->summary[brick_idx / 64] &= ~summary_bit;
+    }
+  }
+}
+
+function void
+vox_occupancy_set_span(VOX_Occupancy *occ, V3S32 local_coord, S32 count, B32 solid)
+{
+  S32 x_opl = local_coord.x + count;
+  for (S32 x = local_coord.x; x < x_opl;) {
+    S32 brick_x_opl = Min((x / VOX_BRICK_SIZE + 1)*VOX_BRICK_SIZE, x_opl);
+    V3S32 coord = v3s32(x, local_coord.y, local_coord.z);
+    S32 brick_idx = vox_brick_idx_from_local_coord(coord);
+    U64 bits = (((U64)1 << (brick_x_opl - x)) - 1) << vox_brick_bit_from_local_coord(coord);
+    U64 summary_bit = (U64)1 << (brick_idx % 64);
+    
+    if (solid) {
+      occ->bricks[brick_idx] |= bits;
+      occ->summary[brick_idx / 64] |= summary_bit;
+    }
+    else {
+      occ->bricks[brick_idx] &= ~bits;
+      if (occ->bricks[brick_idx] == 0) {
+        occ->summary[brick_idx / 64] &= ~summary_bit;
+      }
+    }
+    
+    x = brick_x_opl;
+  }
+}
+
+function B32
+vox_occupancy_get(VOX_Occupancy *occ, V3S32 local_coord)
+{
+  S32 brick_idx = vox_brick_idx_from_local_coord(local_coord);
+  U64 bit = (U64)1 << vox_brick_bit_from_local_coord(local_coord);
+  B32 result = ((occ->bricks[brick_idx] & bit) != 0);
+  return result;
+}
+
+function B32
+vox_occupancy_brick_empty(VOX_Occupancy *occ, S32 brick_idx)
+{
+  B32 result = ((occ->summary[brick_idx / 64] >> (brick_idx % 64)) & 1) == 0;
+  return result;
+}
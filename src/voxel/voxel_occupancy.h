@@ -0,0 +1,27 @@
+#pragma once
+
+// NOTE: Two-level occupancy mask kept alongside each chunk. The chunk is split
+// into 4^3 bricks whose 64 voxels map onto the bits of a single U64, and a
+// summary mask holds one bit per brick that is set whenever the brick contains
+// any solid voxel. Ray traversal uses the summary to skip empty bricks whole.
+
+#define VOX_BRICK_SIZE            4
+#define VOX_BRICKS_PER_SLICE      (VOX_SLICE_SIZE / VOX_BRICK_SIZE)
+#define VOX_BRICKS_PER_CHUNK      (VOX_BRICKS_PER_SLICE * VOX_BRICKS_PER_SLICE * VOX_BRICKS_PER_SLICE)
+#define VOX_BRICK_SUMMARY_WORDS   (VOX_BRICKS_PER_CHUNK / 64)
+
+struct VOX_Occupancy {
+  U64 bricks[VOX_BRICKS_PER_CHUNK];
+  U64 summary[VOX_BRICK_SUMMARY_WORDS];
+};
+
+function S32 vox_brick_idx_from_local_coord(V3S32 local_coord);
+function U32 vox_brick_bit_from_local_coord(V3S32 local_coord);
+
+// Rebuilds the masks from scratch; returns the number of solid voxels.
+function U32 vox_occupancy_build(VOX_Occupancy *occ, VOX_Chunk *chunk);
+function void vox_occupancy_set(VOX_Occupancy *occ, V3S32 local_coord, B32 solid);
+// Sets `count` voxels along x starting at `local_coord`, a brick at a time.
+function void vox_occupancy_set_span(VOX_Occupancy *occ, V3S32 local_coord, S32 count, B32 solid);
+function B32 vox_occupancy_get(VOX_Occupancy *occ, V3S32 local_coord);
+function B32 vox_occupancy_brick_empty(VOX_Occupancy *occ, S32 brick_idx);
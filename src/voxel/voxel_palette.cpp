@@ -0,0 +1,417 @@
+//
+// Palette store (size-class block allocator)
+//
+
+function VOX_PaletteStore *
+vox_palette_store_alloc(void)
+{
+  Arena *arena = arena_alloc_default();
+  VOX_PaletteStore *store = ArenaPushStruct(arena, VOX_PaletteStore);
+  store->arena = arena;
+  return store;
+}
+
+function void
+vox_palette_store_release(VOX_PaletteStore *store)
+{
+  if (store) {
+    arena_release(store->arena);
+  }
+}
+
+function U32
+vox_palette_block_class_from_size(U64 size)
+{
+  U32 result = 0;
+  while (((U64)1 << (result + VOX_PALETTE_BLOCK_CLASS_MIN)) < size) {
+    result += 1;
+  }
+  Assert(result < VOX_PALETTE_BLOCK_CLASS_COUNT);
+  return result;
+}
+
+function U64
+vox_palette_block_size_from_size(U64 size)
+{
+  U32 block_class = vox_palette_block_class_from_size(size);
+  U64 result = (U64)1 << (block_class + VOX_PALETTE_BLOCK_CLASS_MIN);
+  return result;
+}
+
+function void *
+vox_palette_block_alloc(VOX_PaletteStore *store, U64 size)
+{
+  U32 block_class = vox_palette_block_class_from_size(size);
+  
+  void *result = store->free[block_class];
+  if (result) {
+    SLLStackPop(store->free[block_class]);
+  }
+  else {
+    U64 block_size = (U64)1 << (block_class + VOX_PALETTE_BLOCK_CLASS_MIN);
+    result = arena_push_nozero(store->arena, block_size);
+  }
+  MemoryZero(result, size);
+  
+  return result;
+}
+
+function void
+vox_palette_block_release(VOX_PaletteStore *store, void *block, U64 size)
+{
+  if (block) {
+    U32 block_class = vox_palette_block_class_from_size(size);
+    VOX_PaletteBlock *b = (VOX_PaletteBlock *)block;
+    SLLStackPush(store->free[block_class], b);
+  }
+}
+
+//
+// Packed index helpers
+//
+
+function U32
+vox_palette_cap_from_bits(U32 bits)
+{
+  U32 result = Min((U32)1 << bits, (U32)VOX_CHUNK_SIZE);
+  return result;
+}
+
+function U64
+vox_palette_indices_size_from_bits(U32 bits)
+{
+  U64 result = ((U64)VOX_CHUNK_SIZE*bits) / 8;
+  return result;
+}
+
+function U32
+vox_palette_index_get(U64 *indices, U32 bits, S32 idx)
+{
+  U64 bit_pos = (U64)idx*bits;
+  U64 mask = ((U64)1 << bits) - 1;
+  U32 result = (U32)((indices[bit_pos >> 6] >> (bit_pos & 63)) & mask);
+  return result;
+}
+
+function void
+vox_palette_index_set(U64 *indices, U32 bits, S32 idx, U32 value)
+{
+  U64 bit_pos = (U64)idx*bits;
+  U64 mask = ((U64)1 << bits) - 1;
+  U64 *word = &indices[bit_pos >> 6];
+  U32 shift = (U32)(bit_pos & 63);
+  *word = (*word & ~(mask << shift)) | (((U64)value & mask) << shift);
+}
+
+//
+// Palette lookup
+//
+
+function U32
+vox_palette_hash_from_voxel(VOX_Voxel voxel)
+{
+  U32 h = vox_u32_from_voxel(voxel) * 0x9E3779B1u;
+  h ^= h >> 16;
+  return h;
+}
+
+function S32
+vox_palette_find(VOX_PaletteChunk *pc, VOX_Voxel voxel)
+{
+  S32 result = -1;
+  
+  U32 mask = pc->hash_cap - 1;
+  for (U32 slot = vox_palette_hash_from_voxel(voxel) & mask;; slot = (slot + 1) & mask) {
+    U32 entry = pc->hash[slot];
+    if (entry == 0) {
+      break;
+    }
+    if (vox_voxel_equal(pc->palette[entry - 1], voxel)) {
+      result = (S32)(entry - 1);
+      break;
+    }
+  }
+  
+  return result;
+}
+
+function void
+vox_palette_hash_insert_raw(VOX_PaletteChunk *pc, U32 palette_idx)
+{
+  U32 mask = pc->hash_cap - 1;
+  U32 slot = vox_palette_hash_from_voxel(pc->palette[palette_idx]) & mask;
+  while (pc->hash[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  pc->hash[slot] = (U16)(palette_idx + 1);
+  pc->hash_used += 1;
+}
+
+function void
+vox_palette_hash_rebuild(VOX_PaletteChunk *pc)
+{
+  MemoryZeroArray(pc->hash, pc->hash_cap);
+  pc->hash_used = 0;
+  for (U32 p = 0; p < pc->palette_count; p += 1) {
+    vox_palette_hash_insert_raw(pc, p);
+  }
+}
+
+function void
+vox_palette_hash_insert(VOX_PaletteChunk *pc, U32 palette_idx)
+{
+  // Stale entries accumulate as palette slots get overwritten, so rebuild before
+  // the probe sequences get long.
+  if ((pc->hash_used + 1)*4 > pc->hash_cap*3) {
+    vox_palette_hash_rebuild(pc);
+  }
+  vox_palette_hash_insert_raw(pc, palette_idx);
+}
+
+//
+// Buffer management
+//
+
+function void
+vox_palette_chunk_alloc_buffers(VOX_PaletteChunk *pc, U32 bits)
+{
+  VOX_PaletteStore *store = pc->store;
+  
+  pc->bits = bits;
+  pc->palette_cap = vox_palette_cap_from_bits(bits);
+  pc->hash_cap = Max(pc->palette_cap*2, 4);
+  
+  pc->indices = (U64 *)vox_palette_block_alloc(store, vox_palette_indices_size_from_bits(bits));
+  pc->palette = (VOX_Voxel *)vox_palette_block_alloc(store, sizeof(VOX_Voxel)*pc->palette_cap);
+  pc->counts = (U16 *)vox_palette_block_alloc(store, sizeof(U16)*pc->palette_cap);
+  pc->hash = (U16 *)vox_palette_block_alloc(store, sizeof(U16)*pc->hash_cap);
+}
+
+function void
+vox_palette_chunk_release_buffers(VOX_PaletteChunk *pc)
+{
+  VOX_PaletteStore *store = pc->store;
+  vox_palette_block_release(store, pc->indices, vox_palette_indices_size_from_bits(pc->bits));
+  vox_palette_block_release(store, pc->palette, sizeof(VOX_Voxel)*pc->palette_cap);
+  vox_palette_block_release(store, pc->counts, sizeof(U16)*pc->palette_cap);
+  vox_palette_block_release(store, pc->hash, sizeof(U16)*pc->hash_cap);
+}
+
+// Drops palette entries that are no longer referenced and re-packs all indices
+// at the given width.
+function void
+vox_palette_chunk_repack(VOX_PaletteChunk *pc, U32 bits)
+{
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  VOX_PaletteChunk next = {0};
+  next.store = pc->store;
+  vox_palette_chunk_alloc_buffers(&next, bits);
+  
+  U16 *remap = ArenaPushArrayNoZero(scratch.arena, U16, pc->palette_count);
+  for (U32 p = 0; p < pc->palette_count; p += 1) {
+    if (pc->counts[p] > 0) {
+      Assert(next.palette_count < next.palette_cap);
+      remap[p] = (U16)next.palette_count;
+      next.palette[next.palette_count] = pc->palette[p];
+      next.counts[next.palette_count] = pc->counts[p];
+      next.palette_count += 1;
+    }
+  }
+  next.live_count = next.palette_count;
+  
+  for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+    U32 p = vox_palette_index_get(pc->indices, pc->bits, idx);
+    vox_palette_index_set(next.indices, next.bits, idx, remap[p]);
+  }
+  
+  vox_palette_hash_rebuild(&next);
+  vox_palette_chunk_release_buffers(pc);
+  *pc = next;
+  
+  arena_scratch_end(scratch);
+}
+
+//
+// Palette chunks
+//
+
+function VOX_PaletteChunk
+vox_palette_chunk_make(VOX_PaletteStore *store, VOX_Voxel fill)
+{
+  VOX_PaletteChunk pc = {0};
+  pc.store = store;
+  vox_palette_chunk_alloc_buffers(&pc, VOX_PALETTE_BITS_MIN);
+  
+  pc.palette[0] = fill;
+  pc.counts[0] = (U16)VOX_CHUNK_SIZE;
+  pc.palette_count = 1;
+  pc.live_count = 1;
+  vox_palette_hash_insert(&pc, 0);
+  
+  return pc;
+}
+
+function VOX_PaletteChunk
+vox_palette_chunk_from_chunk(VOX_PaletteStore *store, VOX_Chunk *chunk)
+{
+  VOX_PaletteChunk pc = {0};
+  pc.store = store;
+  
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  // Gather unique values into a temporary full-width palette first so the final
+  // width is known before anything is packed.
+  VOX_PaletteChunk tmp = {0};
+  tmp.bits = VOX_PALETTE_BITS_MAX;
+  tmp.palette_cap = vox_palette_cap_from_bits(VOX_PALETTE_BITS_MAX);
+  tmp.hash_cap = tmp.palette_cap*2;
+  tmp.palette = ArenaPushArrayNoZero(scratch.arena, VOX_Voxel, tmp.palette_cap);
+  tmp.counts = ArenaPushArray(scratch.arena, U16, tmp.palette_cap);
+  tmp.hash = ArenaPushArray(scratch.arena, U16, tmp.hash_cap);
+  U16 *voxel_palette_idx = ArenaPushArrayNoZero(scratch.arena, U16, VOX_CHUNK_SIZE);
+  
+  for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+    VOX_Voxel v = chunk->voxels[idx];
+    S32 p = vox_palette_find(&tmp, v);
+    if (p < 0) {
+      p = (S32)tmp.palette_count;
+      tmp.palette[p] = v;
+      tmp.palette_count += 1;
+      vox_palette_hash_insert_raw(&tmp, (U32)p);
+    }
+    tmp.counts[p] += 1;
+    voxel_palette_idx[idx] = (U16)p;
+  }
+  
+  U32 bits = VOX_PALETTE_BITS_MIN;
+  while (vox_palette_cap_from_bits(bits) < tmp.palette_count) {
+    bits *= 2;
+  }
+  
+  vox_palette_chunk_alloc_buffers(&pc, bits);
+  MemoryCopy(pc.palette, tmp.palette, sizeof(VOX_Voxel)*tmp.palette_count);
+  MemoryCopy(pc.counts, tmp.counts, sizeof(U16)*tmp.palette_count);
+  pc.palette_count = tmp.palette_count;
+  pc.live_count = tmp.palette_count;
+  
+  for (S32 idx = 0; idx < VOX_CHUNK_SIZE; idx += 1) {
+    vox_palette_index_set(pc.indices, bits, idx, voxel_palette_idx[idx]);
+  }
+  vox_palette_hash_rebuild(&pc);
+  
+  arena_scratch_end(scratch);
+  
+  return pc;
+}
+
+function void
+vox_palette_chunk_release(VOX_PaletteChunk *pc)
+{
+  vox_palette_chunk_release_buffers(pc);
+  MemoryZeroStruct(pc);
+}
+
+function VOX_Voxel
+vox_palette_chunk_get(VOX_PaletteChunk *pc, S32 idx)
+{
+  U32 p = vox_palette_index_get(pc->indices, pc->bits, idx);
+  VOX_Voxel result = pc->palette[p];
+  return result;
+}
+
+function void
+vox_palette_chunk_set(VOX_PaletteChunk *pc, S32 idx, VOX_Voxel voxel)
+{
+  U32 old_p = vox_palette_index_get(pc->indices, pc->bits, idx);
+  if (vox_voxel_equal(pc->palette[old_p], voxel)) {
+    return;
+  }
+  
+  S32 p = vox_palette_find(pc, voxel);
+  if (p < 0) {
+    // If this voxel is the only user of its old entry, the entry can simply be
+    // retargeted to the new value.
+    if (pc->counts[old_p] == 1) {
+      pc->palette[old_p] = voxel;
+      vox_palette_hash_insert(pc, old_p);
+      return;
+    }
+    
+    // Out of palette slots: drop dead entries, and widen if every entry is still
+    // in use.
+    if (pc->palette_count == pc->palette_cap) {
+      U32 bits = pc->bits;
+      if (pc->live_count == pc->palette_cap) {
+        Assert(bits < VOX_PALETTE_BITS_MAX);
+        bits *= 2;
+      }
+      vox_palette_chunk_repack(pc, bits);
+      old_p = vox_palette_index_get(pc->indices, pc->bits, idx);
+    }
+    
+    p = (S32)pc->palette_count;
+    pc->palette[p] = voxel;
+    pc->counts[p] = 0;
+    pc->palette_count += 1;
+    vox_palette_hash_insert(pc, (U32)p);
+  }
+  
+  if (pc->counts[p] == 0) {
+    pc->live_count += 1;
+  }
+  pc->counts[p] += 1;
+  pc->counts[old_p] -= 1;
+  vox_palette_index_set(pc->indices, pc->bits, idx, (U32)p);
+  
+  // Narrow once the live palette comfortably fits a smaller width; the slack
+  // keeps a chunk hovering around a boundary from repacking on every edit.
+  if (pc->counts[old_p] == 0) {
+    pc->live_count -= 1;
+    if (pc->bits > VOX_PALETTE_BITS_MIN) {
+      U32 narrow_bits = pc->bits / 2;
+      if (pc->live_count <= vox_palette_cap_from_bits(narrow_bits) / 2) {
+        vox_palette_chunk_repack(pc, narrow_bits);
+      }
+    }
+  }
+}
+
+function void
+vox_palette_chunk_get_range(VOX_PaletteChunk *pc, S32 first, S32 count, VOX_Voxel *out)
+{
+  U32 bits = pc->bits;
+  U64 mask = ((U64)1 << bits) - 1;
+  U32 per_word = 64 / bits;
+  VOX_Voxel *palette = pc->palette;
+  
+  S32 idx = first;
+  S32 opl = first + count;
+  while (idx < opl) {
+    U64 bit_pos = (U64)idx*bits;
+    U64 word = pc->indices[bit_pos >> 6] >> (bit_pos & 63);
+    
+    S32 word_opl = Min(opl, idx + (S32)(per_word - (idx % per_word)));
+    for (; idx < word_opl; idx += 1) {
+      *out++ = palette[word & mask];
+      word >>= bits;
+    }
+  }
+}
+
+function void
+vox_chunk_from_palette_chunk(VOX_PaletteChunk *pc, VOX_Chunk *chunk)
+{
+  vox_palette_chunk_get_range(pc, 0, VOX_CHUNK_SIZE, chunk->voxels);
+}
+
+function U64
+vox_palette_chunk_memory_size(VOX_PaletteChunk *pc)
+{
+  U64 result = sizeof(VOX_PaletteChunk);
+  result += vox_palette_block_size_from_size(vox_palette_indices_size_from_bits(pc->bits));
+  result += vox_palette_block_size_from_size(sizeof(VOX_Voxel)*pc->palette_cap);
+  result += vox_palette_block_size_from_size(sizeof(U16)*pc->palette_cap);
+  result += vox_palette_block_size_from_size(sizeof(U16)*pc->hash_cap);
+  return result;
+}
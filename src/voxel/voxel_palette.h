@@ -0,0 +1,61 @@
+#pragma once
+
+// NOTE: Palette chunks are an alternative storage mode for chunk data. Instead of
+// storing every VOX_Voxel in full, a chunk keeps a palette of its unique voxel
+// values and one bit-packed palette index per voxel. The index width is one of
+// 1, 2, 4, 8 or 16 bits and is widened or narrowed automatically as edits add
+// or remove unique values. Index widths always divide 64, so an index never
+// straddles two words.
+
+#define VOX_PALETTE_BITS_MIN 1
+#define VOX_PALETTE_BITS_MAX 16
+
+// Buffers are handed out by a size-class allocator so that chunks changing width
+// can recycle each other's memory. Classes are powers of two from 16 B to 128 KiB.
+#define VOX_PALETTE_BLOCK_CLASS_MIN   4
+#define VOX_PALETTE_BLOCK_CLASS_COUNT 14
+
+struct VOX_PaletteBlock {
+  VOX_PaletteBlock *next;
+};
+
+struct VOX_PaletteStore {
+  Arena *arena;
+  VOX_PaletteBlock *free[VOX_PALETTE_BLOCK_CLASS_COUNT];
+};
+
+struct VOX_PaletteChunk {
+  VOX_PaletteStore *store;
+  
+  U32 bits;
+  U64 *indices;       // VOX_CHUNK_SIZE palette indices, `bits` wide each
+  
+  VOX_Voxel *palette;
+  U16 *counts;        // Number of voxels referencing each palette entry
+  U32 palette_count;  // Entries in use, including ones whose count dropped to 0
+  U32 palette_cap;
+  U32 live_count;     // Entries with a non-zero count
+  
+  // Open-addressed map from voxel value to (palette index + 1). Entries may go
+  // stale when a palette slot is overwritten, so lookups always verify the value.
+  U16 *hash;
+  U32 hash_cap;
+  U32 hash_used;
+};
+
+function VOX_PaletteStore *vox_palette_store_alloc(void);
+function void vox_palette_store_release(VOX_PaletteStore *store);
+
+function VOX_PaletteChunk vox_palette_chunk_make(VOX_PaletteStore *store, VOX_Voxel fill);
+function VOX_PaletteChunk vox_palette_chunk_from_chunk(VOX_PaletteStore *store, VOX_Chunk *chunk);
+function void vox_palette_chunk_release(VOX_PaletteChunk *pc);
+
+function VOX_Voxel vox_palette_chunk_get(VOX_PaletteChunk *pc, S32 idx);
+function void vox_palette_chunk_set(VOX_PaletteChunk *pc, S32 idx, VOX_Voxel voxel);
+
+// Bulk decode of a contiguous index range; much faster than repeated gets since
+// it walks the packed words directly.
+function void vox_palette_chunk_get_range(VOX_PaletteChunk *pc, S32 first, S32 count, VOX_Voxel *out);
+function void vox_chunk_from_palette_chunk(VOX_PaletteChunk *pc, VOX_Chunk *chunk);
+
+function U64 vox_palette_chunk_memory_size(VOX_PaletteChunk *pc);
@@ -2,7 +2,6 @@ function VOX_MapResult
 vox_map(V3F32 pos, F32 voxel_scale)
 {
 	VOX_MapResult result = {0};
-  result.idx = -1;
   
 #if 0
 	// Treat center of chunk as origin
@@ -19,100 +18,364 @@ vox_map(V3F32 pos, F32 voxel_scale)
   chunk_coord.z = (S32)(pos.z / voxel_scale);
 #endif
   
-  V3S32 chunk_coord = {0};
-  chunk_coord.x = (S32)(pos.x);
-  chunk_coord.y = (S32)(pos.y);
-  chunk_coord.z = (S32)(pos.z);
+  V3S32 coord = {0};
+  coord.x = (S32)floorf32(pos.x);
+  coord.y = (S32)floorf32(pos.y);
+  coord.z = (S32)floorf32(pos.z);
   
-  B32 coord_valid = 
-  (chunk_coord.x >= 0 && chunk_coord.x < VOX_SLICE_SIZE) && 
-  (chunk_coord.y >= 0 && chunk_coord.y < VOX_SLICE_SIZE) && 
-  (chunk_coord.z >= 0 && chunk_coord.z < VOX_SLICE_SIZE);
+  result.coord = coord;
+  result.chunk_coord = vox_chunk_coord_from_voxel_coord(coord);
+  result.idx = vox_idx_from_local_coord(vox_local_coord_from_voxel_coord(coord));
   
-  if (coord_valid) {
-    S32 idx = 
-      chunk_coord.x + 
-      chunk_coord.y*VOX_SLICE_SIZE +
-      chunk_coord.z*VOX_SLICE_SIZE*VOX_SLICE_SIZE;
+  return result;
+}
+
+// Moves the traversal to the first voxel past the aligned cell of the given size
+// that contains the current voxel. Used to skip absent chunks and empty bricks 
+// in one step instead of visiting each of their voxels.
+function void
+vox_raycast_leap(VOX_RaycastState *s, F32 cell_size)
+{
+  V3F32 cell_min = {0};
+  cell_min.x = floorf32(s->pos.x / cell_size) * cell_size;
+  cell_min.y = floorf32(s->pos.y / cell_size) * cell_size;
+  cell_min.z = floorf32(s->pos.z / cell_size) * cell_size;
+  
+  // Parametric distance to the cell's exit plane on each axis
+  V3F32 t_exit = {0};
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    F32 plane = (s->stp.e[axis] > 0.f) ? cell_min.e[axis] + cell_size : cell_min.e[axis];
+    t_exit.e[axis] = (s->rd.e[axis] != 0.f) ? (plane - s->ro.e[axis]) / s->rd.e[axis] : VOX_RAYCAST_T_FAR;
+  }
+  
+  U32 exit_axis = 2;
+  if (t_exit.x < t_exit.y && t_exit.x < t_exit.z) {
+    exit_axis = 0;
+  }
+  else if (t_exit.y < t_exit.z) {
+    exit_axis = 1;
+  }
+  F32 t = t_exit.e[exit_axis];
+  
+  // Land on the voxel just across the exit plane; clamp the other axes to the
+  // cell so that rounding can't push the traversal sideways.
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    F32 p = 0.f;
+    if (axis == exit_axis) {
+      p = (s->stp.e[axis] > 0.f) ? cell_min.e[axis] + cell_size : cell_min.e[axis] - 1.f;
+    }
+    else {
+      p = floorf32(s->ro.e[axis] + s->rd.e[axis]*t);
+      p = Clamp(p, cell_min.e[axis], cell_min.e[axis] + cell_size - 1.f);
+    }
+    s->pos.e[axis] = p;
     
-    result.idx = idx;
+    F32 boundary = (s->stp.e[axis] > 0.f) ? p + 1.f : p;
+    s->t_max.e[axis] = (s->rd.e[axis] != 0.f) ? (boundary - s->ro.e[axis]) / s->rd.e[axis] : VOX_RAYCAST_T_FAR;
   }
   
+  s->normal = v3f32(0,0,0);
+  s->normal.e[exit_axis] = -s->stp.e[exit_axis];
+  s->t = t;
+}
+
+function void
+vox_raycast_step(VOX_RaycastState *s)
+{
+  // Advance to next voxel boundary in the dimension in which
+  // the distance to the next voxel boundary is smallest
+  if (s->t_max.x < s->t_max.y && s->t_max.x < s->t_max.z ) { 
+    s->t = s->t_max.x; s->t_max.x += s->t_delta.x; s->pos.x += s->stp.x; 
+    s->normal = v3f32(-s->stp.x, 0, 0);
+  }
+  else if(s->t_max.y < s->t_max.z ) { 
+    s->t = s->t_max.y; s->t_max.y += s->t_delta.y; s->pos.y += s->stp.y; 
+    s->normal = v3f32(0, -s->stp.y, 0);
+  }
+  else { 
+    s->t = s->t_max.z; s->t_max.z += s->t_delta.z; s->pos.z += s->stp.z; 
+    s->normal = v3f32(0, 0, -s->stp.z);
+  }     
+}
+
+// Inverse of vox_map: world-space position of a voxel's minimum corner.
+function V3F32
+vox_world_pos_from_voxel_coord(V3S32 coord)
+{
+  V3F32 result = v3f32((F32)coord.x, (F32)coord.y, (F32)coord.z);
+  result.y -= VOX_SLICE_SIZE;
   return result;
 }
 
-function VOX_RaycastResult 
-vox_raycast(VOX_Chunk *chunk, F32 voxel_scale, V3F32 ro, V3F32 rd)
+// Parametric range [t_enter, t_exit] over which the ray is inside the world's
+// chunk bounds. t_exit < t_enter if it never enters.
+function V2F32
+vox_raycast_world_range(VOX_World *world, V3F32 ro, V3F32 rd)
 {
-  VOX_RaycastResult result = {0};
-  
-  V3F32 stp = v3f32((F32)Sign(rd.x), (F32)Sign(rd.y), (F32)Sign(rd.z));
-  V3F32 pos = v3f32(floorf32(ro.x), floorf32(ro.y), floorf32(ro.z));
+  V2F32 result = v2f32(0.f, -1.f);
   
-  // Initial distance to next voxel boundary, in the appropriate direction
-  V3F32 dist_to_vox = v3f32_sub(pos, ro);
-  dist_to_vox = v3f32_mul(dist_to_vox, stp);
+  if (world->has_bounds) {
+    V3F32 box_min = vox_world_pos_from_voxel_coord(v3s32_scale(world->chunk_min, VOX_SLICE_SIZE));
+    V3F32 box_max = vox_world_pos_from_voxel_coord(v3s32_scale(v3s32_add(world->chunk_max, v3s32(1,1,1)), VOX_SLICE_SIZE));
+    
+    F32 t_enter = 0.f;
+    F32 t_exit = VOX_RAYCAST_T_FAR;
+    for (U32 axis = 0; axis < 3; axis += 1) {
+      if (rd.e[axis] != 0.f) {
+        F32 t0 = (box_min.e[axis] - ro.e[axis]) / rd.e[axis];
+        F32 t1 = (box_max.e[axis] - ro.e[axis]) / rd.e[axis];
+        t_enter = Max(t_enter, Min(t0, t1));
+        t_exit = Min(t_exit, Max(t0, t1));
+      }
+      else if (ro.e[axis] < box_min.e[axis] || ro.e[axis] >= box_max.e[axis]) {
+        t_exit = -1.f;
+      }
+    }
+    result = v2f32(t_enter, t_exit);
+  }
   
-  // Convert stp to a value between 0 and 1 so we can use it to scale the ray
-  // direction vector below.
-  V3F32 stp_positive = v3f32_add(v3f32_scale(stp, 0.5f), v3f32(0.5f,0.5f,0.5f));
+  return result;
+}
+
+function VOX_RaycastState
+vox_raycast_state_make(V3F32 ro, V3F32 rd)
+{
+  VOX_RaycastState s = {0};
+  s.ro = ro;
+  s.rd = rd;
+  s.stp = v3f32((F32)Sign(rd.x), (F32)Sign(rd.y), (F32)Sign(rd.z));
+  s.pos = v3f32(floorf32(ro.x), floorf32(ro.y), floorf32(ro.z));
   
   // Distance to next voxel boundary expressed as a parametric 
   // t-value along the current pixel's ray.
-  V3F32 t_max = {0};
-	t_max.x = (rd.x > 0.f) ? (pos.x + 1.f - ro.x) / rd.x : (ro.x - pos.x) / -rd.x;
-	t_max.y = (rd.y > 0.f) ? (pos.y + 1.f - ro.y) / rd.y : (ro.y - pos.y) / -rd.y;
-	t_max.z = (rd.z > 0.f) ? (pos.z + 1.f - ro.z) / rd.z : (ro.z - pos.z) / -rd.z;
-	
+  // Axis-parallel rays never cross a boundary on the zero axes.
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    F32 boundary = (rd.e[axis] > 0.f) ? s.pos.e[axis] + 1.f : s.pos.e[axis];
+    s.t_max.e[axis] = (rd.e[axis] != 0.f) ? (boundary - ro.e[axis]) / rd.e[axis] : VOX_RAYCAST_T_FAR;
+  }
+  
   // Distance needed to move by one voxel in each axis along the 
   // current pixel's ray. 
-  V3F32 t_delta = {0};
-  t_delta.x = absf32(1.f / rd.x);
-  t_delta.y = absf32(1.f / rd.y);
-  t_delta.z = absf32(1.f / rd.z);
+  s.t_delta.x = (rd.x != 0.f) ? absf32(1.f / rd.x) : VOX_RAYCAST_T_FAR;
+  s.t_delta.y = (rd.y != 0.f) ? absf32(1.f / rd.y) : VOX_RAYCAST_T_FAR;
+  s.t_delta.z = (rd.z != 0.f) ? absf32(1.f / rd.z) : VOX_RAYCAST_T_FAR;
+  
+  return s;
+}
+
+// Like vox_raycast_state_make, but a ray from outside the world's chunk bounds
+// starts in the voxel where it enters them, on the face it crosses, so that it
+// doesn't spend its iterations walking up to the world. `world_range` is the
+// ray's vox_raycast_world_range.
+function VOX_RaycastState
+vox_raycast_state_enter_world(VOX_World *world, V3F32 ro, V3F32 rd, V2F32 world_range)
+{
+  VOX_RaycastState s = vox_raycast_state_make(ro, rd);
+  F32 t_enter = world_range.x;
+  
+  if (t_enter > 0.f && t_enter <= world_range.y) {
+    V3F32 box_min = vox_world_pos_from_voxel_coord(v3s32_scale(world->chunk_min, VOX_SLICE_SIZE));
+    V3F32 box_max = vox_world_pos_from_voxel_coord(v3s32_scale(v3s32_add(world->chunk_max, v3s32(1,1,1)), VOX_SLICE_SIZE));
+    
+    // The face crossed is the one on the axis whose slab the ray enters last
+    U32 enter_axis = 0;
+    F32 t_near_max = -VOX_RAYCAST_T_FAR;
+    for (U32 axis = 0; axis < 3; axis += 1) {
+      if (rd.e[axis] != 0.f) {
+        F32 t0 = (box_min.e[axis] - ro.e[axis]) / rd.e[axis];
+        F32 t1 = (box_max.e[axis] - ro.e[axis]) / rd.e[axis];
+        if (Min(t0, t1) > t_near_max) {
+          t_near_max = Min(t0, t1);
+          enter_axis = axis;
+        }
+      }
+    }
+    
+    // Clamp to the bounds so that rounding can't start the ray outside them
+    for (U32 axis = 0; axis < 3; axis += 1) {
+      F32 p = Clamp(floorf32(ro.e[axis] + rd.e[axis]*t_enter), box_min.e[axis], box_max.e[axis] - 1.f);
+      s.pos.e[axis] = p;
+      F32 boundary = (rd.e[axis] > 0.f) ? p + 1.f : p;
+      s.t_max.e[axis] = (rd.e[axis] != 0.f) ? (boundary - ro.e[axis]) / rd.e[axis] : VOX_RAYCAST_T_FAR;
+    }
+    s.normal.e[enter_axis] = -s.stp.e[enter_axis];
+    s.t = t_enter;
+  }
+  
+  return s;
+}
+
+function VOX_RaycastResult 
+vox_raycast(VOX_World *world, F32 voxel_scale, V3F32 ro, V3F32 rd)
+{
+  VOX_RaycastResult result = {0};
+  
+  V2F32 world_range = vox_raycast_world_range(world, ro, rd);
+  F32 t_exit = world_range.y;
+  if (t_exit < world_range.x) {
+    return result;
+  }
+  
+  VOX_RaycastState s = vox_raycast_state_enter_world(world, ro, rd, world_range);
   
   F32 steps = 0.f;
-  F32 t = 0.f;
   B32 hit = 0;
   
-  V3F32 normal = {0};
+  // The chunk lookup is cached across steps since consecutive voxels along
+  // the ray almost always share a chunk.
+  VOX_ChunkNode *node = 0;
+  V3S32 node_coord = {0};
+  B32 node_valid = 0;
   
   for (F32 idx = 0.f; idx < 256.f; idx += 1.f) {
-    VOX_MapResult map = vox_map(pos, voxel_scale);
-    if (map.idx >= 0) {
-      result.idx = map.idx;
-      result.pos = pos;
-      result.normal = normal;
-      
-      VOX_Voxel *v = vox_get_voxel(chunk, result.idx);
-      if (v->opacity > 0) {
+    if (s.t > t_exit) {
+      break;
+    }
+    
+    VOX_MapResult map = vox_map(s.pos, voxel_scale);
+    
+    B32 same_chunk = node_valid && 
+      map.chunk_coord.x == node_coord.x && 
+      map.chunk_coord.y == node_coord.y && 
+      map.chunk_coord.z == node_coord.z;
+    if (!same_chunk) {
+      node = vox_world_chunk_from_coord(world, map.chunk_coord);
+      node_coord = map.chunk_coord;
+      node_valid = 1;
+    }
+    
+    steps += 1.f;
+    
+    if (!node) {
+      vox_raycast_leap(&s, (F32)VOX_SLICE_SIZE);
+      continue;
+    }
+    
+    V3S32 local_coord = v3s32_sub(map.coord, v3s32_scale(map.chunk_coord, VOX_SLICE_SIZE));
+    S32 brick_idx = vox_brick_idx_from_local_coord(local_coord);
+    if (vox_occupancy_brick_empty(&node->occupancy, brick_idx)) {
+      vox_raycast_leap(&s, (F32)VOX_BRICK_SIZE);
+      continue;
+    }
+    
+    if (vox_occupancy_get(&node->occupancy, local_coord)) {
+      result.coord = map.coord;
+      result.pos = s.pos;
+      result.normal = s.normal;
+      hit = 1;
+      break;
+    }
+    
+    vox_raycast_step(&s);
+  }
+  
+  {
+    V3F32 p = v3f32_add(result.pos, result.normal);
+    VOX_MapResult map = vox_map(p, voxel_scale);
+    result.prev_coord = map.coord;
+  }
+  
+  result.hit = hit;
+  result.steps = steps;
+  
+  return result;
+}
+
+function VOX_RaycastResult
+vox_raycast_lod(VOX_World *world, VOX_LodCache *lods, V3F32 ro, V3F32 rd, F32 cone, F32 lod_bias)
+{
+  VOX_RaycastResult result = {0};
+  
+  V2F32 world_range = vox_raycast_world_range(world, ro, rd);
+  F32 t_exit = world_range.y;
+  if (t_exit < world_range.x) {
+    return result;
+  }
+  
+  VOX_RaycastState s = vox_raycast_state_enter_world(world, ro, rd, world_range);
+  
+  F32 steps = 0.f;
+  B32 hit = 0;
+  
+  // Footprint per unit of t, with the bias folded in
+  F32 footprint_scale = cone*powf32(2.f, lod_bias);
+  
+  VOX_ChunkNode *node = 0;
+  VOX_ChunkLod *lod = 0;
+  V3S32 node_coord = {0};
+  B32 node_valid = 0;
+  
+  for (F32 idx = 0.f; idx < 256.f; idx += 1.f) {
+    if (s.t > t_exit) {
+      break;
+    }
+    
+    VOX_MapResult map = vox_map(s.pos, 1.f);
+    
+    B32 same_chunk = node_valid && 
+      map.chunk_coord.x == node_coord.x && 
+      map.chunk_coord.y == node_coord.y && 
+      map.chunk_coord.z == node_coord.z;
+    if (!same_chunk) {
+      node = vox_world_chunk_from_coord(world, map.chunk_coord);
+      lod = vox_lod_from_chunk_coord(lods, map.chunk_coord);
+      node_coord = map.chunk_coord;
+      node_valid = 1;
+    }
+    
+    steps += 1.f;
+    
+    if (!node) {
+      vox_raycast_leap(&s, (F32)VOX_SLICE_SIZE);
+      continue;
+    }
+    
+    V3S32 local_coord = v3s32_sub(map.coord, v3s32_scale(map.chunk_coord, VOX_SLICE_SIZE));
+    
+    // Cells are aligned to the chunk, and so to world positions, since the
+    // chunk size is a multiple of every cell size.
+    U32 level = lod ? vox_lod_level_from_footprint(s.t*footprint_scale) : 0;
+    S32 brick_idx = vox_brick_idx_from_local_coord(local_coord);
+    if (level > 0) {
+      V3S32 cell = v3s32(local_coord.x >> level, local_coord.y >> level, local_coord.z >> level);
+      if (vox_lod_get_voxel(lod, level, cell).opacity) {
+        result.coord = v3s32_add(v3s32_scale(map.chunk_coord, VOX_SLICE_SIZE), v3s32_scale(cell, 1 << level));
+        result.pos = s.pos;
+        result.normal = s.normal;
+        result.level = level;
         hit = 1;
         break;
       }
+      
+      // Level 1 cells are smaller than a brick, which may be empty as a whole
+      F32 cell_size = (F32)(1 << level);
+      if (cell_size < VOX_BRICK_SIZE && vox_occupancy_brick_empty(&node->occupancy, brick_idx)) {
+        cell_size = (F32)VOX_BRICK_SIZE;
+      }
+      vox_raycast_leap(&s, cell_size);
+      continue;
     }
     
-    // Advance to next voxel boundary in the dimension in which
-    // the distance to the next voxel boundary is smallest
-    if (t_max.x < t_max.y && t_max.x < t_max.z ) { 
-      t = t_max.x; t_max.x += t_delta.x; pos.x += stp.x; 
-      normal = v3f32(-stp.x, 0, 0);
+    if (vox_occupancy_brick_empty(&node->occupancy, brick_idx)) {
+      vox_raycast_leap(&s, (F32)VOX_BRICK_SIZE);
+      continue;
     }
-    else if(t_max.y < t_max.z ) { 
-      t = t_max.y; t_max.y += t_delta.y; pos.y += stp.y; 
-      normal = v3f32(0, -stp.y, 0);
+    
+    if (vox_occupancy_get(&node->occupancy, local_coord)) {
+      result.coord = map.coord;
+      result.pos = s.pos;
+      result.normal = s.normal;
+      hit = 1;
+      break;
     }
-    else { 
-      t = t_max.z; t_max.z += t_delta.z; pos.z += stp.z; 
-      normal = v3f32(0, 0, -stp.z);
-    }     
     
-    steps += 1.f;
+    vox_raycast_step(&s);
   }
   
   {
     V3F32 p = v3f32_add(result.pos, result.normal);
-    VOX_MapResult map = vox_map(p, voxel_scale);
-    result.prev_idx = map.idx;
+    VOX_MapResult map = vox_map(p, 1.f);
+    result.prev_coord = map.coord;
   }
   
   result.hit = hit;
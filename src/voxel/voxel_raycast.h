@@ -1,17 +1,45 @@
 #pragma once
 
 struct VOX_MapResult {
-  S32 idx;
+  V3S32 coord;       // World-space voxel coordinate
+  V3S32 chunk_coord; // Coordinate of the chunk containing the voxel
+  S32 idx;           // Index of the voxel within its chunk
 };
 
 struct VOX_RaycastResult {
   B32 hit;
-  S32 prev_idx;
+  V3S32 coord;
+  V3S32 prev_coord;
   V3F32 pos;
   V3F32 normal;
-  S32 idx;
   F32 steps;
+  U32 level; // LOD level of the hit; above 0, `coord` is the min corner of its cell
+};
+
+// Must stay below F32 max so t-values can still be compared after adding deltas.
+#define VOX_RAYCAST_T_FAR 1e30f
+
+struct VOX_RaycastState {
+  V3F32 ro;
+  V3F32 rd;
+  V3F32 stp;     // Step direction (+1 or -1 for each axis)
+  V3F32 pos;     // Current voxel, in world units
+  V3F32 t_max;   // t-value of the next voxel boundary on each axis
+  V3F32 t_delta; // t-value needed to cross one voxel on each axis
+  V3F32 normal;  // Normal of the last boundary crossed
+  F32 t;
 };
 
 function VOX_MapResult vox_map(V3F32 pos, F32 voxel_scale);
-function VOX_RaycastResult vox_raycast(VOX_Chunk *chunk, F32 voxel_scale, V3F32 ro, V3F32 rd);
\ No newline at end of file
+function V3F32 vox_world_pos_from_voxel_coord(V3S32 coord);
+function V2F32 vox_raycast_world_range(VOX_World *world, V3F32 ro, V3F32 rd);
+function VOX_RaycastState vox_raycast_state_make(V3F32 ro, V3F32 rd);
+function VOX_RaycastState vox_raycast_state_enter_world(VOX_World *world, V3F32 ro, V3F32 rd, V2F32 world_range);
+function void vox_raycast_leap(VOX_RaycastState *s, F32 cell_size);
+function void vox_raycast_step(VOX_RaycastState *s);
+function VOX_RaycastResult vox_raycast(VOX_World *world, F32 voxel_scale, V3F32 ro, V3F32 rd);
+
+// Like vox_raycast, but wherever the ray's cone (`cone` voxels wide per unit of
+// t) has grown wide enough it tests the cells of a coarser level of `lods` (see
+// voxel/voxel_lod.h) instead of voxels, and leaps over the empty ones whole.
+function VOX_RaycastResult vox_raycast_lod(VOX_World *world, VOX_LodCache *lods, V3F32 ro, V3F32 rd, F32 cone, F32 lod_bias);
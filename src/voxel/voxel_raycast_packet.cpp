@@ -0,0 +1,410 @@
+//
+// Lane helpers
+//
+
+#if VOX_RAYCAST_PACKET_AVX2
+typedef __m256  VOX_LaneF32;
+typedef __m256i VOX_LaneS32;
+# define vox_lane_f32_load(p)          _mm256_loadu_ps((p))
+# define vox_lane_f32_store(p, v)      _mm256_storeu_ps((p), (v))
+# define vox_lane_f32_set1(x)          _mm256_set1_ps((x))
+# define vox_lane_f32_add(a, b)        _mm256_add_ps((a), (b))
+# define vox_lane_f32_sub(a, b)        _mm256_sub_ps((a), (b))
+# define vox_lane_f32_mul(a, b)        _mm256_mul_ps((a), (b))
+# define vox_lane_f32_div(a, b)        _mm256_div_ps((a), (b))
+# define vox_lane_f32_min(a, b)        _mm256_min_ps((a), (b))
+# define vox_lane_f32_max(a, b)        _mm256_max_ps((a), (b))
+# define vox_lane_f32_floor(v)         _mm256_floor_ps((v))
+# define vox_lane_f32_eq(a, b)         _mm256_cmp_ps((a), (b), _CMP_EQ_OQ)
+# define vox_lane_f32_lt(a, b)         _mm256_cmp_ps((a), (b), _CMP_LT_OQ)
+# define vox_lane_f32_and(a, b)        _mm256_and_ps((a), (b))
+# define vox_lane_f32_or(a, b)         _mm256_or_ps((a), (b))
+# define vox_lane_f32_andnot(a, b)     _mm256_andnot_ps((a), (b))
+# define vox_lane_f32_blend(a, b, m)   _mm256_blendv_ps((a), (b), (m))
+# define vox_lane_f32_movemask(v)      ((U32)_mm256_movemask_ps((v)))
+# define vox_lane_s32_from_f32(v)      _mm256_cvttps_epi32((v))
+# define vox_lane_s32_store(p, v)      _mm256_storeu_si256((__m256i *)(p), (v))
+# define vox_lane_s32_set1(x)          _mm256_set1_epi32((x))
+# define vox_lane_s32_add(a, b)        _mm256_add_epi32((a), (b))
+# define vox_lane_s32_and(a, b)        _mm256_and_si256((a), (b))
+# define vox_lane_s32_sra(v, n)        _mm256_srai_epi32((v), (n))
+# define vox_lane_s32_eq(a, b)         _mm256_cmpeq_epi32((a), (b))
+# define vox_lane_f32_from_s32_bits(v) _mm256_castsi256_ps((v))
+# define vox_lane_s32_lane_bits()      _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)
+#elif VOX_RAYCAST_PACKET_SSE
+typedef __m128  VOX_LaneF32;
+typedef __m128i VOX_LaneS32;
+# define vox_lane_f32_load(p)          _mm_loadu_ps((p))
+# define vox_lane_f32_store(p, v)      _mm_storeu_ps((p), (v))
+# define vox_lane_f32_set1(x)          _mm_set1_ps((x))
+# define vox_lane_f32_add(a, b)        _mm_add_ps((a), (b))
+# define vox_lane_f32_sub(a, b)        _mm_sub_ps((a), (b))
+# define vox_lane_f32_mul(a, b)        _mm_mul_ps((a), (b))
+# define vox_lane_f32_div(a, b)        _mm_div_ps((a), (b))
+# define vox_lane_f32_min(a, b)        _mm_min_ps((a), (b))
+# define vox_lane_f32_max(a, b)        _mm_max_ps((a), (b))
+# define vox_lane_f32_floor(v)         _mm_floor_ps((v))
+# define vox_lane_f32_eq(a, b)         _mm_cmpeq_ps((a), (b))
+# define vox_lane_f32_lt(a, b)         _mm_cmplt_ps((a), (b))
+# define vox_lane_f32_and(a, b)        _mm_and_ps((a), (b))
+# define vox_lane_f32_or(a, b)         _mm_or_ps((a), (b))
+# define vox_lane_f32_andnot(a, b)     _mm_andnot_ps((a), (b))
+# define vox_lane_f32_blend(a, b, m)   _mm_blendv_ps((a), (b), (m))
+# define vox_lane_f32_movemask(v)      ((U32)_mm_movemask_ps((v)))
+# define vox_lane_s32_from_f32(v)      _mm_cvttps_epi32((v))
+# define vox_lane_s32_store(p, v)      _mm_storeu_si128((__m128i *)(p), (v))
+# define vox_lane_s32_set1(x)          _mm_set1_epi32((x))
+# define vox_lane_s32_add(a, b)        _mm_add_epi32((a), (b))
+# define vox_lane_s32_and(a, b)        _mm_and_si128((a), (b))
+# define vox_lane_s32_sra(v, n)        _mm_srai_epi32((v), (n))
+# define vox_lane_s32_eq(a, b)         _mm_cmpeq_epi32((a), (b))
+# define vox_lane_f32_from_s32_bits(v) _mm_castsi128_ps((v))
+# define vox_lane_s32_lane_bits()      _mm_setr_epi32(1, 2, 4, 8)
+#endif
+
+//
+// Packet lanes
+//
+
+function VOX_RaycastState
+vox_ray_packet_lane_get(VOX_RayPacket *packet, U32 lane)
+{
+  VOX_RaycastState s = {0};
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    s.ro.e[axis]      = packet->ro[axis][lane];
+    s.rd.e[axis]      = packet->rd[axis][lane];
+    s.stp.e[axis]     = packet->stp[axis][lane];
+    s.pos.e[axis]     = packet->pos[axis][lane];
+    s.t_max.e[axis]   = packet->t_max[axis][lane];
+    s.t_delta.e[axis] = packet->t_delta[axis][lane];
+    s.normal.e[axis]  = packet->normal[axis][lane];
+  }
+  s.t = packet->t[lane];
+  return s;
+}
+
+function void
+vox_ray_packet_lane_set(VOX_RayPacket *packet, U32 lane, VOX_RaycastState *s)
+{
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    packet->ro[axis][lane]      = s->ro.e[axis];
+    packet->rd[axis][lane]      = s->rd.e[axis];
+    packet->stp[axis][lane]     = s->stp.e[axis];
+    packet->pos[axis][lane]     = s->pos.e[axis];
+    packet->t_max[axis][lane]   = s->t_max.e[axis];
+    packet->t_delta[axis][lane] = s->t_delta.e[axis];
+    packet->normal[axis][lane]  = s->normal.e[axis];
+  }
+  packet->t[lane] = s->t;
+}
+
+#if VOX_RAYCAST_PACKET_AVX2 || VOX_RAYCAST_PACKET_SSE
+
+function VOX_LaneF32
+vox_lane_mask_from_bits(U32 bits)
+{
+  VOX_LaneS32 lane_bits = vox_lane_s32_lane_bits();
+  VOX_LaneS32 set = vox_lane_s32_and(vox_lane_s32_set1((S32)bits), lane_bits);
+  VOX_LaneF32 result = vox_lane_f32_from_s32_bits(vox_lane_s32_eq(set, lane_bits));
+  return result;
+}
+
+// Vectorized vox_raycast_step() over the lanes in `step_mask`. The branch
+// conditions are evaluated with the same comparisons as the scalar version so
+// both paths visit exactly the same voxels.
+function void
+vox_ray_packet_step(VOX_RayPacket *packet, U32 step_mask)
+{
+  VOX_LaneF32 active = vox_lane_mask_from_bits(step_mask);
+  VOX_LaneF32 zero = vox_lane_f32_set1(0.f);
+  
+  VOX_LaneF32 tx = vox_lane_f32_load(packet->t_max[0]);
+  VOX_LaneF32 ty = vox_lane_f32_load(packet->t_max[1]);
+  VOX_LaneF32 tz = vox_lane_f32_load(packet->t_max[2]);
+  
+  VOX_LaneF32 mx = vox_lane_f32_and(vox_lane_f32_lt(tx, ty), vox_lane_f32_lt(tx, tz));
+  VOX_LaneF32 my = vox_lane_f32_andnot(mx, vox_lane_f32_lt(ty, tz));
+  VOX_LaneF32 mz = vox_lane_f32_andnot(vox_lane_f32_or(mx, my), active);
+  mx = vox_lane_f32_and(mx, active);
+  my = vox_lane_f32_and(my, active);
+  
+  VOX_LaneF32 t = vox_lane_f32_load(packet->t);
+  t = vox_lane_f32_blend(t, tx, mx);
+  t = vox_lane_f32_blend(t, ty, my);
+  t = vox_lane_f32_blend(t, tz, mz);
+  vox_lane_f32_store(packet->t, t);
+  
+  VOX_LaneF32 masks[3] = { mx, my, mz };
+  VOX_LaneF32 t_max[3] = { tx, ty, tz };
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    VOX_LaneF32 m = masks[axis];
+    VOX_LaneF32 stp = vox_lane_f32_load(packet->stp[axis]);
+    VOX_LaneF32 t_delta = vox_lane_f32_load(packet->t_delta[axis]);
+    VOX_LaneF32 pos = vox_lane_f32_load(packet->pos[axis]);
+    VOX_LaneF32 normal = vox_lane_f32_load(packet->normal[axis]);
+    
+    t_max[axis] = vox_lane_f32_blend(t_max[axis], vox_lane_f32_add(t_max[axis], t_delta), m);
+    pos = vox_lane_f32_blend(pos, vox_lane_f32_add(pos, stp), m);
+    
+    // Every stepping lane gets a fresh axis-aligned normal: -stp on the axis
+    // that was crossed, zero on the others.
+    VOX_LaneF32 normal_new = vox_lane_f32_and(m, vox_lane_f32_sub(zero, stp));
+    normal = vox_lane_f32_blend(normal, normal_new, active);
+    
+    vox_lane_f32_store(packet->t_max[axis], t_max[axis]);
+    vox_lane_f32_store(packet->pos[axis], pos);
+    vox_lane_f32_store(packet->normal[axis], normal);
+  }
+}
+
+// Vectorized vox_raycast_leap() over the lanes in `leap_mask`: lanes in
+// `chunk_mask` leap over their chunk, the others over their brick. Same
+// operations in the same order as the scalar version, so both paths land on
+// exactly the same voxels.
+function void
+vox_ray_packet_leap(VOX_RayPacket *packet, U32 leap_mask, U32 chunk_mask)
+{
+  VOX_LaneF32 active = vox_lane_mask_from_bits(leap_mask);
+  VOX_LaneF32 zero = vox_lane_f32_set1(0.f);
+  VOX_LaneF32 one = vox_lane_f32_set1(1.f);
+  VOX_LaneF32 t_far = vox_lane_f32_set1(VOX_RAYCAST_T_FAR);
+  VOX_LaneF32 cell_size = vox_lane_f32_blend(vox_lane_f32_set1((F32)VOX_BRICK_SIZE), vox_lane_f32_set1((F32)VOX_SLICE_SIZE),
+                                             vox_lane_mask_from_bits(chunk_mask));
+  
+  VOX_LaneF32 cell_min[3];
+  VOX_LaneF32 t_exit[3];
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    VOX_LaneF32 pos = vox_lane_f32_load(packet->pos[axis]);
+    VOX_LaneF32 stp_pos = vox_lane_f32_lt(zero, vox_lane_f32_load(packet->stp[axis]));
+    VOX_LaneF32 ro = vox_lane_f32_load(packet->ro[axis]);
+    VOX_LaneF32 rd = vox_lane_f32_load(packet->rd[axis]);
+    
+    cell_min[axis] = vox_lane_f32_mul(vox_lane_f32_floor(vox_lane_f32_div(pos, cell_size)), cell_size);
+    VOX_LaneF32 plane = vox_lane_f32_blend(cell_min[axis], vox_lane_f32_add(cell_min[axis], cell_size), stp_pos);
+    t_exit[axis] = vox_lane_f32_blend(vox_lane_f32_div(vox_lane_f32_sub(plane, ro), rd), t_far, vox_lane_f32_eq(rd, zero));
+  }
+  
+  VOX_LaneF32 mx = vox_lane_f32_and(vox_lane_f32_lt(t_exit[0], t_exit[1]), vox_lane_f32_lt(t_exit[0], t_exit[2]));
+  VOX_LaneF32 my = vox_lane_f32_andnot(mx, vox_lane_f32_lt(t_exit[1], t_exit[2]));
+  VOX_LaneF32 mz = vox_lane_f32_andnot(vox_lane_f32_or(mx, my), vox_lane_f32_eq(zero, zero));
+  VOX_LaneF32 t = vox_lane_f32_blend(vox_lane_f32_blend(t_exit[2], t_exit[1], my), t_exit[0], mx);
+  
+  VOX_LaneF32 masks[3] = { mx, my, mz };
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    VOX_LaneF32 stp = vox_lane_f32_load(packet->stp[axis]);
+    VOX_LaneF32 stp_pos = vox_lane_f32_lt(zero, stp);
+    VOX_LaneF32 ro = vox_lane_f32_load(packet->ro[axis]);
+    VOX_LaneF32 rd = vox_lane_f32_load(packet->rd[axis]);
+    VOX_LaneF32 cell_max = vox_lane_f32_sub(vox_lane_f32_add(cell_min[axis], cell_size), one);
+    
+    // Just across the exit plane on the exit axis, clamped to the cell on the others
+    VOX_LaneF32 p_exit = vox_lane_f32_blend(vox_lane_f32_sub(cell_min[axis], one), vox_lane_f32_add(cell_min[axis], cell_size), stp_pos);
+    VOX_LaneF32 p_other = vox_lane_f32_floor(vox_lane_f32_add(ro, vox_lane_f32_mul(rd, t)));
+    p_other = vox_lane_f32_min(vox_lane_f32_max(p_other, cell_min[axis]), cell_max);
+    VOX_LaneF32 p = vox_lane_f32_blend(p_other, p_exit, masks[axis]);
+    
+    VOX_LaneF32 boundary = vox_lane_f32_blend(p, vox_lane_f32_add(p, one), stp_pos);
+    VOX_LaneF32 t_max = vox_lane_f32_blend(vox_lane_f32_div(vox_lane_f32_sub(boundary, ro), rd), t_far, vox_lane_f32_eq(rd, zero));
+    VOX_LaneF32 normal = vox_lane_f32_and(masks[axis], vox_lane_f32_sub(zero, stp));
+    
+    vox_lane_f32_store(packet->pos[axis], vox_lane_f32_blend(vox_lane_f32_load(packet->pos[axis]), p, active));
+    vox_lane_f32_store(packet->t_max[axis], vox_lane_f32_blend(vox_lane_f32_load(packet->t_max[axis]), t_max, active));
+    vox_lane_f32_store(packet->normal[axis], vox_lane_f32_blend(vox_lane_f32_load(packet->normal[axis]), normal, active));
+  }
+  vox_lane_f32_store(packet->t, vox_lane_f32_blend(vox_lane_f32_load(packet->t), t, active));
+}
+
+// Same mapping as vox_map(), for all lanes at once.
+function void
+vox_ray_packet_map(VOX_RayPacket *packet, S32 coords[3][VOX_RAYCAST_PACKET_LANES], S32 chunk_coords[3][VOX_RAYCAST_PACKET_LANES])
+{
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    VOX_LaneS32 coord = vox_lane_s32_from_f32(vox_lane_f32_load(packet->pos[axis]));
+    if (axis == 1) {
+      coord = vox_lane_s32_add(coord, vox_lane_s32_set1(VOX_SLICE_SIZE));
+    }
+    vox_lane_s32_store(coords[axis], coord);
+    vox_lane_s32_store(chunk_coords[axis], vox_lane_s32_sra(coord, VOX_SLICE_SIZE_LOG2));
+  }
+}
+
+function U32
+vox_ray_packet_exited_mask(VOX_RayPacket *packet)
+{
+  VOX_LaneF32 t = vox_lane_f32_load(packet->t);
+  VOX_LaneF32 t_exit = vox_lane_f32_load(packet->t_exit);
+  U32 result = vox_lane_f32_movemask(vox_lane_f32_lt(t_exit, t));
+  return result;
+}
+
+#else
+
+function void
+vox_ray_packet_step(VOX_RayPacket *packet, U32 step_mask)
+{
+  for (U32 lane = 0; lane < VOX_RAYCAST_PACKET_LANES; lane += 1) {
+    if (step_mask & (1u << lane)) {
+      VOX_RaycastState s = vox_ray_packet_lane_get(packet, lane);
+      vox_raycast_step(&s);
+      vox_ray_packet_lane_set(packet, lane, &s);
+    }
+  }
+}
+
+function void
+vox_ray_packet_leap(VOX_RayPacket *packet, U32 leap_mask, U32 chunk_mask)
+{
+  for (U32 lane = 0; lane < VOX_RAYCAST_PACKET_LANES; lane += 1) {
+    if (leap_mask & (1u << lane)) {
+      VOX_RaycastState s = vox_ray_packet_lane_get(packet, lane);
+      vox_raycast_leap(&s, (chunk_mask & (1u << lane)) ? (F32)VOX_SLICE_SIZE : (F32)VOX_BRICK_SIZE);
+      vox_ray_packet_lane_set(packet, lane, &s);
+    }
+  }
+}
+
+function void
+vox_ray_packet_map(VOX_RayPacket *packet, S32 coords[3][VOX_RAYCAST_PACKET_LANES], S32 chunk_coords[3][VOX_RAYCAST_PACKET_LANES])
+{
+  for (U32 lane = 0; lane < VOX_RAYCAST_PACKET_LANES; lane += 1) {
+    V3F32 pos = v3f32(packet->pos[0][lane], packet->pos[1][lane], packet->pos[2][lane]);
+    VOX_MapResult map = vox_map(pos, 1.f);
+    for (U32 axis = 0; axis < 3; axis += 1) {
+      coords[axis][lane] = map.coord.e[axis];
+      chunk_coords[axis][lane] = map.chunk_coord.e[axis];
+    }
+  }
+}
+
+function U32
+vox_ray_packet_exited_mask(VOX_RayPacket *packet)
+{
+  U32 result = 0;
+  for (U32 lane = 0; lane < VOX_RAYCAST_PACKET_LANES; lane += 1) {
+    if (packet->t[lane] > packet->t_exit[lane]) {
+      result |= (1u << lane);
+    }
+  }
+  return result;
+}
+
+#endif
+
+//
+// Packet traversal
+//
+
+function void
+vox_raycast_packet(VOX_World *world, F32 voxel_scale, V3F32 *ro, V3F32 *rd, U32 count, VOX_RaycastResult *results)
+{
+  for (U32 base = 0; base < count; base += VOX_RAYCAST_PACKET_LANES) {
+    U32 lanes_count = Min((U32)VOX_RAYCAST_PACKET_LANES, count - base);
+    U32 active = 0;
+    
+    // Rays that miss the world's bounds stay inactive, as vox_raycast returns
+    // them before the loop. Packets where every ray misses are done here.
+    V2F32 world_ranges[VOX_RAYCAST_PACKET_LANES];
+    for (U32 lane = 0; lane < lanes_count; lane += 1) {
+      VOX_RaycastResult zero_result = {0};
+      results[base + lane] = zero_result;
+      world_ranges[lane] = vox_raycast_world_range(world, ro[base + lane], rd[base + lane]);
+      if (world_ranges[lane].x <= world_ranges[lane].y) {
+        active |= (1u << lane);
+      }
+    }
+    if (!active) {
+      continue;
+    }
+    U32 entered = active;
+    
+    VOX_RayPacket packet = {0};
+    for (U32 lanes = active; lanes != 0; lanes &= lanes - 1) {
+      U32 lane = count_trailing_zeros_u32(lanes);
+      VOX_RaycastState s = vox_raycast_state_enter_world(world, ro[base + lane], rd[base + lane], world_ranges[lane]);
+      vox_ray_packet_lane_set(&packet, lane, &s);
+      packet.t_exit[lane] = world_ranges[lane].y;
+    }
+    
+    // Per-lane chunk lookup cache, as in vox_raycast()
+    VOX_ChunkNode *nodes[VOX_RAYCAST_PACKET_LANES] = {0};
+    V3S32 node_coords[VOX_RAYCAST_PACKET_LANES] = {0};
+    B32 node_valid[VOX_RAYCAST_PACKET_LANES] = {0};
+    F32 steps[VOX_RAYCAST_PACKET_LANES] = {0};
+    
+    for (F32 idx = 0.f; idx < 256.f && active; idx += 1.f) {
+      active &= ~vox_ray_packet_exited_mask(&packet);
+      
+      S32 coords[3][VOX_RAYCAST_PACKET_LANES];
+      S32 chunk_coords[3][VOX_RAYCAST_PACKET_LANES];
+      vox_ray_packet_map(&packet, coords, chunk_coords);
+      
+      U32 step_mask = 0;
+      U32 leap_mask = 0;
+      U32 chunk_mask = 0;
+      for (U32 lanes = active; lanes != 0; lanes &= lanes - 1) {
+        U32 lane = count_trailing_zeros_u32(lanes);
+        U32 lane_bit = (1u << lane);
+        
+        V3S32 coord = v3s32(coords[0][lane], coords[1][lane], coords[2][lane]);
+        V3S32 chunk_coord = v3s32(chunk_coords[0][lane], chunk_coords[1][lane], chunk_coords[2][lane]);
+        
+        B32 same_chunk = node_valid[lane] &&
+          chunk_coord.x == node_coords[lane].x &&
+          chunk_coord.y == node_coords[lane].y &&
+          chunk_coord.z == node_coords[lane].z;
+        if (!same_chunk) {
+          nodes[lane] = vox_world_chunk_from_coord(world, chunk_coord);
+          node_coords[lane] = chunk_coord;
+          node_valid[lane] = 1;
+        }
+        VOX_ChunkNode *node = nodes[lane];
+        
+        steps[lane] += 1.f;
+        
+        if (!node) {
+          leap_mask |= lane_bit;
+          chunk_mask |= lane_bit;
+          continue;
+        }
+        
+        V3S32 local_coord = v3s32_sub(coord, v3s32_scale(chunk_coord, VOX_SLICE_SIZE));
+        S32 brick_idx = vox_brick_idx_from_local_coord(local_coord);
+        if (vox_occupancy_brick_empty(&node->occupancy, brick_idx)) {
+          leap_mask |= lane_bit;
+          continue;
+        }
+        
+        if (vox_occupancy_get(&node->occupancy, local_coord)) {
+          VOX_RaycastResult *result = &results[base + lane];
+          result->hit = 1;
+          result->coord = coord;
+          result->pos = v3f32(packet.pos[0][lane], packet.pos[1][lane], packet.pos[2][lane]);
+          result->normal = v3f32(packet.normal[0][lane], packet.normal[1][lane], packet.normal[2][lane]);
+          active &= ~lane_bit;
+          continue;
+        }
+        
+        step_mask |= lane_bit;
+      }
+      
+      // Leaping and stepping lanes are disjoint, so the order doesn't matter
+      if (leap_mask) {
+        vox_ray_packet_leap(&packet, leap_mask, chunk_mask);
+      }
+      if (step_mask) {
+        vox_ray_packet_step(&packet, step_mask);
+      }
+    }
+    
+    for (U32 lane = 0; lane < lanes_count; lane += 1) {
+      if (!(entered & (1u << lane))) {
+        continue;
+      }
+      VOX_RaycastResult *result = &results[base + lane];
+      V3F32 p = v3f32_add(result->pos, result->normal);
+      VOX_MapResult map = vox_map(p, voxel_scale);
+      result->prev_coord = map.coord;
+      result->steps = steps[lane];
+    }
+  }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// NOTE: Packet traversal runs the same DDA as vox_raycast over several coherent
+// rays at once. Rays are stored SoA, one SIMD lane per ray; lanes that finish
+// (hit, left the world or ran out of iterations) are masked out while the rest
+// keep stepping. Per-lane results are identical to the scalar path.
+//
+// Lane count follows the instruction set the translation unit is built for:
+// 8 lanes with AVX2, 4 lanes with SSE4.1, and a scalar fallback otherwise.
+
+#if ARCH_X64 && defined(__AVX2__)
+# define VOX_RAYCAST_PACKET_AVX2 1
+# define VOX_RAYCAST_PACKET_LANES 8
+#elif (ARCH_X64 || ARCH_X86) && (COMPILER_MSVC || defined(__SSE4_1__))
+# define VOX_RAYCAST_PACKET_SSE 1
+# define VOX_RAYCAST_PACKET_LANES 4
+#else
+# define VOX_RAYCAST_PACKET_LANES 1
+#endif
+
+#if !defined(VOX_RAYCAST_PACKET_AVX2)
+# define VOX_RAYCAST_PACKET_AVX2 0
+#endif
+#if !defined(VOX_RAYCAST_PACKET_SSE)
+# define VOX_RAYCAST_PACKET_SSE 0
+#endif
+
+#if VOX_RAYCAST_PACKET_AVX2 || VOX_RAYCAST_PACKET_SSE
+# include <immintrin.h>
+#endif
+
+struct VOX_RayPacket {
+  F32 ro[3][VOX_RAYCAST_PACKET_LANES];
+  F32 rd[3][VOX_RAYCAST_PACKET_LANES];
+  F32 stp[3][VOX_RAYCAST_PACKET_LANES];
+  F32 pos[3][VOX_RAYCAST_PACKET_LANES];
+  F32 t_max[3][VOX_RAYCAST_PACKET_LANES];
+  F32 t_delta[3][VOX_RAYCAST_PACKET_LANES];
+  F32 normal[3][VOX_RAYCAST_PACKET_LANES];
+  F32 t[VOX_RAYCAST_PACKET_LANES];
+  F32 t_exit[VOX_RAYCAST_PACKET_LANES];
+};
+
+function VOX_RaycastState vox_ray_packet_lane_get(VOX_RayPacket *packet, U32 lane);
+function void vox_ray_packet_lane_set(VOX_RayPacket *packet, U32 lane, VOX_RaycastState *s);
+function void vox_ray_packet_step(VOX_RayPacket *packet, U32 step_mask);
+function void vox_ray_packet_leap(VOX_RayPacket *packet, U32 leap_mask, U32 chunk_mask);
+
+// Casts `count` rays, VOX_RAYCAST_PACKET_LANES at a time. `results` receives one
+// entry per ray in the same order.
+function void vox_raycast_packet(VOX_World *world, F32 voxel_scale, V3F32 *ro, V3F32 *rd, U32 count, VOX_RaycastResult *results);
@@ -15,6 +15,15 @@ vox_render_release(VOX_Renderer *r)
 {
   // @Todo: Release D3D11 objects
   if (r) {
+    if (!os_handle_is_null(r->shader_watch)) {
+      os_file_watch_close(r->shader_watch);
+    }
+    if (r->shader_reload.arena) {
+      async_wait(&r->shader_reload.counter);
+      arena_release(r->shader_reload.arena);
+      arena_release(r->shader_error_arena);
+    }
+    sc_cache_release(r->shader_cache);
     arena_release(r->arena);
   }
 }
@@ -47,7 +56,7 @@ vox_render_init(VOX_Renderer *r, OS_Handle window, String8 shader_path)
   }
   
   // Enable debug breaks in debug builds
-  
+
 #if BUILD_DEBUG
   {
     // Enable debug break on API errors for debug builds
@@ -180,23 +189,29 @@ vox_render_init(VOX_Renderer *r, OS_Handle window, String8 shader_path)
 #endif
     r->shader_compile_flags = compile_flags;
     
-    ID3DBlob *error;
-    
-    ID3DBlob *vblob;
-    hr = D3DCompile(source.data, source.count, 0, 0, 0, "vs_main", "vs_5_0", 
-                    compile_flags, 0, &vblob, &error);
-    if (FAILED(hr)) {
-      char *msg = (char *)error->GetBufferPointer();
-      OutputDebugStringA(msg);
+    // Compiled shaders are cached next to the executable, so only the first
+    // launch after an edit pays for D3DCompile
+    r->shader_cache = sc_cache_alloc(S8("shader_cache"));
+    
+    SC_Shader shader = {0};
+    shader.name = shader_path;
+    shader.source = source;
+    shader.flags = compile_flags;
+    String8 error = {0};
+    
+    shader.entry = S8("vs_main");
+    shader.target = S8("vs_5_0");
+    String8 vs_bytecode = sc_bytecode_from_shader(scratch.arena, r->shader_cache, &shader, vox_shader_compile_d3d, shader_path.data, &error);
+    if (vs_bytecode.count == 0) {
+      OutputDebugStringA((char *)error.data);
       Assert(!"vox_render_init(): failed to compile vertex shader");
     }
     
-    ID3DBlob *pblob;
-    hr = D3DCompile(source.data, source.count, 0, 0, 0, "ps_main", "ps_5_0", 
-                    compile_flags, 0, &pblob, &error);
-    if (FAILED(hr)) {
-      char *msg = (char *)error->GetBufferPointer();
-      OutputDebugStringA(msg);
+    shader.entry = S8("ps_main");
+    shader.target = S8("ps_5_0");
+    String8 ps_bytecode = sc_bytecode_from_shader(scratch.arena, r->shader_cache, &shader, vox_shader_compile_d3d, shader_path.data, &error);
+    if (ps_bytecode.count == 0) {
+      OutputDebugStringA((char *)error.data);
       Assert(!"vox_render_init(): failed to compile pixel shader");
     }
     
@@ -204,12 +219,10 @@ vox_render_init(VOX_Renderer *r, OS_Handle window, String8 shader_path)
     ID3D11PixelShader *pixel_shader;
     ID3D11InputLayout *input_layout;
     
-    r->device->CreateVertexShader(vblob->GetBufferPointer(), vblob->GetBufferSize(), 0, &vertex_shader);
-    r->device->CreatePixelShader(pblob->GetBufferPointer(), pblob->GetBufferSize(), 0, &pixel_shader);
-    r->device->CreateInputLayout(desc, ARRAYSIZE(desc), vblob->GetBufferPointer(), vblob->GetBufferSize(), &input_layout);
+    r->device->CreateVertexShader(vs_bytecode.data, vs_bytecode.count, 0, &vertex_shader);
+    r->device->CreatePixelShader(ps_bytecode.data, ps_bytecode.count, 0, &pixel_shader);
+    r->device->CreateInputLayout(desc, ARRAYSIZE(desc), vs_bytecode.data, vs_bytecode.count, &input_layout);
     
-    pblob->Release();
-    vblob->Release();
     arena_scratch_end(scratch);
     
     r->pixel_shader = pixel_shader;
@@ -217,6 +230,94 @@ vox_render_init(VOX_Renderer *r, OS_Handle window, String8 shader_path)
     r->input_layout = input_layout;
   }
   
+  // Set up the mesh render path: shaders next to the full-screen one, an input
+  // layout of packed vertices, and an index buffer that turns every 4 vertices
+  // into two triangles
+  
+  {
+    D3D11_INPUT_ELEMENT_DESC desc[] = {
+      { "PACKED", 0, DXGI_FORMAT_R32_UINT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+    
+    TempArena scratch = arena_scratch_begin(0,0);
+    
+    String8 dir = {0};
+    String8 name = {0};
+    os_path_split(shader_path, &dir, &name);
+    String8 mesh_shader_path = str8_pushf(scratch.arena, (char *)"%.*s/mesh.hlsl", (int)dir.count, dir.data);
+    
+    SC_Shader shader = {0};
+    shader.name = mesh_shader_path;
+    shader.source = os_file_read(scratch.arena, mesh_shader_path);
+    shader.flags = r->shader_compile_flags;
+    Assert(shader.source.count > 0);
+    String8 error = {0};
+    
+    shader.entry = S8("vs_main");
+    shader.target = S8("vs_5_0");
+    String8 vs_bytecode = sc_bytecode_from_shader(scratch.arena, r->shader_cache, &shader, vox_shader_compile_d3d, mesh_shader_path.data, &error);
+    if (vs_bytecode.count == 0) {
+      OutputDebugStringA((char *)error.data);
+      Assert(!"vox_render_init(): failed to compile mesh vertex shader");
+    }
+    
+    shader.entry = S8("ps_main");
+    shader.target = S8("ps_5_0");
+    String8 ps_bytecode = sc_bytecode_from_shader(scratch.arena, r->shader_cache, &shader, vox_shader_compile_d3d, mesh_shader_path.data, &error);
+    if (ps_bytecode.count == 0) {
+      OutputDebugStringA((char *)error.data);
+      Assert(!"vox_render_init(): failed to compile mesh pixel shader");
+    }
+    
+    r->device->CreateVertexShader(vs_bytecode.data, vs_bytecode.count, 0, &r->mesh_vertex_shader);
+    r->device->CreatePixelShader(ps_bytecode.data, ps_bytecode.count, 0, &r->mesh_pixel_shader);
+    r->device->CreateInputLayout(desc, ARRAYSIZE(desc), vs_bytecode.data, vs_bytecode.count, &r->mesh_input_layout);
+    
+    U32 indices_count = VOX_MESH_QUADS_MAX*VOX_MESH_INDICES_PER_QUAD;
+    U32 *indices = ArenaPushArrayNoZero(scratch.arena, U32, indices_count);
+    for (U32 quad = 0; quad < VOX_MESH_QUADS_MAX; quad += 1) {
+      U32 base = quad*VOX_MESH_VERTICES_PER_QUAD;
+      U32 *dst = indices + quad*VOX_MESH_INDICES_PER_QUAD;
+      dst[0] = base + 0;
+      dst[1] = base + 1;
+      dst[2] = base + 2;
+      dst[3] = base + 0;
+      dst[4] = base + 2;
+      dst[5] = base + 3;
+    }
+    
+    D3D11_BUFFER_DESC index_desc = {0};
+    index_desc.ByteWidth = indices_count*sizeof(U32);
+    index_desc.Usage = D3D11_USAGE_IMMUTABLE;
+    index_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    
+    D3D11_SUBRESOURCE_DATA initial_data = {0};
+    initial_data.pSysMem = indices;
+    r->device->CreateBuffer(&index_desc, &initial_data, &r->mesh_index_buffer);
+    
+    D3D11_BUFFER_DESC constant_desc = {0};
+    constant_desc.ByteWidth = sizeof(VOX_MeshUniformData);
+    constant_desc.Usage = D3D11_USAGE_DYNAMIC;
+    constant_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    constant_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    r->device->CreateBuffer(&constant_desc, 0, &r->mesh_constant_buffer);
+    
+    arena_scratch_end(scratch);
+  }
+  
+  // Watch the shader file for hot reloading
+  
+  {
+    VOX_ShaderReload *reload = &r->shader_reload;
+    reload->arena = arena_alloc_default();
+    reload->path = str8_pushf(r->arena, (char *)"%.*s", (int)shader_path.count, shader_path.data);
+    reload->compile_flags = r->shader_compile_flags;
+    reload->cache = r->shader_cache;
+    
+    r->shader_error_arena = arena_alloc_default();
+    r->shader_watch = os_file_watch_open(shader_path, 0);
+  }
+  
   // Create a constant buffer to hold per-frame data
   
   {
@@ -244,7 +345,7 @@ vox_render_init(VOX_Renderer *r, OS_Handle window, String8 shader_path)
     desc.Width          = width;
     desc.Height         = height;
     desc.Depth          = depth;
-    desc.MipLevels      = 1; // @Todo: What should I use here?
+    desc.MipLevels      = VOX_LOD_LEVELS; // The LOD pyramid, see voxel/voxel_lod.h
     desc.Format         = DXGI_FORMAT_R8G8B8A8_UNORM;
     desc.Usage          = D3D11_USAGE_DEFAULT;
     desc.BindFlags      = D3D11_BIND_SHADER_RESOURCE;
@@ -257,6 +358,49 @@ vox_render_init(VOX_Renderer *r, OS_Handle window, String8 shader_path)
     r->chunk_texture_view = texture_view;
   }
   
+  // Create a 3D texture for the chunk's baked light. Texels are bit fields, so the
+  // shader loads them as integers.
+  
+  {
+    D3D11_TEXTURE3D_DESC desc = {0};
+    desc.Width          = VOX_SLICE_SIZE;
+    desc.Height         = VOX_SLICE_SIZE;
+    desc.Depth          = VOX_SLICE_SIZE;
+    desc.MipLevels      = 1;
+    desc.Format         = DXGI_FORMAT_R16_UINT;
+    desc.Usage          = D3D11_USAGE_DEFAULT;
+    desc.BindFlags      = D3D11_BIND_SHADER_RESOURCE;
+    
+    ID3D11Texture3D *texture;
+    ID3D11ShaderResourceView *texture_view;
+    r->device->CreateTexture3D(&desc, 0, &texture);
+    r->device->CreateShaderResourceView((ID3D11Resource *)texture, 0, &texture_view);
+    
+    r->light_texture = texture;
+    r->light_texture_view = texture_view;
+  }
+  
+  // Create a 3D texture for the chunk's distance field, loaded as integers too
+  
+  {
+    D3D11_TEXTURE3D_DESC desc = {0};
+    desc.Width          = VOX_SLICE_SIZE;
+    desc.Height         = VOX_SLICE_SIZE;
+    desc.Depth          = VOX_SLICE_SIZE;
+    desc.MipLevels      = 1;
+    desc.Format         = DXGI_FORMAT_R8_UINT;
+    desc.Usage          = D3D11_USAGE_DEFAULT;
+    desc.BindFlags      = D3D11_BIND_SHADER_RESOURCE;
+    
+    ID3D11Texture3D *texture;
+    ID3D11ShaderResourceView *texture_view;
+    r->device->CreateTexture3D(&desc, 0, &texture);
+    r->device->CreateShaderResourceView((ID3D11Resource *)texture, 0, &texture_view);
+    
+    r->distance_texture = texture;
+    r->distance_texture_view = texture_view;
+  }
+  
   // Create a sampler for the chunk texture(s)
   
   {
@@ -328,8 +472,86 @@ vox_render_init(VOX_Renderer *r, OS_Handle window, String8 shader_path)
     
     r->device->CreateDepthStencilState(&desc, &depth_state);
     r->depth_state = depth_state;
+    
+    // Meshes are drawn in any order, so they need the depth test
+    desc.DepthEnable = TRUE;
+    r->device->CreateDepthStencilState(&desc, &r->mesh_depth_state);
   }
   
   r->window = window;
   r->shader_path = shader_path;
-}
\ No newline at end of file
+}
+//
+// Shader hot reload
+//
+
+// SC_CompileProc for D3DCompile; `user` is the nul-terminated source path that
+// error messages refer to.
+function String8
+vox_shader_compile_d3d(Arena *arena, void *user, String8 source, String8 entry, String8 target, U32 flags, String8 *error)
+{
+  String8 result = {0};
+  
+  String8 entry_cstr = str8_pushf(arena, (char *)"%.*s", (int)entry.count, entry.data);
+  String8 target_cstr = str8_pushf(arena, (char *)"%.*s", (int)target.count, target.data);
+  
+  ID3DBlob *blob = 0;
+  ID3DBlob *error_blob = 0;
+  HRESULT hr = D3DCompile(source.data, source.count, (char *)user, 0, 0, (char *)entry_cstr.data, (char *)target_cstr.data, 
+                          flags, 0, &blob, &error_blob);
+  if (SUCCEEDED(hr)) {
+    result.data = ArenaPushArray(arena, U8, blob->GetBufferSize());
+    result.count = blob->GetBufferSize();
+    MemoryCopy(result.data, blob->GetBufferPointer(), result.count);
+    blob->Release();
+  }
+  else if (error_blob) {
+    *error = str8_pushf(arena, (char *)"%.*s", (int)error_blob->GetBufferSize(), (char *)error_blob->GetBufferPointer());
+  }
+  else {
+    *error = str8_pushf(arena, (char *)"D3DCompile failed (0x%08lx)", (unsigned long)hr);
+  }
+  
+  if (error_blob) {
+    error_blob->Release();
+  }
+  
+  return result;
+}
+
+function void
+vox_shader_reload_work(void *data)
+{
+  VOX_ShaderReload *reload = (VOX_ShaderReload *)data;
+  arena_clear(reload->arena);
+  reload->bytecode = str8(0, 0);
+  reload->error = str8(0, 0);
+  
+  String8 source = os_file_read(reload->arena, reload->path);
+  if (source.count == 0) {
+    reload->error = str8_pushf(reload->arena, (char *)"failed to read %.*s", (int)reload->path.count, reload->path.data);
+  }
+  else {
+    SC_Shader shader = {0};
+    shader.name = reload->path;
+    shader.source = source;
+    shader.entry = S8("ps_main");
+    shader.target = S8("ps_5_0");
+    shader.flags = reload->compile_flags;
+    reload->bytecode = sc_bytecode_from_shader(reload->arena, reload->cache, &shader, vox_shader_compile_d3d, reload->path.data, &reload->error);
+  }
+}
+
+//
+// Mesh render path
+//
+
+function void
+vox_render_mesh_release(void *user, VOX_ChunkMesh *mesh)
+{
+  ID3D11Buffer *vertex_buffer = (ID3D11Buffer *)mesh->backend;
+  if (vertex_buffer) {
+    vertex_buffer->Release();
+  }
+  mesh->backend = 0;
+}
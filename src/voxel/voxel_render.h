@@ -20,16 +20,24 @@ struct VOX_Vertex {
   V2F32 texcoord;
 };
 
-struct VOX_UniformData {
-  // @Todo: fov, view angle instead of view, orbit radius/distance, view height (ray_y)
-  V2F32 client_size;
-  F32 pad0[2];
-  V2F32 view; 
-  F32 pad1[2];
-  V4F32 mouse; // x-position, y-position, left btn (0/1), right btn (0/1)
-  F32 zoom = 1;
-  F32 time;
-  F32 pad3[2];
+// NOTE: Mirrors the PerChunkData constant buffer in shaders/mesh.hlsl.
+struct VOX_MeshUniformData {
+  V3F32 chunk_origin; // In voxels
+  F32 pad0;
+};
+
+// Pixel shader hot reload. A compile job owns everything here but `pending`
+// until its counter drops to zero.
+struct VOX_ShaderReload {
+  Arena *arena; // Source, bytecode and error text of the latest compile
+  String8 path;
+  U32 compile_flags;
+  SC_Cache *cache;
+  
+  ASYNC_Counter counter;
+  B32 pending;      // Submitted, and the result not yet taken by the render thread
+  String8 bytecode; // Empty when compiling failed
+  String8 error;
 };
 
 struct VOX_Renderer {
@@ -39,6 +47,7 @@ struct VOX_Renderer {
   V2U32 client_size;
   String8 shader_path;
   U32 shader_compile_flags;
+  SC_Cache *shader_cache;
   
   ID3D11Device *device;
   ID3D11DeviceContext *context;
@@ -53,10 +62,41 @@ struct VOX_Renderer {
   ID3D11Texture3D *chunk_texture;
   ID3D11ShaderResourceView *chunk_texture_view; 
   ID3D11SamplerState *chunk_texture_sampler;
+  B32 chunk_texture_cleared; // Texture currently holds an empty chunk
+  U64 chunk_upload_bricks[VOX_BRICK_SUMMARY_WORDS]; // Edited since the last upload
+  U64 chunk_lod_version;     // Of the LOD pyramid in the texture's mips; 0 when cleared
+  
+  // Baked light of the same chunk (see voxel/voxel_light.h), one VOX_LightTexel each
+  ID3D11Texture3D *light_texture;
+  ID3D11ShaderResourceView *light_texture_view;
+  B32 light_texture_cleared;
+  
+  // Distance field of the same chunk (see voxel/voxel_distance.h), for leaping
+  // over empty space. Re-uploaded whole when the field's version changes.
+  ID3D11Texture3D *distance_texture;
+  ID3D11ShaderResourceView *distance_texture_view;
+  U64 distance_texture_version;
+  B32 distance_texture_cleared;
   
   ID3D11VertexShader *vertex_shader;
   ID3D11PixelShader *pixel_shader;
   
+  // The shader file is watched; changes are recompiled on a worker and swapped
+  // in between frames once they compile. Until then the previous shader stays.
+  OS_Handle shader_watch;
+  VOX_ShaderReload shader_reload;
+  Arena *shader_error_arena;
+  String8 shader_error; // Of the last reload; empty once one succeeds
+  
+  // Mesh render path (see voxel/voxel_mesh.h). Each chunk's vertices live in an
+  // immutable buffer hung off VOX_ChunkMesh::backend.
+  ID3D11VertexShader *mesh_vertex_shader;
+  ID3D11PixelShader *mesh_pixel_shader;
+  ID3D11InputLayout *mesh_input_layout;
+  ID3D11Buffer *mesh_index_buffer; // Shared by every chunk, VOX_MESH_QUADS_MAX quads
+  ID3D11Buffer *mesh_constant_buffer;
+  ID3D11DepthStencilState *mesh_depth_state;
+  
   ID3D11BlendState *blend_state;
   ID3D11RasterizerState *rasterizer_state;
   ID3D11DepthStencilState *depth_state;
@@ -70,6 +110,12 @@ function void vox_render_release(VOX_Renderer *r);
 
 function void vox_render_init(VOX_Renderer *r, String8 shader_path, OS_Handle window);
 
+function String8 vox_shader_compile_d3d(Arena *arena, void *user, String8 source, String8 entry, String8 target, U32 flags, String8 *error);
+function void vox_shader_reload_work(void *data);
+
+// VOX_MeshBackendReleaseProc; `user` is the renderer.
+function void vox_render_mesh_release(void *user, VOX_ChunkMesh *mesh);
+
 #if 0
 function void vox_render_reload_shader(VOX_Renderer *r);
 
@@ -0,0 +1,427 @@
+//
+// Shader helpers (see shaders/fullscreen.hlsl)
+//
+
+global V3F32 vox_render_cpu_palette[4] = {
+  {0.2f, 0.2f, 0.2f},
+  {0.24f, 0.38f, 0.1f},
+  {0.1f, 0.23f, 0.14f},
+  {0.123f, 0.22f, 0.24f},
+};
+
+global F32 vox_render_cpu_ao_curve[4] = { 0.45f, 0.65f, 0.85f, 1.f };
+
+function F32
+vox_fracf32(F32 x)
+{
+  F32 result = x - floorf32(x);
+  return result;
+}
+
+// https://www.shadertoy.com/view/XtBfzz
+function F32
+vox_filtered_grid(V2F32 p, V2F32 dx, V2F32 dy)
+{
+  F32 N = 12.f;
+  F32 result = 1.f;
+  
+  for (U32 axis = 0; axis < 2; axis += 1) {
+    // filter kernel
+    F32 w = Max(absf32(dx.e[axis]), absf32(dy.e[axis])) + 0.01f;
+    
+    // analytic (box) filtering
+    F32 a = p.e[axis] + 0.5f*w;
+    F32 b = p.e[axis] - 0.5f*w;
+    F32 i = (floorf32(a) + Min(vox_fracf32(a)*N, 1.f) - floorf32(b) - Min(vox_fracf32(b)*N, 1.f)) / (N*w);
+    
+    // pattern
+    result *= (1.f - i);
+  }
+  
+  return result;
+}
+
+function V3F32
+vox_apply_fog(V3F32 col, V3F32 fog_col, F32 t)
+{
+  F32 b = 0.05f;
+  F32 fog = 1.f - expf(-t*b);
+  V3F32 result = v3f32_lerp(col, fog_col, fog);
+  return result;
+}
+
+// Sphere traces the floor plane the same way ps_main does (map1).
+function B32
+vox_render_cpu_trace_floor(V3F32 ro, V3F32 rd, F32 *t_out, V3F32 *pos_out)
+{
+  B32 hit = 0;
+  F32 t = 0.f;
+  V3F32 pos = {0};
+  
+  for (F32 stp = 0.f; stp < 256.f; stp += 1.f) {
+    pos = v3f32_add(ro, v3f32_scale(rd, t));
+    F32 d = -pos.y;
+    if (d < 0.001f) {
+      hit = 1;
+      break;
+    }
+    t += d;
+  }
+  
+  *t_out = t;
+  *pos_out = pos;
+  return hit;
+}
+
+function V2F32
+vox_render_cpu_floor_uv(VOX_UniformData *uniforms, U32 x, U32 y)
+{
+  VOX_CameraRay ray = vox_camera_ray_from_frag_coord(uniforms, v2f32((F32)x + 0.5f, (F32)y + 0.5f));
+  F32 t = 0.f;
+  V3F32 pos = {0};
+  vox_render_cpu_trace_floor(ray.ro, ray.rd, &t, &pos);
+  
+  F32 grid_cell_freq = 1.f;
+  V2F32 result = v2f32(pos.x*grid_cell_freq, pos.z*grid_cell_freq);
+  return result;
+}
+
+function U32
+vox_rgba8_from_v3f32(V3F32 color)
+{
+  U32 result = 0;
+  for (U32 idx = 0; idx < 3; idx += 1) {
+    F32 c = Clamp(color.e[idx], 0.f, 1.f);
+    result |= ((U32)(c*255.f + 0.5f)) << (idx*8);
+  }
+  result |= 0xFF000000;
+  return result;
+}
+
+//
+// Renderer
+//
+
+function VOX_Framebuffer
+vox_framebuffer_alloc(Arena *arena, U32 width, U32 height)
+{
+  VOX_Framebuffer fb = {0};
+  fb.width = width;
+  fb.height = height;
+  fb.pixels = ArenaPushArray(arena, U32, (U64)width*height);
+  return fb;
+}
+
+function VOX_CameraRay
+vox_camera_ray_from_frag_coord(VOX_UniformData *uniforms, V2F32 frag_coord)
+{
+  V2F32 client_size = uniforms->client_size;
+  V2F32 p = v2f32_scale(v2f32_sub(frag_coord, v2f32_scale(client_size, 0.5f)), 1.f / client_size.y);
+  
+  F32 view_angle = 10.f*uniforms->view.x / client_size.x;
+  F32 ray_y = 120.f*uniforms->view.y / client_size.y;
+  F32 orbit_radius = 100.f;
+  
+  V3F32 rb = v3f32(0,0,0);
+  V3F32 ro = v3f32_add(rb, v3f32(orbit_radius*cosf32(view_angle), -ray_y, orbit_radius*sinf32(view_angle)));
+  
+  F32 fov = 3.14159f/1.2f;
+  V3F32 up = v3f32(0,1,0);
+  
+  V3F32 cw = v3f32_normalize(v3f32_sub(rb, ro));
+  V3F32 cu = v3f32_normalize(v3f32_cross(cw, up));
+  V3F32 cv = v3f32_cross(cu, cw);
+  
+  V3F32 dx = v3f32_scale(cu, p.x);
+  V3F32 dy = v3f32_scale(cv, p.y);
+  V3F32 dz = v3f32_scale(cw, fov);
+  
+  VOX_CameraRay result = {0};
+  result.ro = ro;
+  result.rd = v3f32_normalize(v3f32_add(v3f32_add(dx, dy), dz));
+  return result;
+}
+
+function F32
+vox_camera_pixel_cone(VOX_UniformData *uniforms)
+{
+  // Rays are normalize(p.x*cu + p.y*cv + cw*fov) with p in units of the height
+  F32 fov = 3.14159f/1.2f;
+  F32 result = 1.f / (uniforms->client_size.y*fov);
+  return result;
+}
+
+function U32
+vox_render_cpu_pixel(VOX_World *world, VOX_LightCache *lights, VOX_LodCache *lods, VOX_UniformData *uniforms, U32 x, U32 y)
+{
+  V2F32 client_size = uniforms->client_size;
+  V2F32 frag_coord = v2f32((F32)x + 0.5f, (F32)y + 0.5f);
+  V2F32 p = v2f32_scale(v2f32_sub(frag_coord, v2f32_scale(client_size, 0.5f)), 1.f / client_size.y);
+  
+  VOX_CameraRay ray = vox_camera_ray_from_frag_coord(uniforms, frag_coord);
+  V3F32 ro = ray.ro;
+  V3F32 rd = ray.rd;
+  
+  V3F32 color = v3f32_lerp(v3f32(0.22f,0.22f,0.12f), v3f32(0.23f,0.32f,0.24f), 2.f - v2f32_dot(p, p));
+  V3F32 normal = v3f32(0,0,0);
+  
+  // Grid floor
+  {
+    F32 t = 0.f;
+    V3F32 pos = {0};
+    if (vox_render_cpu_trace_floor(ro, rd, &t, &pos)) {
+      V3F32 bg_color = color;
+      V3F32 grid_color = v3f32(0.1f,0.1f,0.1f);
+      
+      F32 grid_cell_freq = 1.f;
+      V2F32 uv = v2f32(pos.x*grid_cell_freq, pos.z*grid_cell_freq);
+      
+      // ddx/ddy are evaluated per 2x2 pixel quad on the GPU, so difference the
+      // floor coordinates against this pixel's neighbour within its quad.
+      V2F32 ddx_uv = {0};
+      if ((x & 1) == 0) {
+        ddx_uv = v2f32_sub(vox_render_cpu_floor_uv(uniforms, x + 1, y), uv);
+      }
+      else {
+        ddx_uv = v2f32_sub(uv, vox_render_cpu_floor_uv(uniforms, x - 1, y));
+      }
+      V2F32 ddy_uv = {0};
+      if ((y & 1) == 0) {
+        ddy_uv = v2f32_sub(vox_render_cpu_floor_uv(uniforms, x, y + 1), uv);
+      }
+      else {
+        ddy_uv = v2f32_sub(uv, vox_render_cpu_floor_uv(uniforms, x, y - 1));
+      }
+      
+      F32 grid_f = (1.f - vox_filtered_grid(uv, ddx_uv, ddy_uv));
+      color = v3f32_lerp(color, grid_color, grid_f);
+      F32 tmp = 0.2f;
+      color = vox_apply_fog(color, bg_color, tmp*t);
+    }
+  }
+  
+  // Voxels
+  VOX_RaycastResult res = {0};
+  if (lods) {
+    res = vox_raycast_lod(world, lods, ro, rd, vox_camera_pixel_cone(uniforms), uniforms->lod_bias);
+  }
+  else {
+    res = vox_raycast(world, uniforms->zoom, ro, rd);
+  }
+  if (res.hit) {
+    VOX_Voxel v = vox_world_get_voxel(world, res.coord);
+    if (res.level > 0) {
+      VOX_ChunkLod *lod = vox_lod_from_chunk_coord(lods, vox_chunk_coord_from_voxel_coord(res.coord));
+      V3S32 local_coord = vox_local_coord_from_voxel_coord(res.coord);
+      V3S32 cell = v3s32(local_coord.x >> res.level, local_coord.y >> res.level, local_coord.z >> res.level);
+      v = vox_lod_get_voxel(lod, res.level, cell);
+    }
+    color = vox_render_cpu_palette[Min(v.color, ArrayCount(vox_render_cpu_palette) - 1)];
+    normal = res.normal;
+    
+    V3F32 key_dir = v3f32_normalize(v3f32(-0.35f, -0.6f, -0.5f));
+    V3F32 key_col = v3f32(1.64f, 1.27f, 0.99f);
+    F32 key = Clamp(v3f32_dot(normal, key_dir), 0.f, 1.f);
+    
+    V3F32 sky_col = v3f32(0.16f,0.20f,0.28f);
+    F32 sky = Clamp(0.5f - 0.5f*normal.y, 0.f, 1.f);
+    
+    V3F32 ind_col = v3f32(0.40f,0.28f,0.20f);
+    F32 ind = Clamp(v3f32_dot(normal, v3f32_normalize(v3f32_mul(key_dir, v3f32(-1.f,0.f,-1.f)))), 0.f, 1.f);
+    
+    F32 ao = 1.f;
+    F32 sun = 1.f;
+    // Light is baked per voxel, so coarse cells go without it
+    if (lights && res.level == 0) {
+      VOX_ChunkLight *light = vox_light_from_chunk_coord(lights, vox_chunk_coord_from_voxel_coord(res.coord));
+      VOX_LightTexel texel = 0;
+      if (light) {
+        texel = light->texels[vox_idx_from_local_coord(vox_local_coord_from_voxel_coord(res.coord))];
+      }
+      U32 axis = (normal.x != 0.f) ? 0 : (normal.y != 0.f) ? 1 : 2;
+      VOX_MeshFace face = (VOX_MeshFace)(axis*2 + ((normal.x + normal.y + normal.z < 0.f) ? 1 : 0));
+      ao = vox_render_cpu_ao_curve[vox_light_texel_ao(texel, face)];
+      sun = (F32)((texel >> (VOX_LIGHT_SUN_SHIFT + axis)) & 1);
+    }
+    
+    V3F32 lin = v3f32_add(v3f32_scale(key_col, key*sun), v3f32_scale(v3f32_add(v3f32_scale(sky_col, sky), v3f32_scale(ind_col, ind)), ao));
+    color = v3f32_mul(color, lin);
+    
+    F32 gamma = 1.f/2.2f;
+    color = v3f32(powf32(color.x, gamma), powf32(color.y, gamma), powf32(color.z, gamma));
+  }
+  
+  U32 result = vox_rgba8_from_v3f32(color);
+  return result;
+}
+
+function void
+vox_render_cpu_tile(VOX_RenderCpuJob *job, U32 tile_idx)
+{
+  VOX_Framebuffer *fb = job->fb;
+  
+  U32 x0 = (tile_idx % job->tiles_x)*VOX_RENDER_CPU_TILE_SIZE;
+  U32 y0 = (tile_idx / job->tiles_x)*VOX_RENDER_CPU_TILE_SIZE;
+  U32 x1 = Min(x0 + VOX_RENDER_CPU_TILE_SIZE, fb->width);
+  U32 y1 = Min(y0 + VOX_RENDER_CPU_TILE_SIZE, fb->height);
+  
+  for (U32 y = y0; y < y1; y += 1) {
+    U32 *row = fb->pixels + (U64)y*fb->width;
+    for (U32 x = x0; x < x1; x += 1) {
+      row[x] = vox_render_cpu_pixel(job->world, job->lights, job->lods, job->uniforms, x, y);
+    }
+  }
+}
+
+function void
+vox_render_cpu_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_RenderCpuJob *job = (VOX_RenderCpuJob *)user;
+  for (U64 tile_idx = first; tile_idx < opl; tile_idx += 1) {
+    vox_render_cpu_tile(job, (U32)tile_idx);
+  }
+}
+
+function void
+vox_render_cpu(VOX_World *world, VOX_LightCache *lights, VOX_LodCache *lods, VOX_UniformData *uniforms, VOX_Framebuffer *fb)
+{
+  VOX_RenderCpuJob job = {0};
+  job.world = world;
+  job.lights = lights;
+  job.lods = lods;
+  job.uniforms = uniforms;
+  job.fb = fb;
+  job.tiles_x = (fb->width + VOX_RENDER_CPU_TILE_SIZE - 1) / VOX_RENDER_CPU_TILE_SIZE;
+  U32 tiles_y = (fb->height + VOX_RENDER_CPU_TILE_SIZE - 1) / VOX_RENDER_CPU_TILE_SIZE;
+  job.tiles_count = job.tiles_x*tiles_y;
+  
+  ProfBegin("vox_render_cpu");
+  async_parallel_for(job.tiles_count, 1, vox_render_cpu_work, &job);
+  ProfEnd();
+}
+
+//
+// PNG output
+//
+
+function void
+vox_png_write_u32_be(U8 *dst, U32 v)
+{
+  dst[0] = (U8)(v >> 24);
+  dst[1] = (U8)(v >> 16);
+  dst[2] = (U8)(v >> 8);
+  dst[3] = (U8)(v);
+}
+
+function U32
+vox_png_crc32(U32 *table, U8 *data, U64 size)
+{
+  U32 crc = 0xFFFFFFFF;
+  for (U64 idx = 0; idx < size; idx += 1) {
+    crc = table[(crc ^ data[idx]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFF;
+}
+
+function String8
+vox_png_from_framebuffer(Arena *arena, VOX_Framebuffer *fb)
+{
+  U32 crc_table[256];
+  for (U32 n = 0; n < 256; n += 1) {
+    U32 c = n;
+    for (U32 k = 0; k < 8; k += 1) {
+      c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+    }
+    crc_table[n] = c;
+  }
+  
+  // Filtered image data is a filter-type byte (0, none) followed by the row.
+  U64 row_size = 1 + (U64)fb->width*4;
+  U64 raw_size = row_size*fb->height;
+  
+  // The zlib stream only uses stored deflate blocks, each holding up to 65535 bytes.
+  U64 block_max = 65535;
+  U64 blocks_count = Max((raw_size + block_max - 1) / block_max, 1);
+  U64 zlib_size = 2 + blocks_count*5 + raw_size + 4;
+  
+  U64 size = 8 + (12 + 13) + (12 + zlib_size) + 12;
+  U8 *data = ArenaPushArrayNoZero(arena, U8, size);
+  U8 *at = data;
+  
+  U8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  MemoryCopy(at, signature, 8);
+  at += 8;
+  
+  // IHDR
+  {
+    U8 *chunk = at;
+    vox_png_write_u32_be(at, 13);
+    MemoryCopy(at + 4, "IHDR", 4);
+    vox_png_write_u32_be(at + 8, fb->width);
+    vox_png_write_u32_be(at + 12, fb->height);
+    at[16] = 8; // bit depth
+    at[17] = 6; // color type: RGBA
+    at[18] = 0; // compression
+    at[19] = 0; // filter
+    at[20] = 0; // interlace
+    at += 21;
+    vox_png_write_u32_be(at, vox_png_crc32(crc_table, chunk + 4, 4 + 13));
+    at += 4;
+  }
+  
+  // IDAT
+  {
+    U8 *chunk = at;
+    vox_png_write_u32_be(at, (U32)zlib_size);
+    MemoryCopy(at + 4, "IDAT", 4);
+    at += 8;
+    
+    *at++ = 0x78;
+    *at++ = 0x01;
+    
+    U32 adler_a = 1;
+    U32 adler_b = 0;
+    U64 raw_pos = 0;
+    for (U64 block_idx = 0; block_idx < blocks_count; block_idx += 1) {
+      U16 block_size = (U16)Min(raw_size - raw_pos, block_max);
+      U16 block_size_inv = (U16)~block_size;
+      *at++ = (block_idx == blocks_count - 1) ? 1 : 0;
+      *at++ = (U8)(block_size);
+      *at++ = (U8)(block_size >> 8);
+      *at++ = (U8)(block_size_inv);
+      *at++ = (U8)(block_size_inv >> 8);
+      
+      for (U16 idx = 0; idx < block_size; idx += 1, raw_pos += 1) {
+        U64 row = raw_pos / row_size;
+        U64 col = raw_pos % row_size;
+        U8 byte = 0;
+        if (col > 0) {
+          U8 *pixels = (U8 *)fb->pixels;
+          byte = pixels[row*fb->width*4 + (col - 1)];
+        }
+        *at++ = byte;
+        
+        adler_a = (adler_a + byte) % 65521;
+        adler_b = (adler_b + adler_a) % 65521;
+      }
+    }
+    vox_png_write_u32_be(at, (adler_b << 16) | adler_a);
+    at += 4;
+    
+    vox_png_write_u32_be(at, vox_png_crc32(crc_table, chunk + 4, 4 + zlib_size));
+    at += 4;
+  }
+  
+  // IEND
+  {
+    U8 *chunk = at;
+    vox_png_write_u32_be(at, 0);
+    MemoryCopy(at + 4, "IEND", 4);
+    at += 8;
+    vox_png_write_u32_be(at, vox_png_crc32(crc_table, chunk + 4, 4));
+    at += 4;
+  }
+  
+  String8 result = str8(data, (U64)(at - data));
+  return result;
+}
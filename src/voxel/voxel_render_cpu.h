@@ -0,0 +1,50 @@
+#pragma once
+
+// NOTE: CPU reference renderer. Reproduces ps_main in shaders/fullscreen.hlsl
+// (orbit camera, grid floor, fog, voxel DDA and lighting) without a GPU, so scenes
+// can be rendered on headless machines and compared against golden images. The
+// voxel DDA goes through vox_raycast and therefore sees the whole world, whereas
+// the shader only sees the chunk that is uploaded to the GPU.
+
+#define VOX_RENDER_CPU_TILE_SIZE 32
+
+struct VOX_Framebuffer {
+  U32 width;
+  U32 height;
+  U32 *pixels; // RGBA8 (R in the lowest byte), top row first
+};
+
+struct VOX_CameraRay {
+  V3F32 ro;
+  V3F32 rd;
+};
+
+// Shared by every thread rendering a frame.
+struct VOX_RenderCpuJob {
+  VOX_World *world;
+  VOX_LightCache *lights; // Optional
+  VOX_LodCache *lods;     // Optional
+  VOX_UniformData *uniforms;
+  VOX_Framebuffer *fb;
+  U32 tiles_x;
+  U32 tiles_count;
+};
+
+function VOX_Framebuffer vox_framebuffer_alloc(Arena *arena, U32 width, U32 height);
+
+function VOX_CameraRay vox_camera_ray_from_frag_coord(VOX_UniformData *uniforms, V2F32 frag_coord);
+// Width of a pixel's cone per unit of distance along its ray
+function F32 vox_camera_pixel_cone(VOX_UniformData *uniforms);
+function U32 vox_render_cpu_pixel(VOX_World *world, VOX_LightCache *lights, VOX_LodCache *lods, VOX_UniformData *uniforms, U32 x, U32 y);
+function void vox_render_cpu_tile(VOX_RenderCpuJob *job, U32 tile_idx);
+
+// Renders the whole framebuffer. Tiles are spread over the async worker threads
+// when the async layer is initialized; the calling thread renders tiles too.
+// With `lights`, voxels are shaded with its baked occlusion and shadows, as the
+// shader does; without, they are lit as if nothing occluded them. With `lods`,
+// far voxels are traced through the coarser levels the shader would pick for them
+// (see uniforms->lod_bias).
+function void vox_render_cpu(VOX_World *world, VOX_LightCache *lights, VOX_LodCache *lods, VOX_UniformData *uniforms, VOX_Framebuffer *fb);
+
+// Encodes the framebuffer as a PNG file (uncompressed deflate, no dependencies).
+function String8 vox_png_from_framebuffer(Arena *arena, VOX_Framebuffer *fb);
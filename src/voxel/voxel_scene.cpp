@@ -0,0 +1,371 @@
+//
+// Chunk codec
+//
+
+function U64
+vox_scene_chunk_encode(VOX_Chunk *chunk, U8 *dst, VOX_SceneCodec *codec_out)
+{
+  U64 result = 0;
+  
+#if VOX_CHUNK_LAYOUT != VOX_CHUNK_LAYOUT_LINEAR
+  // Files are linear whatever the chunk layout, so any build can read them
+  TempArena scratch = arena_scratch_begin(0, 0);
+  VOX_Chunk *linear = ArenaPushStruct(scratch.arena, VOX_Chunk);
+  vox_chunk_linear_from_layout(linear, chunk);
+  chunk = linear;
+#endif
+  
+  VOX_ChunkCodec codec = VOX_ChunkCodec_Raw;
+  result = vox_chunk_encode(chunk->voxels, dst, &codec);
+  *codec_out = (VOX_SceneCodec)codec;
+  
+#if VOX_CHUNK_LAYOUT != VOX_CHUNK_LAYOUT_LINEAR
+  arena_scratch_end(scratch);
+#endif
+  
+  return result;
+}
+
+function B32
+vox_scene_chunk_decode(VOX_SceneCodec codec, String8 payload, VOX_Chunk *chunk)
+{
+  B32 result = 0;
+  
+#if VOX_CHUNK_LAYOUT != VOX_CHUNK_LAYOUT_LINEAR
+  // Decoded in file order, then reordered into the chunk
+  VOX_Chunk *dst = chunk;
+  TempArena scratch = arena_scratch_begin(0, 0);
+  chunk = ArenaPushStruct(scratch.arena, VOX_Chunk);
+#endif
+  
+  result = vox_chunk_decode((VOX_ChunkCodec)codec, payload, chunk->voxels);
+  
+#if VOX_CHUNK_LAYOUT != VOX_CHUNK_LAYOUT_LINEAR
+  if (result) {
+    vox_chunk_layout_from_linear(dst, chunk);
+  }
+  arena_scratch_end(scratch);
+#endif
+  
+  return result;
+}
+
+//
+// Writer
+//
+
+function VOX_SceneWriter *
+vox_scene_writer_begin(String8 path)
+{
+  VOX_SceneWriter *writer = 0;
+  
+  OS_Handle file = os_file_open(path, OS_FileAccess_Write);
+  if (!os_handle_is_null(file)) {
+    Arena *arena = arena_alloc_default();
+    writer = ArenaPushStruct(arena, VOX_SceneWriter);
+    writer->arena = arena;
+    writer->file = file;
+    writer->offset = sizeof(VOX_SceneHeader); // Header is written last
+  }
+  
+  return writer;
+}
+
+function void
+vox_scene_writer_push_chunk(VOX_SceneWriter *writer, V3S32 chunk_coord, VOX_Chunk *chunk, U32 solid_count)
+{
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  U8 *payload = ArenaPushArrayNoZero(scratch.arena, U8, sizeof(VOX_Chunk));
+  VOX_SceneCodec codec = VOX_SceneCodec_Raw;
+  U64 payload_size = vox_scene_chunk_encode(chunk, payload, &codec);
+  
+  if (!os_file_write_at(writer->file, writer->offset, str8(payload, payload_size))) {
+    writer->failed = 1;
+  }
+  
+  VOX_SceneEntryBlock *block = writer->last_block;
+  if (!block || block->count == VOX_SCENE_ENTRY_BLOCK_CAP) {
+    block = ArenaPushStruct(writer->arena, VOX_SceneEntryBlock);
+    SLLQueuePush(writer->first_block, writer->last_block, block);
+  }
+  
+  VOX_SceneChunkEntry *entry = &block->entries[block->count++];
+  entry->coord[0] = chunk_coord.x;
+  entry->coord[1] = chunk_coord.y;
+  entry->coord[2] = chunk_coord.z;
+  entry->codec = codec;
+  entry->offset = writer->offset;
+  entry->size = (U32)payload_size;
+  entry->solid_count = solid_count;
+  
+  writer->offset += payload_size;
+  writer->chunks_count += 1;
+  
+  arena_scratch_end(scratch);
+}
+
+function B32
+vox_scene_writer_end(VOX_SceneWriter *writer)
+{
+  // Keep the directory 8-byte aligned so the reader can use it in place
+  U64 directory_offset = AlignPow2(writer->offset, 8);
+  
+  U64 at = directory_offset;
+  for (VOX_SceneEntryBlock *block = writer->first_block; block != 0; block = block->next) {
+    U64 size = block->count*sizeof(VOX_SceneChunkEntry);
+    if (!os_file_write_at(writer->file, at, str8((U8 *)block->entries, size))) {
+      writer->failed = 1;
+    }
+    at += size;
+  }
+  
+  VOX_SceneHeader header = {0};
+  header.magic = VOX_SCENE_MAGIC;
+  header.version = VOX_SCENE_VERSION;
+  header.slice_size = VOX_SLICE_SIZE;
+  header.chunks_count = writer->chunks_count;
+  header.directory_offset = directory_offset;
+  if (!os_file_write_at(writer->file, 0, str8((U8 *)&header, sizeof(header)))) {
+    writer->failed = 1;
+  }
+  
+  B32 result = !writer->failed;
+  os_file_close(writer->file);
+  arena_release(writer->arena);
+  return result;
+}
+
+function B32
+vox_scene_write_world(VOX_World *world, String8 path)
+{
+  B32 result = 0;
+  
+  VOX_SceneWriter *writer = vox_scene_writer_begin(path);
+  if (writer) {
+    for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+      vox_scene_writer_push_chunk(writer, n->coord, &n->chunk, n->solid_count);
+    }
+    result = vox_scene_writer_end(writer);
+  }
+  
+  return result;
+}
+
+//
+// Reader
+//
+
+function U32
+vox_scene_lookup_slot_from_coord(VOX_Scene *scene, V3S32 chunk_coord)
+{
+  U32 result = (U32)vox_hash_from_chunk_coord(chunk_coord) & scene->lookup_mask;
+  return result;
+}
+
+function VOX_Scene *
+vox_scene_open(String8 path)
+{
+  VOX_Scene *scene = 0;
+  
+  OS_Handle file = os_file_open(path, OS_FileAccess_Read);
+  if (!os_handle_is_null(file)) {
+    U64 size = os_file_size(file);
+    U8 *base = 0;
+    if (size >= sizeof(VOX_SceneHeader)) {
+      base = (U8 *)os_file_map_view(file, size);
+    }
+    os_file_close(file);
+    
+    B32 valid = 0;
+    VOX_SceneHeader header = {0};
+    if (base) {
+      MemoryCopy(&header, base, sizeof(header));
+      U64 directory_size = (U64)header.chunks_count*sizeof(VOX_SceneChunkEntry);
+      valid = (header.magic == VOX_SCENE_MAGIC &&
+               header.version >= 1 && header.version <= VOX_SCENE_VERSION &&
+               header.slice_size == VOX_SLICE_SIZE &&
+               header.directory_offset % 8 == 0 &&
+               header.directory_offset <= size &&
+               directory_size <= size - header.directory_offset);
+    }
+    
+    if (valid) {
+      // Decoded chunks are 128 KiB each, as in the world
+      Arena *arena = arena_alloc(GiB(4llu));
+      scene = ArenaPushStruct(arena, VOX_Scene);
+      scene->arena = arena;
+      scene->base = base;
+      scene->size = size;
+      scene->entries = (VOX_SceneChunkEntry *)(base + header.directory_offset);
+      scene->chunks_count = header.chunks_count;
+      scene->decoded = ArenaPushArray(arena, VOX_Chunk *, scene->chunks_count);
+      
+      U32 lookup_count = 16;
+      while (lookup_count < scene->chunks_count*2) {
+        lookup_count *= 2;
+      }
+      scene->lookup = ArenaPushArray(arena, U32, lookup_count);
+      scene->lookup_mask = lookup_count - 1;
+      
+      for (U32 idx = 0; idx < scene->chunks_count; idx += 1) {
+        VOX_SceneChunkEntry *entry = &scene->entries[idx];
+        V3S32 coord = v3s32(entry->coord[0], entry->coord[1], entry->coord[2]);
+        
+        U32 slot = vox_scene_lookup_slot_from_coord(scene, coord);
+        while (scene->lookup[slot] != 0) {
+          slot = (slot + 1) & scene->lookup_mask;
+        }
+        scene->lookup[slot] = idx + 1;
+        
+        if (idx == 0) {
+          scene->chunk_min = coord;
+          scene->chunk_max = coord;
+        }
+        else {
+          scene->chunk_min = v3s32(Min(scene->chunk_min.x, coord.x), Min(scene->chunk_min.y, coord.y), Min(scene->chunk_min.z, coord.z));
+          scene->chunk_max = v3s32(Max(scene->chunk_max.x, coord.x), Max(scene->chunk_max.y, coord.y), Max(scene->chunk_max.z, coord.z));
+        }
+      }
+    }
+    else if (base) {
+      os_file_unmap_view(base, size);
+    }
+  }
+  
+  return scene;
+}
+
+function void
+vox_scene_close(VOX_Scene *scene)
+{
+  if (scene) {
+    os_file_unmap_view(scene->base, scene->size);
+    arena_release(scene->arena);
+  }
+}
+
+function S32
+vox_scene_entry_idx_from_coord(VOX_Scene *scene, V3S32 chunk_coord)
+{
+  S32 result = -1;
+  
+  U32 slot = vox_scene_lookup_slot_from_coord(scene, chunk_coord);
+  while (scene->lookup[slot] != 0) {
+    U32 idx = scene->lookup[slot] - 1;
+    VOX_SceneChunkEntry *entry = &scene->entries[idx];
+    if (entry->coord[0] == chunk_coord.x && entry->coord[1] == chunk_coord.y && entry->coord[2] == chunk_coord.z) {
+      result = (S32)idx;
+      break;
+    }
+    slot = (slot + 1) & scene->lookup_mask;
+  }
+  
+  return result;
+}
+
+function B32
+vox_scene_decode_entry(VOX_Scene *scene, U32 entry_idx, VOX_Chunk *chunk)
+{
+  B32 result = 0;
+  
+  VOX_SceneChunkEntry *entry = &scene->entries[entry_idx];
+  if (entry->codec < VOX_SceneCodec_COUNT &&
+      entry->offset <= scene->size &&
+      entry->size <= scene->size - entry->offset) {
+    String8 payload = str8(scene->base + entry->offset, entry->size);
+    result = vox_scene_chunk_decode((VOX_SceneCodec)entry->codec, payload, chunk);
+  }
+  
+  return result;
+}
+
+function VOX_Chunk *
+vox_scene_chunk_from_coord(VOX_Scene *scene, V3S32 chunk_coord)
+{
+  VOX_Chunk *result = 0;
+  
+  S32 idx = vox_scene_entry_idx_from_coord(scene, chunk_coord);
+  if (idx >= 0) {
+    result = scene->decoded[idx];
+    if (!result) {
+      VOX_Chunk *chunk = ArenaPushArrayNoZero(scene->arena, VOX_Chunk, 1);
+      if (vox_scene_decode_entry(scene, (U32)idx, chunk)) {
+        scene->decoded[idx] = chunk;
+        result = chunk;
+      }
+      else {
+        ArenaPopArray(scene->arena, VOX_Chunk, 1);
+      }
+    }
+  }
+  
+  return result;
+}
+
+//
+// World loading
+//
+
+struct VOX_SceneLoadJob {
+  VOX_Scene *scene;
+  U32 *entry_indices;
+  VOX_ChunkNode **nodes;
+};
+
+function void
+vox_world_load_scene_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_SceneLoadJob *job = (VOX_SceneLoadJob *)user;
+  for (U64 idx = first; idx < opl; idx += 1) {
+    VOX_ChunkNode *node = job->nodes[idx];
+    if (!vox_scene_decode_entry(job->scene, job->entry_indices[idx], &node->chunk)) {
+      MemoryZeroStruct(&node->chunk);
+    }
+    node->solid_count = vox_occupancy_build(&node->occupancy, &node->chunk);
+  }
+}
+
+function U32
+vox_world_load_scene(VOX_World *world, VOX_Scene *scene, V3S32 chunk_min, V3S32 chunk_max)
+{
+  ProfBegin("vox_world_load_scene");
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  // Nodes are acquired up front on this thread; only decoding is spread out
+  VOX_SceneLoadJob job = {0};
+  job.scene = scene;
+  job.entry_indices = ArenaPushArray(scratch.arena, U32, scene->chunks_count);
+  job.nodes = ArenaPushArray(scratch.arena, VOX_ChunkNode *, scene->chunks_count);
+  
+  U32 count = 0;
+  for (U32 idx = 0; idx < scene->chunks_count; idx += 1) {
+    VOX_SceneChunkEntry *entry = &scene->entries[idx];
+    V3S32 coord = v3s32(entry->coord[0], entry->coord[1], entry->coord[2]);
+    B32 inside = (coord.x >= chunk_min.x && coord.x <= chunk_max.x &&
+                  coord.y >= chunk_min.y && coord.y <= chunk_max.y &&
+                  coord.z >= chunk_min.z && coord.z <= chunk_max.z);
+    if (inside && entry->solid_count > 0 && !vox_world_chunk_from_coord(world, coord)) {
+      job.entry_indices[count] = idx;
+      job.nodes[count] = vox_world_chunk_acquire(world, coord);
+      count += 1;
+    }
+  }
+  
+  async_parallel_for(count, 1, vox_world_load_scene_work, &job);
+  
+  // Corrupt payloads decode as empty chunks, which the world doesn't keep
+  U32 result = 0;
+  for (U32 idx = 0; idx < count; idx += 1) {
+    if (job.nodes[idx]->solid_count == 0) {
+      vox_world_chunk_release(world, job.nodes[idx]);
+    }
+    else {
+      result += 1;
+    }
+  }
+  
+  arena_scratch_end(scratch);
+  ProfEnd();
+  return result;
+}
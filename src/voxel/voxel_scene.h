@@ -0,0 +1,114 @@
+#pragma once
+
+// NOTE: Binary scene file. All values are little-endian.
+//
+//   VOX_SceneHeader
+//   chunk payloads, each compressed on its own
+//   VOX_SceneChunkEntry[chunks_count]   (the directory, at directory_offset)
+//
+// The directory comes last so the writer can stream payloads out one chunk at a
+// time and only keep the small directory entries in memory. The reader maps the
+// file and decodes a chunk the first time it is asked for, so opening a scene
+// costs one mapping plus a hash table over the directory.
+
+#define VOX_SCENE_MAGIC   0x53584F56 // "VOXS"
+// Version 2 added the Uniform and Lz codecs; version 1 files still open.
+#define VOX_SCENE_VERSION 2
+
+#define VOX_SCENE_ENTRY_BLOCK_CAP 256
+
+// The chunk codecs (see VOX_ChunkCodec), over voxels in linear order whatever
+// VOX_CHUNK_LAYOUT is.
+enum VOX_SceneCodec {
+  VOX_SceneCodec_Raw     = VOX_ChunkCodec_Raw,
+  VOX_SceneCodec_Rle     = VOX_ChunkCodec_Rle,
+  VOX_SceneCodec_Uniform = VOX_ChunkCodec_Uniform,
+  VOX_SceneCodec_Lz      = VOX_ChunkCodec_Lz,
+  VOX_SceneCodec_COUNT   = VOX_ChunkCodec_COUNT,
+};
+
+struct VOX_SceneHeader {
+  U32 magic;
+  U32 version;
+  U32 slice_size; // Must match VOX_SLICE_SIZE
+  U32 chunks_count;
+  U64 directory_offset;
+};
+
+struct VOX_SceneChunkEntry {
+  S32 coord[3];
+  U32 codec;
+  U64 offset;
+  U32 size;
+  U32 solid_count;
+};
+
+//
+// Writer
+//
+
+struct VOX_SceneEntryBlock {
+  VOX_SceneEntryBlock *next;
+  U32 count;
+  VOX_SceneChunkEntry entries[VOX_SCENE_ENTRY_BLOCK_CAP];
+};
+
+struct VOX_SceneWriter {
+  Arena *arena;
+  OS_Handle file;
+  U64 offset; // Where the next payload goes
+  
+  VOX_SceneEntryBlock *first_block;
+  VOX_SceneEntryBlock *last_block;
+  U32 chunks_count;
+  
+  B32 failed;
+};
+
+//
+// Reader
+//
+
+struct VOX_Scene {
+  Arena *arena;
+  
+  U8 *base;
+  U64 size;
+  
+  VOX_SceneChunkEntry *entries;
+  U32 chunks_count;
+  V3S32 chunk_min; // Bounds of the directory, in chunk coordinates
+  V3S32 chunk_max;
+  
+  // Open-addressed table of entry index + 1, keyed by chunk coordinate
+  U32 *lookup;
+  U32 lookup_mask;
+  
+  VOX_Chunk **decoded; // Per entry, null until first access
+};
+
+// Payload codec: vox_chunk_encode/vox_chunk_decode on the chunk in linear order.
+// `dst` must hold sizeof(VOX_Chunk) bytes.
+function U64 vox_scene_chunk_encode(VOX_Chunk *chunk, U8 *dst, VOX_SceneCodec *codec_out);
+function B32 vox_scene_chunk_decode(VOX_SceneCodec codec, String8 payload, VOX_Chunk *chunk);
+
+function VOX_SceneWriter *vox_scene_writer_begin(String8 path);
+function void vox_scene_writer_push_chunk(VOX_SceneWriter *writer, V3S32 chunk_coord, VOX_Chunk *chunk, U32 solid_count);
+// Writes the directory and the header and closes the file; returns 0 if any write failed.
+function B32 vox_scene_writer_end(VOX_SceneWriter *writer);
+
+function B32 vox_scene_write_world(VOX_World *world, String8 path);
+
+// Returns 0 when the file is missing, truncated or has an unknown version.
+function VOX_Scene *vox_scene_open(String8 path);
+function void vox_scene_close(VOX_Scene *scene);
+
+function S32 vox_scene_entry_idx_from_coord(VOX_Scene *scene, V3S32 chunk_coord);
+// Decoded on first access and cached for the lifetime of the scene. Not
+// thread-safe. Returns 0 when the scene has no such chunk or it is corrupt.
+function VOX_Chunk *vox_scene_chunk_from_coord(VOX_Scene *scene, V3S32 chunk_coord);
+
+// Decodes the scene chunks that fall inside [chunk_min, chunk_max] straight into
+// world chunks, skipping coordinates the world already holds. Decoding runs on
+// the async workers. Returns the number of chunks loaded.
+function U32 vox_world_load_scene(VOX_World *world, VOX_Scene *scene, V3S32 chunk_min, V3S32 chunk_max);
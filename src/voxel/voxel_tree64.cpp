@@ -0,0 +1,329 @@
+//
+// Build
+//
+
+function V3S32
+vox_tree64_child_offset(U32 bit)
+{
+  V3S32 result = v3s32((S32)(bit % 4), (S32)(bit / 4 % 4), (S32)(bit / 16));
+  return result;
+}
+
+function B32
+vox_tree64_any_chunk(VOX_World *world, V3S32 min, S32 size)
+{
+  B32 result = 0;
+  
+  V3S32 chunk_min = vox_chunk_coord_from_voxel_coord(min);
+  V3S32 chunk_max = vox_chunk_coord_from_voxel_coord(v3s32_add(min, v3s32(size - 1, size - 1, size - 1)));
+  for (S32 cz = chunk_min.z; cz <= chunk_max.z && !result; cz += 1) {
+    for (S32 cy = chunk_min.y; cy <= chunk_max.y && !result; cy += 1) {
+      for (S32 cx = chunk_min.x; cx <= chunk_max.x && !result; cx += 1) {
+        result = (vox_world_chunk_from_coord(world, v3s32(cx, cy, cz)) != 0);
+      }
+    }
+  }
+  
+  return result;
+}
+
+// Node for the cube of 4^level voxels per side at `min`; its mask is 0 when the
+// cube is empty, and then nothing was added to the builder.
+function VOX_Tree64Node
+vox_tree64_build_node(VOX_Tree64Builder *b, V3S32 min, U32 level)
+{
+  VOX_Tree64Node node = {0};
+  S32 size = 1 << (2*level);
+  
+  if (level == 1) {
+    // Leaves are exactly the chunks' occupancy bricks
+    VOX_ChunkNode *chunk = vox_world_chunk_from_coord(b->world, vox_chunk_coord_from_voxel_coord(min));
+    if (chunk) {
+      V3S32 local_coord = vox_local_coord_from_voxel_coord(min);
+      U64 mask = chunk->occupancy.bricks[vox_brick_idx_from_local_coord(local_coord)];
+      if (mask) {
+        U32 count = count_bits_set_u64(mask);
+        VOX_Voxel *voxels = ArenaPushArrayNoZero(b->voxels_arena, VOX_Voxel, count);
+        U32 voxel_idx = 0;
+        for (U32 bit = 0; bit < 64; bit += 1) {
+          if ((mask >> bit) & 1) {
+            V3S32 coord = v3s32_add(local_coord, vox_tree64_child_offset(bit));
+            voxels[voxel_idx++] = *vox_get_voxel(&chunk->chunk, vox_idx_from_local_coord(coord));
+          }
+        }
+        node.child_mask = mask;
+        node.first_child = b->voxels_count;
+        b->voxels_count += count;
+      }
+    }
+  }
+  else if (size >= VOX_SLICE_SIZE ? vox_tree64_any_chunk(b->world, min, size) : vox_tree64_any_chunk(b->world, min, 1)) {
+    VOX_Tree64Node children[64];
+    U32 children_count = 0;
+    S32 child_size = size / 4;
+    for (U32 bit = 0; bit < 64; bit += 1) {
+      V3S32 child_min = v3s32_add(min, v3s32_scale(vox_tree64_child_offset(bit), child_size));
+      VOX_Tree64Node child = vox_tree64_build_node(b, child_min, level - 1);
+      if (child.child_mask) {
+        children[children_count++] = child;
+        node.child_mask |= (U64)1 << bit;
+      }
+    }
+    
+    // Children go after their own subtrees, which were added while building them
+    if (children_count) {
+      VOX_Tree64Node *dst = ArenaPushArrayNoZero(b->nodes_arena, VOX_Tree64Node, children_count);
+      MemoryCopy(dst, children, sizeof(VOX_Tree64Node)*children_count);
+      node.first_child = b->nodes_count;
+      b->nodes_count += children_count;
+    }
+  }
+  
+  return node;
+}
+
+function VOX_Tree64
+vox_tree64_build(Arena *arena, VOX_World *world)
+{
+  ProfBegin("tree64 build");
+  
+  // Chunks are a multiple of 16 voxels, so every node of 16^3 or less lies
+  // within a single chunk.
+  V3S32 origin = {0};
+  U32 depth = 2;
+  if (world->has_bounds) {
+    origin = v3s32_scale(world->chunk_min, VOX_SLICE_SIZE);
+    V3S32 extent = v3s32_scale(v3s32_add(v3s32_sub(world->chunk_max, world->chunk_min), v3s32(1,1,1)), VOX_SLICE_SIZE);
+    S32 extent_max = Max(Max(extent.x, extent.y), extent.z);
+    while (depth < VOX_TREE64_DEPTH_MAX && (1 << (2*depth)) < extent_max) {
+      depth += 1;
+    }
+  }
+  
+  VOX_Tree64Builder b = {0};
+  b.world = world;
+  b.nodes_arena = arena_alloc(GiB(4llu));
+  b.voxels_arena = arena_alloc(GiB(4llu));
+  arena_set_align(b.voxels_arena, sizeof(VOX_Voxel));
+  
+  // The root goes first, once its children are known
+  b.nodes = ArenaPushArray(b.nodes_arena, VOX_Tree64Node, 1);
+  b.voxels = ArenaPushArrayNoZero(b.voxels_arena, VOX_Voxel, 0);
+  b.nodes_count = 1;
+  b.nodes[0] = vox_tree64_build_node(&b, origin, depth);
+  
+  U64 nodes_size = sizeof(VOX_Tree64Node)*b.nodes_count;
+  U64 voxels_size = sizeof(VOX_Voxel)*b.voxels_count;
+  U64 blob_size = sizeof(VOX_Tree64Header) + nodes_size + voxels_size;
+  U8 *blob = (U8 *)arena_push_nozero(arena, blob_size);
+  
+  VOX_Tree64Header *header = (VOX_Tree64Header *)blob;
+  MemoryZeroStruct(header);
+  header->magic = VOX_TREE64_MAGIC;
+  header->version = VOX_TREE64_VERSION;
+  header->origin[0] = origin.x;
+  header->origin[1] = origin.y;
+  header->origin[2] = origin.z;
+  header->depth = depth;
+  header->nodes_count = b.nodes_count;
+  header->voxels_count = b.voxels_count;
+  MemoryCopy(blob + sizeof(VOX_Tree64Header), b.nodes, nodes_size);
+  MemoryCopy(blob + sizeof(VOX_Tree64Header) + nodes_size, b.voxels, voxels_size);
+  
+  arena_release(b.nodes_arena);
+  arena_release(b.voxels_arena);
+  
+  VOX_Tree64 result = vox_tree64_from_blob(str8(blob, blob_size));
+  
+  ProfEnd();
+  return result;
+}
+
+function VOX_Tree64
+vox_tree64_from_blob(String8 blob)
+{
+  VOX_Tree64 result = {0};
+  
+  if (blob.count >= sizeof(VOX_Tree64Header)) {
+    VOX_Tree64Header *header = (VOX_Tree64Header *)blob.data;
+    U64 nodes_size = sizeof(VOX_Tree64Node)*(U64)header->nodes_count;
+    U64 voxels_size = sizeof(VOX_Voxel)*(U64)header->voxels_count;
+    B32 valid = (header->magic == VOX_TREE64_MAGIC &&
+                 header->version == VOX_TREE64_VERSION &&
+                 header->depth >= 2 && header->depth <= VOX_TREE64_DEPTH_MAX &&
+                 header->nodes_count >= 1 &&
+                 blob.count >= sizeof(VOX_Tree64Header) + nodes_size + voxels_size);
+    if (valid) {
+      result.blob = blob;
+      result.origin = v3s32(header->origin[0], header->origin[1], header->origin[2]);
+      result.depth = header->depth;
+      result.nodes = (VOX_Tree64Node *)(blob.data + sizeof(VOX_Tree64Header));
+      result.nodes_count = header->nodes_count;
+      result.voxels = (VOX_Voxel *)(blob.data + sizeof(VOX_Tree64Header) + nodes_size);
+      result.voxels_count = header->voxels_count;
+    }
+  }
+  
+  return result;
+}
+
+//
+// Queries
+//
+
+function U32
+vox_tree64_child_idx(VOX_Tree64Node *node, U32 bit)
+{
+  U32 result = node->first_child + count_bits_set_u64(node->child_mask & (((U64)1 << bit) - 1));
+  return result;
+}
+
+function VOX_Voxel
+vox_tree64_get_voxel(VOX_Tree64 *tree, V3S32 voxel_coord)
+{
+  VOX_Voxel result = {0};
+  
+  S32 size = 1 << (2*tree->depth);
+  V3S32 p = v3s32_sub(voxel_coord, tree->origin);
+  if (tree->nodes_count &&
+      p.x >= 0 && p.y >= 0 && p.z >= 0 && p.x < size && p.y < size && p.z < size) {
+    VOX_Tree64Node *node = &tree->nodes[0];
+    for (U32 level = tree->depth; level >= 1; level -= 1) {
+      S32 shift = 2*(level - 1);
+      U32 bit = (U32)(((p.x >> shift) & 3) + ((p.y >> shift) & 3)*4 + ((p.z >> shift) & 3)*16);
+      if (((node->child_mask >> bit) & 1) == 0) {
+        break;
+      }
+      U32 idx = vox_tree64_child_idx(node, bit);
+      if (level == 1) {
+        result = tree->voxels[idx];
+        break;
+      }
+      node = &tree->nodes[idx];
+    }
+  }
+  
+  return result;
+}
+
+function VOX_RaycastResult
+vox_tree64_raycast(VOX_Tree64 *tree, V3F32 ro, V3F32 rd)
+{
+  VOX_RaycastResult result = {0};
+  
+  // Traverse in tree space, where the root spans [0, size) on every axis and the
+  // cells of each level are aligned to multiples of their size, as
+  // vox_raycast_leap expects.
+  V3F32 offset = vox_world_pos_from_voxel_coord(tree->origin);
+  V3F32 local_ro = v3f32_sub(ro, offset);
+  F32 size = (F32)(1 << (2*tree->depth));
+  
+  F32 t_enter = 0.f;
+  F32 t_exit = VOX_RAYCAST_T_FAR;
+  U32 enter_axis = 3;
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    if (rd.e[axis] != 0.f) {
+      F32 t0 = (0.f - local_ro.e[axis]) / rd.e[axis];
+      F32 t1 = (size - local_ro.e[axis]) / rd.e[axis];
+      if (Min(t0, t1) > t_enter) {
+        t_enter = Min(t0, t1);
+        enter_axis = axis;
+      }
+      t_exit = Min(t_exit, Max(t0, t1));
+    }
+    else if (local_ro.e[axis] < 0.f || local_ro.e[axis] >= size) {
+      t_exit = -1.f;
+    }
+  }
+  if (tree->nodes_count == 0 || t_exit < t_enter) {
+    return result;
+  }
+  
+  // Start in the cell where the ray enters the root, on the face it crosses
+  VOX_RaycastState s = vox_raycast_state_make(local_ro, rd);
+  if (enter_axis < 3) {
+    for (U32 axis = 0; axis < 3; axis += 1) {
+      F32 p = Clamp(floorf32(local_ro.e[axis] + rd.e[axis]*t_enter), 0.f, size - 1.f);
+      s.pos.e[axis] = p;
+      F32 boundary = (rd.e[axis] > 0.f) ? p + 1.f : p;
+      s.t_max.e[axis] = (rd.e[axis] != 0.f) ? (boundary - local_ro.e[axis]) / rd.e[axis] : VOX_RAYCAST_T_FAR;
+    }
+    s.normal.e[enter_axis] = -s.stp.e[enter_axis];
+    s.t = t_enter;
+  }
+  
+  // Nodes from the root down to the one the last step ended in
+  struct { U32 node; V3F32 min; F32 size; } stack[VOX_TREE64_DEPTH_MAX];
+  U32 top = 0;
+  stack[0].node = 0;
+  stack[0].min = v3f32(0,0,0);
+  stack[0].size = size;
+  
+  F32 steps = 0.f;
+  B32 hit = 0;
+  
+  for (U32 iter = 0; iter < VOX_TREE64_STEPS_MAX && !hit; iter += 1) {
+    if (s.pos.x < 0.f || s.pos.y < 0.f || s.pos.z < 0.f ||
+        s.pos.x >= size || s.pos.y >= size || s.pos.z >= size) {
+      break;
+    }
+    
+    // Back up to the smallest node still containing the position
+    for (;;) {
+      V3F32 min = stack[top].min;
+      F32 node_size = stack[top].size;
+      B32 inside = (s.pos.x >= min.x && s.pos.x < min.x + node_size &&
+                    s.pos.y >= min.y && s.pos.y < min.y + node_size &&
+                    s.pos.z >= min.z && s.pos.z < min.z + node_size);
+      if (inside || top == 0) {
+        break;
+      }
+      top -= 1;
+    }
+    
+    steps += 1.f;
+    
+    // Then down until an empty child, which is skipped whole, or a solid voxel
+    for (;;) {
+      VOX_Tree64Node *node = &tree->nodes[stack[top].node];
+      F32 child_size = stack[top].size*0.25f;
+      V3F32 min = stack[top].min;
+      S32 cx = (S32)((s.pos.x - min.x) / child_size);
+      S32 cy = (S32)((s.pos.y - min.y) / child_size);
+      S32 cz = (S32)((s.pos.z - min.z) / child_size);
+      U32 bit = (U32)(cx + cy*4 + cz*16);
+      
+      if (((node->child_mask >> bit) & 1) == 0) {
+        if (child_size > 1.f) {
+          vox_raycast_leap(&s, child_size);
+        }
+        else {
+          vox_raycast_step(&s);
+        }
+        break;
+      }
+      
+      if (child_size == 1.f) {
+        hit = 1;
+        break;
+      }
+      
+      top += 1;
+      stack[top].node = vox_tree64_child_idx(node, bit);
+      stack[top].min = v3f32(min.x + cx*child_size, min.y + cy*child_size, min.z + cz*child_size);
+      stack[top].size = child_size;
+    }
+  }
+  
+  if (hit) {
+    V3S32 local_coord = v3s32((S32)s.pos.x, (S32)s.pos.y, (S32)s.pos.z);
+    result.coord = v3s32_add(tree->origin, local_coord);
+    result.pos = v3f32_add(s.pos, offset);
+    result.normal = s.normal;
+    result.prev_coord = v3s32_add(result.coord, v3s32((S32)s.normal.x, (S32)s.normal.y, (S32)s.normal.z));
+  }
+  result.hit = hit;
+  result.steps = steps;
+  
+  return result;
+}
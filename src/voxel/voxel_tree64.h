@@ -0,0 +1,71 @@
+#pragma once
+
+// NOTE: Sparse 64-tree for static scenes. Every node splits its cube into 4^3
+// children and keeps a 64-bit mask of the ones that hold any solid voxel, so
+// empty space costs nothing to store and a ray skips it a whole child at a time.
+//
+// Present children are stored next to each other in bit order, and a node only
+// records where the first one is: child `bit` lives at
+// first_child + count_bits_set_u64(child_mask & ((1 << bit) - 1)). Nodes of 4^3
+// voxels are the leaves. Their mask is the occupancy brick, and `first_child`
+// indexes the voxel array instead.
+//
+// The tree is built once from a world and never edited. Nodes, root first, and
+// voxels are two flat arrays in a single blob behind a header. The blob is also
+// the serialized form: vox_tree64_from_blob reads a file's contents in place.
+
+#define VOX_TREE64_MAGIC   0x34365456 // "VT64"
+#define VOX_TREE64_VERSION 1
+
+// The root covers 4^depth voxels per side; leaves are at depth 1.
+#define VOX_TREE64_DEPTH_MAX 12
+
+#define VOX_TREE64_STEPS_MAX 512
+
+struct VOX_Tree64Node {
+  U64 child_mask;  // Bit x + y*4 + z*16 per child, as in an occupancy brick
+  U32 first_child; // Into the nodes, or into the voxels for leaves
+  U32 pad;
+};
+
+struct VOX_Tree64Header {
+  U32 magic;
+  U32 version;
+  S32 origin[3];
+  U32 depth;
+  U32 nodes_count;
+  U32 voxels_count;
+};
+
+struct VOX_Tree64 {
+  String8 blob;  // Header, nodes, voxels
+  V3S32 origin;  // Voxel coordinate of the root's min corner
+  U32 depth;
+  VOX_Tree64Node *nodes;
+  U32 nodes_count;
+  VOX_Voxel *voxels;
+  U32 voxels_count;
+};
+
+// Nodes and voxels grow in arenas of their own so each stays one array.
+struct VOX_Tree64Builder {
+  VOX_World *world;
+  Arena *nodes_arena;
+  Arena *voxels_arena;
+  VOX_Tree64Node *nodes;
+  U32 nodes_count;
+  VOX_Voxel *voxels;
+  U32 voxels_count;
+};
+
+// Builds the tree of every chunk in the world into a blob on `arena`.
+function VOX_Tree64 vox_tree64_build(Arena *arena, VOX_World *world);
+
+// Points a tree at a blob written by vox_tree64_build. Returns a tree without
+// nodes if the blob is not one, or is cut short.
+function VOX_Tree64 vox_tree64_from_blob(String8 blob);
+
+function VOX_Voxel vox_tree64_get_voxel(VOX_Tree64 *tree, V3S32 voxel_coord);
+
+// Same rays and results as vox_raycast, through the tree.
+function VOX_RaycastResult vox_tree64_raycast(VOX_Tree64 *tree, V3F32 ro, V3F32 rd);
@@ -0,0 +1,444 @@
+//
+// History
+//
+
+function VOX_UndoHistory *
+vox_undo_alloc(U64 budget)
+{
+  Arena *arena = arena_alloc(budget + MiB(1));
+  VOX_UndoHistory *undo = ArenaPushStruct(arena, VOX_UndoHistory);
+  undo->arena = arena;
+  undo->budget = budget;
+  undo->ring = ArenaPushArrayNoZero(arena, U8, budget);
+  undo->entries = ArenaPushArray(arena, VOX_UndoEntry, VOX_UNDO_ENTRIES_MAX);
+  
+  // Each touched chunk costs ~132 KiB while a stroke is recorded
+  undo->stroke_arena = arena_alloc(GiB(4llu));
+  undo->stroke_slots = ArenaPushArray(undo->stroke_arena, VOX_UndoStrokeChunk *, VOX_UNDO_STROKE_SLOTS);
+  
+  return undo;
+}
+
+function void
+vox_undo_release(VOX_UndoHistory *undo)
+{
+  if (undo) {
+    arena_release(undo->stroke_arena);
+    arena_release(undo->arena);
+  }
+}
+
+function VOX_UndoEntry *
+vox_undo_entry_from_idx(VOX_UndoHistory *undo, U32 idx)
+{
+  VOX_UndoEntry *result = &undo->entries[(undo->entries_first + idx) % VOX_UNDO_ENTRIES_MAX];
+  return result;
+}
+
+function void
+vox_undo_stroke_reset(VOX_UndoHistory *undo)
+{
+  arena_clear(undo->stroke_arena);
+  undo->stroke_slots = ArenaPushArray(undo->stroke_arena, VOX_UndoStrokeChunk *, VOX_UNDO_STROKE_SLOTS);
+  undo->stroke_first = 0;
+  undo->stroke_merge_key = 0;
+}
+
+function void
+vox_undo_clear(VOX_UndoHistory *undo)
+{
+  undo->entries_first = 0;
+  undo->entries_count = 0;
+  undo->applied_count = 0;
+  undo->stroke_active = 0;
+  vox_undo_stroke_reset(undo);
+}
+
+function void
+vox_undo_evict_oldest(VOX_UndoHistory *undo)
+{
+  undo->entries_first = (undo->entries_first + 1) % VOX_UNDO_ENTRIES_MAX;
+  undo->entries_count -= 1;
+  if (undo->applied_count > 0) {
+    undo->applied_count -= 1;
+  }
+}
+
+// Finds room for `size` bytes after the newest entry, evicting the oldest entries
+// until it fits. Returns the ring offset.
+function U64
+vox_undo_ring_alloc(VOX_UndoHistory *undo, U64 size)
+{
+  U64 result = 0;
+  
+  for (;;) {
+    if (undo->entries_count == 0 || undo->entries_count == VOX_UNDO_ENTRIES_MAX) {
+      if (undo->entries_count == 0) {
+        result = 0;
+        break;
+      }
+      vox_undo_evict_oldest(undo);
+      continue;
+    }
+    
+    VOX_UndoEntry *oldest = vox_undo_entry_from_idx(undo, 0);
+    VOX_UndoEntry *newest = vox_undo_entry_from_idx(undo, undo->entries_count - 1);
+    U64 head = oldest->offset;
+    U64 tail = newest->offset + newest->size;
+    
+    B32 found = 0;
+    if (newest->offset >= head) {
+      // Used: [head, tail). Free: [tail, budget) and [0, head).
+      if (size <= undo->budget - tail) {
+        result = tail;
+        found = 1;
+      }
+      else if (size <= head) {
+        result = 0;
+        found = 1;
+      }
+    }
+    else {
+      // Wrapped. Used: [head, budget) and [0, tail). Free: [tail, head).
+      if (size <= head - tail) {
+        result = tail;
+        found = 1;
+      }
+    }
+    
+    if (found) {
+      break;
+    }
+    vox_undo_evict_oldest(undo);
+  }
+  
+  return result;
+}
+
+function U64
+vox_undo_bytes_used(VOX_UndoHistory *undo)
+{
+  U64 result = 0;
+  for (U32 idx = 0; idx < undo->entries_count; idx += 1) {
+    result += vox_undo_entry_from_idx(undo, idx)->size;
+  }
+  return result;
+}
+
+//
+// Records
+//
+
+function void
+vox_undo_put(U8 *dst, U64 *at, void *src, U64 size)
+{
+  if (dst) {
+    MemoryCopy(dst + *at, src, size);
+  }
+  *at += size;
+}
+
+function void
+vox_undo_get(U8 *src, U64 *at, void *dst, U64 size)
+{
+  MemoryCopy(dst, src + *at, size);
+  *at += size;
+}
+
+function B32
+vox_undo_stroke_chunk_touched(VOX_UndoStrokeChunk *sc, U32 idx)
+{
+  B32 result = (sc->touched[idx / 64] >> (idx % 64)) & 1;
+  return result;
+}
+
+// Encodes the recorded stroke against the world's current (new) values. With a
+// null `dst` only measures. Voxels that ended up unchanged aren't stored.
+function U64
+vox_undo_stroke_encode(VOX_UndoHistory *undo, VOX_World *world, U8 *dst, U64 *voxels_count_out)
+{
+  U64 at = 0;
+  U64 voxels_count = 0;
+  
+  U64 chunks_count_at = at;
+  U32 chunks_count = 0;
+  vox_undo_put(dst, &at, &chunks_count, sizeof(chunks_count));
+  
+  local VOX_Chunk empty_chunk = {0};
+  for (VOX_UndoStrokeChunk *sc = undo->stroke_first; sc != 0; sc = sc->next) {
+    VOX_ChunkNode *node = vox_world_chunk_from_coord(world, sc->coord);
+    VOX_Chunk *chunk = node ? &node->chunk : &empty_chunk;
+    
+    U64 chunk_at = at;
+    U32 runs_count = 0;
+    S32 coord[3] = { sc->coord.x, sc->coord.y, sc->coord.z };
+    vox_undo_put(dst, &at, coord, sizeof(coord));
+    vox_undo_put(dst, &at, &runs_count, sizeof(runs_count));
+    
+    for (U32 idx = 0; idx < VOX_CHUNK_SIZE;) {
+      if ((idx % 64) == 0 && sc->touched[idx / 64] == 0) {
+        idx += 64;
+        continue;
+      }
+      
+      B32 changed = (vox_undo_stroke_chunk_touched(sc, idx) && !vox_voxel_equal(sc->old[idx], chunk->voxels[idx]));
+      if (!changed) {
+        idx += 1;
+        continue;
+      }
+      
+      U32 first = idx;
+      U32 opl = idx + 1;
+      B32 old_uniform = 1;
+      B32 new_uniform = 1;
+      while (opl < VOX_CHUNK_SIZE &&
+             vox_undo_stroke_chunk_touched(sc, opl) &&
+             !vox_voxel_equal(sc->old[opl], chunk->voxels[opl])) {
+        old_uniform = old_uniform && vox_voxel_equal(sc->old[opl], sc->old[first]);
+        new_uniform = new_uniform && vox_voxel_equal(chunk->voxels[opl], chunk->voxels[first]);
+        opl += 1;
+      }
+      
+      U32 count = opl - first;
+      U16 first_u16 = (U16)first;
+      U16 count_minus_one = (U16)(count - 1);
+      U8 flags = 0;
+      flags |= old_uniform ? VOX_UndoRunFlag_OldUniform : 0;
+      flags |= new_uniform ? VOX_UndoRunFlag_NewUniform : 0;
+      vox_undo_put(dst, &at, &first_u16, sizeof(first_u16));
+      vox_undo_put(dst, &at, &count_minus_one, sizeof(count_minus_one));
+      vox_undo_put(dst, &at, &flags, sizeof(flags));
+      vox_undo_put(dst, &at, &sc->old[first], sizeof(VOX_Voxel)*(old_uniform ? 1 : count));
+      vox_undo_put(dst, &at, &chunk->voxels[first], sizeof(VOX_Voxel)*(new_uniform ? 1 : count));
+      
+      runs_count += 1;
+      voxels_count += count;
+      idx = opl;
+    }
+    
+    if (runs_count > 0) {
+      vox_undo_put(dst, &chunk_at, coord, sizeof(coord));
+      vox_undo_put(dst, &chunk_at, &runs_count, sizeof(runs_count));
+      chunks_count += 1;
+    }
+    else {
+      at = chunk_at;
+    }
+  }
+  
+  vox_undo_put(dst, &chunks_count_at, &chunks_count, sizeof(chunks_count));
+  
+  *voxels_count_out = voxels_count;
+  U64 result = (chunks_count > 0) ? at : 0;
+  return result;
+}
+
+function void
+vox_undo_record_apply(U8 *record, VOX_World *world, B32 apply_new)
+{
+  U64 at = 0;
+  U32 chunks_count = 0;
+  vox_undo_get(record, &at, &chunks_count, sizeof(chunks_count));
+  
+  for (U32 chunk_idx = 0; chunk_idx < chunks_count; chunk_idx += 1) {
+    S32 coord[3] = {0};
+    U32 runs_count = 0;
+    vox_undo_get(record, &at, coord, sizeof(coord));
+    vox_undo_get(record, &at, &runs_count, sizeof(runs_count));
+    V3S32 chunk_base = v3s32_scale(v3s32(coord[0], coord[1], coord[2]), VOX_SLICE_SIZE);
+    
+    for (U32 run_idx = 0; run_idx < runs_count; run_idx += 1) {
+      U16 first = 0;
+      U16 count_minus_one = 0;
+      U8 flags = 0;
+      vox_undo_get(record, &at, &first, sizeof(first));
+      vox_undo_get(record, &at, &count_minus_one, sizeof(count_minus_one));
+      vox_undo_get(record, &at, &flags, sizeof(flags));
+      U32 count = (U32)count_minus_one + 1;
+      
+      U64 old_at = at;
+      U64 old_size = sizeof(VOX_Voxel)*((flags & VOX_UndoRunFlag_OldUniform) ? 1 : count);
+      U64 new_at = old_at + old_size;
+      U64 new_size = sizeof(VOX_Voxel)*((flags & VOX_UndoRunFlag_NewUniform) ? 1 : count);
+      at = new_at + new_size;
+      
+      U64 values_at = apply_new ? new_at : old_at;
+      B32 uniform = (flags & (apply_new ? VOX_UndoRunFlag_NewUniform : VOX_UndoRunFlag_OldUniform)) != 0;
+      for (U32 i = 0; i < count; i += 1) {
+        VOX_Voxel voxel = {0};
+        MemoryCopy(&voxel, record + values_at + sizeof(VOX_Voxel)*(uniform ? 0 : i), sizeof(voxel));
+        V3S32 local_coord = vox_local_coord_from_idx((S32)first + (S32)i);
+        vox_world_set_voxel(world, v3s32_add(chunk_base, local_coord), voxel);
+      }
+    }
+  }
+}
+
+//
+// Strokes
+//
+
+function void
+vox_undo_begin_stroke(VOX_UndoHistory *undo, U32 merge_key)
+{
+  // The previous stroke's chunks are still recorded, so merging only drops its
+  // entry and keeps recording into the same state; end_stroke re-encodes both.
+  B32 merge = 0;
+  if (merge_key != 0 && undo->stroke_merge_key == merge_key &&
+      undo->entries_count > 0 && undo->applied_count == undo->entries_count) {
+    VOX_UndoEntry *newest = vox_undo_entry_from_idx(undo, undo->entries_count - 1);
+    F64 elapsed = (os_get_ticks() - newest->end_ticks) / os_get_ticks_frequency();
+    merge = (newest->merge_key == merge_key && elapsed < VOX_UNDO_MERGE_SECONDS);
+  }
+  
+  if (merge) {
+    undo->entries_count -= 1;
+    undo->applied_count -= 1;
+  }
+  else {
+    vox_undo_stroke_reset(undo);
+  }
+  
+  undo->stroke_active = 1;
+  undo->stroke_merge_key = merge_key;
+}
+
+function void
+vox_undo_end_stroke(VOX_UndoHistory *undo, VOX_World *world)
+{
+  if (undo->stroke_active) {
+    ProfBegin("vox_undo_end_stroke");
+    undo->stroke_active = 0;
+    
+    // A new step discards everything that could have been redone
+    undo->entries_count = undo->applied_count;
+    
+    U64 voxels_count = 0;
+    U64 size = vox_undo_stroke_encode(undo, world, 0, &voxels_count);
+    if (size > undo->budget) {
+      // Older entries can't be replayed consistently without this one
+      vox_undo_clear(undo);
+    }
+    else if (size > 0) {
+      U64 offset = vox_undo_ring_alloc(undo, size);
+      vox_undo_stroke_encode(undo, world, undo->ring + offset, &voxels_count);
+      
+      VOX_UndoEntry *entry = vox_undo_entry_from_idx(undo, undo->entries_count);
+      entry->offset = offset;
+      entry->size = size;
+      entry->voxels_count = voxels_count;
+      entry->merge_key = undo->stroke_merge_key;
+      entry->end_ticks = os_get_ticks();
+      undo->entries_count += 1;
+      undo->applied_count += 1;
+    }
+    else {
+      // Nothing changed; don't let a later stroke merge into an older entry
+      undo->stroke_merge_key = 0;
+    }
+    ProfEnd();
+  }
+}
+
+function VOX_UndoStrokeChunk *
+vox_undo_stroke_chunk_from_coord(VOX_UndoHistory *undo, V3S32 chunk_coord)
+{
+  U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % VOX_UNDO_STROKE_SLOTS;
+  VOX_UndoStrokeChunk *sc = undo->stroke_slots[slot_idx];
+  for (; sc != 0; sc = sc->hash_next) {
+    if (sc->coord.x == chunk_coord.x && sc->coord.y == chunk_coord.y && sc->coord.z == chunk_coord.z) {
+      break;
+    }
+  }
+  if (!sc) {
+    sc = ArenaPushStruct(undo->stroke_arena, VOX_UndoStrokeChunk);
+    sc->coord = chunk_coord;
+    SLLStackPushN(undo->stroke_slots[slot_idx], sc, hash_next);
+    SLLStackPush(undo->stroke_first, sc);
+  }
+  return sc;
+}
+
+function void
+vox_undo_set_voxel(VOX_UndoHistory *undo, VOX_World *world, V3S32 voxel_coord, VOX_Voxel voxel)
+{
+  B32 implicit_stroke = !undo->stroke_active;
+  if (implicit_stroke) {
+    vox_undo_begin_stroke(undo, 0);
+  }
+  
+  V3S32 chunk_coord = vox_chunk_coord_from_voxel_coord(voxel_coord);
+  VOX_UndoStrokeChunk *sc = vox_undo_stroke_chunk_from_coord(undo, chunk_coord);
+  
+  U32 idx = (U32)vox_idx_from_local_coord(vox_local_coord_from_voxel_coord(voxel_coord));
+  if (!vox_undo_stroke_chunk_touched(sc, idx)) {
+    sc->touched[idx / 64] |= (U64)1 << (idx % 64);
+    sc->old[idx] = vox_world_get_voxel(world, voxel_coord);
+  }
+  
+  vox_world_set_voxel(world, voxel_coord, voxel);
+  
+  if (implicit_stroke) {
+    vox_undo_end_stroke(undo, world);
+  }
+}
+
+function void
+vox_undo_touch_span(VOX_UndoHistory *undo, V3S32 chunk_coord, VOX_Chunk *chunk, U32 first_idx, U32 count)
+{
+  VOX_UndoStrokeChunk *sc = vox_undo_stroke_chunk_from_coord(undo, chunk_coord);
+  
+  for (U32 idx = first_idx; idx < first_idx + count;) {
+    // Whole untouched words are copied in one go
+    U64 *word = &sc->touched[idx / 64];
+    if ((idx % 64) == 0 && idx + 64 <= first_idx + count && *word == 0) {
+      MemoryCopy(&sc->old[idx], &chunk->voxels[idx], sizeof(VOX_Voxel)*64);
+      *word = MAX_U64;
+      idx += 64;
+      continue;
+    }
+    
+    U64 bit = (U64)1 << (idx % 64);
+    if (!(*word & bit)) {
+      *word |= bit;
+      sc->old[idx] = chunk->voxels[idx];
+    }
+    idx += 1;
+  }
+}
+
+//
+// Undo/redo
+//
+
+function B32
+vox_undo(VOX_UndoHistory *undo, VOX_World *world)
+{
+  vox_undo_end_stroke(undo, world);
+  
+  B32 result = 0;
+  if (undo->applied_count > 0) {
+    VOX_UndoEntry *entry = vox_undo_entry_from_idx(undo, undo->applied_count - 1);
+    vox_undo_record_apply(undo->ring + entry->offset, world, 0);
+    undo->applied_count -= 1;
+    undo->stroke_merge_key = 0;
+    result = 1;
+  }
+  return result;
+}
+
+function B32
+vox_redo(VOX_UndoHistory *undo, VOX_World *world)
+{
+  vox_undo_end_stroke(undo, world);
+  
+  B32 result = 0;
+  if (undo->applied_count < undo->entries_count) {
+    VOX_UndoEntry *entry = vox_undo_entry_from_idx(undo, undo->applied_count);
+    vox_undo_record_apply(undo->ring + entry->offset, world, 1);
+    undo->applied_count += 1;
+    undo->stroke_merge_key = 0;
+    result = 1;
+  }
+  return result;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+// NOTE: Undo history for voxel edits. Instead of snapshotting chunks, each entry
+// stores only the voxels a stroke changed, as runs of consecutive chunk indices
+// with their old and new values. A run whose old (or new) values are all the
+// same stores that value once, so filling or clearing a large region costs a few
+// bytes per run. Undo and redo replay the runs, so they cost O(changed voxels).
+//
+// Entries live in a byte ring sized by the memory budget. When a new entry
+// doesn't fit, the oldest entries are evicted. Strokes recorded with the same
+// non-zero merge key within VOX_UNDO_MERGE_SECONDS of each other are merged into
+// one entry, so e.g. a drag that edits a voxel per frame undoes as a whole.
+//
+// Record layout (byte-packed):
+//   U32 chunks_count
+//   per chunk: S32 coord[3], U32 runs_count
+//     per run: U16 first_idx, U16 count - 1, U8 flags,
+//              old voxels (1 if VOX_UndoRunFlag_OldUniform, else count),
+//              new voxels (1 if VOX_UndoRunFlag_NewUniform, else count)
+
+#define VOX_UNDO_DEFAULT_BUDGET MiB(64)
+#define VOX_UNDO_ENTRIES_MAX    4096
+#define VOX_UNDO_MERGE_SECONDS  0.5
+#define VOX_UNDO_STROKE_SLOTS   64
+
+enum {
+  VOX_UndoRunFlag_OldUniform = (1 << 0),
+  VOX_UndoRunFlag_NewUniform = (1 << 1),
+};
+
+struct VOX_UndoEntry {
+  U64 offset; // Into the ring
+  U64 size;
+  U64 voxels_count;
+  U32 merge_key;
+  F64 end_ticks;
+};
+
+// Voxels touched by the stroke being recorded in one chunk, with the values
+// they had before the stroke. New values are read from the world when the
+// stroke ends.
+struct VOX_UndoStrokeChunk {
+  VOX_UndoStrokeChunk *next;
+  VOX_UndoStrokeChunk *hash_next;
+  V3S32 coord;
+  U64 touched[VOX_CHUNK_SIZE / 64];
+  VOX_Voxel old[VOX_CHUNK_SIZE];
+};
+
+struct VOX_UndoHistory {
+  Arena *arena;
+  
+  U8 *ring;
+  U64 budget;
+  
+  // Ring of entries, oldest first. Entries [0, applied_count) are applied and can
+  // be undone; the rest can be redone.
+  VOX_UndoEntry *entries;
+  U32 entries_first;
+  U32 entries_count;
+  U32 applied_count;
+  
+  // Stroke being recorded
+  Arena *stroke_arena;
+  B32 stroke_active;
+  U32 stroke_merge_key;
+  VOX_UndoStrokeChunk *stroke_first;
+  VOX_UndoStrokeChunk **stroke_slots;
+};
+
+function VOX_UndoHistory *vox_undo_alloc(U64 budget);
+function void vox_undo_release(VOX_UndoHistory *undo);
+function void vox_undo_clear(VOX_UndoHistory *undo);
+
+// Edits between begin and end form one undo step. Pass a merge key of 0 for
+// strokes that must never merge with the previous one.
+function void vox_undo_begin_stroke(VOX_UndoHistory *undo, U32 merge_key);
+function void vox_undo_end_stroke(VOX_UndoHistory *undo, VOX_World *world);
+
+// Records the voxel's current value and then writes the new one. Outside of a
+// stroke the edit becomes its own unmergeable step.
+function void vox_undo_set_voxel(VOX_UndoHistory *undo, VOX_World *world, V3S32 voxel_coord, VOX_Voxel voxel);
+
+// For code that writes chunk voxels directly: records the current values of
+// `count` voxels starting at `first_idx` before they are overwritten. Voxels the
+// stroke already recorded keep their first value. Needs an active stroke.
+function void vox_undo_touch_span(VOX_UndoHistory *undo, V3S32 chunk_coord, VOX_Chunk *chunk, U32 first_idx, U32 count);
+
+// Return 0 when there is nothing to undo/redo.
+function B32 vox_undo(VOX_UndoHistory *undo, VOX_World *world);
+function B32 vox_redo(VOX_UndoHistory *undo, VOX_World *world);
+
+function U64 vox_undo_bytes_used(VOX_UndoHistory *undo);
@@ -0,0 +1,168 @@
+function void
+vox_dirty_bricks_mark(U64 *dirty_bricks, V3S32 local_coord)
+{
+  S32 brick_idx = vox_brick_idx_from_local_coord(local_coord);
+  dirty_bricks[brick_idx / 64] |= (U64)1 << (brick_idx % 64);
+}
+
+function void
+vox_dirty_bricks_mark_all(U64 *dirty_bricks)
+{
+  for (U32 idx = 0; idx < VOX_BRICK_SUMMARY_WORDS; idx += 1) {
+    dirty_bricks[idx] = ~(U64)0;
+  }
+}
+
+function void
+vox_dirty_bricks_clear(U64 *dirty_bricks)
+{
+  MemoryZero(dirty_bricks, sizeof(U64)*VOX_BRICK_SUMMARY_WORDS);
+}
+
+function B32
+vox_dirty_bricks_any(U64 *dirty_bricks)
+{
+  U64 any = 0;
+  for (U32 idx = 0; idx < VOX_BRICK_SUMMARY_WORDS; idx += 1) {
+    any |= dirty_bricks[idx];
+  }
+  B32 result = (any != 0);
+  return result;
+}
+
+function B32
+vox_upload_brick_get(U64 *bricks, S32 bx, S32 by, S32 bz)
+{
+  S32 brick_idx = bx + by*VOX_BRICKS_PER_SLICE + bz*VOX_BRICKS_PER_SLICE*VOX_BRICKS_PER_SLICE;
+  B32 result = (bricks[brick_idx / 64] >> (brick_idx % 64)) & 1;
+  return result;
+}
+
+function void
+vox_upload_brick_unset(U64 *bricks, S32 bx, S32 by, S32 bz)
+{
+  S32 brick_idx = bx + by*VOX_BRICKS_PER_SLICE + bz*VOX_BRICKS_PER_SLICE*VOX_BRICKS_PER_SLICE;
+  bricks[brick_idx / 64] &= ~((U64)1 << (brick_idx % 64));
+}
+
+function VOX_UploadPlan
+vox_upload_plan_from_dirty_bricks(U64 *dirty_bricks)
+{
+  VOX_UploadPlan plan = {0};
+  
+  U64 remaining[VOX_BRICK_SUMMARY_WORDS];
+  MemoryCopy(remaining, dirty_bricks, sizeof(remaining));
+  
+  V3S32 bounds_min = v3s32(VOX_BRICKS_PER_SLICE, VOX_BRICKS_PER_SLICE, VOX_BRICKS_PER_SLICE);
+  V3S32 bounds_max = v3s32(0, 0, 0);
+  B32 overflow = 0;
+  S32 n = VOX_BRICKS_PER_SLICE;
+  
+  // Greedy box growth: starting at the first remaining dirty brick, extend along
+  // x, then y while the whole row is dirty, then z while the whole rectangle is.
+  // Each box covers only dirty bricks and removes them from the remaining set.
+  for (S32 bz = 0; bz < n; bz += 1) {
+    for (S32 by = 0; by < n; by += 1) {
+      for (S32 bx = 0; bx < n; bx += 1) {
+        if (!vox_upload_brick_get(remaining, bx, by, bz)) {
+          continue;
+        }
+        
+        S32 x1 = bx + 1;
+        while (x1 < n && vox_upload_brick_get(remaining, x1, by, bz)) {
+          x1 += 1;
+        }
+        
+        S32 y1 = by + 1;
+        for (; y1 < n; y1 += 1) {
+          B32 row_dirty = 1;
+          for (S32 x = bx; x < x1 && row_dirty; x += 1) {
+            row_dirty = vox_upload_brick_get(remaining, x, y1, bz);
+          }
+          if (!row_dirty) {
+            break;
+          }
+        }
+        
+        S32 z1 = bz + 1;
+        for (; z1 < n; z1 += 1) {
+          B32 rect_dirty = 1;
+          for (S32 y = by; y < y1 && rect_dirty; y += 1) {
+            for (S32 x = bx; x < x1 && rect_dirty; x += 1) {
+              rect_dirty = vox_upload_brick_get(remaining, x, y, z1);
+            }
+          }
+          if (!rect_dirty) {
+            break;
+          }
+        }
+        
+        for (S32 z = bz; z < z1; z += 1) {
+          for (S32 y = by; y < y1; y += 1) {
+            for (S32 x = bx; x < x1; x += 1) {
+              vox_upload_brick_unset(remaining, x, y, z);
+            }
+          }
+        }
+        
+        bounds_min = v3s32(Min(bounds_min.x, bx), Min(bounds_min.y, by), Min(bounds_min.z, bz));
+        bounds_max = v3s32(Max(bounds_max.x, x1), Max(bounds_max.y, y1), Max(bounds_max.z, z1));
+        
+        if (plan.boxes_count < VOX_UPLOAD_BOXES_MAX) {
+          VOX_UploadBox *box = &plan.boxes[plan.boxes_count];
+          box->min = v3s32_scale(v3s32(bx, by, bz), VOX_BRICK_SIZE);
+          box->max = v3s32_scale(v3s32(x1, y1, z1), VOX_BRICK_SIZE);
+          plan.boxes_count += 1;
+        }
+        else {
+          overflow = 1;
+        }
+      }
+    }
+  }
+  
+  if (overflow) {
+    plan.boxes_count = 1;
+    plan.boxes[0].min = v3s32_scale(bounds_min, VOX_BRICK_SIZE);
+    plan.boxes[0].max = v3s32_scale(bounds_max, VOX_BRICK_SIZE);
+  }
+  
+  for (U32 idx = 0; idx < plan.boxes_count; idx += 1) {
+    V3S32 size = v3s32_sub(plan.boxes[idx].max, plan.boxes[idx].min);
+    plan.voxels_count += (U64)size.x*size.y*size.z;
+  }
+  
+  return plan;
+}
+
+function VOX_UploadSource
+vox_upload_source_from_box(Arena *arena, void *texels, U64 texel_size, VOX_UploadBox *box)
+{
+  VOX_UploadSource result = {0};
+  
+#if VOX_CHUNK_LAYOUT == VOX_CHUNK_LAYOUT_LINEAR
+  // Pitches stay those of the whole chunk
+  result.data = (U8 *)texels + texel_size*vox_idx_from_local_coord(box->min);
+  result.row_pitch = (U32)(texel_size*VOX_SLICE_SIZE);
+  result.depth_pitch = result.row_pitch*VOX_SLICE_SIZE;
+#else
+  V3S32 size = v3s32_sub(box->max, box->min);
+  U8 *dst = (U8 *)arena_push_nozero(arena, texel_size*size.x*size.y*size.z);
+  result.data = dst;
+  result.row_pitch = (U32)(texel_size*size.x);
+  result.depth_pitch = result.row_pitch*(U32)size.y;
+  
+  for (S32 z = box->min.z; z < box->max.z; z += 1) {
+    for (S32 y = box->min.y; y < box->max.y; y += 1) {
+      for (S32 x = box->min.x, count = 0; x < box->max.x; x += count) {
+        V3S32 coord = v3s32(x, y, z);
+        count = vox_idx_run_from_local_coord(coord, box->max.x - x);
+        MemoryCopy(dst, (U8 *)texels + texel_size*vox_idx_from_local_coord(coord), texel_size*count);
+        dst += texel_size*count;
+      }
+    }
+  }
+#endif
+  
+  return result;
+}
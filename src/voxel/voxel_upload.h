@@ -0,0 +1,45 @@
+#pragma once
+
+// NOTE: Backend-agnostic planning of partial chunk uploads. Each chunk keeps a
+// dirty mask with one bit per 4^3 brick (same layout as the occupancy summary)
+// that edits set and the renderer clears at the end of every frame, once the
+// caches and the upload have read it (see vox_world_clear_dirty_bricks). The planner
+// turns the mask into a small set of boxes covering exactly the dirty bricks,
+// which a backend can upload with e.g. D3D11_BOX updates.
+
+// Past this many boxes the per-call overhead outweighs the saved bandwidth, so
+// the plan falls back to the dirty bricks' bounding box.
+#define VOX_UPLOAD_BOXES_MAX 16
+
+// Box in local voxel coordinates of a chunk; `max` is exclusive.
+struct VOX_UploadBox {
+  V3S32 min;
+  V3S32 max;
+};
+
+struct VOX_UploadPlan {
+  U32 boxes_count;
+  VOX_UploadBox boxes[VOX_UPLOAD_BOXES_MAX];
+  U64 voxels_count;
+};
+
+// A box's texels as a backend reads them: `data` is the box's first texel, and
+// rows and slices are `row_pitch` and `depth_pitch` bytes apart.
+struct VOX_UploadSource {
+  void *data;
+  U32 row_pitch;
+  U32 depth_pitch;
+};
+
+function void vox_dirty_bricks_mark(U64 *dirty_bricks, V3S32 local_coord);
+function void vox_dirty_bricks_mark_all(U64 *dirty_bricks);
+function void vox_dirty_bricks_clear(U64 *dirty_bricks);
+function B32 vox_dirty_bricks_any(U64 *dirty_bricks);
+
+function VOX_UploadPlan vox_upload_plan_from_dirty_bricks(U64 *dirty_bricks);
+
+// Where to upload one box of a chunk-sized array from (voxels, light texels),
+// whose elements are `texel_size` bytes in the chunk's layout. Linear chunks are
+// read in place. For other layouts the box is gathered into `arena` first, since
+// textures are linear.
+function VOX_UploadSource vox_upload_source_from_box(Arena *arena, void *texels, U64 texel_size, VOX_UploadBox *box);
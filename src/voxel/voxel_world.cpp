@@ -0,0 +1,419 @@
+//
+// Coordinate helpers
+//
+
+function U64
+vox_hash_from_chunk_coord(V3S32 chunk_coord)
+{
+  // Spatial hash from "Optimized Spatial Hashing for Collision Detection of
+  // Deformable Objects" (Teschner et al.)
+  U64 result =
+    ((U64)(U32)chunk_coord.x * 73856093llu) ^
+    ((U64)(U32)chunk_coord.y * 19349663llu) ^
+    ((U64)(U32)chunk_coord.z * 83492791llu);
+  return result;
+}
+
+function S32
+vox_floor_div(S32 a, S32 b)
+{
+  S32 result = a / b;
+  if ((a % b != 0) && ((a < 0) != (b < 0))) {
+    result -= 1;
+  }
+  return result;
+}
+
+function V3S32
+vox_chunk_coord_from_voxel_coord(V3S32 voxel_coord)
+{
+  V3S32 result = {0};
+  result.x = vox_floor_div(voxel_coord.x, VOX_SLICE_SIZE);
+  result.y = vox_floor_div(voxel_coord.y, VOX_SLICE_SIZE);
+  result.z = vox_floor_div(voxel_coord.z, VOX_SLICE_SIZE);
+  return result;
+}
+
+function V3S32
+vox_local_coord_from_voxel_coord(V3S32 voxel_coord)
+{
+  V3S32 chunk_coord = vox_chunk_coord_from_voxel_coord(voxel_coord);
+  V3S32 result = v3s32_sub(voxel_coord, v3s32_scale(chunk_coord, VOX_SLICE_SIZE));
+  return result;
+}
+
+// Every third bit of a Morton code belongs to the same axis, x lowest
+#define VOX_MORTON_MASK_X 0x1249
+#define VOX_MORTON_MASK_Y 0x2492
+#define VOX_MORTON_MASK_Z 0x4924
+
+// Coordinate bits spread three apart
+global U16 vox_morton_spread[VOX_SLICE_SIZE] = {
+  0x0000, 0x0001, 0x0008, 0x0009, 0x0040, 0x0041, 0x0048, 0x0049,
+  0x0200, 0x0201, 0x0208, 0x0209, 0x0240, 0x0241, 0x0248, 0x0249,
+  0x1000, 0x1001, 0x1008, 0x1009, 0x1040, 0x1041, 0x1048, 0x1049,
+  0x1200, 0x1201, 0x1208, 0x1209, 0x1240, 0x1241, 0x1248, 0x1249,
+};
+
+// Six code bits to two bits of each axis: x | y << 2 | z << 4
+global U8 vox_morton_compact[64] = {
+  0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15, 0x02, 0x03, 0x06, 0x07, 0x12, 0x13, 0x16, 0x17,
+  0x08, 0x09, 0x0c, 0x0d, 0x18, 0x19, 0x1c, 0x1d, 0x0a, 0x0b, 0x0e, 0x0f, 0x1a, 0x1b, 0x1e, 0x1f,
+  0x20, 0x21, 0x24, 0x25, 0x30, 0x31, 0x34, 0x35, 0x22, 0x23, 0x26, 0x27, 0x32, 0x33, 0x36, 0x37,
+  0x28, 0x29, 0x2c, 0x2d, 0x38, 0x39, 0x3c, 0x3d, 0x2a, 0x2b, 0x2e, 0x2f, 0x3a, 0x3b, 0x3e, 0x3f,
+};
+
+function U32
+vox_morton_from_local_coord(V3S32 local_coord)
+{
+#if VOX_MORTON_BMI2
+  U32 result =
+    _pdep_u32((U32)local_coord.x, VOX_MORTON_MASK_X) |
+    _pdep_u32((U32)local_coord.y, VOX_MORTON_MASK_Y) |
+    _pdep_u32((U32)local_coord.z, VOX_MORTON_MASK_Z);
+#else
+  U32 result =
+    (U32)vox_morton_spread[local_coord.x] |
+    (U32)vox_morton_spread[local_coord.y] << 1 |
+    (U32)vox_morton_spread[local_coord.z] << 2;
+#endif
+  return result;
+}
+
+function V3S32
+vox_local_coord_from_morton(U32 code)
+{
+  V3S32 result = {0};
+#if VOX_MORTON_BMI2
+  result.x = (S32)_pext_u32(code, VOX_MORTON_MASK_X);
+  result.y = (S32)_pext_u32(code, VOX_MORTON_MASK_Y);
+  result.z = (S32)_pext_u32(code, VOX_MORTON_MASK_Z);
+#else
+  U32 lo = vox_morton_compact[code & 63];
+  U32 mid = vox_morton_compact[(code >> 6) & 63];
+  U32 hi = vox_morton_compact[(code >> 12) & 63];
+  for (U32 axis = 0; axis < 3; axis += 1) {
+    U32 shift = axis*2;
+    result.e[axis] = (S32)(((lo >> shift) & 3) | ((mid >> shift) & 3) << 2 | ((hi >> shift) & 3) << 4);
+  }
+#endif
+  return result;
+}
+
+function S32
+vox_idx_from_local_coord(V3S32 local_coord)
+{
+#if VOX_CHUNK_LAYOUT == VOX_CHUNK_LAYOUT_MORTON
+  S32 idx = (S32)vox_morton_from_local_coord(local_coord);
+#elif VOX_CHUNK_LAYOUT == VOX_CHUNK_LAYOUT_BRICKS
+  // vox_brick_idx_from_local_coord*64 + vox_brick_bit_from_local_coord, as bits
+  S32 idx =
+    (local_coord.x & 3) | (local_coord.y & 3) << 2 | (local_coord.z & 3) << 4 |
+    (local_coord.x >> 2) << 6 | (local_coord.y >> 2) << 9 | (local_coord.z >> 2) << 12;
+#else
+  S32 idx =
+    local_coord.x +
+    local_coord.y*VOX_SLICE_SIZE +
+    local_coord.z*VOX_SLICE_SIZE*VOX_SLICE_SIZE;
+#endif
+  return idx;
+}
+
+function V3S32
+vox_local_coord_from_idx(S32 idx)
+{
+  V3S32 result = {0};
+#if VOX_CHUNK_LAYOUT == VOX_CHUNK_LAYOUT_MORTON
+  result = vox_local_coord_from_morton((U32)idx);
+#elif VOX_CHUNK_LAYOUT == VOX_CHUNK_LAYOUT_BRICKS
+  result.x = (idx & 3) | ((idx >> 6) & 7) << 2;
+  result.y = ((idx >> 2) & 3) | ((idx >> 9) & 7) << 2;
+  result.z = ((idx >> 4) & 3) | ((idx >> 12) & 7) << 2;
+#else
+  result.x = idx % VOX_SLICE_SIZE;
+  result.y = (idx / VOX_SLICE_SIZE) % VOX_SLICE_SIZE;
+  result.z = idx / (VOX_SLICE_SIZE*VOX_SLICE_SIZE);
+#endif
+  return result;
+}
+
+function S32
+vox_idx_run_from_local_coord(V3S32 local_coord, S32 count)
+{
+#if VOX_CHUNK_LAYOUT == VOX_CHUNK_LAYOUT_MORTON
+  S32 result = Min(count, 2 - (local_coord.x & 1));
+#elif VOX_CHUNK_LAYOUT == VOX_CHUNK_LAYOUT_BRICKS
+  S32 result = Min(count, VOX_BRICK_SIZE - (local_coord.x & 3));
+#else
+  S32 result = Min(count, VOX_SLICE_SIZE - local_coord.x);
+#endif
+  return result;
+}
+
+function void
+vox_chunk_linear_from_layout(VOX_Chunk *dst, VOX_Chunk *src)
+{
+  S32 linear_idx = 0;
+  for (S32 z = 0; z < VOX_SLICE_SIZE; z += 1) {
+    for (S32 y = 0; y < VOX_SLICE_SIZE; y += 1) {
+      for (S32 x = 0; x < VOX_SLICE_SIZE; x += 1) {
+        dst->voxels[linear_idx++] = src->voxels[vox_idx_from_local_coord(v3s32(x, y, z))];
+      }
+    }
+  }
+}
+
+function void
+vox_chunk_layout_from_linear(VOX_Chunk *dst, VOX_Chunk *src)
+{
+  S32 linear_idx = 0;
+  for (S32 z = 0; z < VOX_SLICE_SIZE; z += 1) {
+    for (S32 y = 0; y < VOX_SLICE_SIZE; y += 1) {
+      for (S32 x = 0; x < VOX_SLICE_SIZE; x += 1) {
+        dst->voxels[vox_idx_from_local_coord(v3s32(x, y, z))] = src->voxels[linear_idx++];
+      }
+    }
+  }
+}
+
+//
+// World
+//
+
+function VOX_World *
+vox_world_alloc(void)
+{
+  VOX_World *world = 0;
+  
+  // Chunks are large (128 KiB each), so reserve enough address space up front
+  // for sizeable scenes; only pages that are actually touched get committed.
+  Arena *arena = arena_alloc(GiB(4llu));
+  world = ArenaPushStruct(arena, VOX_World);
+  world->arena = arena;
+  world->slots_count = VOX_WORLD_CHUNK_SLOTS;
+  world->slots = ArenaPushArray(arena, VOX_ChunkSlot, world->slots_count);
+  
+  return world;
+}
+
+function void
+vox_world_release(VOX_World *world)
+{
+  if (world) {
+    arena_release(world->arena);
+  }
+}
+
+function void
+vox_world_clear(VOX_World *world)
+{
+  for (VOX_ChunkNode *n = world->first, *next = 0; n != 0; n = next) {
+    next = n->next;
+    vox_world_chunk_release(world, n);
+  }
+  world->has_bounds = 0;
+}
+
+function VOX_ChunkNode *
+vox_world_chunk_from_coord(VOX_World *world, V3S32 chunk_coord)
+{
+  VOX_ChunkNode *result = 0;
+  
+  U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % world->slots_count;
+  VOX_ChunkSlot *slot = &world->slots[slot_idx];
+  for (VOX_ChunkNode *n = slot->first; n != 0; n = n->hash_next) {
+    if (n->coord.x == chunk_coord.x && n->coord.y == chunk_coord.y && n->coord.z == chunk_coord.z) {
+      result = n;
+      break;
+    }
+  }
+  
+  return result;
+}
+
+function VOX_ChunkNode *
+vox_world_chunk_acquire(VOX_World *world, V3S32 chunk_coord)
+{
+  VOX_ChunkNode *node = vox_world_chunk_from_coord(world, chunk_coord);
+  
+  if (!node) {
+    node = world->free;
+    if (node) {
+      SLLStackPop(world->free);
+      MemoryZeroStruct(node);
+    }
+    else {
+      node = ArenaPushStruct(world->arena, VOX_ChunkNode);
+    }
+    node->coord = chunk_coord;
+    
+    // The chunk's contents are new, so all of it needs uploading.
+    vox_dirty_bricks_mark_all(node->dirty_bricks);
+    
+    U64 slot_idx = vox_hash_from_chunk_coord(chunk_coord) % world->slots_count;
+    VOX_ChunkSlot *slot = &world->slots[slot_idx];
+    DLLPushBackNP(slot->first, slot->last, node, hash_next, hash_prev);
+    DLLPushBack(world->first, world->last, node);
+    world->chunks_count += 1;
+    
+    if (!world->has_bounds) {
+      world->chunk_min = chunk_coord;
+      world->chunk_max = chunk_coord;
+      world->has_bounds = 1;
+    }
+    else {
+      world->chunk_min = v3s32(Min(world->chunk_min.x, chunk_coord.x), Min(world->chunk_min.y, chunk_coord.y), Min(world->chunk_min.z, chunk_coord.z));
+      world->chunk_max = v3s32(Max(world->chunk_max.x, chunk_coord.x), Max(world->chunk_max.y, chunk_coord.y), Max(world->chunk_max.z, chunk_coord.z));
+    }
+  }
+  
+  return node;
+}
+
+function void
+vox_world_chunk_release(VOX_World *world, VOX_ChunkNode *node)
+{
+  U64 slot_idx = vox_hash_from_chunk_coord(node->coord) % world->slots_count;
+  VOX_ChunkSlot *slot = &world->slots[slot_idx];
+  DLLRemoveNP(slot->first, slot->last, node, hash_next, hash_prev);
+  DLLRemove(world->first, world->last, node);
+  world->chunks_count -= 1;
+  
+  SLLStackPush(world->free, node);
+}
+
+function VOX_Voxel
+vox_world_get_voxel(VOX_World *world, V3S32 voxel_coord)
+{
+  VOX_Voxel result = {0};
+  
+  V3S32 chunk_coord = vox_chunk_coord_from_voxel_coord(voxel_coord);
+  VOX_ChunkNode *node = vox_world_chunk_from_coord(world, chunk_coord);
+  if (node) {
+    V3S32 local_coord = vox_local_coord_from_voxel_coord(voxel_coord);
+    S32 idx = vox_idx_from_local_coord(local_coord);
+    result = *vox_get_voxel(&node->chunk, idx);
+  }
+  
+  return result;
+}
+
+function void
+vox_world_set_voxel(VOX_World *world, V3S32 voxel_coord, VOX_Voxel voxel)
+{
+  V3S32 chunk_coord = vox_chunk_coord_from_voxel_coord(voxel_coord);
+  
+  // Writing an empty voxel into a chunk that doesn't exist is a no-op, so only
+  // allocate when there is something to store.
+  VOX_ChunkNode *node = 0;
+  if (voxel.opacity > 0) {
+    node = vox_world_chunk_acquire(world, chunk_coord);
+  }
+  else {
+    node = vox_world_chunk_from_coord(world, chunk_coord);
+  }
+  
+  if (node) {
+    V3S32 local_coord = vox_local_coord_from_voxel_coord(voxel_coord);
+    S32 idx = vox_idx_from_local_coord(local_coord);
+    VOX_Voxel *v = vox_get_voxel(&node->chunk, idx);
+    
+    B32 was_solid = (v->opacity > 0);
+    B32 is_solid = (voxel.opacity > 0);
+    if (!vox_voxel_equal(*v, voxel)) {
+      vox_dirty_bricks_mark(node->dirty_bricks, local_coord);
+    }
+    *v = voxel;
+    
+    if (was_solid != is_solid) {
+      vox_occupancy_set(&node->occupancy, local_coord, is_solid);
+    }
+    
+    if (!was_solid && is_solid) {
+      node->solid_count += 1;
+    }
+    else if (was_solid && !is_solid) {
+      node->solid_count -= 1;
+      if (node->solid_count == 0) {
+        vox_world_chunk_release(world, node);
+      }
+    }
+  }
+}
+
+function void
+vox_world_rebuild_occupancy_work(Arena *scratch, void *user, U64 first, U64 opl)
+{
+  VOX_ChunkNode **nodes = (VOX_ChunkNode **)user;
+  for (U64 idx = first; idx < opl; idx += 1) {
+    VOX_ChunkNode *node = nodes[idx];
+    node->solid_count = vox_occupancy_build(&node->occupancy, &node->chunk);
+    vox_dirty_bricks_mark_all(node->dirty_bricks);
+  }
+}
+
+function void
+vox_world_rebuild_occupancy(VOX_World *world)
+{
+  TempArena scratch = arena_scratch_begin(0, 0);
+  
+  U32 nodes_count = world->chunks_count;
+  VOX_ChunkNode **nodes = ArenaPushArray(scratch.arena, VOX_ChunkNode *, nodes_count);
+  {
+    U32 idx = 0;
+    for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+      nodes[idx++] = n;
+    }
+  }
+  
+  async_parallel_for(nodes_count, 1, vox_world_rebuild_occupancy_work, nodes);
+  
+  for (U32 idx = 0; idx < nodes_count; idx += 1) {
+    if (nodes[idx]->solid_count == 0) {
+      vox_world_chunk_release(world, nodes[idx]);
+    }
+  }
+  
+  arena_scratch_end(scratch);
+}
+
+function void
+vox_world_clear_dirty_bricks(VOX_World *world)
+{
+  for (VOX_ChunkNode *n = world->first; n != 0; n = n->next) {
+    vox_dirty_bricks_clear(n->dirty_bricks);
+  }
+}
+
+// Fills chunk (0,0,0) with solid voxels; the scene the editor starts with.
+function void
+vox_world_make_test_scene(VOX_World *world)
+{
+  for (S32 z = 0; z < VOX_SLICE_SIZE; z += 1) {
+    for (S32 y = 0; y < VOX_SLICE_SIZE; y += 1) {
+      for (S32 x = 0; x < VOX_SLICE_SIZE; x += 1) {
+        V3S32 coord = v3s32(x, y, z);
+        S32 voxel_idx = vox_idx_from_local_coord(coord);
+        
+        VOX_Voxel v = {0};
+        v.opacity = 155;
+        v.color = 2;
+        
+        v.id0 = (U8)((voxel_idx >> 8) & 255);
+        v.id1 = (U8)(voxel_idx & 255);
+#if 0
+        if (voxel_idx >= VOX_CHUNK_SIZE/8) {
+          v.color = 0;
+        }
+        if (voxel_idx >= VOX_CHUNK_SIZE/4) {
+          v.color = 3;
+        }
+        if (voxel_idx >= VOX_CHUNK_SIZE/2) {
+          v.color = 1;
+        }
+#endif
+        vox_world_set_voxel(world, coord, v);
+      }
+    }
+  }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// NOTE: The world is a sparse set of chunks keyed by chunk coordinate. Chunks are
+// allocated lazily on the first non-empty write and returned to a free list once
+// their last solid voxel is removed, so memory scales with the occupied volume
+// rather than with the bounding box of the scene.
+
+#define VOX_WORLD_CHUNK_SLOTS 1024
+
+struct VOX_ChunkNode {
+  // World chunk list
+  VOX_ChunkNode *next;
+  VOX_ChunkNode *prev;
+  
+  // Hash slot chain
+  VOX_ChunkNode *hash_next;
+  VOX_ChunkNode *hash_prev;
+  
+  V3S32 coord;
+  U32 solid_count;
+  VOX_Occupancy occupancy;
+  U64 dirty_bricks[VOX_BRICK_SUMMARY_WORDS]; // Bricks edited since the end of the last frame
+  VOX_Chunk chunk;
+};
+
+struct VOX_ChunkSlot {
+  VOX_ChunkNode *first;
+  VOX_ChunkNode *last;
+};
+
+struct VOX_World {
+  Arena *arena;
+  
+  VOX_ChunkSlot *slots;
+  U32 slots_count;
+  
+  VOX_ChunkNode *first;
+  VOX_ChunkNode *last;
+  U32 chunks_count;
+  
+  // Conservative bounds of all chunks ever allocated, in chunk coordinates.
+  // Only grows; used to terminate rays that have left the world.
+  B32 has_bounds;
+  V3S32 chunk_min;
+  V3S32 chunk_max;
+  
+  VOX_ChunkNode *free;
+};
+
+function VOX_World *vox_world_alloc(void);
+function void vox_world_release(VOX_World *world);
+function void vox_world_clear(VOX_World *world);
+
+function VOX_ChunkNode *vox_world_chunk_from_coord(VOX_World *world, V3S32 chunk_coord);
+function VOX_ChunkNode *vox_world_chunk_acquire(VOX_World *world, V3S32 chunk_coord);
+function void vox_world_chunk_release(VOX_World *world, VOX_ChunkNode *node);
+
+function VOX_Voxel vox_world_get_voxel(VOX_World *world, V3S32 voxel_coord);
+function void vox_world_set_voxel(VOX_World *world, V3S32 voxel_coord, VOX_Voxel voxel);
+
+// For code that writes chunk voxels directly: rebuilds occupancy and solid counts
+// of every chunk in parallel, marks them dirty and releases chunks left empty.
+function void vox_world_rebuild_occupancy(VOX_World *world);
+
+// Ends a frame's edits. The light, distance, LOD and mesh caches and the chunk
+// upload all read the dirty bricks without clearing them, so the renderer calls
+// this once every one of them has run; a chunk left dirty would be rebuilt by
+// all of them on every frame.
+function void vox_world_clear_dirty_bricks(VOX_World *world);
+
+function void vox_world_make_test_scene(VOX_World *world);
+
+//
+// Coordinate helpers
+//
+
+function U64 vox_hash_from_chunk_coord(V3S32 chunk_coord);
+function V3S32 vox_chunk_coord_from_voxel_coord(V3S32 voxel_coord);
+function V3S32 vox_local_coord_from_voxel_coord(V3S32 voxel_coord);
+// Index of a voxel within its chunk, in the order VOX_CHUNK_LAYOUT picks
+function S32 vox_idx_from_local_coord(V3S32 local_coord);
+function V3S32 vox_local_coord_from_idx(S32 idx);
+// How many of the `count` voxels from `local_coord` along +x follow each other in
+// memory: the whole row for linear chunks, 4 for bricks and 2 for Morton codes
+function S32 vox_idx_run_from_local_coord(V3S32 local_coord, S32 count);
+
+// Reorders a chunk's voxels into linear order and back (a copy for linear chunks)
+function void vox_chunk_linear_from_layout(VOX_Chunk *dst, VOX_Chunk *src);
+function void vox_chunk_layout_from_linear(VOX_Chunk *dst, VOX_Chunk *src);